@@ -51,7 +51,9 @@
 
 #include <math.h>
 #include <string.h>
+#include <errno.h>
 #include <glib/gprintf.h>
+#include <glib/gstdio.h>
 
 #include <gst/base/base.h>
 
@@ -88,11 +90,16 @@ enum
   PROP_METADATA,
   PROP_STREAMINFO,
   PROP_MAX_GAP_TIME,
-  PROP_MAX_BACKTRACK_DISTANCE
+  PROP_MAX_BACKTRACK_DISTANCE,
+  PROP_SEEK_INDEX_DIR,
+  PROP_READ_AHEAD_SIZE,
+  PROP_STATS
 };
 
 #define DEFAULT_MAX_GAP_TIME           (2 * GST_SECOND)
 #define DEFAULT_MAX_BACKTRACK_DISTANCE 30
+#define DEFAULT_SEEK_INDEX_DIR         NULL
+#define DEFAULT_READ_AHEAD_SIZE        GST_MATROSKA_READ_AHEAD_SIZE_DEFAULT
 #define INVALID_DATA_THRESHOLD         (2 * 1024 * 1024)
 
 static GstStaticPadTemplate sink_templ = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -216,6 +223,7 @@ gst_matroska_demux_finalize (GObject * object)
 
   gst_matroska_read_common_finalize (&demux->common);
   gst_flow_combiner_free (demux->flowcombiner);
+  g_free (demux->seek_index_dir);
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -248,6 +256,57 @@ gst_matroska_demux_class_init (GstMatroskaDemuxClass * klass)
           0, G_MAXUINT, DEFAULT_MAX_BACKTRACK_DISTANCE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMatroskaDemux:seek-index-dir:
+   *
+   * Directory in which the positions of the clusters found while seeking
+   * in local files without cues are saved, so that later seeks in the
+   * same file don't have to search for them again.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_SEEK_INDEX_DIR,
+      g_param_spec_string ("seek-index-dir", "Seek index directory",
+          "Directory to save and load cluster positions of local files "
+          "without cues in (NULL = disabled)", DEFAULT_SEEK_INDEX_DIR,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMatroskaDemux:read-ahead-size:
+   *
+   * Size of the blocks read from upstream in pull mode. Element headers
+   * and frames are parsed from these blocks, so larger blocks mean fewer
+   * but larger reads, which is faster on network or FUSE backed sources.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_READ_AHEAD_SIZE,
+      g_param_spec_uint ("read-ahead-size", "Read ahead size",
+          "Size of the blocks to read from upstream in pull mode (in bytes)",
+          4096, 64 * 1024 * 1024, DEFAULT_READ_AHEAD_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMatroskaDemux:stats:
+   *
+   * Various statistics of the last run in pull mode. This property returns
+   * a GstStructure with name application/x-matroska-demux-stats with the
+   * following fields:
+   *
+   * * #guint64 `read-ahead-hits`: the number of reads served from the
+   *   block read ahead from upstream.
+   * * #guint64 `read-ahead-misses`: the number of reads that needed a new
+   *   block to be pulled from upstream.
+   *
+   * The counters are reset when going from READY to PAUSED.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Various statistics", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_matroska_demux_change_state);
   gstelement_class->send_event =
@@ -298,6 +357,7 @@ gst_matroska_demux_init (GstMatroskaDemux * demux)
   /* property defaults */
   demux->max_gap_time = DEFAULT_MAX_GAP_TIME;
   demux->max_backtrack_distance = DEFAULT_MAX_BACKTRACK_DISTANCE;
+  demux->seek_index_dir = g_strdup (DEFAULT_SEEK_INDEX_DIR);
 
   GST_OBJECT_FLAG_SET (demux, GST_ELEMENT_FLAG_INDEXABLE);
 
@@ -332,6 +392,14 @@ gst_matroska_demux_reset (GstElement * element)
     demux->clusters = NULL;
   }
 
+  if (demux->cluster_index) {
+    g_array_free (demux->cluster_index, TRUE);
+    demux->cluster_index = NULL;
+  }
+  demux->cluster_index_dirty = FALSE;
+  g_free (demux->seek_index_file);
+  demux->seek_index_file = NULL;
+
   g_list_foreach (demux->seek_parsed,
       (GFunc) gst_matroska_read_common_free_parsed_el, NULL);
   g_list_free (demux->seek_parsed);
@@ -2090,6 +2158,211 @@ gst_matroska_cluster_compare (gint64 * i1, gint64 * i2)
     return 0;
 }
 
+/* Three states to express: starts with I-frame, starts with delta, don't know */
+typedef enum
+{
+  CLUSTER_STATUS_NONE = 0,
+  CLUSTER_STATUS_STARTS_WITH_KEYFRAME,
+  CLUSTER_STATUS_STARTS_WITH_DELTAUNIT,
+} ClusterStatus;
+
+typedef struct
+{
+  guint64 offset;
+  guint64 size;
+  guint64 prev_size;
+  GstClockTime time;
+  ClusterStatus status;
+} ClusterInfo;
+
+static gint
+gst_matroska_cluster_info_compare_offset (const ClusterInfo * c,
+    const guint64 * offset, gpointer user_data)
+{
+  if (c->offset < *offset)
+    return -1;
+  else if (c->offset > *offset)
+    return 1;
+  else
+    return 0;
+}
+
+static gint
+gst_matroska_cluster_info_compare_time (const ClusterInfo * c,
+    const GstClockTime * time, gpointer user_data)
+{
+  if (c->time < *time)
+    return -1;
+  else if (c->time > *time)
+    return 1;
+  else
+    return 0;
+}
+
+/* returns the position in the cluster index of the last known cluster
+ * starting at or before @offset, or -1 */
+static gint
+gst_matroska_demux_cluster_index_find (GstMatroskaDemux * demux,
+    guint64 offset)
+{
+  ClusterInfo *c;
+
+  if (!demux->cluster_index || demux->cluster_index->len == 0)
+    return -1;
+
+  c = gst_util_array_binary_search (demux->cluster_index->data,
+      demux->cluster_index->len, sizeof (ClusterInfo),
+      (GCompareDataFunc) gst_matroska_cluster_info_compare_offset,
+      GST_SEARCH_MODE_BEFORE, &offset, NULL);
+  if (!c)
+    return -1;
+
+  return c - (ClusterInfo *) demux->cluster_index->data;
+}
+
+/* records @cluster in the cluster index, or completes what is known about
+ * it if it is already there */
+static void
+gst_matroska_demux_cluster_index_add (GstMatroskaDemux * demux,
+    const ClusterInfo * cluster)
+{
+  ClusterInfo *c, *other;
+  gint i;
+
+  if (cluster->time == GST_CLOCK_TIME_NONE)
+    return;
+
+  if (G_UNLIKELY (!demux->cluster_index))
+    demux->cluster_index = g_array_new (FALSE, FALSE, sizeof (ClusterInfo));
+
+  i = gst_matroska_demux_cluster_index_find (demux, cluster->offset);
+  if (i >= 0 &&
+      g_array_index (demux->cluster_index, ClusterInfo, i).offset ==
+      cluster->offset) {
+    c = &g_array_index (demux->cluster_index, ClusterInfo, i);
+    if (c->size == 0 && cluster->size > 0) {
+      c->size = cluster->size;
+      demux->cluster_index_dirty = TRUE;
+    }
+    if (c->prev_size == 0 && cluster->prev_size > 0) {
+      c->prev_size = cluster->prev_size;
+      demux->cluster_index_dirty = TRUE;
+    }
+    if (c->status == CLUSTER_STATUS_NONE &&
+        cluster->status != CLUSTER_STATUS_NONE) {
+      c->status = cluster->status;
+      demux->cluster_index_dirty = TRUE;
+    }
+  } else {
+    GST_LOG_OBJECT (demux, "adding cluster @ %" G_GUINT64_FORMAT ", time %"
+        GST_TIME_FORMAT " to cluster index", cluster->offset,
+        GST_TIME_ARGS (cluster->time));
+    i++;
+    g_array_insert_vals (demux->cluster_index, i, cluster, 1);
+    c = &g_array_index (demux->cluster_index, ClusterInfo, i);
+    demux->cluster_index_dirty = TRUE;
+  }
+
+  /* clusters of unknown size, as written by live muxers, can still be
+   * sized using the prev size of the cluster following them */
+  if (c->prev_size > 0 && i > 0) {
+    other = &g_array_index (demux->cluster_index, ClusterInfo, i - 1);
+    if (other->size == 0 && other->offset + c->prev_size == c->offset) {
+      other->size = c->prev_size;
+      demux->cluster_index_dirty = TRUE;
+    }
+  }
+  if (c->size == 0 && i + 1 < (gint) demux->cluster_index->len) {
+    other = &g_array_index (demux->cluster_index, ClusterInfo, i + 1);
+    if (other->prev_size > 0 && other->offset - other->prev_size == c->offset) {
+      c->size = other->prev_size;
+      demux->cluster_index_dirty = TRUE;
+    }
+  }
+}
+
+/* records the cluster being parsed in the cluster index */
+static void
+gst_matroska_demux_cluster_index_add_current (GstMatroskaDemux * demux)
+{
+  ClusterInfo cluster = { 0, };
+
+  if (demux->streaming || demux->cluster_time == GST_CLOCK_TIME_NONE)
+    return;
+
+  cluster.offset = demux->cluster_offset;
+  if (demux->next_cluster_offset > demux->cluster_offset)
+    cluster.size = demux->next_cluster_offset - cluster.offset;
+  cluster.prev_size = demux->cluster_prevsize;
+  cluster.time = demux->cluster_time * demux->common.time_scale;
+  gst_matroska_demux_cluster_index_add (demux, &cluster);
+}
+
+/* returns the known cluster covering @offset, or NULL */
+static ClusterInfo *
+gst_matroska_demux_cluster_index_get_containing (GstMatroskaDemux * demux,
+    guint64 offset)
+{
+  ClusterInfo *c;
+  gint i;
+
+  i = gst_matroska_demux_cluster_index_find (demux, offset);
+  if (i < 0)
+    return NULL;
+
+  c = &g_array_index (demux->cluster_index, ClusterInfo, i);
+  if (c->size == 0 || offset >= c->offset + c->size)
+    return NULL;
+
+  return c;
+}
+
+/* returns the known cluster directly following @cluster, or NULL */
+static ClusterInfo *
+gst_matroska_demux_cluster_index_get_next (GstMatroskaDemux * demux,
+    ClusterInfo * cluster)
+{
+  ClusterInfo *next;
+  guint i;
+
+  i = cluster - (ClusterInfo *) demux->cluster_index->data;
+  if (cluster->size == 0 || i + 1 >= demux->cluster_index->len)
+    return NULL;
+
+  next = &g_array_index (demux->cluster_index, ClusterInfo, i + 1);
+  if (next->offset != cluster->offset + cluster->size)
+    return NULL;
+
+  return next;
+}
+
+/* looks up the last known cluster starting at or before @time in @before,
+ * and the known cluster following it in @after */
+static void
+gst_matroska_demux_cluster_index_lookup_time (GstMatroskaDemux * demux,
+    GstClockTime time, ClusterInfo ** before, ClusterInfo ** after)
+{
+  ClusterInfo *c;
+  guint i;
+
+  *before = *after = NULL;
+
+  if (!demux->cluster_index || demux->cluster_index->len == 0)
+    return;
+
+  c = gst_util_array_binary_search (demux->cluster_index->data,
+      demux->cluster_index->len, sizeof (ClusterInfo),
+      (GCompareDataFunc) gst_matroska_cluster_info_compare_time,
+      GST_SEARCH_MODE_BEFORE, &time, NULL);
+  if (!c)
+    return;
+
+  *before = c;
+  i = c - (ClusterInfo *) demux->cluster_index->data;
+  if (i + 1 < demux->cluster_index->len)
+    *after = &g_array_index (demux->cluster_index, ClusterInfo, i + 1);
+}
+
 /* searches for a cluster start from @pos,
  * return GST_FLOW_OK and cluster position in @pos if found */
 static GstFlowReturn
@@ -2135,6 +2408,31 @@ gst_matroska_demux_search_cluster (GstMatroskaDemux * demux, gint64 * pos,
     }
   }
 
+  /* no need to scan when we already know the clusters around @pos */
+  if (forward) {
+    ClusterInfo *c;
+
+    c = gst_matroska_demux_cluster_index_get_containing (demux, newpos);
+    if (c && c->offset != newpos)
+      c = gst_matroska_demux_cluster_index_get_next (demux, c);
+    if (c) {
+      GST_DEBUG_OBJECT (demux,
+          "known cluster at offset %" G_GUINT64_FORMAT, c->offset);
+      newpos = c->offset;
+      goto exit;
+    }
+  } else if (newpos > 0) {
+    ClusterInfo *c;
+
+    c = gst_matroska_demux_cluster_index_get_containing (demux, newpos - 1);
+    if (c) {
+      GST_DEBUG_OBJECT (demux,
+          "known cluster at offset %" G_GUINT64_FORMAT, c->offset);
+      newpos = c->offset;
+      goto exit;
+    }
+  }
+
   /* read in at newpos and scan for ebml cluster id */
   oldpos = oldlength = -1;
   while (1) {
@@ -2253,23 +2551,6 @@ exit:
   return ret;
 }
 
-/* Three states to express: starts with I-frame, starts with delta, don't know */
-typedef enum
-{
-  CLUSTER_STATUS_NONE = 0,
-  CLUSTER_STATUS_STARTS_WITH_KEYFRAME,
-  CLUSTER_STATUS_STARTS_WITH_DELTAUNIT,
-} ClusterStatus;
-
-typedef struct
-{
-  guint64 offset;
-  guint64 size;
-  guint64 prev_size;
-  GstClockTime time;
-  ClusterStatus status;
-} ClusterInfo;
-
 static const gchar *
 cluster_status_get_nick (ClusterStatus status)
 {
@@ -2426,10 +2707,35 @@ out:
       GST_TIME_ARGS (cluster->time), cluster->size, cluster->prev_size,
       cluster_status_get_nick (cluster->status));
 
+  gst_matroska_demux_cluster_index_add (demux, cluster);
+
   /* return success as long as we could extract the minimum useful information */
   return cluster->time != GST_CLOCK_TIME_NONE;
 }
 
+/* like gst_matroska_demux_peek_cluster_info(), but avoids reading the
+ * cluster if the cluster index already has all the information */
+static gboolean
+gst_matroska_demux_get_cluster_info (GstMatroskaDemux * demux,
+    ClusterInfo * cluster, guint64 offset)
+{
+  gint i;
+
+  i = gst_matroska_demux_cluster_index_find (demux, offset);
+  if (i >= 0) {
+    ClusterInfo *c = &g_array_index (demux->cluster_index, ClusterInfo, i);
+
+    if (c->offset == offset && c->status != CLUSTER_STATUS_NONE) {
+      GST_LOG_OBJECT (demux, "Cluster @ %" G_GUINT64_FORMAT " is indexed",
+          offset);
+      *cluster = *c;
+      return TRUE;
+    }
+  }
+
+  return gst_matroska_demux_peek_cluster_info (demux, cluster, offset);
+}
+
 /* returns TRUE if the cluster offset was updated */
 static gboolean
 gst_matroska_demux_scan_back_for_keyframe_cluster (GstMatroskaDemux * demux,
@@ -2442,7 +2748,7 @@ gst_matroska_demux_scan_back_for_keyframe_cluster (GstMatroskaDemux * demux,
 
   GST_INFO_OBJECT (demux, "Checking if cluster starts with keyframe");
   while (off > first_cluster_offset) {
-    if (!gst_matroska_demux_peek_cluster_info (demux, &cluster, off)) {
+    if (!gst_matroska_demux_get_cluster_info (demux, &cluster, off)) {
       GST_LOG_OBJECT (demux,
           "Couldn't get info on cluster @ %" G_GUINT64_FORMAT, off);
       break;
@@ -2567,6 +2873,34 @@ gst_matroska_demux_search_pos (GstMatroskaDemux * demux, GstClockTime time)
 
   maxpos = gst_matroska_read_common_get_length (&demux->common);
 
+  /* start from what we already know about the clusters around the target */
+  if (time != GST_CLOCK_TIME_NONE) {
+    ClusterInfo *before, *after;
+
+    gst_matroska_demux_cluster_index_lookup_time (demux, time, &before,
+        &after);
+    if (before && before->offset >= apos && before->time >= atime) {
+      guint64 end = before->offset + before->size;
+
+      if (before->size > 0 && ((after && end == after->offset) ||
+              (maxpos != -1 && end == (guint64) maxpos))) {
+        GST_DEBUG_OBJECT (demux, "target is in known cluster at offset %"
+            G_GUINT64_FORMAT, before->offset);
+        cluster_offset = before->offset;
+        cluster_time = before->time;
+        goto found;
+      }
+      apos = before->offset;
+      atime = before->time;
+      if (after && after->time > time) {
+        opos = after->offset;
+        otime = after->time;
+      }
+      otime = MAX (otime, atime);
+      opos = MAX (opos, apos);
+    }
+  }
+
   /* invariants;
    * apos <= opos
    * atime <= otime
@@ -2730,6 +3064,7 @@ retry:
   cluster_offset = prev_cluster_offset;
   cluster_time = prev_cluster_time;
 
+found:
   /* If we have video and can easily backtrack, check if we landed on a cluster
    * that starts with a keyframe - and if not backtrack until we find one that
    * does. */
@@ -2758,6 +3093,181 @@ exit:
   return entry;
 }
 
+/* seek index files, named after the SHA1 of the file name, start with
+ * the magic, a version and the size and modification time of the file
+ * they were made for, followed by the number of clusters and the clusters,
+ * all little endian */
+#define SEEK_INDEX_MAGIC "GSTMKVIX"
+#define SEEK_INDEX_VERSION 1
+#define SEEK_INDEX_HEADER_SIZE (8 + 4 + 8 + 8 + 4)
+#define SEEK_INDEX_ENTRY_SIZE (8 + 8 + 8 + 8 + 1)
+
+static void
+gst_matroska_demux_load_seek_index (GstMatroskaDemux * demux)
+{
+  GstQuery *query;
+  GStatBuf st;
+  GstByteReader br;
+  GArray *clusters = NULL;
+  const guint8 *magic;
+  gchar *dir, *uri = NULL, *filename = NULL, *checksum, *basename;
+  gchar *contents = NULL;
+  gsize len;
+  guint64 file_size;
+  gint64 file_mtime;
+  guint32 version, n_clusters, i;
+
+  g_free (demux->seek_index_file);
+  demux->seek_index_file = NULL;
+
+  GST_OBJECT_LOCK (demux);
+  dir = g_strdup (demux->seek_index_dir);
+  GST_OBJECT_UNLOCK (demux);
+
+  if (!dir)
+    return;
+
+  query = gst_query_new_uri ();
+  if (gst_pad_peer_query (demux->common.sinkpad, query))
+    gst_query_parse_uri (query, &uri);
+  gst_query_unref (query);
+
+  if (uri)
+    filename = g_filename_from_uri (uri, NULL, NULL);
+  if (!filename || g_stat (filename, &st) != 0) {
+    GST_DEBUG_OBJECT (demux, "upstream is not a local file, no seek index");
+    goto done;
+  }
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, filename, -1);
+  basename = g_strconcat (checksum, ".mkvidx", NULL);
+  demux->seek_index_file = g_build_filename (dir, basename, NULL);
+  demux->seek_index_file_size = st.st_size;
+  demux->seek_index_file_mtime = st.st_mtime;
+  g_free (basename);
+  g_free (checksum);
+
+  if (!g_file_get_contents (demux->seek_index_file, &contents, &len, NULL)) {
+    GST_DEBUG_OBJECT (demux, "no seek index in %s", demux->seek_index_file);
+    goto done;
+  }
+
+  gst_byte_reader_init (&br, (const guint8 *) contents, len);
+  if (!gst_byte_reader_get_data (&br, 8, &magic) ||
+      memcmp (magic, SEEK_INDEX_MAGIC, 8) != 0 ||
+      !gst_byte_reader_get_uint32_le (&br, &version) ||
+      version != SEEK_INDEX_VERSION ||
+      !gst_byte_reader_get_uint64_le (&br, &file_size) ||
+      !gst_byte_reader_get_int64_le (&br, &file_mtime) ||
+      !gst_byte_reader_get_uint32_le (&br, &n_clusters) ||
+      gst_byte_reader_get_remaining (&br) / SEEK_INDEX_ENTRY_SIZE <
+      n_clusters)
+    goto invalid;
+
+  if (file_size != demux->seek_index_file_size ||
+      file_mtime != demux->seek_index_file_mtime) {
+    GST_INFO_OBJECT (demux, "file changed since seek index %s was made",
+        demux->seek_index_file);
+    goto done;
+  }
+
+  clusters = g_array_sized_new (FALSE, FALSE, sizeof (ClusterInfo),
+      n_clusters);
+  for (i = 0; i < n_clusters; i++) {
+    ClusterInfo cluster = { 0, };
+    guint8 status;
+
+    cluster.offset = gst_byte_reader_get_uint64_le_unchecked (&br);
+    cluster.size = gst_byte_reader_get_uint64_le_unchecked (&br);
+    cluster.prev_size = gst_byte_reader_get_uint64_le_unchecked (&br);
+    cluster.time = gst_byte_reader_get_uint64_le_unchecked (&br);
+    status = gst_byte_reader_get_uint8_unchecked (&br);
+
+    if (cluster.offset < demux->first_cluster_offset ||
+        cluster.offset + cluster.size > file_size ||
+        status > CLUSTER_STATUS_STARTS_WITH_DELTAUNIT)
+      goto invalid;
+    cluster.status = status;
+
+    g_array_append_val (clusters, cluster);
+  }
+
+  for (i = 0; i < clusters->len; i++)
+    gst_matroska_demux_cluster_index_add (demux,
+        &g_array_index (clusters, ClusterInfo, i));
+  /* nothing new to save yet */
+  demux->cluster_index_dirty = FALSE;
+
+  GST_INFO_OBJECT (demux, "loaded %u clusters from seek index %s",
+      n_clusters, demux->seek_index_file);
+  goto done;
+
+invalid:
+  GST_WARNING_OBJECT (demux, "ignoring invalid seek index %s",
+      demux->seek_index_file);
+
+done:
+  if (clusters)
+    g_array_free (clusters, TRUE);
+  g_free (contents);
+  g_free (filename);
+  g_free (uri);
+  g_free (dir);
+}
+
+static void
+gst_matroska_demux_save_seek_index (GstMatroskaDemux * demux)
+{
+  GstByteWriter bw;
+  GError *err = NULL;
+  gboolean res = TRUE;
+  guint8 *data;
+  gchar *dir;
+  guint size, i;
+
+  if (!demux->seek_index_file || !demux->cluster_index ||
+      !demux->cluster_index_dirty)
+    return;
+
+  gst_byte_writer_init_with_size (&bw, SEEK_INDEX_HEADER_SIZE +
+      demux->cluster_index->len * SEEK_INDEX_ENTRY_SIZE, FALSE);
+  res &= gst_byte_writer_put_data (&bw, (const guint8 *) SEEK_INDEX_MAGIC, 8);
+  res &= gst_byte_writer_put_uint32_le (&bw, SEEK_INDEX_VERSION);
+  res &= gst_byte_writer_put_uint64_le (&bw, demux->seek_index_file_size);
+  res &= gst_byte_writer_put_int64_le (&bw, demux->seek_index_file_mtime);
+  res &= gst_byte_writer_put_uint32_le (&bw, demux->cluster_index->len);
+  for (i = 0; i < demux->cluster_index->len; i++) {
+    ClusterInfo *c = &g_array_index (demux->cluster_index, ClusterInfo, i);
+
+    res &= gst_byte_writer_put_uint64_le (&bw, c->offset);
+    res &= gst_byte_writer_put_uint64_le (&bw, c->size);
+    res &= gst_byte_writer_put_uint64_le (&bw, c->prev_size);
+    res &= gst_byte_writer_put_uint64_le (&bw, c->time);
+    res &= gst_byte_writer_put_uint8 (&bw, c->status);
+  }
+  size = gst_byte_writer_get_size (&bw);
+  data = gst_byte_writer_reset_and_get_data (&bw);
+
+  dir = g_path_get_dirname (demux->seek_index_file);
+  if (!res) {
+    GST_WARNING_OBJECT (demux, "failed to serialize seek index");
+  } else if (g_mkdir_with_parents (dir, 0755) != 0) {
+    GST_WARNING_OBJECT (demux, "failed to create %s: %s", dir,
+        g_strerror (errno));
+  } else if (!g_file_set_contents (demux->seek_index_file,
+          (const gchar *) data, size, &err)) {
+    GST_WARNING_OBJECT (demux, "failed to save seek index: %s", err->message);
+    g_clear_error (&err);
+  } else {
+    GST_INFO_OBJECT (demux, "saved %u clusters to seek index %s",
+        demux->cluster_index->len, demux->seek_index_file);
+    demux->cluster_index_dirty = FALSE;
+  }
+
+  g_free (dir);
+  g_free (data);
+}
+
 static gboolean
 gst_matroska_demux_handle_seek_event (GstMatroskaDemux * demux,
     GstPad * pad, GstEvent * event)
@@ -5648,6 +6158,9 @@ gst_matroska_demux_parse_id (GstMatroskaDemux * demux, guint32 id,
             demux->common.state = GST_MATROSKA_READ_STATE_DATA;
             demux->first_cluster_offset = demux->common.offset;
 
+            if (!demux->streaming)
+              gst_matroska_demux_load_seek_index (demux);
+
             if (!demux->streaming &&
                 !GST_CLOCK_TIME_IS_VALID (demux->common.segment.duration)) {
               GstMatroskaIndex *last = NULL;
@@ -5718,6 +6231,8 @@ gst_matroska_demux_parse_id (GstMatroskaDemux * demux, guint32 id,
           /* record next cluster for recovery */
           if (read != G_MAXUINT64)
             demux->next_cluster_offset = demux->cluster_offset + read;
+          else
+            demux->next_cluster_offset = 0;
           /* eat cluster prefix */
           gst_matroska_demux_flush (demux, needed);
           break;
@@ -5736,6 +6251,8 @@ gst_matroska_demux_parse_id (GstMatroskaDemux * demux, guint32 id,
             demux->stream_last_time =
                 demux->cluster_time * demux->common.time_scale;
           }
+          /* and remember it for seeking */
+          gst_matroska_demux_cluster_index_add_current (demux);
 #if 0
           if (demux->common.element_index) {
             if (demux->common.element_index_writer_id == -1)
@@ -5848,6 +6365,7 @@ gst_matroska_demux_parse_id (GstMatroskaDemux * demux, guint32 id,
           GST_LOG_OBJECT (demux, "ClusterPrevSize: %" G_GUINT64_FORMAT, num);
           demux->cluster_prevsize = num;
           demux->seen_cluster_prevsize = TRUE;
+          gst_matroska_demux_cluster_index_add_current (demux);
           break;
         }
         case GST_MATROSKA_ID_POSITION:
@@ -7401,6 +7919,12 @@ gst_matroska_demux_change_state (GstElement * element,
 
   /* handle upwards state changes here */
   switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      GST_OBJECT_LOCK (demux);
+      demux->common.cache_hits = 0;
+      demux->common.cache_misses = 0;
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       break;
   }
@@ -7410,6 +7934,7 @@ gst_matroska_demux_change_state (GstElement * element,
   /* handle downwards state changes */
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_matroska_demux_save_seek_index (demux);
       gst_matroska_demux_reset (GST_ELEMENT (demux));
       break;
     default:
@@ -7439,6 +7964,17 @@ gst_matroska_demux_set_property (GObject * object,
       demux->max_backtrack_distance = g_value_get_uint (value);
       GST_OBJECT_UNLOCK (demux);
       break;
+    case PROP_SEEK_INDEX_DIR:
+      GST_OBJECT_LOCK (demux);
+      g_free (demux->seek_index_dir);
+      demux->seek_index_dir = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_READ_AHEAD_SIZE:
+      GST_OBJECT_LOCK (demux);
+      demux->common.read_ahead_size = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -7465,6 +8001,25 @@ gst_matroska_demux_get_property (GObject * object,
       g_value_set_uint (value, demux->max_backtrack_distance);
       GST_OBJECT_UNLOCK (demux);
       break;
+    case PROP_SEEK_INDEX_DIR:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_string (value, demux->seek_index_dir);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_READ_AHEAD_SIZE:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint (value, demux->common.read_ahead_size);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_STATS:
+      GST_OBJECT_LOCK (demux);
+      g_value_take_boxed (value,
+          gst_structure_new ("application/x-matroska-demux-stats",
+              "read-ahead-hits", G_TYPE_UINT64, demux->common.cache_hits,
+              "read-ahead-misses", G_TYPE_UINT64, demux->common.cache_misses,
+              NULL));
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
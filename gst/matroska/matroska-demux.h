@@ -129,6 +129,15 @@ typedef struct _GstMatroskaDemux {
 
   /* Cached upstream length (default G_MAXUINT64) */
   guint64	           cached_length;
+
+  /* clusters seen while playing and seeking in pull mode, sorted by
+   * offset, used to seek in files without cues */
+  GArray                  *cluster_index;
+  gboolean                 cluster_index_dirty;
+  gchar                   *seek_index_dir;
+  gchar                   *seek_index_file;
+  guint64                  seek_index_file_size;
+  gint64                   seek_index_file_mtime;
 } GstMatroskaDemux;
 
 typedef struct _GstMatroskaDemuxClass {
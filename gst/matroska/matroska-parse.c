@@ -3253,6 +3253,10 @@ gst_matroska_parse_change_state (GstElement * element,
 
   /* handle upwards state changes here */
   switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      parse->common.cache_hits = 0;
+      parse->common.cache_misses = 0;
+      break;
     default:
       break;
   }
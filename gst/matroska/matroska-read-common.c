@@ -2757,6 +2757,36 @@ gst_matroska_read_common_peek_adapter (GstMatroskaReadCommon * common, guint
   return GST_FLOW_OK;
 }
 
+static void
+gst_matroska_read_common_drop_cache (GstMatroskaReadCommon * common)
+{
+  if (common->cached_buffer) {
+    if (common->cached_data) {
+      gst_buffer_unmap (common->cached_buffer, &common->cached_map);
+      common->cached_data = NULL;
+    }
+    gst_buffer_unref (common->cached_buffer);
+    common->cached_buffer = NULL;
+  }
+}
+
+static void
+gst_matroska_read_common_get_cached (GstMatroskaReadCommon * common, guint64
+    offset, guint size, GstBuffer ** p_buf, guint8 ** bytes)
+{
+  if (p_buf)
+    *p_buf = gst_buffer_copy_region (common->cached_buffer,
+        GST_BUFFER_COPY_ALL, offset - common->cached_offset, size);
+  if (bytes) {
+    if (!common->cached_data) {
+      gst_buffer_map (common->cached_buffer, &common->cached_map,
+          GST_MAP_READ);
+      common->cached_data = common->cached_map.data;
+    }
+    *bytes = common->cached_data + offset - common->cached_offset;
+  }
+}
+
 /*
  * Calls pull_range for (offset,size) without advancing our offset
  */
@@ -2764,82 +2794,90 @@ GstFlowReturn
 gst_matroska_read_common_peek_bytes (GstMatroskaReadCommon * common, guint64
     offset, guint size, GstBuffer ** p_buf, guint8 ** bytes)
 {
+  GstBuffer *head = NULL;
   GstFlowReturn ret;
+  guint64 block_start, block_end, cache_end;
+  guint block_size;
 
-  /* Caching here actually makes much less difference than one would expect.
-   * We do it mainly to avoid pulling buffers of 1 byte all the time */
+  /* Element headers are only a few bytes, so read ahead in large blocks
+   * aligned to the block size and parse both the headers and the data
+   * following them from those, instead of pulling every few bytes */
   if (common->cached_buffer) {
-    guint64 cache_offset = GST_BUFFER_OFFSET (common->cached_buffer);
-    gsize cache_size = gst_buffer_get_size (common->cached_buffer);
-
-    if (cache_offset <= common->offset &&
-        (common->offset + size) <= (cache_offset + cache_size)) {
-      if (p_buf)
-        *p_buf = gst_buffer_copy_region (common->cached_buffer,
-            GST_BUFFER_COPY_ALL, common->offset - cache_offset, size);
-      if (bytes) {
-        if (!common->cached_data) {
-          gst_buffer_map (common->cached_buffer, &common->cached_map,
-              GST_MAP_READ);
-          common->cached_data = common->cached_map.data;
-        }
-        *bytes = common->cached_data + common->offset - cache_offset;
-      }
+    cache_end = common->cached_offset +
+        gst_buffer_get_size (common->cached_buffer);
+
+    if (common->cached_offset <= offset && offset + size <= cache_end) {
+      common->cache_hits++;
+      gst_matroska_read_common_get_cached (common, offset, size, p_buf, bytes);
       return GST_FLOW_OK;
     }
-    /* not enough data in the cache, free cache and get a new one */
-    if (common->cached_data) {
-      gst_buffer_unmap (common->cached_buffer, &common->cached_map);
-      common->cached_data = NULL;
-    }
-    gst_buffer_unref (common->cached_buffer);
-    common->cached_buffer = NULL;
+
+    /* keep the part of the cache we still need and only read what
+     * follows it */
+    if (common->cached_offset <= offset && offset < cache_end)
+      head = gst_buffer_copy_region (common->cached_buffer,
+          GST_BUFFER_COPY_MEMORY, offset - common->cached_offset,
+          cache_end - offset);
+    gst_matroska_read_common_drop_cache (common);
   }
 
-  /* refill the cache */
-  ret = gst_pad_pull_range (common->sinkpad, common->offset,
-      MAX (size, 64 * 1024), &common->cached_buffer);
+  common->cache_misses++;
+
+  block_size = MAX (common->read_ahead_size, 1);
+  block_start = head ? offset + gst_buffer_get_size (head) :
+      offset - offset % block_size;
+  block_end = offset + size + block_size - 1;
+  block_end -= block_end % block_size;
+
+  GST_LOG_OBJECT (common->sinkpad, "reading %" G_GUINT64_FORMAT " bytes "
+      "ahead at offset %" G_GUINT64_FORMAT " for %u bytes at offset %"
+      G_GUINT64_FORMAT, block_end - block_start, block_start, size, offset);
+
+  ret = gst_pad_pull_range (common->sinkpad, block_start,
+      block_end - block_start, &common->cached_buffer);
   if (ret != GST_FLOW_OK) {
     common->cached_buffer = NULL;
+    if (head)
+      gst_buffer_unref (head);
     return ret;
   }
 
-  if (gst_buffer_get_size (common->cached_buffer) >= size) {
-    if (p_buf)
-      *p_buf = gst_buffer_copy_region (common->cached_buffer,
-          GST_BUFFER_COPY_ALL, 0, size);
-    if (bytes) {
-      gst_buffer_map (common->cached_buffer, &common->cached_map, GST_MAP_READ);
-      common->cached_data = common->cached_map.data;
-      *bytes = common->cached_data;
-    }
+  if (head) {
+    common->cached_buffer = gst_buffer_append (head, common->cached_buffer);
+    common->cached_offset = offset;
+  } else {
+    common->cached_offset = block_start;
+  }
+
+  if (common->cached_offset + gst_buffer_get_size (common->cached_buffer) >=
+      offset + size) {
+    gst_matroska_read_common_get_cached (common, offset, size, p_buf, bytes);
     return GST_FLOW_OK;
   }
 
   /* Not possible to get enough data, try a last time with
    * requesting exactly the size we need */
-  gst_buffer_unref (common->cached_buffer);
-  common->cached_buffer = NULL;
+  gst_matroska_read_common_drop_cache (common);
 
-  ret =
-      gst_pad_pull_range (common->sinkpad, common->offset, size,
+  ret = gst_pad_pull_range (common->sinkpad, offset, size,
       &common->cached_buffer);
   if (ret != GST_FLOW_OK) {
     GST_DEBUG_OBJECT (common->sinkpad, "pull_range returned %d", ret);
+    common->cached_buffer = NULL;
     if (p_buf)
       *p_buf = NULL;
     if (bytes)
       *bytes = NULL;
     return ret;
   }
+  common->cached_offset = offset;
 
   if (gst_buffer_get_size (common->cached_buffer) < size) {
     GST_WARNING_OBJECT (common->sinkpad, "Dropping short buffer at offset %"
         G_GUINT64_FORMAT ": wanted %u bytes, got %" G_GSIZE_FORMAT " bytes",
-        common->offset, size, gst_buffer_get_size (common->cached_buffer));
+        offset, size, gst_buffer_get_size (common->cached_buffer));
 
-    gst_buffer_unref (common->cached_buffer);
-    common->cached_buffer = NULL;
+    gst_matroska_read_common_drop_cache (common);
     if (p_buf)
       *p_buf = NULL;
     if (bytes)
@@ -2847,14 +2885,7 @@ gst_matroska_read_common_peek_bytes (GstMatroskaReadCommon * common, guint64
     return GST_FLOW_EOS;
   }
 
-  if (p_buf)
-    *p_buf = gst_buffer_copy_region (common->cached_buffer,
-        GST_BUFFER_COPY_ALL, 0, size);
-  if (bytes) {
-    gst_buffer_map (common->cached_buffer, &common->cached_map, GST_MAP_READ);
-    common->cached_data = common->cached_map.data;
-    *bytes = common->cached_data;
-  }
+  gst_matroska_read_common_get_cached (common, offset, size, p_buf, bytes);
 
   return GST_FLOW_OK;
 }
@@ -3242,6 +3273,7 @@ gst_matroska_read_common_init (GstMatroskaReadCommon * ctx)
   ctx->toc = NULL;
   ctx->internal_toc = NULL;
   ctx->toc_updated = FALSE;
+  ctx->read_ahead_size = GST_MATROSKA_READ_AHEAD_SIZE_DEFAULT;
   ctx->cached_track_taglists =
       g_hash_table_new_full (NULL, NULL, NULL,
       (GDestroyNotify) gst_tag_list_unref);
@@ -3347,14 +3379,9 @@ gst_matroska_read_common_reset (GstElement * element,
   ctx->start_resync_offset = -1;
   ctx->state_to_restore = -1;
 
-  if (ctx->cached_buffer) {
-    if (ctx->cached_data) {
-      gst_buffer_unmap (ctx->cached_buffer, &ctx->cached_map);
-      ctx->cached_data = NULL;
-    }
-    gst_buffer_unref (ctx->cached_buffer);
-    ctx->cached_buffer = NULL;
-  }
+  GST_DEBUG_OBJECT (element, "read-ahead cache: %" G_GUINT64_FORMAT " hits, %"
+      G_GUINT64_FORMAT " misses", ctx->cache_hits, ctx->cache_misses);
+  gst_matroska_read_common_drop_cache (ctx);
 
   /* free chapters TOC if any */
   if (ctx->toc) {
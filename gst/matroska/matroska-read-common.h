@@ -33,6 +33,9 @@ G_BEGIN_DECLS
 
 GST_DEBUG_CATEGORY_EXTERN(matroskareadcommon_debug);
 
+/* size of the blocks read ahead in pull mode */
+#define GST_MATROSKA_READ_AHEAD_SIZE_DEFAULT (256 * 1024)
+
 typedef enum {
   GST_MATROSKA_READ_STATE_START,
   GST_MATROSKA_READ_STATE_SEGMENT,
@@ -100,6 +103,10 @@ typedef struct _GstMatroskaReadCommon {
   GstBuffer *cached_buffer;
   guint8 *cached_data;
   GstMapInfo cached_map;
+  guint64 cached_offset;
+  guint read_ahead_size;
+  guint64 cache_hits;
+  guint64 cache_misses;
 
   /* push and pull mode */
   guint64                  offset;
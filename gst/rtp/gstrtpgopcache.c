@@ -0,0 +1,145 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "gstrtpgopcache.h"
+
+void
+gst_rtp_gop_cache_init (GstRtpGopCache * cache)
+{
+  g_queue_init (&cache->buffers);
+  cache->bytes = 0;
+  cache->max_bytes = 0;
+  cache->access_units = TRUE;
+  cache->overflow = FALSE;
+  cache->num_gops = 0;
+  cache->num_overflows = 0;
+  cache->num_replays = 0;
+}
+
+void
+gst_rtp_gop_cache_clear (GstRtpGopCache * cache)
+{
+  GstBuffer *buffer;
+
+  while ((buffer = g_queue_pop_head (&cache->buffers)))
+    gst_buffer_unref (buffer);
+  cache->bytes = 0;
+  cache->overflow = FALSE;
+}
+
+void
+gst_rtp_gop_cache_set_max_bytes (GstRtpGopCache * cache, gsize max_bytes)
+{
+  cache->max_bytes = max_bytes;
+
+  if (cache->bytes > max_bytes) {
+    gst_rtp_gop_cache_clear (cache);
+    cache->overflow = TRUE;
+  }
+}
+
+/* Keeps a reference to @buffer. A keyframe starts a new GOP, except for
+ * the parameter sets and slices of a keyframe that are output as separate
+ * NAL units. A GOP larger than max_bytes is dropped until the next
+ * keyframe. */
+void
+gst_rtp_gop_cache_add (GstRtpGopCache * cache, GstBuffer * buffer)
+{
+  gboolean keyframe = !GST_BUFFER_FLAG_IS_SET (buffer,
+      GST_BUFFER_FLAG_DELTA_UNIT);
+  gsize size = gst_buffer_get_size (buffer);
+
+  if (cache->max_bytes == 0)
+    return;
+
+  if (keyframe) {
+    GstBuffer *last = g_queue_peek_tail (&cache->buffers);
+
+    if (cache->access_units || last == NULL ||
+        GST_BUFFER_FLAG_IS_SET (last, GST_BUFFER_FLAG_DELTA_UNIT)) {
+      gst_rtp_gop_cache_clear (cache);
+      cache->num_gops++;
+    }
+  } else if (cache->overflow || g_queue_is_empty (&cache->buffers)) {
+    /* nothing to decode this with */
+    return;
+  }
+
+  if (cache->bytes + size > cache->max_bytes) {
+    gst_rtp_gop_cache_clear (cache);
+    cache->overflow = TRUE;
+    cache->num_overflows++;
+    return;
+  }
+
+  g_queue_push_tail (&cache->buffers, gst_buffer_ref (buffer));
+  cache->bytes += size;
+}
+
+/* Returns the cached GOP, or %NULL if there is none. The consumer has seen
+ * all of it before, or only needs it to decode the next buffer, so all
+ * buffers are flagged as decode-only. @headers, if not %NULL, is prepended
+ * to the keyframe, for parameter sets that were not sent in-band. */
+GstBufferList *
+gst_rtp_gop_cache_replay (GstRtpGopCache * cache, GstBuffer * headers)
+{
+  GstBufferList *list;
+  GList *l;
+
+  if (g_queue_is_empty (&cache->buffers))
+    return NULL;
+
+  list = gst_buffer_list_new_sized (cache->buffers.length);
+  for (l = cache->buffers.head; l; l = l->next) {
+    GstBuffer *buffer = gst_buffer_copy (l->data);
+
+    if (l == cache->buffers.head) {
+      if (headers) {
+        GstBuffer *head = gst_buffer_copy (headers);
+
+        gst_buffer_copy_into (head, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
+        buffer = gst_buffer_append (head, buffer);
+      }
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+    }
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DECODE_ONLY);
+
+    gst_buffer_list_add (list, buffer);
+  }
+  cache->num_replays++;
+
+  return list;
+}
+
+gboolean
+gst_rtp_gop_cache_is_replay_event (GstEvent * event)
+{
+  return GST_EVENT_TYPE (event) == GST_EVENT_CUSTOM_UPSTREAM &&
+      gst_event_has_name (event, GST_RTP_GOP_CACHE_REPLAY_EVENT);
+}
+
+void
+gst_rtp_gop_cache_add_stats (GstRtpGopCache * cache, GstStructure * s)
+{
+  gst_structure_set (s,
+      "gop-cache-bytes", G_TYPE_UINT64, (guint64) cache->bytes,
+      "gop-cache-buffers", G_TYPE_UINT, cache->buffers.length,
+      "gop-cache-gops", G_TYPE_UINT64, cache->num_gops,
+      "gop-cache-overflows", G_TYPE_UINT64, cache->num_overflows,
+      "gop-cache-replays", G_TYPE_UINT64, cache->num_replays, NULL);
+}
@@ -0,0 +1,74 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_RTP_GOP_CACHE_H__
+#define __GST_RTP_GOP_CACHE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* name of the custom upstream event asking for the cached GOP, for consumers
+ * that join behind a tee, where the source pad of the depayloader doesn't
+ * get linked again */
+#define GST_RTP_GOP_CACHE_REPLAY_EVENT "GstRtpGopCacheReplay"
+
+/* The output buffers of a video depayloader since the last keyframe, to be
+ * replayed to consumers that can't wait for the next one */
+typedef struct
+{
+  GQueue buffers;
+  gsize bytes;
+  /* 0 disables the cache */
+  gsize max_bytes;
+  /* a keyframe buffer starts a new GOP even after another keyframe buffer,
+   * set when buffers are access units and not NAL units */
+  gboolean access_units;
+  /* the GOP didn't fit, wait for the next keyframe */
+  gboolean overflow;
+
+  guint64 num_gops;
+  guint64 num_overflows;
+  guint64 num_replays;
+} GstRtpGopCache;
+
+G_GNUC_INTERNAL
+void gst_rtp_gop_cache_init (GstRtpGopCache * cache);
+
+G_GNUC_INTERNAL
+void gst_rtp_gop_cache_clear (GstRtpGopCache * cache);
+
+G_GNUC_INTERNAL
+void gst_rtp_gop_cache_set_max_bytes (GstRtpGopCache * cache, gsize max_bytes);
+
+G_GNUC_INTERNAL
+void gst_rtp_gop_cache_add (GstRtpGopCache * cache, GstBuffer * buffer);
+
+G_GNUC_INTERNAL
+GstBufferList * gst_rtp_gop_cache_replay (GstRtpGopCache * cache,
+    GstBuffer * headers);
+
+G_GNUC_INTERNAL
+gboolean gst_rtp_gop_cache_is_replay_event (GstEvent * event);
+
+G_GNUC_INTERNAL
+void gst_rtp_gop_cache_add_stats (GstRtpGopCache * cache, GstStructure * s);
+
+G_END_DECLS
+
+#endif /* __GST_RTP_GOP_CACHE_H__ */
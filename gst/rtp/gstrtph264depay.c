@@ -41,12 +41,19 @@ GST_DEBUG_CATEGORY_STATIC (rtph264depay_debug);
 #define DEFAULT_ACCESS_UNIT   FALSE
 #define DEFAULT_WAIT_FOR_KEYFRAME FALSE
 #define DEFAULT_REQUEST_KEYFRAME FALSE
+#define DEFAULT_GOP_CACHE_SIZE 0
+#define DEFAULT_KEYFRAME_REQUEST_INTERVAL 0
+#define DEFAULT_ZERO_COPY FALSE
 
 enum
 {
   PROP_0,
   PROP_WAIT_FOR_KEYFRAME,
   PROP_REQUEST_KEYFRAME,
+  PROP_ZERO_COPY,
+  PROP_GOP_CACHE_SIZE,
+  PROP_KEYFRAME_REQUEST_INTERVAL,
+  PROP_STATS,
 };
 
 
@@ -109,10 +116,32 @@ static gboolean gst_rtp_h264_depay_handle_event (GstRTPBaseDepayload * depay,
     GstEvent * event);
 static GstBuffer *gst_rtp_h264_complete_au (GstRtpH264Depay * rtph264depay,
     GstClockTime * out_timestamp, gboolean * out_keyframe);
+static gboolean gst_rtp_h264_depay_src_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
+static void gst_rtp_h264_depay_src_linked (GstPad * pad, GstPad * peer,
+    gpointer user_data);
+static gboolean gst_rtp_h264_depay_request_keyframe (GstRtpH264Depay *
+    rtph264depay, GstEvent * event);
 static void gst_rtp_h264_depay_push (GstRtpH264Depay * rtph264depay,
     GstBuffer * outbuf, gboolean keyframe, GstClockTime timestamp,
     gboolean marker);
 
+static GstStructure *
+gst_rtp_h264_depay_create_stats (GstRtpH264Depay * self)
+{
+  GstStructure *s;
+
+  GST_OBJECT_LOCK (self);
+  s = gst_structure_new ("application/x-rtp-h264-depay-stats",
+      "keyframe-requests", G_TYPE_UINT64, self->num_keyframe_requests,
+      "keyframe-requests-coalesced", G_TYPE_UINT64,
+      self->num_keyframe_requests_coalesced, NULL);
+  gst_rtp_gop_cache_add_stats (&self->gop_cache, s);
+  GST_OBJECT_UNLOCK (self);
+
+  return s;
+}
+
 static void
 gst_rtp_h264_depay_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -126,6 +155,20 @@ gst_rtp_h264_depay_set_property (GObject * object, guint prop_id,
     case PROP_REQUEST_KEYFRAME:
       self->request_keyframe = g_value_get_boolean (value);
       break;
+    case PROP_ZERO_COPY:
+      self->zero_copy = g_value_get_boolean (value);
+      break;
+    case PROP_GOP_CACHE_SIZE:
+      GST_OBJECT_LOCK (self);
+      gst_rtp_gop_cache_set_max_bytes (&self->gop_cache,
+          g_value_get_uint (value));
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_KEYFRAME_REQUEST_INTERVAL:
+      GST_OBJECT_LOCK (self);
+      self->keyframe_request_interval = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -145,6 +188,22 @@ gst_rtp_h264_depay_get_property (GObject * object, guint prop_id,
     case PROP_REQUEST_KEYFRAME:
       g_value_set_boolean (value, self->request_keyframe);
       break;
+    case PROP_ZERO_COPY:
+      g_value_set_boolean (value, self->zero_copy);
+      break;
+    case PROP_GOP_CACHE_SIZE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->gop_cache.max_bytes);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_KEYFRAME_REQUEST_INTERVAL:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->keyframe_request_interval);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_rtp_h264_depay_create_stats (self));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -194,6 +253,86 @@ gst_rtp_h264_depay_class_init (GstRtpH264DepayClass * klass)
           DEFAULT_REQUEST_KEYFRAME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRtpH264Depay:zero-copy:
+   *
+   * Output NAL units and access units as buffers referencing the RTP
+   * payloads, with the start codes or NAL unit sizes in separate memories,
+   * instead of copying them into newly allocated memory. NAL units or access
+   * units that span more memories than a buffer can hold are still copied,
+   * once.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero Copy",
+          "Output buffers referencing the RTP payloads instead of copying them",
+          DEFAULT_ZERO_COPY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpH264Depay:gop-cache-size:
+   *
+   * Maximum number of bytes of output kept from the last keyframe on, to be
+   * replayed when the source pad gets linked and after a flush, instead of
+   * waiting for the next keyframe. The replayed buffers are flagged as
+   * decode-only, the first buffer that is shown is the next one. The cache
+   * is dropped until the next keyframe when a GOP doesn't fit. 0 disables
+   * the cache.
+   *
+   * Consumers that join behind a tee can ask for the cached GOP with a
+   * custom upstream event named `GstRtpGopCacheReplay`. The GOP is then
+   * pushed to all consumers sharing the output.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_GOP_CACHE_SIZE,
+      g_param_spec_uint ("gop-cache-size", "GOP Cache Size",
+          "Maximum size in bytes of the cached GOP replayed to new consumers "
+          "(0 = disabled)", 0, G_MAXUINT, DEFAULT_GOP_CACHE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpH264Depay:keyframe-request-interval:
+   *
+   * Minimum interval in milliseconds between keyframe requests sent
+   * upstream, requests from downstream or after packet loss arriving in
+   * between are dropped. 0 sends all requests.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_KEYFRAME_REQUEST_INTERVAL,
+      g_param_spec_uint ("keyframe-request-interval",
+          "Keyframe Request Interval",
+          "Minimum interval in ms between keyframe requests sent upstream "
+          "(0 = no limit)", 0, G_MAXUINT, DEFAULT_KEYFRAME_REQUEST_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpH264Depay:stats:
+   *
+   * Various depayloader statistics. This property returns a #GstStructure
+   * with name application/x-rtp-h264-depay-stats with the following fields:
+   *
+   * * #guint64 `keyframe-requests`: the number of keyframe requests sent
+   *   upstream.
+   * * #guint64 `keyframe-requests-coalesced`: the number of keyframe requests
+   *   dropped because of #GstRtpH264Depay:keyframe-request-interval.
+   * * #guint64 `gop-cache-bytes`: the size of the cached GOP.
+   * * #guint `gop-cache-buffers`: the number of cached buffers.
+   * * #guint64 `gop-cache-gops`: the number of GOPs that were cached.
+   * * #guint64 `gop-cache-overflows`: the number of GOPs that didn't fit in
+   *   #GstRtpH264Depay:gop-cache-size.
+   * * #guint64 `gop-cache-replays`: the number of times the cache was
+   *   replayed.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Various statistics", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class,
       &gst_rtp_h264_depay_src_template);
   gst_element_class_add_static_pad_template (gstelement_class,
@@ -223,6 +362,16 @@ gst_rtp_h264_depay_init (GstRtpH264Depay * rtph264depay)
       (GDestroyNotify) gst_buffer_unref);
   rtph264depay->wait_for_keyframe = DEFAULT_WAIT_FOR_KEYFRAME;
   rtph264depay->request_keyframe = DEFAULT_REQUEST_KEYFRAME;
+  rtph264depay->zero_copy = DEFAULT_ZERO_COPY;
+
+  gst_rtp_gop_cache_init (&rtph264depay->gop_cache);
+  rtph264depay->keyframe_request_interval = DEFAULT_KEYFRAME_REQUEST_INTERVAL;
+  rtph264depay->last_keyframe_request = -1;
+
+  gst_pad_set_event_function (GST_RTP_BASE_DEPAYLOAD_SRCPAD (rtph264depay),
+      gst_rtp_h264_depay_src_event);
+  g_signal_connect (GST_RTP_BASE_DEPAYLOAD_SRCPAD (rtph264depay), "linked",
+      G_CALLBACK (gst_rtp_h264_depay_src_linked), rtph264depay);
 }
 
 static void
@@ -232,6 +381,7 @@ gst_rtp_h264_depay_reset (GstRtpH264Depay * rtph264depay, gboolean hard)
   rtph264depay->wait_start = TRUE;
   rtph264depay->waiting_for_keyframe = rtph264depay->wait_for_keyframe;
   gst_adapter_clear (rtph264depay->picture_adapter);
+  rtph264depay->picture_n_memory = 0;
   rtph264depay->picture_start = FALSE;
   rtph264depay->last_keyframe = FALSE;
   rtph264depay->last_ts = 0;
@@ -241,6 +391,13 @@ gst_rtp_h264_depay_reset (GstRtpH264Depay * rtph264depay, gboolean hard)
   g_ptr_array_set_size (rtph264depay->pps, 0);
 
   if (hard) {
+    GST_OBJECT_LOCK (rtph264depay);
+    gst_rtp_gop_cache_clear (&rtph264depay->gop_cache);
+    gst_clear_buffer (&rtph264depay->gop_cache_headers);
+    rtph264depay->gop_cache_replay = FALSE;
+    rtph264depay->last_keyframe_request = -1;
+    GST_OBJECT_UNLOCK (rtph264depay);
+
     if (rtph264depay->allocator != NULL) {
       gst_object_unref (rtph264depay->allocator);
       rtph264depay->allocator = NULL;
@@ -280,6 +437,9 @@ gst_rtp_h264_depay_finalize (GObject * object)
   g_ptr_array_free (rtph264depay->sps, TRUE);
   g_ptr_array_free (rtph264depay->pps, TRUE);
 
+  gst_rtp_gop_cache_clear (&rtph264depay->gop_cache);
+  gst_clear_buffer (&rtph264depay->gop_cache_headers);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -340,6 +500,10 @@ gst_rtp_h264_depay_negotiate (GstRtpH264Depay * rtph264depay)
         DEFAULT_ACCESS_UNIT);
     rtph264depay->merge = DEFAULT_ACCESS_UNIT;
   }
+
+  GST_OBJECT_LOCK (rtph264depay);
+  rtph264depay->gop_cache.access_units = rtph264depay->merge;
+  GST_OBJECT_UNLOCK (rtph264depay);
 }
 
 static gboolean
@@ -628,6 +792,11 @@ gst_rtp_h264_set_src_caps (GstRtpH264Depay * rtph264depay)
     if (rtph264depay->codec_data)
       gst_buffer_unref (rtph264depay->codec_data);
     rtph264depay->codec_data = codec_data;
+
+    /* a replayed GOP needs them too */
+    GST_OBJECT_LOCK (rtph264depay);
+    gst_buffer_replace (&rtph264depay->gop_cache_headers, codec_data);
+    GST_OBJECT_UNLOCK (rtph264depay);
   }
 
   if (res)
@@ -821,6 +990,11 @@ gst_rtp_h264_depay_setcaps (GstRTPBaseDepayload * depayload, GstCaps * caps)
     if (rtph264depay->codec_data)
       gst_buffer_unref (rtph264depay->codec_data);
     rtph264depay->codec_data = codec_data;
+
+    /* a replayed GOP needs them too */
+    GST_OBJECT_LOCK (rtph264depay);
+    gst_buffer_replace (&rtph264depay->gop_cache_headers, codec_data);
+    GST_OBJECT_UNLOCK (rtph264depay);
   } else if (!rtph264depay->byte_stream) {
     gchar **params;
     gint i;
@@ -908,6 +1082,15 @@ gst_rtp_h264_complete_au (GstRtpH264Depay * rtph264depay,
   GST_DEBUG_OBJECT (rtph264depay, "taking completed AU");
   outsize = gst_adapter_available (rtph264depay->picture_adapter);
 
+  /* reference the NAL units, unless there are more memories than a buffer
+   * can hold, they would be merged again and again */
+  if (rtph264depay->zero_copy &&
+      rtph264depay->picture_n_memory <= gst_buffer_get_max_memory ()) {
+    outbuf = gst_adapter_take_buffer_fast (rtph264depay->picture_adapter,
+        outsize);
+    goto done;
+  }
+
   outbuf = gst_rtp_h264_depay_allocate_output_buffer (rtph264depay, outsize);
 
   if (outbuf == NULL)
@@ -942,6 +1125,9 @@ gst_rtp_h264_complete_au (GstRtpH264Depay * rtph264depay,
   gst_buffer_list_unref (list);
   gst_buffer_unmap (outbuf, &outmap);
 
+done:
+  rtph264depay->picture_n_memory = 0;
+
   *out_timestamp = rtph264depay->last_ts;
   *out_keyframe = rtph264depay->last_keyframe;
 
@@ -955,6 +1141,8 @@ static void
 gst_rtp_h264_depay_push (GstRtpH264Depay * rtph264depay, GstBuffer * outbuf,
     gboolean keyframe, GstClockTime timestamp, gboolean marker)
 {
+  GstBufferList *replay = NULL;
+
   /* prepend codec_data */
   if (rtph264depay->codec_data) {
     GST_DEBUG_OBJECT (rtph264depay, "prepending codec_data");
@@ -977,9 +1165,58 @@ gst_rtp_h264_depay_push (GstRtpH264Depay * rtph264depay, GstBuffer * outbuf,
   if (marker)
     GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_MARKER);
 
+  GST_OBJECT_LOCK (rtph264depay);
+  if (rtph264depay->gop_cache_replay) {
+    rtph264depay->gop_cache_replay = FALSE;
+    /* a keyframe is as good as the cached GOP */
+    if (!keyframe)
+      replay = gst_rtp_gop_cache_replay (&rtph264depay->gop_cache,
+          rtph264depay->gop_cache_headers);
+  }
+  gst_rtp_gop_cache_add (&rtph264depay->gop_cache, outbuf);
+  GST_OBJECT_UNLOCK (rtph264depay);
+
+  if (replay) {
+    GST_DEBUG_OBJECT (rtph264depay, "replaying %u cached buffers",
+        gst_buffer_list_length (replay));
+    gst_rtp_base_depayload_push_list (GST_RTP_BASE_DEPAYLOAD (rtph264depay),
+        replay);
+  }
+
   gst_rtp_base_depayload_push (GST_RTP_BASE_DEPAYLOAD (rtph264depay), outbuf);
 }
 
+/* Sends @event upstream, unless a keyframe was requested less than
+ * keyframe-request-interval ago */
+static gboolean
+gst_rtp_h264_depay_request_keyframe (GstRtpH264Depay * rtph264depay,
+    GstEvent * event)
+{
+  gint64 now = g_get_monotonic_time ();
+  gboolean coalesce;
+
+  GST_OBJECT_LOCK (rtph264depay);
+  coalesce = rtph264depay->last_keyframe_request != -1 &&
+      now - rtph264depay->last_keyframe_request <
+      (gint64) rtph264depay->keyframe_request_interval * 1000;
+  if (coalesce) {
+    rtph264depay->num_keyframe_requests_coalesced++;
+  } else {
+    rtph264depay->last_keyframe_request = now;
+    rtph264depay->num_keyframe_requests++;
+  }
+  GST_OBJECT_UNLOCK (rtph264depay);
+
+  if (coalesce) {
+    GST_DEBUG_OBJECT (rtph264depay, "coalescing keyframe request");
+    gst_event_unref (event);
+    return TRUE;
+  }
+
+  return gst_pad_push_event (GST_RTP_BASE_DEPAYLOAD_SINKPAD (rtph264depay),
+      event);
+}
+
 /* SPS/PPS/IDR considered key, all others DELTA;
  * so downstream waiting for keyframe can pick up at SPS/PPS/IDR */
 #define NAL_TYPE_IS_KEY(nt) (((nt) == 5) || ((nt) == 7) || ((nt) == 8))
@@ -990,16 +1227,17 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
 {
   GstRTPBaseDepayload *depayload = GST_RTP_BASE_DEPAYLOAD (rtph264depay);
   gint nal_type;
-  GstMapInfo map;
+  guint8 header[6] = { 0, };
   GstBuffer *outbuf = NULL;
   GstClockTime out_timestamp;
   gboolean keyframe, out_keyframe;
 
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  if (G_UNLIKELY (map.size < 5))
+  /* only look at the NAL header and the start of the slice header, the NAL
+   * might span several memories */
+  if (G_UNLIKELY (gst_buffer_extract (nal, 0, header, sizeof (header)) < 5))
     goto short_nal;
 
-  nal_type = map.data[4] & 0x1f;
+  nal_type = header[4] & 0x1f;
   GST_DEBUG_OBJECT (rtph264depay, "handle NAL type %d", nal_type);
 
   keyframe = NAL_TYPE_IS_KEY (nal_type);
@@ -1012,18 +1250,16 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
       gst_rtp_h264_depay_add_sps_pps (rtph264depay,
           gst_buffer_copy_region (nal, GST_BUFFER_COPY_ALL,
               4, gst_buffer_get_size (nal) - 4));
-      gst_buffer_unmap (nal, &map);
       gst_buffer_unref (nal);
       return;
     } else if (rtph264depay->sps->len == 0 || rtph264depay->pps->len == 0) {
       /* Down push down any buffer in non-bytestream mode if the SPS/PPS haven't
        * go through yet
        */
-      gst_pad_push_event (GST_RTP_BASE_DEPAYLOAD_SINKPAD (depayload),
+      gst_rtp_h264_depay_request_keyframe (rtph264depay,
           gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
               gst_structure_new ("GstForceKeyUnit",
                   "all-headers", G_TYPE_BOOLEAN, TRUE, NULL)));
-      gst_buffer_unmap (nal, &map);
       gst_buffer_unref (nal);
       return;
     }
@@ -1049,7 +1285,7 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
     if (nal_type == 1 || nal_type == 2 || nal_type == 5) {
       /* we have a picture start */
       start = TRUE;
-      if (map.data[5] & 0x80) {
+      if (header[5] & 0x80) {
         /* first_mb_in_slice == 0 completes a picture */
         complete = TRUE;
       }
@@ -1067,12 +1303,11 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
             &out_keyframe);
     }
     /* add to adapter */
-    gst_buffer_unmap (nal, &map);
-
     if (!rtph264depay->picture_start && start && out_keyframe)
       rtph264depay->waiting_for_keyframe = FALSE;
 
     GST_DEBUG_OBJECT (depayload, "adding NAL to picture adapter");
+    rtph264depay->picture_n_memory += gst_buffer_n_memory (nal);
     gst_adapter_push (rtph264depay->picture_adapter, nal);
     rtph264depay->last_ts = in_timestamp;
     rtph264depay->last_keyframe |= keyframe;
@@ -1085,7 +1320,6 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
     /* no merge, output is input nal */
     GST_DEBUG_OBJECT (depayload, "using NAL as output");
     outbuf = nal;
-    gst_buffer_unmap (nal, &map);
   }
 
   if (outbuf) {
@@ -1106,7 +1340,6 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
 short_nal:
   {
     GST_WARNING_OBJECT (depayload, "dropping short NAL");
-    gst_buffer_unmap (nal, &map);
     gst_buffer_unref (nal);
     return;
   }
@@ -1116,25 +1349,28 @@ static void
 gst_rtp_h264_finish_fragmentation_unit (GstRtpH264Depay * rtph264depay)
 {
   guint outsize;
-  GstMapInfo map;
+  guint8 prefix[4];
   GstBuffer *outbuf;
 
   outsize = gst_adapter_available (rtph264depay->adapter);
-  outbuf = gst_adapter_take_buffer (rtph264depay->adapter, outsize);
 
-  gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
+  /* the fragments reference the RTP payloads, gather them once if there
+   * are more than a buffer can hold */
+  if (rtph264depay->zero_copy &&
+      rtph264depay->fu_n_memory <= gst_buffer_get_max_memory ())
+    outbuf = gst_adapter_take_buffer_fast (rtph264depay->adapter, outsize);
+  else
+    outbuf = gst_adapter_take_buffer (rtph264depay->adapter, outsize);
+  outbuf = gst_buffer_make_writable (outbuf);
+
   GST_DEBUG_OBJECT (rtph264depay, "output %d bytes", outsize);
 
   if (rtph264depay->byte_stream) {
-    memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+    memcpy (prefix, sync_bytes, sizeof (sync_bytes));
   } else {
-    outsize -= 4;
-    map.data[0] = (outsize >> 24);
-    map.data[1] = (outsize >> 16);
-    map.data[2] = (outsize >> 8);
-    map.data[3] = (outsize);
+    GST_WRITE_UINT32_BE (prefix, outsize - 4);
   }
-  gst_buffer_unmap (outbuf, &map);
+  gst_buffer_fill (outbuf, 0, prefix, sizeof (prefix));
 
   rtph264depay->current_fu_type = 0;
 
@@ -1142,6 +1378,35 @@ gst_rtp_h264_finish_fragmentation_unit (GstRtpH264Depay * rtph264depay)
       rtph264depay->fu_timestamp, rtph264depay->fu_marker);
 }
 
+/* Creates a buffer with @prefix_len bytes of @prefix followed by @size bytes
+ * of the payload of @rtp starting at @offset. In zero-copy mode the payload
+ * is referenced after a memory holding the prefix */
+static GstBuffer *
+gst_rtp_h264_depay_create_nal (GstRtpH264Depay * rtph264depay,
+    GstRTPBuffer * rtp, const guint8 * prefix, guint prefix_len, guint offset,
+    guint size)
+{
+  GstBuffer *outbuf;
+
+  if (rtph264depay->zero_copy) {
+    outbuf = gst_buffer_new_allocate (NULL, prefix_len, NULL);
+    gst_buffer_copy_into (outbuf, rtp->buffer, GST_BUFFER_COPY_MEMORY,
+        gst_rtp_buffer_get_header_len (rtp) + offset, size);
+  } else {
+    guint8 *data = gst_rtp_buffer_get_payload (rtp);
+
+    outbuf = gst_buffer_new_and_alloc (prefix_len + size);
+    gst_buffer_fill (outbuf, prefix_len, data + offset, size);
+  }
+
+  if (prefix_len > 0)
+    gst_buffer_fill (outbuf, 0, prefix, prefix_len);
+
+  gst_rtp_copy_video_meta (rtph264depay, outbuf, rtp->buffer);
+
+  return outbuf;
+}
+
 static GstBuffer *
 gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
 {
@@ -1167,17 +1432,17 @@ gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
 
 
     if (rtph264depay->request_keyframe)
-      gst_pad_push_event (GST_RTP_BASE_DEPAYLOAD_SINKPAD (depayload),
+      gst_rtp_h264_depay_request_keyframe (rtph264depay,
           gst_video_event_new_upstream_force_key_unit (GST_CLOCK_TIME_NONE,
               TRUE, 0));
   }
 
   {
     gint payload_len;
-    guint8 *payload;
+    guint8 *payload, *payload_start;
     guint header_len;
     guint8 nal_ref_idc;
-    GstMapInfo map;
+    guint8 prefix[5];
     guint outsize, nalu_size;
     GstClockTime timestamp;
     gboolean marker;
@@ -1185,7 +1450,7 @@ gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
     timestamp = GST_BUFFER_PTS (rtp->buffer);
 
     payload_len = gst_rtp_buffer_get_payload_len (rtp);
-    payload = gst_rtp_buffer_get_payload (rtp);
+    payload = payload_start = gst_rtp_buffer_get_payload (rtp);
     marker = gst_rtp_buffer_get_marker (rtp);
 
     GST_DEBUG_OBJECT (rtph264depay, "receiving %d bytes", payload_len);
@@ -1253,26 +1518,20 @@ gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
           if (nalu_size > (payload_len - 2))
             nalu_size = payload_len - 2;
 
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
-
-          gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
           if (rtph264depay->byte_stream) {
-            memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+            memcpy (prefix, sync_bytes, sizeof (sync_bytes));
           } else {
-            map.data[0] = map.data[1] = 0;
-            map.data[2] = payload[0];
-            map.data[3] = payload[1];
+            prefix[0] = prefix[1] = 0;
+            prefix[2] = payload[0];
+            prefix[3] = payload[1];
           }
 
           /* strip NALU size */
           payload += 2;
           payload_len -= 2;
 
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-          gst_buffer_unmap (outbuf, &map);
-
-          gst_rtp_copy_video_meta (rtph264depay, outbuf, rtp->buffer);
+          outbuf = gst_rtp_h264_depay_create_nal (rtph264depay, rtp, prefix,
+              sizeof (sync_bytes), payload - payload_start, nalu_size);
 
           if (payload_len - nalu_size <= 2)
             last = TRUE;
@@ -1336,25 +1595,24 @@ gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
           /* reconstruct NAL header */
           nal_header = (payload[0] & 0xe0) | (payload[1] & 0x1f);
 
-          /* strip type header, keep FU header, we'll reuse it to reconstruct
-           * the NAL header. */
-          payload += 1;
-          payload_len -= 1;
-
-          nalu_size = payload_len;
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
+          /* strip FU indicator and FU header, the NAL header is written
+           * after room for the start code or NALU size, which is filled
+           * when the NAL unit is complete. */
+          payload += 2;
+          payload_len -= 2;
 
-          gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-          map.data[sizeof (sync_bytes)] = nal_header;
-          gst_buffer_unmap (outbuf, &map);
+          memset (prefix, 0, sizeof (sync_bytes));
+          prefix[sizeof (sync_bytes)] = nal_header;
 
-          gst_rtp_copy_video_meta (rtph264depay, outbuf, rtp->buffer);
+          nalu_size = payload_len;
+          outsize = nalu_size + sizeof (prefix);
+          outbuf = gst_rtp_h264_depay_create_nal (rtph264depay, rtp, prefix,
+              sizeof (prefix), payload - payload_start, nalu_size);
 
           GST_DEBUG_OBJECT (rtph264depay, "queueing %d bytes", outsize);
 
           /* and assemble in the adapter */
+          rtph264depay->fu_n_memory = gst_buffer_n_memory (outbuf);
           gst_adapter_push (rtph264depay->adapter, outbuf);
         } else {
           if (rtph264depay->current_fu_type == 0) {
@@ -1381,14 +1639,13 @@ gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
           payload_len -= 2;
 
           outsize = payload_len;
-          outbuf = gst_buffer_new_and_alloc (outsize);
-          gst_buffer_fill (outbuf, 0, payload, outsize);
-
-          gst_rtp_copy_video_meta (rtph264depay, outbuf, rtp->buffer);
+          outbuf = gst_rtp_h264_depay_create_nal (rtph264depay, rtp, NULL, 0,
+              payload - payload_start, outsize);
 
           GST_DEBUG_OBJECT (rtph264depay, "queueing %d bytes", outsize);
 
           /* and assemble in the adapter */
+          rtph264depay->fu_n_memory += gst_buffer_n_memory (outbuf);
           gst_adapter_push (rtph264depay->adapter, outbuf);
         }
 
@@ -1407,21 +1664,17 @@ gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
         /* 1-23   NAL unit  Single NAL unit packet per H.264   5.6 */
         /* the entire payload is the output buffer */
         nalu_size = payload_len;
-        outsize = nalu_size + sizeof (sync_bytes);
-        outbuf = gst_buffer_new_and_alloc (outsize);
 
-        gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
         if (rtph264depay->byte_stream) {
-          memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+          memcpy (prefix, sync_bytes, sizeof (sync_bytes));
         } else {
-          map.data[0] = map.data[1] = 0;
-          map.data[2] = nalu_size >> 8;
-          map.data[3] = nalu_size & 0xff;
+          prefix[0] = prefix[1] = 0;
+          prefix[2] = nalu_size >> 8;
+          prefix[3] = nalu_size & 0xff;
         }
-        memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-        gst_buffer_unmap (outbuf, &map);
 
-        gst_rtp_copy_video_meta (rtph264depay, outbuf, rtp->buffer);
+        outbuf = gst_rtp_h264_depay_create_nal (rtph264depay, rtp, prefix,
+            sizeof (sync_bytes), 0, nalu_size);
 
         gst_rtp_h264_depay_handle_nal (rtph264depay, outbuf, timestamp, marker);
         break;
@@ -1466,6 +1719,10 @@ gst_rtp_h264_depay_handle_event (GstRTPBaseDepayload * depay, GstEvent * event)
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_FLUSH_STOP:
       gst_rtp_h264_depay_reset (rtph264depay, FALSE);
+      /* downstream lost what it had, start again from the cached GOP */
+      GST_OBJECT_LOCK (rtph264depay);
+      rtph264depay->gop_cache_replay = TRUE;
+      GST_OBJECT_UNLOCK (rtph264depay);
       break;
     case GST_EVENT_EOS:
       gst_rtp_h264_depay_drain (rtph264depay);
@@ -1478,6 +1735,42 @@ gst_rtp_h264_depay_handle_event (GstRTPBaseDepayload * depay, GstEvent * event)
       GST_RTP_BASE_DEPAYLOAD_CLASS (parent_class)->handle_event (depay, event);
 }
 
+static gboolean
+gst_rtp_h264_depay_src_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstRtpH264Depay *rtph264depay = GST_RTP_H264_DEPAY (parent);
+
+  /* a keyframe request doesn't replay the cache, the other consumers that
+   * share this output would get the GOP twice */
+  if (gst_video_event_is_force_key_unit (event))
+    return gst_rtp_h264_depay_request_keyframe (rtph264depay, event);
+
+  if (gst_rtp_gop_cache_is_replay_event (event)) {
+    GST_DEBUG_OBJECT (rtph264depay, "replaying the cached GOP on request");
+    GST_OBJECT_LOCK (rtph264depay);
+    rtph264depay->gop_cache_replay = TRUE;
+    GST_OBJECT_UNLOCK (rtph264depay);
+    gst_event_unref (event);
+    return TRUE;
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static void
+gst_rtp_h264_depay_src_linked (GstPad * pad, GstPad * peer, gpointer user_data)
+{
+  GstRtpH264Depay *rtph264depay = user_data;
+
+  GST_DEBUG_OBJECT (rtph264depay, "linked to %" GST_PTR_FORMAT
+      ", replaying the cached GOP", peer);
+
+  GST_OBJECT_LOCK (rtph264depay);
+  rtph264depay->gop_cache_replay = TRUE;
+  GST_OBJECT_UNLOCK (rtph264depay);
+}
+
 static GstStateChangeReturn
 gst_rtp_h264_depay_change_state (GstElement * element,
     GstStateChange transition)
@@ -24,6 +24,8 @@
 #include <gst/base/gstadapter.h>
 #include <gst/rtp/gstrtpbasedepayload.h>
 
+#include "gstrtpgopcache.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_RTP_H264_DEPAY \
@@ -53,6 +55,7 @@ struct _GstRtpH264Depay
   /* nal merging */
   gboolean    merge;
   GstAdapter *picture_adapter;
+  guint       picture_n_memory;
   gboolean    picture_start;
   GstClockTime last_ts;
   gboolean    last_keyframe;
@@ -62,6 +65,7 @@ struct _GstRtpH264Depay
   guint16 last_fu_seqnum;
   GstClockTime fu_timestamp;
   gboolean fu_marker;
+  guint fu_n_memory;
 
   /* misc */
   GPtrArray *sps;
@@ -75,6 +79,17 @@ struct _GstRtpH264Depay
   gboolean wait_for_keyframe;
   gboolean request_keyframe;
   gboolean waiting_for_keyframe;
+  gboolean zero_copy;
+
+  /* protected by the object lock */
+  GstRtpGopCache gop_cache;
+  gboolean gop_cache_replay;
+  /* out-of-band parameter sets, prepended to a replayed GOP */
+  GstBuffer *gop_cache_headers;
+  guint keyframe_request_interval;
+  gint64 last_keyframe_request;
+  guint64 num_keyframe_requests;
+  guint64 num_keyframe_requests_coalesced;
 };
 
 struct _GstRtpH264DepayClass
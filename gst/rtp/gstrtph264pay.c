@@ -1157,6 +1157,7 @@ gst_rtp_h264_pay_reset_bundle (GstRtpH264Pay * rtph264pay)
 {
   g_clear_pointer (&rtph264pay->bundle, gst_buffer_list_unref);
   rtph264pay->bundle_size = 0;
+  rtph264pay->bundle_n_memory = 0;
   rtph264pay->bundle_contains_vcl = FALSE;
 }
 
@@ -1195,16 +1196,19 @@ gst_rtp_h264_pay_send_bundle (GstRtpH264Pay * rtph264pay, gboolean end_of_au)
         "sending NAL Unit unaggregated: datasize=%u", bundle_size - 2);
   } else {
     guint8 stap_header;
+    GstMemory *headers;
+    GstMapInfo map;
     guint i;
 
-    outbuf = gst_buffer_new_allocate (NULL, sizeof stap_header, NULL);
+    /* the STAP-A header and all the NALU sizes are written in one memory,
+     * the packet references it and the NALU data in between */
+    headers = gst_allocator_alloc (NULL, 1 + 2 * length, NULL);
+    gst_memory_map (headers, &map, GST_MAP_WRITE);
     stap_header = STAP_A_TYPE_ID;
 
     for (i = 0; i < length; i++) {
       GstBuffer *buf = gst_buffer_list_get (bundle, i);
       guint8 nal_header;
-      GstMemory *size_header;
-      GstMapInfo map;
 
       gst_buffer_extract (buf, 0, &nal_header, sizeof nal_header);
 
@@ -1216,18 +1220,30 @@ gst_rtp_h264_pay_send_bundle (GstRtpH264Pay * rtph264pay, gboolean end_of_au)
       if ((nal_header & 0x60) > (stap_header & 0x60))
         stap_header = (stap_header & 0x9f) | (nal_header & 0x60);
 
-      /* append NALU size */
-      size_header = gst_allocator_alloc (NULL, 2, NULL);
-      gst_memory_map (size_header, &map, GST_MAP_WRITE);
-      GST_WRITE_UINT16_BE (map.data, gst_buffer_get_size (buf));
-      gst_memory_unmap (size_header, &map);
-      gst_buffer_append_memory (outbuf, size_header);
+      /* NALU size */
+      GST_WRITE_UINT16_BE (map.data + 1 + 2 * i, gst_buffer_get_size (buf));
+    }
+
+    map.data[0] = stap_header;
+    gst_memory_unmap (headers, &map);
+
+    outbuf = gst_buffer_new ();
+
+    for (i = 0; i < length; i++) {
+      GstBuffer *buf = gst_buffer_list_get (bundle, i);
+
+      /* append NALU size, after the STAP-A header for the first one */
+      if (i == 0)
+        gst_buffer_append_memory (outbuf, gst_memory_share (headers, 0, 3));
+      else
+        gst_buffer_append_memory (outbuf,
+            gst_memory_share (headers, 1 + 2 * i, 2));
 
       /* append NALU data */
-      outbuf = gst_buffer_append (outbuf, gst_buffer_ref (buf));
+      gst_buffer_copy_into (outbuf, buf, GST_BUFFER_COPY_MEMORY, 0, -1);
     }
 
-    gst_buffer_fill (outbuf, 0, &stap_header, sizeof stap_header);
+    gst_memory_unref (headers);
 
     GST_DEBUG_OBJECT (rtph264pay,
         "sending STAP-A bundle: n=%u header=%02x datasize=%u",
@@ -1246,7 +1262,7 @@ gst_rtp_h264_pay_payload_nal_bundle (GstRTPBasePayload * basepayload,
 {
   GstRtpH264Pay *rtph264pay;
   GstFlowReturn ret;
-  guint mtu, pay_size, bundle_size;
+  guint mtu, pay_size, bundle_size, n_memory;
   GstBufferList *bundle;
   guint8 nal_type;
   gboolean start_of_au;
@@ -1310,10 +1326,28 @@ gst_rtp_h264_pay_payload_nal_bundle (GstRTPBasePayload * basepayload,
     bundle = NULL;
   }
 
+  /* the NALU size and the NALU memories, the packet also has one for the
+   * RTP header. More than a buffer can hold would be merged by copying */
+  n_memory = 1 + gst_buffer_n_memory (paybuf);
+
+  if (bundle && 1 + rtph264pay->bundle_n_memory + n_memory >
+      gst_buffer_get_max_memory ()) {
+    GST_DEBUG_OBJECT (rtph264pay,
+        "bundle has too many memories, sending: n_memory=%u",
+        rtph264pay->bundle_n_memory);
+
+    ret = gst_rtp_h264_pay_send_bundle (rtph264pay, FALSE);
+    if (ret != GST_FLOW_OK)
+      goto out;
+
+    bundle = NULL;
+  }
+
   if (!bundle) {
     GST_DEBUG_OBJECT (rtph264pay, "creating new STAP-A aggregate");
     bundle = rtph264pay->bundle = gst_buffer_list_new ();
     bundle_size = rtph264pay->bundle_size = 1;
+    rtph264pay->bundle_n_memory = 0;
     rtph264pay->bundle_contains_vcl = FALSE;
   }
 
@@ -1337,6 +1371,7 @@ gst_rtp_h264_pay_payload_nal_bundle (GstRTPBasePayload * basepayload,
 
   gst_buffer_list_add (bundle, gst_buffer_ref (paybuf));
   rtph264pay->bundle_size += pay_size;
+  rtph264pay->bundle_n_memory += n_memory;
   ret = GST_FLOW_OK;
 
   if ((nal_type >= 1 && nal_type <= 5) || nal_type == 14 ||
@@ -1625,7 +1660,8 @@ gst_rtp_h264_pay_handle_buffer (GstRTPBasePayload * basepayload,
             marker || draining)
           end_of_au = TRUE;
       }
-      paybuf = gst_adapter_take_buffer (rtph264pay->adapter, size);
+      /* reference the NAL data, even when it spans several input buffers */
+      paybuf = gst_adapter_take_buffer_fast (rtph264pay->adapter, size);
       g_assert (paybuf);
 
       /* put the data in one or more RTP packets */
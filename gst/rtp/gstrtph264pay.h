@@ -93,6 +93,7 @@ struct _GstRtpH264Pay
   /* aggregate buffers with STAP-A */
   GstBufferList *bundle;
   guint bundle_size;
+  guint bundle_n_memory;
   gboolean bundle_contains_vcl;
   GstRTPH264AggregateMode aggregate_mode;
 };
@@ -39,6 +39,18 @@ GST_DEBUG_CATEGORY_STATIC (rtph265depay_debug);
  * expressed a restriction or preference via caps */
 #define DEFAULT_STREAM_FORMAT GST_H265_STREAM_FORMAT_BYTESTREAM
 #define DEFAULT_ACCESS_UNIT   FALSE
+#define DEFAULT_ZERO_COPY     FALSE
+#define DEFAULT_GOP_CACHE_SIZE 0
+#define DEFAULT_KEYFRAME_REQUEST_INTERVAL 0
+
+enum
+{
+  PROP_0,
+  PROP_ZERO_COPY,
+  PROP_GOP_CACHE_SIZE,
+  PROP_KEYFRAME_REQUEST_INTERVAL,
+  PROP_STATS,
+};
 
 /* 3 zero bytes syncword */
 static const guint8 sync_bytes[] = { 0, 0, 0, 1 };
@@ -115,10 +127,87 @@ static gboolean gst_rtp_h265_depay_handle_event (GstRTPBaseDepayload * depay,
     GstEvent * event);
 static GstBuffer *gst_rtp_h265_complete_au (GstRtpH265Depay * rtph265depay,
     GstClockTime * out_timestamp, gboolean * out_keyframe);
+static gboolean gst_rtp_h265_depay_src_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
+static void gst_rtp_h265_depay_src_linked (GstPad * pad, GstPad * peer,
+    gpointer user_data);
+static gboolean gst_rtp_h265_depay_request_keyframe (GstRtpH265Depay *
+    rtph265depay, GstEvent * event);
 static void gst_rtp_h265_depay_push (GstRtpH265Depay * rtph265depay,
     GstBuffer * outbuf, gboolean keyframe, GstClockTime timestamp,
     gboolean marker);
 
+static GstStructure *
+gst_rtp_h265_depay_create_stats (GstRtpH265Depay * self)
+{
+  GstStructure *s;
+
+  GST_OBJECT_LOCK (self);
+  s = gst_structure_new ("application/x-rtp-h265-depay-stats",
+      "keyframe-requests", G_TYPE_UINT64, self->num_keyframe_requests,
+      "keyframe-requests-coalesced", G_TYPE_UINT64,
+      self->num_keyframe_requests_coalesced, NULL);
+  gst_rtp_gop_cache_add_stats (&self->gop_cache, s);
+  GST_OBJECT_UNLOCK (self);
+
+  return s;
+}
+
+static void
+gst_rtp_h265_depay_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstRtpH265Depay *self = GST_RTP_H265_DEPAY (object);
+
+  switch (prop_id) {
+    case PROP_ZERO_COPY:
+      self->zero_copy = g_value_get_boolean (value);
+      break;
+    case PROP_GOP_CACHE_SIZE:
+      GST_OBJECT_LOCK (self);
+      gst_rtp_gop_cache_set_max_bytes (&self->gop_cache,
+          g_value_get_uint (value));
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_KEYFRAME_REQUEST_INTERVAL:
+      GST_OBJECT_LOCK (self);
+      self->keyframe_request_interval = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_rtp_h265_depay_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRtpH265Depay *self = GST_RTP_H265_DEPAY (object);
+
+  switch (prop_id) {
+    case PROP_ZERO_COPY:
+      g_value_set_boolean (value, self->zero_copy);
+      break;
+    case PROP_GOP_CACHE_SIZE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->gop_cache.max_bytes);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_KEYFRAME_REQUEST_INTERVAL:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->keyframe_request_interval);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_rtp_h265_depay_create_stats (self));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
 
 static void
 gst_rtp_h265_depay_class_init (GstRtpH265DepayClass * klass)
@@ -132,6 +221,88 @@ gst_rtp_h265_depay_class_init (GstRtpH265DepayClass * klass)
   gstrtpbasedepayload_class = (GstRTPBaseDepayloadClass *) klass;
 
   gobject_class->finalize = gst_rtp_h265_depay_finalize;
+  gobject_class->set_property = gst_rtp_h265_depay_set_property;
+  gobject_class->get_property = gst_rtp_h265_depay_get_property;
+
+  /**
+   * GstRtpH265Depay:zero-copy:
+   *
+   * Output NAL units and access units as buffers referencing the RTP
+   * payloads, with the start codes or NAL unit sizes in separate memories,
+   * instead of copying them into newly allocated memory. NAL units or access
+   * units that span more memories than a buffer can hold are still copied,
+   * once.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero Copy",
+          "Output buffers referencing the RTP payloads instead of copying them",
+          DEFAULT_ZERO_COPY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpH265Depay:gop-cache-size:
+   *
+   * Maximum number of bytes of output kept from the last keyframe on, to be
+   * replayed when the source pad gets linked and after a flush, instead of
+   * waiting for the next keyframe. The replayed buffers are flagged as
+   * decode-only, the first buffer that is shown is the next one. The cache
+   * is dropped until the next keyframe when a GOP doesn't fit. 0 disables
+   * the cache.
+   *
+   * Consumers that join behind a tee can ask for the cached GOP with a
+   * custom upstream event named `GstRtpGopCacheReplay`. The GOP is then
+   * pushed to all consumers sharing the output.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_GOP_CACHE_SIZE,
+      g_param_spec_uint ("gop-cache-size", "GOP Cache Size",
+          "Maximum size in bytes of the cached GOP replayed to new consumers "
+          "(0 = disabled)", 0, G_MAXUINT, DEFAULT_GOP_CACHE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpH265Depay:keyframe-request-interval:
+   *
+   * Minimum interval in milliseconds between keyframe requests sent
+   * upstream, requests from downstream or after packet loss arriving in
+   * between are dropped. 0 sends all requests.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_KEYFRAME_REQUEST_INTERVAL,
+      g_param_spec_uint ("keyframe-request-interval",
+          "Keyframe Request Interval",
+          "Minimum interval in ms between keyframe requests sent upstream "
+          "(0 = no limit)", 0, G_MAXUINT, DEFAULT_KEYFRAME_REQUEST_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpH265Depay:stats:
+   *
+   * Various depayloader statistics. This property returns a #GstStructure
+   * with name application/x-rtp-h265-depay-stats with the following fields:
+   *
+   * * #guint64 `keyframe-requests`: the number of keyframe requests sent
+   *   upstream.
+   * * #guint64 `keyframe-requests-coalesced`: the number of keyframe requests
+   *   dropped because of #GstRtpH265Depay:keyframe-request-interval.
+   * * #guint64 `gop-cache-bytes`: the size of the cached GOP.
+   * * #guint `gop-cache-buffers`: the number of cached buffers.
+   * * #guint64 `gop-cache-gops`: the number of GOPs that were cached.
+   * * #guint64 `gop-cache-overflows`: the number of GOPs that didn't fit in
+   *   #GstRtpH265Depay:gop-cache-size.
+   * * #guint64 `gop-cache-replays`: the number of times the cache was
+   *   replayed.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Various statistics", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_add_static_pad_template (gstelement_class,
       &gst_rtp_h265_depay_src_template);
@@ -165,6 +336,16 @@ gst_rtp_h265_depay_init (GstRtpH265Depay * rtph265depay)
       (GDestroyNotify) gst_buffer_unref);
   rtph265depay->pps = g_ptr_array_new_with_free_func (
       (GDestroyNotify) gst_buffer_unref);
+  rtph265depay->zero_copy = DEFAULT_ZERO_COPY;
+
+  gst_rtp_gop_cache_init (&rtph265depay->gop_cache);
+  rtph265depay->keyframe_request_interval = DEFAULT_KEYFRAME_REQUEST_INTERVAL;
+  rtph265depay->last_keyframe_request = -1;
+
+  gst_pad_set_event_function (GST_RTP_BASE_DEPAYLOAD_SRCPAD (rtph265depay),
+      gst_rtp_h265_depay_src_event);
+  g_signal_connect (GST_RTP_BASE_DEPAYLOAD_SRCPAD (rtph265depay), "linked",
+      G_CALLBACK (gst_rtp_h265_depay_src_linked), rtph265depay);
 }
 
 static void
@@ -173,6 +354,7 @@ gst_rtp_h265_depay_reset (GstRtpH265Depay * rtph265depay, gboolean hard)
   gst_adapter_clear (rtph265depay->adapter);
   rtph265depay->wait_start = TRUE;
   gst_adapter_clear (rtph265depay->picture_adapter);
+  rtph265depay->picture_n_memory = 0;
   rtph265depay->picture_start = FALSE;
   rtph265depay->last_keyframe = FALSE;
   rtph265depay->last_ts = 0;
@@ -183,6 +365,13 @@ gst_rtp_h265_depay_reset (GstRtpH265Depay * rtph265depay, gboolean hard)
   g_ptr_array_set_size (rtph265depay->pps, 0);
 
   if (hard) {
+    GST_OBJECT_LOCK (rtph265depay);
+    gst_rtp_gop_cache_clear (&rtph265depay->gop_cache);
+    gst_clear_buffer (&rtph265depay->gop_cache_headers);
+    rtph265depay->gop_cache_replay = FALSE;
+    rtph265depay->last_keyframe_request = -1;
+    GST_OBJECT_UNLOCK (rtph265depay);
+
     if (rtph265depay->allocator != NULL) {
       gst_object_unref (rtph265depay->allocator);
       rtph265depay->allocator = NULL;
@@ -223,6 +412,9 @@ gst_rtp_h265_depay_finalize (GObject * object)
   g_ptr_array_free (rtph265depay->sps, TRUE);
   g_ptr_array_free (rtph265depay->pps, TRUE);
 
+  gst_rtp_gop_cache_clear (&rtph265depay->gop_cache);
+  gst_clear_buffer (&rtph265depay->gop_cache_headers);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -308,6 +500,10 @@ gst_rtp_h265_depay_negotiate (GstRtpH265Depay * rtph265depay)
         DEFAULT_ACCESS_UNIT);
     rtph265depay->merge = DEFAULT_ACCESS_UNIT;
   }
+
+  GST_OBJECT_LOCK (rtph265depay);
+  rtph265depay->gop_cache.access_units = rtph265depay->merge;
+  GST_OBJECT_UNLOCK (rtph265depay);
 }
 
 static gboolean
@@ -656,6 +852,11 @@ gst_rtp_h265_set_src_caps (GstRtpH265Depay * rtph265depay)
     if (rtph265depay->codec_data)
       gst_buffer_unref (rtph265depay->codec_data);
     rtph265depay->codec_data = codec_data;
+
+    /* a replayed GOP needs them too */
+    GST_OBJECT_LOCK (rtph265depay);
+    gst_buffer_replace (&rtph265depay->gop_cache_headers, codec_data);
+    GST_OBJECT_UNLOCK (rtph265depay);
   }
 
   if (res)
@@ -885,6 +1086,11 @@ gst_rtp_h265_depay_setcaps (GstRTPBaseDepayload * depayload, GstCaps * caps)
     if (rtph265depay->codec_data)
       gst_buffer_unref (rtph265depay->codec_data);
     rtph265depay->codec_data = codec_data;
+
+    /* a replayed GOP needs them too */
+    GST_OBJECT_LOCK (rtph265depay);
+    gst_buffer_replace (&rtph265depay->gop_cache_headers, codec_data);
+    GST_OBJECT_UNLOCK (rtph265depay);
   } else if (!rtph265depay->byte_stream) {
     gchar **params;
     gint i;
@@ -979,6 +1185,15 @@ gst_rtp_h265_complete_au (GstRtpH265Depay * rtph265depay,
   GST_DEBUG_OBJECT (rtph265depay, "taking completed AU");
   outsize = gst_adapter_available (rtph265depay->picture_adapter);
 
+  /* reference the NAL units, unless there are more memories than a buffer
+   * can hold, they would be merged again and again */
+  if (rtph265depay->zero_copy &&
+      rtph265depay->picture_n_memory <= gst_buffer_get_max_memory ()) {
+    outbuf = gst_adapter_take_buffer_fast (rtph265depay->picture_adapter,
+        outsize);
+    goto done;
+  }
+
   outbuf = gst_rtp_h265_depay_allocate_output_buffer (rtph265depay, outsize);
 
   if (outbuf == NULL)
@@ -1013,6 +1228,9 @@ gst_rtp_h265_complete_au (GstRtpH265Depay * rtph265depay,
   gst_buffer_list_unref (list);
   gst_buffer_unmap (outbuf, &outmap);
 
+done:
+  rtph265depay->picture_n_memory = 0;
+
   *out_timestamp = rtph265depay->last_ts;
   *out_keyframe = rtph265depay->last_keyframe;
 
@@ -1058,6 +1276,8 @@ static void
 gst_rtp_h265_depay_push (GstRtpH265Depay * rtph265depay, GstBuffer * outbuf,
     gboolean keyframe, GstClockTime timestamp, gboolean marker)
 {
+  GstBufferList *replay = NULL;
+
   /* prepend codec_data */
   if (rtph265depay->codec_data) {
     GST_DEBUG_OBJECT (rtph265depay, "prepending codec_data");
@@ -1080,25 +1300,75 @@ gst_rtp_h265_depay_push (GstRtpH265Depay * rtph265depay, GstBuffer * outbuf,
   if (marker)
     GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_MARKER);
 
+  GST_OBJECT_LOCK (rtph265depay);
+  if (rtph265depay->gop_cache_replay) {
+    rtph265depay->gop_cache_replay = FALSE;
+    /* a keyframe is as good as the cached GOP */
+    if (!keyframe)
+      replay = gst_rtp_gop_cache_replay (&rtph265depay->gop_cache,
+          rtph265depay->gop_cache_headers);
+  }
+  gst_rtp_gop_cache_add (&rtph265depay->gop_cache, outbuf);
+  GST_OBJECT_UNLOCK (rtph265depay);
+
+  if (replay) {
+    GST_DEBUG_OBJECT (rtph265depay, "replaying %u cached buffers",
+        gst_buffer_list_length (replay));
+    gst_rtp_base_depayload_push_list (GST_RTP_BASE_DEPAYLOAD (rtph265depay),
+        replay);
+  }
+
   gst_rtp_base_depayload_push (GST_RTP_BASE_DEPAYLOAD (rtph265depay), outbuf);
 }
 
+/* Sends @event upstream, unless a keyframe was requested less than
+ * keyframe-request-interval ago */
+static gboolean
+gst_rtp_h265_depay_request_keyframe (GstRtpH265Depay * rtph265depay,
+    GstEvent * event)
+{
+  gint64 now = g_get_monotonic_time ();
+  gboolean coalesce;
+
+  GST_OBJECT_LOCK (rtph265depay);
+  coalesce = rtph265depay->last_keyframe_request != -1 &&
+      now - rtph265depay->last_keyframe_request <
+      (gint64) rtph265depay->keyframe_request_interval * 1000;
+  if (coalesce) {
+    rtph265depay->num_keyframe_requests_coalesced++;
+  } else {
+    rtph265depay->last_keyframe_request = now;
+    rtph265depay->num_keyframe_requests++;
+  }
+  GST_OBJECT_UNLOCK (rtph265depay);
+
+  if (coalesce) {
+    GST_DEBUG_OBJECT (rtph265depay, "coalescing keyframe request");
+    gst_event_unref (event);
+    return TRUE;
+  }
+
+  return gst_pad_push_event (GST_RTP_BASE_DEPAYLOAD_SINKPAD (rtph265depay),
+      event);
+}
+
 static void
 gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
     GstClockTime in_timestamp, gboolean marker)
 {
   GstRTPBaseDepayload *depayload = GST_RTP_BASE_DEPAYLOAD (rtph265depay);
   gint nal_type;
-  GstMapInfo map;
+  guint8 header[7] = { 0, };
   GstBuffer *outbuf = NULL;
   GstClockTime out_timestamp;
   gboolean keyframe, out_keyframe;
 
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  if (G_UNLIKELY (map.size < 5))
+  /* only look at the NAL header and the start of the slice header, the NAL
+   * might span several memories */
+  if (G_UNLIKELY (gst_buffer_extract (nal, 0, header, sizeof (header)) < 5))
     goto short_nal;
 
-  nal_type = (map.data[4] >> 1) & 0x3f;
+  nal_type = (header[4] >> 1) & 0x3f;
   GST_DEBUG_OBJECT (rtph265depay, "handle NAL type %d (RTP marker bit %d)",
       nal_type, marker);
 
@@ -1112,18 +1382,16 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
       gst_rtp_h265_depay_add_vps_sps_pps (rtph265depay,
           gst_buffer_copy_region (nal, GST_BUFFER_COPY_ALL,
               4, gst_buffer_get_size (nal) - 4));
-      gst_buffer_unmap (nal, &map);
       gst_buffer_unref (nal);
       return;
     } else if (rtph265depay->sps->len == 0 || rtph265depay->pps->len == 0) {
       /* Down push down any buffer in non-bytestream mode if the SPS/PPS haven't
        * go through yet
        */
-      gst_pad_push_event (GST_RTP_BASE_DEPAYLOAD_SINKPAD (depayload),
+      gst_rtp_h265_depay_request_keyframe (rtph265depay,
           gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
               gst_structure_new ("GstForceKeyUnit",
                   "all-headers", G_TYPE_BOOLEAN, TRUE, NULL)));
-      gst_buffer_unmap (nal, &map);
       gst_buffer_unref (nal);
       return;
     }
@@ -1142,7 +1410,7 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
       if (NAL_TYPE_IS_CODED_SLICE_SEGMENT (nal_type)) {
         /* A NAL unit (X) ends an access unit if the next-occurring VCL NAL unit (Y) has the high-order bit of the first byte after its NAL unit header equal to 1 */
         start = TRUE;
-        if (((map.data[6] >> 7) & 0x01) == 1) {
+        if (((header[6] >> 7) & 0x01) == 1) {
           complete = TRUE;
         }
       } else if ((nal_type >= 32 && nal_type <= 35)
@@ -1158,9 +1426,8 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
             &out_keyframe);
     }
     /* add to adapter */
-    gst_buffer_unmap (nal, &map);
-
     GST_DEBUG_OBJECT (depayload, "adding NAL to picture adapter");
+    rtph265depay->picture_n_memory += gst_buffer_n_memory (nal);
     gst_adapter_push (rtph265depay->picture_adapter, nal);
     rtph265depay->last_ts = in_timestamp;
     rtph265depay->last_keyframe |= keyframe;
@@ -1173,7 +1440,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
     /* no merge, output is input nal */
     GST_DEBUG_OBJECT (depayload, "using NAL as output");
     outbuf = nal;
-    gst_buffer_unmap (nal, &map);
   }
 
   if (outbuf) {
@@ -1187,7 +1453,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
 short_nal:
   {
     GST_WARNING_OBJECT (depayload, "dropping short NAL");
-    gst_buffer_unmap (nal, &map);
     gst_buffer_unref (nal);
     return;
   }
@@ -1197,23 +1462,29 @@ static void
 gst_rtp_h265_finish_fragmentation_unit (GstRtpH265Depay * rtph265depay)
 {
   guint outsize;
-  GstMapInfo map;
+  guint8 prefix[4];
   GstBuffer *outbuf;
 
   outsize = gst_adapter_available (rtph265depay->adapter);
   g_assert (outsize >= 4);
 
-  outbuf = gst_adapter_take_buffer (rtph265depay->adapter, outsize);
+  /* the fragments reference the RTP payloads, gather them once if there
+   * are more than a buffer can hold */
+  if (rtph265depay->zero_copy &&
+      rtph265depay->fu_n_memory <= gst_buffer_get_max_memory ())
+    outbuf = gst_adapter_take_buffer_fast (rtph265depay->adapter, outsize);
+  else
+    outbuf = gst_adapter_take_buffer (rtph265depay->adapter, outsize);
+  outbuf = gst_buffer_make_writable (outbuf);
 
-  gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
   GST_DEBUG_OBJECT (rtph265depay, "output %d bytes", outsize);
 
   if (rtph265depay->byte_stream) {
-    memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+    memcpy (prefix, sync_bytes, sizeof (sync_bytes));
   } else {
-    GST_WRITE_UINT32_BE (map.data, outsize - 4);
+    GST_WRITE_UINT32_BE (prefix, outsize - 4);
   }
-  gst_buffer_unmap (outbuf, &map);
+  gst_buffer_fill (outbuf, 0, prefix, sizeof (prefix));
 
   rtph265depay->current_fu_type = 0;
 
@@ -1221,6 +1492,35 @@ gst_rtp_h265_finish_fragmentation_unit (GstRtpH265Depay * rtph265depay)
       rtph265depay->fu_timestamp, rtph265depay->fu_marker);
 }
 
+/* Creates a buffer with @prefix_len bytes of @prefix followed by @size bytes
+ * of the payload of @rtp starting at @offset. In zero-copy mode the payload
+ * is referenced after a memory holding the prefix */
+static GstBuffer *
+gst_rtp_h265_depay_create_nal (GstRtpH265Depay * rtph265depay,
+    GstRTPBuffer * rtp, const guint8 * prefix, guint prefix_len, guint offset,
+    guint size)
+{
+  GstBuffer *outbuf;
+
+  if (rtph265depay->zero_copy) {
+    outbuf = gst_buffer_new_allocate (NULL, prefix_len, NULL);
+    gst_buffer_copy_into (outbuf, rtp->buffer, GST_BUFFER_COPY_MEMORY,
+        gst_rtp_buffer_get_header_len (rtp) + offset, size);
+  } else {
+    guint8 *data = gst_rtp_buffer_get_payload (rtp);
+
+    outbuf = gst_buffer_new_and_alloc (prefix_len + size);
+    gst_buffer_fill (outbuf, prefix_len, data + offset, size);
+  }
+
+  if (prefix_len > 0)
+    gst_buffer_fill (outbuf, 0, prefix, prefix_len);
+
+  gst_rtp_copy_video_meta (rtph265depay, outbuf, rtp->buffer);
+
+  return outbuf;
+}
+
 static GstBuffer *
 gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
 {
@@ -1240,9 +1540,9 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
 
   {
     gint payload_len;
-    guint8 *payload;
+    guint8 *payload, *payload_start;
     guint header_len;
-    GstMapInfo map;
+    guint8 prefix[6];
     guint outsize, nalu_size;
     GstClockTime timestamp;
     gboolean marker;
@@ -1256,7 +1556,7 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
     timestamp = GST_BUFFER_PTS (rtp->buffer);
 
     payload_len = gst_rtp_buffer_get_payload_len (rtp);
-    payload = gst_rtp_buffer_get_payload (rtp);
+    payload = payload_start = gst_rtp_buffer_get_payload (rtp);
     marker = gst_rtp_buffer_get_marker (rtp);
 
     GST_DEBUG_OBJECT (rtph265depay, "receiving %d bytes", payload_len);
@@ -1348,24 +1648,18 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
           if (nalu_size > (payload_len - 2))
             nalu_size = payload_len - 2;
 
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
-
-          gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
           if (rtph265depay->byte_stream) {
-            memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+            memcpy (prefix, sync_bytes, sizeof (sync_bytes));
           } else {
-            GST_WRITE_UINT32_BE (map.data, nalu_size);
+            GST_WRITE_UINT32_BE (prefix, nalu_size);
           }
 
           /* strip NALU size */
           payload += 2;
           payload_len -= 2;
 
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-          gst_buffer_unmap (outbuf, &map);
-
-          gst_rtp_copy_video_meta (rtph265depay, outbuf, rtp->buffer);
+          outbuf = gst_rtp_h265_depay_create_nal (rtph265depay, rtp, prefix,
+              sizeof (sync_bytes), payload - payload_start, nalu_size);
 
           if (payload_len - nalu_size <= 2)
             last = TRUE;
@@ -1442,33 +1736,24 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
               ((payload[0] & 0x3f) << 9) | (nuh_layer_id << 3) |
               nuh_temporal_id_plus1;
 
-          /* go back one byte so we can copy the payload + two bytes more in the front which
-           * will be overwritten by the nal_header
-           */
-          payload -= 1;
-          payload_len += 1;
-
-          nalu_size = payload_len;
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
+          /* strip FU header, the NAL header is written after room for the
+           * start code or NALU size, which is filled in
+           * finish_fragmentation_unit() */
+          payload += 1;
+          payload_len -= 1;
 
-          gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-          if (rtph265depay->byte_stream) {
-            GST_WRITE_UINT32_BE (map.data, 0x00000001);
-          } else {
-            /* will be fixed up in finish_fragmentation_unit() */
-            GST_WRITE_UINT32_BE (map.data, 0xffffffff);
-          }
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-          map.data[4] = nal_header >> 8;
-          map.data[5] = nal_header & 0xff;
-          gst_buffer_unmap (outbuf, &map);
+          memset (prefix, 0, sizeof (sync_bytes));
+          GST_WRITE_UINT16_BE (prefix + sizeof (sync_bytes), nal_header);
 
-          gst_rtp_copy_video_meta (rtph265depay, outbuf, rtp->buffer);
+          nalu_size = payload_len;
+          outsize = nalu_size + sizeof (prefix);
+          outbuf = gst_rtp_h265_depay_create_nal (rtph265depay, rtp, prefix,
+              sizeof (prefix), payload - payload_start, nalu_size);
 
           GST_DEBUG_OBJECT (rtph265depay, "queueing %d bytes", outsize);
 
           /* and assemble in the adapter */
+          rtph265depay->fu_n_memory = gst_buffer_n_memory (outbuf);
           gst_adapter_push (rtph265depay->adapter, outbuf);
         } else {
           if (rtph265depay->current_fu_type == 0) {
@@ -1498,14 +1783,13 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
           payload_len -= 1;
 
           outsize = payload_len;
-          outbuf = gst_buffer_new_and_alloc (outsize);
-          gst_buffer_fill (outbuf, 0, payload, outsize);
-
-          gst_rtp_copy_video_meta (rtph265depay, outbuf, rtp->buffer);
+          outbuf = gst_rtp_h265_depay_create_nal (rtph265depay, rtp, NULL, 0,
+              payload - payload_start, outsize);
 
           GST_DEBUG_OBJECT (rtph265depay, "queueing %d bytes", outsize);
 
           /* and assemble in the adapter */
+          rtph265depay->fu_n_memory += gst_buffer_n_memory (outbuf);
           gst_adapter_push (rtph265depay->adapter, outbuf);
         }
 
@@ -1534,19 +1818,15 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
 #endif
 
         nalu_size = payload_len;
-        outsize = nalu_size + sizeof (sync_bytes);
-        outbuf = gst_buffer_new_and_alloc (outsize);
 
-        gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
         if (rtph265depay->byte_stream) {
-          memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+          memcpy (prefix, sync_bytes, sizeof (sync_bytes));
         } else {
-          GST_WRITE_UINT32_BE (map.data, nalu_size);
+          GST_WRITE_UINT32_BE (prefix, nalu_size);
         }
-        memcpy (map.data + 4, payload, nalu_size);
-        gst_buffer_unmap (outbuf, &map);
 
-        gst_rtp_copy_video_meta (rtph265depay, outbuf, rtp->buffer);
+        outbuf = gst_rtp_h265_depay_create_nal (rtph265depay, rtp, prefix,
+            sizeof (sync_bytes), 0, nalu_size);
 
         gst_rtp_h265_depay_handle_nal (rtph265depay, outbuf, timestamp, marker);
         break;
@@ -1593,6 +1873,10 @@ gst_rtp_h265_depay_handle_event (GstRTPBaseDepayload * depay, GstEvent * event)
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_FLUSH_STOP:
       gst_rtp_h265_depay_reset (rtph265depay, FALSE);
+      /* downstream lost what it had, start again from the cached GOP */
+      GST_OBJECT_LOCK (rtph265depay);
+      rtph265depay->gop_cache_replay = TRUE;
+      GST_OBJECT_UNLOCK (rtph265depay);
       break;
     case GST_EVENT_EOS:
       gst_rtp_h265_depay_drain (rtph265depay);
@@ -1605,6 +1889,42 @@ gst_rtp_h265_depay_handle_event (GstRTPBaseDepayload * depay, GstEvent * event)
       GST_RTP_BASE_DEPAYLOAD_CLASS (parent_class)->handle_event (depay, event);
 }
 
+static gboolean
+gst_rtp_h265_depay_src_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstRtpH265Depay *rtph265depay = GST_RTP_H265_DEPAY (parent);
+
+  /* a keyframe request doesn't replay the cache, the other consumers that
+   * share this output would get the GOP twice */
+  if (gst_video_event_is_force_key_unit (event))
+    return gst_rtp_h265_depay_request_keyframe (rtph265depay, event);
+
+  if (gst_rtp_gop_cache_is_replay_event (event)) {
+    GST_DEBUG_OBJECT (rtph265depay, "replaying the cached GOP on request");
+    GST_OBJECT_LOCK (rtph265depay);
+    rtph265depay->gop_cache_replay = TRUE;
+    GST_OBJECT_UNLOCK (rtph265depay);
+    gst_event_unref (event);
+    return TRUE;
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static void
+gst_rtp_h265_depay_src_linked (GstPad * pad, GstPad * peer, gpointer user_data)
+{
+  GstRtpH265Depay *rtph265depay = user_data;
+
+  GST_DEBUG_OBJECT (rtph265depay, "linked to %" GST_PTR_FORMAT
+      ", replaying the cached GOP", peer);
+
+  GST_OBJECT_LOCK (rtph265depay);
+  rtph265depay->gop_cache_replay = TRUE;
+  GST_OBJECT_UNLOCK (rtph265depay);
+}
+
 static GstStateChangeReturn
 gst_rtp_h265_depay_change_state (GstElement * element,
     GstStateChange transition)
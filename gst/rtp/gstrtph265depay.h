@@ -24,6 +24,8 @@
 #include <gst/gst.h>
 #include <gst/base/gstadapter.h>
 #include <gst/rtp/gstrtpbasedepayload.h>
+
+#include "gstrtpgopcache.h"
 #include "gstrtph265types.h"
 
 G_BEGIN_DECLS
@@ -67,6 +69,7 @@ struct _GstRtpH265Depay
   /* nal merging */
   gboolean merge;
   GstAdapter *picture_adapter;
+  guint picture_n_memory;
   gboolean picture_start;
   GstClockTime last_ts;
   gboolean last_keyframe;
@@ -76,6 +79,7 @@ struct _GstRtpH265Depay
   guint16 last_fu_seqnum;
   GstClockTime fu_timestamp;
   gboolean fu_marker;
+  guint fu_n_memory;
 
   /* misc */
   GPtrArray *vps;
@@ -86,6 +90,18 @@ struct _GstRtpH265Depay
   /* downstream allocator */
   GstAllocator *allocator;
   GstAllocationParams params;
+
+  gboolean zero_copy;
+
+  /* protected by the object lock */
+  GstRtpGopCache gop_cache;
+  gboolean gop_cache_replay;
+  /* out-of-band parameter sets, prepended to a replayed GOP */
+  GstBuffer *gop_cache_headers;
+  guint keyframe_request_interval;
+  gint64 last_keyframe_request;
+  guint64 num_keyframe_requests;
+  guint64 num_keyframe_requests_coalesced;
 };
 
 struct _GstRtpH265DepayClass
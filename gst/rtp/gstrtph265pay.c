@@ -988,6 +988,7 @@ gst_rtp_h265_pay_reset_bundle (GstRtpH265Pay * rtph265pay)
 {
   g_clear_pointer (&rtph265pay->bundle, gst_buffer_list_unref);
   rtph265pay->bundle_size = 0;
+  rtph265pay->bundle_n_memory = 0;
   rtph265pay->bundle_contains_vcl_or_suffix = FALSE;
 }
 
@@ -1276,18 +1277,23 @@ gst_rtp_h265_pay_send_bundle (GstRtpH265Pay * rtph265pay, gboolean marker)
     GST_DEBUG_OBJECT (rtph265pay,
         "sending NAL Unit unaggregated: datasize=%u", bundle_size - 2);
   } else {
-    guint8 ap_header[2];
+    guint8 *ap_header;
+    GstMemory *headers;
+    GstMapInfo map;
     guint i;
     guint8 layer_id = 0xFF;
     guint8 temporal_id = 0xFF;
 
-    outbuf = gst_buffer_new_allocate (NULL, sizeof ap_header, NULL);
+    /* the AP header and all the NALU sizes are written in one memory, the
+     * packet references it and the NALU data in between */
+    headers = gst_allocator_alloc (NULL, 2 + 2 * length, NULL);
+    gst_memory_map (headers, &map, GST_MAP_WRITE);
+    ap_header = map.data;
+    ap_header[0] = 0;
 
     for (i = 0; i < length; i++) {
       GstBuffer *buf = gst_buffer_list_get (bundle, i);
       guint8 nal_header[2];
-      GstMemory *size_header;
-      GstMapInfo map;
       guint8 nal_layer_id;
       guint8 nal_temporal_id;
 
@@ -1304,25 +1310,36 @@ gst_rtp_h265_pay_send_bundle (GstRtpH265Pay * rtph265pay, gboolean marker)
       layer_id = MIN (layer_id, nal_layer_id);
       temporal_id = MIN (temporal_id, nal_temporal_id);
 
-      /* append NALU size */
-      size_header = gst_allocator_alloc (NULL, 2, NULL);
-      gst_memory_map (size_header, &map, GST_MAP_WRITE);
-      GST_WRITE_UINT16_BE (map.data, gst_buffer_get_size (buf));
-      gst_memory_unmap (size_header, &map);
-      gst_buffer_append_memory (outbuf, size_header);
-
-      /* append NALU data */
-      outbuf = gst_buffer_append (outbuf, gst_buffer_ref (buf));
+      /* NALU size */
+      GST_WRITE_UINT16_BE (map.data + 2 + 2 * i, gst_buffer_get_size (buf));
     }
 
     ap_header[0] = (AP_TYPE_ID << 1) | (layer_id & 0x20);
     ap_header[1] = ((layer_id & 0x1F) << 3) | (temporal_id & 0x07);
 
-    gst_buffer_fill (outbuf, 0, &ap_header, sizeof ap_header);
-
     GST_DEBUG_OBJECT (rtph265pay,
         "sending AP bundle: n=%u header=%02x%02x datasize=%u",
         length, ap_header[0], ap_header[1], bundle_size);
+
+    gst_memory_unmap (headers, &map);
+
+    outbuf = gst_buffer_new ();
+
+    for (i = 0; i < length; i++) {
+      GstBuffer *buf = gst_buffer_list_get (bundle, i);
+
+      /* append NALU size, after the AP header for the first one */
+      if (i == 0)
+        gst_buffer_append_memory (outbuf, gst_memory_share (headers, 0, 4));
+      else
+        gst_buffer_append_memory (outbuf,
+            gst_memory_share (headers, 2 + 2 * i, 2));
+
+      /* append NALU data */
+      gst_buffer_copy_into (outbuf, buf, GST_BUFFER_COPY_MEMORY, 0, -1);
+    }
+
+    gst_memory_unref (headers);
   }
 
   gst_rtp_h265_pay_reset_bundle (rtph265pay);
@@ -1337,7 +1354,7 @@ gst_rtp_h265_pay_payload_nal_bundle (GstRTPBasePayload * basepayload,
 {
   GstRtpH265Pay *rtph265pay;
   GstFlowReturn ret;
-  guint pay_size, bundle_size;
+  guint pay_size, bundle_size, n_memory;
   GstBufferList *bundle;
   gboolean start_of_au;
   guint mtu;
@@ -1400,10 +1417,28 @@ gst_rtp_h265_pay_payload_nal_bundle (GstRTPBasePayload * basepayload,
     bundle = NULL;
   }
 
+  /* the NALU size and the NALU memories, the packet also has one for the
+   * RTP header. More than a buffer can hold would be merged by copying */
+  n_memory = 1 + gst_buffer_n_memory (paybuf);
+
+  if (bundle && 1 + rtph265pay->bundle_n_memory + n_memory >
+      gst_buffer_get_max_memory ()) {
+    GST_DEBUG_OBJECT (rtph265pay,
+        "bundle has too many memories, sending: n_memory=%u",
+        rtph265pay->bundle_n_memory);
+
+    ret = gst_rtp_h265_pay_send_bundle (rtph265pay, FALSE);
+    if (ret != GST_FLOW_OK)
+      goto out;
+
+    bundle = NULL;
+  }
+
   if (!bundle) {
     GST_DEBUG_OBJECT (rtph265pay, "creating new AP aggregate");
     bundle = rtph265pay->bundle = gst_buffer_list_new ();
     bundle_size = rtph265pay->bundle_size = 2;
+    rtph265pay->bundle_n_memory = 0;
     rtph265pay->bundle_contains_vcl_or_suffix = FALSE;
   }
 
@@ -1417,6 +1452,7 @@ gst_rtp_h265_pay_payload_nal_bundle (GstRTPBasePayload * basepayload,
 
   gst_buffer_list_add (bundle, gst_buffer_ref (paybuf));
   rtph265pay->bundle_size += pay_size;
+  rtph265pay->bundle_n_memory += n_memory;
   ret = GST_FLOW_OK;
 
   /* In H.265, all VCL NAL units are < 32 */
@@ -1652,7 +1688,8 @@ gst_rtp_h265_pay_handle_buffer (GstRTPBasePayload * basepayload,
         for (; size > 2 && data[size - 1] == 0x0; size--)
           /* skip */ ;
 
-      paybuf = gst_adapter_take_buffer (rtph265pay->adapter, size);
+      /* reference the NAL data, even when it spans several input buffers */
+      paybuf = gst_adapter_take_buffer_fast (rtph265pay->adapter, size);
       g_assert (paybuf);
       g_ptr_array_add (paybufs, paybuf);
 
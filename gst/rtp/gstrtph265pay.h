@@ -76,6 +76,7 @@ struct _GstRtpH265Pay
   /* aggregate buffers with AP */
   GstBufferList *bundle;
   guint bundle_size;
+  guint bundle_n_memory;
   gboolean bundle_contains_vcl_or_suffix;
   GstRTPH265AggregateMode aggregate_mode;
 };
@@ -56,6 +56,14 @@ struct _GstRTPHeaderExtensionColorspace
   GstVideoMasteringDisplayInfo mdi;
   GstVideoContentLightLevel cll;
   gboolean has_hdr_meta;
+
+  /* the element written to every packet, made when the caps are set */
+  guint8 data[GST_RTP_HDREXT_COLORSPACE_WITH_HDR_META_SIZE];
+  gsize data_size;
+
+  /* the last element that was read */
+  guint8 last_read[GST_RTP_HDREXT_COLORSPACE_WITH_HDR_META_SIZE];
+  gsize last_read_size;
 };
 
 G_DEFINE_TYPE_WITH_CODE (GstRTPHeaderExtensionColorspace,
@@ -95,39 +103,21 @@ gst_rtp_header_extension_colorspace_get_max_size (GstRTPHeaderExtension * ext,
       GST_RTP_HDREXT_COLORSPACE_SIZE;
 }
 
-static gssize
-gst_rtp_header_extension_colorspace_write (GstRTPHeaderExtension * ext,
-    const GstBuffer * input_meta, GstRTPHeaderExtensionFlags write_flags,
-    GstBuffer * output, guint8 * data, gsize size)
+static void
+gst_rtp_header_extension_colorspace_update_data (GstRTPHeaderExtensionColorspace
+    * self)
 {
-  GstRTPHeaderExtensionColorspace *self =
-      GST_RTP_HEADER_EXTENSION_COLORSPACE (ext);
-  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
-  gboolean is_frame_last_buffer;
-  guint8 *ptr = data;
+  guint8 *ptr = self->data;
   guint8 horizontal_site;
   guint8 vertical_site;
 
-  g_return_val_if_fail (size >=
-      gst_rtp_header_extension_colorspace_get_max_size (ext, NULL), -1);
-  g_return_val_if_fail (write_flags &
-      gst_rtp_header_extension_colorspace_get_supported_flags (ext), -1);
-
   if (self->colorimetry.matrix == GST_VIDEO_COLOR_MATRIX_UNKNOWN &&
       self->colorimetry.primaries == GST_VIDEO_COLOR_PRIMARIES_UNKNOWN &&
       self->colorimetry.range == GST_VIDEO_COLOR_RANGE_UNKNOWN &&
       self->colorimetry.transfer == GST_VIDEO_TRANSFER_UNKNOWN) {
     /* Nothing to write. */
-    return 0;
-  }
-
-  gst_rtp_buffer_map (output, GST_MAP_READ, &rtp);
-  is_frame_last_buffer = gst_rtp_buffer_get_marker (&rtp);
-  gst_rtp_buffer_unmap (&rtp);
-
-  if (!is_frame_last_buffer) {
-    /* Only a video frame's final packet should carry color space info. */
-    return 0;
+    self->data_size = 0;
+    return;
   }
 
   *ptr++ = gst_video_color_primaries_to_iso (self->colorimetry.primaries);
@@ -180,7 +170,37 @@ gst_rtp_header_extension_colorspace_write (GstRTPHeaderExtension * ext,
     ptr += 2;
   }
 
-  return ptr - data;
+  self->data_size = ptr - self->data;
+}
+
+static gssize
+gst_rtp_header_extension_colorspace_write (GstRTPHeaderExtension * ext,
+    const GstBuffer * input_meta, GstRTPHeaderExtensionFlags write_flags,
+    GstBuffer * output, guint8 * data, gsize size)
+{
+  GstRTPHeaderExtensionColorspace *self =
+      GST_RTP_HEADER_EXTENSION_COLORSPACE (ext);
+  guint8 first_bytes[2];
+
+  g_return_val_if_fail (size >=
+      gst_rtp_header_extension_colorspace_get_max_size (ext, NULL), -1);
+  g_return_val_if_fail (write_flags &
+      gst_rtp_header_extension_colorspace_get_supported_flags (ext), -1);
+
+  if (self->data_size == 0)
+    return 0;
+
+  /* This is called for every packet, only look at the marker bit instead of
+   * mapping the whole RTP packet. */
+  if (gst_buffer_extract (output, 0, first_bytes, 2) != 2 ||
+      !(first_bytes[1] & 0x80)) {
+    /* Only a video frame's final packet should carry color space info. */
+    return 0;
+  }
+
+  memcpy (data, self->data, self->data_size);
+
+  return self->data_size;
 }
 
 static gboolean
@@ -319,7 +339,7 @@ gst_rtp_header_extension_colorspace_read (GstRTPHeaderExtension * ext,
   GstVideoChromaSite chroma_site;
   GstVideoMasteringDisplayInfo mdi;
   GstVideoContentLightLevel cll;
-  gboolean caps_update_needed;
+  gboolean caps_update_needed = FALSE;
   gboolean result;
 
   if (size != GST_RTP_HDREXT_COLORSPACE_SIZE &&
@@ -329,6 +349,11 @@ gst_rtp_header_extension_colorspace_read (GstRTPHeaderExtension * ext,
     return FALSE;
   }
 
+  /* The same element is repeated on every frame, nothing changes then. */
+  if (size == self->last_read_size && memcmp (data, self->last_read,
+          size) == 0)
+    return TRUE;
+
   has_hdr_meta = size == GST_RTP_HDREXT_COLORSPACE_WITH_HDR_META_SIZE;
 
   reader = gst_byte_reader_new (data, size);
@@ -342,6 +367,12 @@ gst_rtp_header_extension_colorspace_read (GstRTPHeaderExtension * ext,
 
   g_clear_pointer (&reader, gst_byte_reader_free);
 
+  if (!result)
+    return FALSE;
+
+  memcpy (self->last_read, data, size);
+  self->last_read_size = size;
+
   if (!gst_video_colorimetry_is_equal (&self->colorimetry, &colorimetry)) {
     caps_update_needed = TRUE;
     self->colorimetry = colorimetry;
@@ -402,6 +433,8 @@ static gboolean
     self->chroma_site = gst_video_chroma_from_string (chroma_site);
   }
 
+  gst_rtp_header_extension_colorspace_update_data (self);
+
   return TRUE;
 }
 
@@ -140,6 +140,8 @@ gst_rtp_jpeg_depay_reset (GstRtpJPEGDepay * depay)
     depay->qtables[i] = NULL;
   }
 
+  gst_buffer_replace (&depay->header, NULL);
+
   gst_adapter_clear (depay->adapter);
 }
 
@@ -624,7 +626,7 @@ gst_rtp_jpeg_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
 
   if (frag_offset == 0) {
     GstMapInfo map;
-    guint size;
+    guint size, qsize;
 
     if (rtpjpegdepay->width != width || rtpjpegdepay->height != height) {
       GstCaps *outcaps;
@@ -671,16 +673,40 @@ gst_rtp_jpeg_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
     if (!qtable)
       goto no_qtable;
 
-    /* max header length, should be big enough */
-    outbuf = gst_buffer_new_and_alloc (1000);
-    gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-    size = MakeHeaders (map.data, type, width, height, qtable, precision, dri);
-    gst_buffer_unmap (outbuf, &map);
-    gst_buffer_resize (outbuf, 0, size);
+    qsize = ((precision & 1) ? 128 : 64) + ((precision & 2) ? 128 : 64);
+
+    /* the header only depends on these values, which almost never change in
+     * a stream, so reuse the previous one when we can */
+    if (rtpjpegdepay->header == NULL || rtpjpegdepay->header_type != type ||
+        rtpjpegdepay->header_width != width ||
+        rtpjpegdepay->header_height != height ||
+        rtpjpegdepay->header_precision != precision ||
+        rtpjpegdepay->header_dri != dri ||
+        memcmp (rtpjpegdepay->header_qtable, qtable, qsize) != 0) {
+      /* max header length, should be big enough */
+      outbuf = gst_buffer_new_and_alloc (1000);
+      gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
+      size = MakeHeaders (map.data, type, width, height, qtable, precision,
+          dri);
+      gst_buffer_unmap (outbuf, &map);
+      gst_buffer_resize (outbuf, 0, size);
+
+      GST_DEBUG_OBJECT (rtpjpegdepay, "made %u bytes of header", size);
+
+      gst_buffer_replace (&rtpjpegdepay->header, outbuf);
+      gst_buffer_unref (outbuf);
+      rtpjpegdepay->header_type = type;
+      rtpjpegdepay->header_width = width;
+      rtpjpegdepay->header_height = height;
+      rtpjpegdepay->header_precision = precision;
+      rtpjpegdepay->header_dri = dri;
+      memcpy (rtpjpegdepay->header_qtable, qtable, qsize);
+    }
 
-    GST_DEBUG_OBJECT (rtpjpegdepay, "pushing %u bytes of header", size);
+    GST_DEBUG_OBJECT (rtpjpegdepay, "pushing header");
 
-    gst_adapter_push (rtpjpegdepay->adapter, outbuf);
+    gst_adapter_push (rtpjpegdepay->adapter,
+        gst_buffer_ref (rtpjpegdepay->header));
   }
 
   /* take JPEG data, push in the adapter */
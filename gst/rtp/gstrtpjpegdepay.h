@@ -49,6 +49,12 @@ struct _GstRtpJPEGDepay
 
   /* cached quant tables */
   guint8 * qtables[255];
+  /* last generated JPEG header and the values it was made from */
+  GstBuffer *header;
+  guint header_type;
+  guint header_width, header_height;
+  guint16 header_precision, header_dri;
+  guint8 header_qtable[256];
   gint frate_num;
   gint frate_denom;
   gint media_width;
@@ -235,6 +235,8 @@ typedef struct
 
 /* FIXME: restart marker header currently unsupported */
 
+static void gst_rtp_jpeg_pay_finalize (GObject * object);
+
 static void gst_rtp_jpeg_pay_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 
@@ -263,6 +265,7 @@ gst_rtp_jpeg_pay_class_init (GstRtpJPEGPayClass * klass)
   gstelement_class = (GstElementClass *) klass;
   gstrtpbasepayload_class = (GstRTPBasePayloadClass *) klass;
 
+  gobject_class->finalize = gst_rtp_jpeg_pay_finalize;
   gobject_class->set_property = gst_rtp_jpeg_pay_set_property;
   gobject_class->get_property = gst_rtp_jpeg_pay_get_property;
 
@@ -305,6 +308,27 @@ gst_rtp_jpeg_pay_init (GstRtpJPEGPay * pay)
   GST_RTP_BASE_PAYLOAD_PT (pay) = GST_RTP_PAYLOAD_JPEG;
 }
 
+static void
+gst_rtp_jpeg_pay_clear_cache (GstRtpJPEGPay * pay)
+{
+  g_free (pay->cache_data);
+  pay->cache_data = NULL;
+  pay->cache_size = 0;
+
+  if (pay->cache_quant) {
+    gst_memory_unref (pay->cache_quant);
+    pay->cache_quant = NULL;
+  }
+}
+
+static void
+gst_rtp_jpeg_pay_finalize (GObject * object)
+{
+  gst_rtp_jpeg_pay_clear_cache (GST_RTP_JPEG_PAY (object));
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gboolean
 gst_rtp_jpeg_pay_setcaps (GstRTPBasePayload * basepayload, GstCaps * caps)
 {
@@ -709,6 +733,52 @@ gst_rtp_jpeg_pay_scan_marker (GstBufferMemoryMap * memory)
   }
 }
 
+/*
+ * Check if @buffer starts with the same header as the previous frame. Camera
+ * streams mostly use the same tables for every frame, so this is a lot
+ * cheaper than scanning all the markers again. On a match the values parsed
+ * from the previous frame are restored.
+ */
+static gboolean
+gst_rtp_jpeg_pay_lookup_cache (GstRtpJPEGPay * pay, GstBuffer * buffer,
+    gsize size)
+{
+  if (pay->cache_data == NULL || pay->cache_size > size)
+    return FALSE;
+
+  if (gst_buffer_memcmp (buffer, 0, pay->cache_data, pay->cache_size) != 0)
+    return FALSE;
+
+  pay->type = pay->cache_type;
+  pay->width = pay->cache_width;
+  pay->height = pay->cache_height;
+
+  return TRUE;
+}
+
+static void
+gst_rtp_jpeg_pay_store_cache (GstRtpJPEGPay * pay, GstBuffer * buffer,
+    guint header_size, gboolean dri_found, RtpRestartMarkerHeader * dri,
+    GstMemory * quant)
+{
+  if (pay->cache_size != header_size) {
+    g_free (pay->cache_data);
+    pay->cache_data = g_malloc (header_size);
+    pay->cache_size = header_size;
+  }
+  gst_buffer_extract (buffer, 0, pay->cache_data, header_size);
+
+  pay->cache_type = pay->type;
+  pay->cache_width = pay->width;
+  pay->cache_height = pay->height;
+  pay->cache_dri_found = dri_found;
+  pay->cache_restart_interval = dri_found ? dri->restart_interval : 0;
+
+  if (pay->cache_quant)
+    gst_memory_unref (pay->cache_quant);
+  pay->cache_quant = quant ? gst_memory_ref (quant) : NULL;
+}
+
 #define RTP_HEADER_LEN 12
 
 static GstFlowReturn
@@ -723,6 +793,7 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
   RtpRestartMarkerHeader restart_marker_header;
   RtpQuantTable tables[15] = { {0, NULL}, };
   CompInfo info[3] = { {0,}, };
+  GstMemory *quant = NULL;
   guint quant_data_size;
   guint mtu, max_payload_size;
   guint bytes_left;
@@ -747,6 +818,17 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
       " , timestamp %" GST_TIME_FORMAT, memory.total_size,
       GST_TIME_ARGS (timestamp));
 
+  if (gst_rtp_jpeg_pay_lookup_cache (pay, buffer, memory.total_size)) {
+    GST_LOG_OBJECT (pay, "same header as previous frame");
+    jpeg_header_size = pay->cache_size;
+    dri_found = pay->cache_dri_found;
+    restart_marker_header.restart_interval = pay->cache_restart_interval;
+    restart_marker_header.restart_count = g_htons (0xFFFF);
+    if (pay->cache_quant)
+      quant = gst_memory_ref (pay->cache_quant);
+    goto header_done;
+  }
+
   /* parse the jpeg header for 'start of scan' and read quant tables if needed */
   sos_found = FALSE;
   dqt_found = FALSE;
@@ -819,17 +901,9 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
 
   GST_LOG_OBJECT (pay, "header size %u", jpeg_header_size);
 
-  offset = 0;
-
   if (dri_found)
     pay->type += 64;
 
-  /* prepare stuff for the jpeg header */
-  jpeg_header.type_spec = 0;
-  jpeg_header.type = pay->type;
-  jpeg_header.q = pay->quant;
-  jpeg_header.width = pay->width;
-  jpeg_header.height = pay->height;
   /* collect the quant headers sizes */
   quant_header.mbz = 0;
   quant_header.precision = 0;
@@ -837,6 +911,9 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
   quant_data_size = 0;
 
   if (pay->quant > 127) {
+    GstMapInfo map;
+    guint8 *data;
+
     /* for the Y and U component, look up the quant table and its size. quant
      * tables for U and V should be the same */
     for (i = 0; i < 2; i++) {
@@ -856,8 +933,48 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
     }
     quant_header.length = g_htons (quant_data_size);
     quant_data_size += sizeof (quant_header);
+
+    /* the quant tables are only sent with the first packet, prepare them
+     * once so that the packets of the next frames can share them */
+    quant = gst_allocator_alloc (NULL, quant_data_size, NULL);
+    gst_memory_map (quant, &map, GST_MAP_WRITE);
+    data = map.data;
+    memcpy (data, &quant_header, sizeof (quant_header));
+    data += sizeof (quant_header);
+
+    /* copy the quant tables for luma and chrominance */
+    for (i = 0; i < 2; i++) {
+      guint qsize;
+      guint qt;
+
+      qt = info[i].qt;
+      qsize = tables[qt].size;
+      memcpy (data, tables[qt].data, qsize);
+
+      GST_LOG_OBJECT (pay, "component %d using quant %d, size %d", i, qt,
+          qsize);
+
+      data += qsize;
+    }
+    gst_memory_unmap (quant, &map);
   }
 
+  if (sos_found)
+    gst_rtp_jpeg_pay_store_cache (pay, buffer, jpeg_header_size, dri_found,
+        &restart_marker_header, quant);
+
+header_done:
+  offset = 0;
+
+  /* prepare stuff for the jpeg header */
+  jpeg_header.type_spec = 0;
+  jpeg_header.type = pay->type;
+  jpeg_header.q = pay->quant;
+  jpeg_header.width = pay->width;
+  jpeg_header.height = pay->height;
+
+  quant_data_size = quant ? gst_memory_get_sizes (quant, NULL, NULL) : 0;
+
   GST_LOG_OBJECT (pay, "quant_data size %u", quant_data_size);
 
   bytes_left =
@@ -885,7 +1002,7 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
         (bytes_left < (mtu - rtp_header_size) ? bytes_left :
         (mtu - rtp_header_size));
 
-    header_size = sizeof (jpeg_header) + quant_data_size;
+    header_size = sizeof (jpeg_header);
     if (dri_found)
       header_size += sizeof (restart_marker_header);
 
@@ -920,31 +1037,16 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
       payload_size -= sizeof (restart_marker_header);
     }
 
+    gst_rtp_buffer_unmap (&rtp);
+
     /* only send quant table with first packet */
     if (G_UNLIKELY (quant_data_size > 0)) {
-      memcpy (payload, &quant_header, sizeof (quant_header));
-      payload += sizeof (quant_header);
-
-      /* copy the quant tables for luma and chrominance */
-      for (i = 0; i < 2; i++) {
-        guint qsize;
-        guint qt;
-
-        qt = info[i].qt;
-        qsize = tables[qt].size;
-        memcpy (payload, tables[qt].data, qsize);
-
-        GST_LOG_OBJECT (pay, "component %d using quant %d, size %d", i, qt,
-            qsize);
-
-        payload += qsize;
-      }
+      gst_buffer_append_memory (outbuf, gst_memory_ref (quant));
       payload_size -= quant_data_size;
       bytes_left -= quant_data_size;
       quant_data_size = 0;
     }
     GST_LOG_OBJECT (pay, "sending payload size %d", payload_size);
-    gst_rtp_buffer_unmap (&rtp);
 
     /* create a new buf to hold the payload */
     paybuf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_ALL,
@@ -972,6 +1074,8 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
   /* push the whole buffer list at once */
   ret = gst_rtp_base_payload_push_list (basepayload, list);
 
+  if (quant)
+    gst_memory_unref (quant);
   gst_buffer_memory_unmap (&memory);
   gst_buffer_unref (buffer);
 
@@ -48,6 +48,18 @@ struct _GstRtpJPEGPay
   gint width;
 
   guint8 quant;
+
+  /* header of the previous frame up to the end of the SOS segment and what
+   * was parsed from it, reused as long as the frames start with the same
+   * bytes */
+  guint8 *cache_data;
+  guint cache_size;
+  guint8 cache_type;
+  gint cache_width;
+  gint cache_height;
+  gboolean cache_dri_found;
+  guint16 cache_restart_interval;
+  GstMemory *cache_quant;
 };
 
 struct _GstRtpJPEGPayClass
@@ -73,12 +73,14 @@ enum
   PROP_0,
   PROP_SIZE_TIME,
   PROP_INTERNAL_STORAGE,
+  PROP_SIZE_BYTES,
   N_PROPERTIES
 };
 
 static GParamSpec *klass_properties[N_PROPERTIES] = { NULL, };
 
 #define DEFAULT_SIZE_TIME (0)
+#define DEFAULT_SIZE_BYTES (0)
 
 GST_DEBUG_CATEGORY (gst_rtp_storage_debug);
 #define GST_CAT_DEFAULT (gst_rtp_storage_debug)
@@ -109,6 +111,9 @@ gst_rtp_storage_set_property (GObject * object, guint prop_id,
           GST_TIME_ARGS (g_value_get_uint64 (value)));
       rtp_storage_set_size (self->storage, g_value_get_uint64 (value));
       break;
+    case PROP_SIZE_BYTES:
+      rtp_storage_set_size_bytes (self->storage, g_value_get_uint64 (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -129,6 +134,9 @@ gst_rtp_storage_get_property (GObject * object, guint prop_id,
       g_value_set_object (value, self->storage);
       break;
     }
+    case PROP_SIZE_BYTES:
+      g_value_set_uint64 (value, rtp_storage_get_size_bytes (self->storage));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -216,6 +224,21 @@ gst_rtp_storage_class_init (GstRtpStorageClass * klass)
       "Internal RtpStorage object", G_TYPE_OBJECT,
       G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstRtpStorage:size-bytes:
+   *
+   * The maximum amount of data to keep in the storage for all streams
+   * together, in addition to #GstRtpStorage:size-time. When exceeded the
+   * packets stored first are dropped, whatever their stream.
+   *
+   * Since: 1.20
+   */
+  klass_properties[PROP_SIZE_BYTES] =
+      g_param_spec_uint64 ("size-bytes", "Storage size (in bytes)",
+      "The amount of data to keep in the storage for all streams "
+      "(in bytes, 0-unlimited)", 0, G_MAXUINT64, DEFAULT_SIZE_BYTES,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, N_PROPERTIES,
       klass_properties);
 }
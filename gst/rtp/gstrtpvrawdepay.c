@@ -323,6 +323,56 @@ no_bufferpool:
   }
 }
 
+/* samples are packed in order Cb-Y-Cr for both interlaced and progressive
+ * frames */
+static void
+unpack_ayuv (guint8 * out, const guint8 * in, guint pgroups)
+{
+  guint i;
+
+  for (i = 0; i < pgroups; i++) {
+    out[4 * i + 0] = 0;
+    out[4 * i + 1] = in[3 * i + 1];
+    out[4 * i + 2] = in[3 * i + 0];
+    out[4 * i + 3] = in[3 * i + 2];
+  }
+}
+
+/* line 0/1: Y00-Y01-Y10-Y11-Cb00-Cr00 Y02-Y03-Y12-Y13-Cb01-Cr01 ...  */
+static void
+unpack_i420 (guint8 * y1, guint8 * y2, guint8 * u, guint8 * v,
+    const guint8 * in, guint pgroups)
+{
+  guint i;
+
+  for (i = 0; i < pgroups; i++) {
+    y1[2 * i + 0] = in[6 * i + 0];
+    y1[2 * i + 1] = in[6 * i + 1];
+    y2[2 * i + 0] = in[6 * i + 2];
+    y2[2 * i + 1] = in[6 * i + 3];
+    u[i] = in[6 * i + 4];
+    v[i] = in[6 * i + 5];
+  }
+}
+
+/* Samples are packed in order Cb0-Y0-Y1-Cr0-Y2-Y3 for both interlaced
+ * and progressive scan lines */
+static void
+unpack_y41b (guint8 * y, guint8 * u, guint8 * v, const guint8 * in,
+    guint pgroups)
+{
+  guint i;
+
+  for (i = 0; i < pgroups; i++) {
+    u[i] = in[6 * i + 0];
+    y[4 * i + 0] = in[6 * i + 1];
+    y[4 * i + 1] = in[6 * i + 2];
+    v[i] = in[6 * i + 3];
+    y[4 * i + 2] = in[6 * i + 4];
+    y[4 * i + 3] = in[6 * i + 5];
+  }
+}
+
 static GstBuffer *
 gst_rtp_vraw_depay_process_packet (GstRTPBaseDepayload * depayload,
     GstRTPBuffer * rtp)
@@ -485,74 +535,29 @@ gst_rtp_vraw_depay_process_packet (GstRTPBaseDepayload * depayload,
         memcpy (datap, payload, plen);
         break;
       case GST_VIDEO_FORMAT_AYUV:
-      {
-        gint i;
-        guint8 *p;
-
         datap = p0 + (line * ystride) + (offs * 4);
-        p = payload;
-
-        /* samples are packed in order Cb-Y-Cr for both interlaced and
-         * progressive frames */
-        for (i = 0; i < plen; i += pgroup) {
-          *datap++ = 0;
-          *datap++ = p[1];
-          *datap++ = p[0];
-          *datap++ = p[2];
-          p += pgroup;
-        }
+        unpack_ayuv (datap, payload, plen / pgroup);
         break;
-      }
       case GST_VIDEO_FORMAT_I420:
       {
-        gint i;
         guint uvoff;
-        guint8 *yd1p, *yd2p, *udp, *vdp, *p;
+        guint8 *yd1p;
 
         yd1p = yp + (line * ystride) + (offs);
-        yd2p = yd1p + ystride;
         uvoff = (line / yinc * uvstride) + (offs / xinc);
 
-        udp = up + uvoff;
-        vdp = vp + uvoff;
-        p = payload;
-
-        /* line 0/1: Y00-Y01-Y10-Y11-Cb00-Cr00 Y02-Y03-Y12-Y13-Cb01-Cr01 ...  */
-        for (i = 0; i < plen; i += pgroup) {
-          *yd1p++ = p[0];
-          *yd1p++ = p[1];
-          *yd2p++ = p[2];
-          *yd2p++ = p[3];
-          *udp++ = p[4];
-          *vdp++ = p[5];
-          p += pgroup;
-        }
+        unpack_i420 (yd1p, yd1p + ystride, up + uvoff, vp + uvoff, payload,
+            plen / pgroup);
         break;
       }
       case GST_VIDEO_FORMAT_Y41B:
       {
-        gint i;
         guint uvoff;
-        guint8 *ydp, *udp, *vdp, *p;
 
-        ydp = yp + (line * ystride) + (offs);
+        datap = yp + (line * ystride) + (offs);
         uvoff = (line / yinc * uvstride) + (offs / xinc);
 
-        udp = up + uvoff;
-        vdp = vp + uvoff;
-        p = payload;
-
-        /* Samples are packed in order Cb0-Y0-Y1-Cr0-Y2-Y3 for both interlaced
-         * and progressive scan lines */
-        for (i = 0; i < plen; i += pgroup) {
-          *udp++ = p[0];
-          *ydp++ = p[1];
-          *ydp++ = p[2];
-          *vdp++ = p[3];
-          *ydp++ = p[4];
-          *ydp++ = p[5];
-          p += pgroup;
-        }
+        unpack_y41b (datap, up + uvoff, vp + uvoff, payload, plen / pgroup);
         break;
       }
       default:
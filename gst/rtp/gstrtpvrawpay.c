@@ -32,10 +32,12 @@
 
 enum
 {
-  PROP_CHUNKS_PER_FRAME = 1
+  PROP_CHUNKS_PER_FRAME = 1,
+  PROP_N_THREADS
 };
 
 #define DEFAULT_CHUNKS_PER_FRAME 10
+#define DEFAULT_N_THREADS 1
 
 GST_DEBUG_CATEGORY_STATIC (rtpvrawpay_debug);
 #define GST_CAT_DEFAULT (rtpvrawpay_debug)
@@ -84,6 +86,7 @@ static void gst_rtp_vraw_pay_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void gst_rtp_vraw_pay_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
+static void gst_rtp_vraw_pay_finalize (GObject * object);
 
 G_DEFINE_TYPE (GstRtpVRawPay, gst_rtp_vraw_pay, GST_TYPE_RTP_BASE_PAYLOAD);
 GST_ELEMENT_REGISTER_DEFINE_WITH_CODE (rtpvrawpay, "rtpvrawpay",
@@ -102,6 +105,7 @@ gst_rtp_vraw_pay_class_init (GstRtpVRawPayClass * klass)
 
   gobject_class->set_property = gst_rtp_vraw_pay_set_property;
   gobject_class->get_property = gst_rtp_vraw_pay_get_property;
+  gobject_class->finalize = gst_rtp_vraw_pay_finalize;
 
   g_object_class_install_property (gobject_class,
       PROP_CHUNKS_PER_FRAME,
@@ -111,6 +115,25 @@ gst_rtp_vraw_pay_class_init (GstRtpVRawPayClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
       );
 
+  /**
+   * GstRtpVRawPay:n-threads:
+   *
+   * Number of threads payloading a frame. The lines of each field are split
+   * in as many ranges, payloaded in parallel, and all the packets of the
+   * frame are pushed in a single buffer list, ignoring
+   * #GstRtpVRawPay:chunks-per-frame. The ranges are payloaded by at most
+   * one thread per processor, and there is at most one range per line.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads payloading a frame (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
+      );
+
   gstrtpbasepayload_class->set_caps = gst_rtp_vraw_pay_setcaps;
   gstrtpbasepayload_class->handle_buffer = gst_rtp_vraw_pay_handle_buffer;
 
@@ -132,6 +155,22 @@ static void
 gst_rtp_vraw_pay_init (GstRtpVRawPay * rtpvrawpay)
 {
   rtpvrawpay->chunks_per_frame = DEFAULT_CHUNKS_PER_FRAME;
+  rtpvrawpay->n_threads = DEFAULT_N_THREADS;
+  g_mutex_init (&rtpvrawpay->slices_lock);
+  g_cond_init (&rtpvrawpay->slices_cond);
+}
+
+static void
+gst_rtp_vraw_pay_finalize (GObject * object)
+{
+  GstRtpVRawPay *rtpvrawpay = GST_RTP_VRAW_PAY (object);
+
+  if (rtpvrawpay->pool)
+    g_thread_pool_free (rtpvrawpay->pool, FALSE, TRUE);
+  g_mutex_clear (&rtpvrawpay->slices_lock);
+  g_cond_clear (&rtpvrawpay->slices_cond);
+
+  G_OBJECT_CLASS (gst_rtp_vraw_pay_parent_class)->finalize (object);
 }
 
 static gboolean
@@ -224,6 +263,17 @@ gst_rtp_vraw_pay_setcaps (GstRTPBasePayload * payload, GstCaps * caps)
   rtpvrawpay->xinc = xinc;
   rtpvrawpay->yinc = yinc;
 
+  switch (GST_VIDEO_INFO_FORMAT (&info)) {
+    case GST_VIDEO_FORMAT_AYUV:
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_Y41B:
+      rtpvrawpay->zero_copy = FALSE;
+      break;
+    default:
+      rtpvrawpay->zero_copy = TRUE;
+      break;
+  }
+
   GST_DEBUG_OBJECT (payload, "width %d, height %d, sampling %s",
       GST_VIDEO_INFO_WIDTH (&info), GST_VIDEO_INFO_HEIGHT (&info), samplingstr);
   GST_DEBUG_OBJECT (payload, "xinc %d, yinc %d, pgroup %d", xinc, yinc, pgroup);
@@ -261,6 +311,477 @@ unknown_format:
   }
 }
 
+/* Cb-Y-Cr from A-Y-Cb-Cr */
+static void
+pack_ayuv (guint8 * out, const guint8 * in, guint pgroups)
+{
+  guint i;
+
+  for (i = 0; i < pgroups; i++) {
+    out[3 * i + 0] = in[4 * i + 2];
+    out[3 * i + 1] = in[4 * i + 1];
+    out[3 * i + 2] = in[4 * i + 3];
+  }
+}
+
+/* line 0/1: Y00-Y01-Y10-Y11-Cb00-Cr00 Y02-Y03-Y12-Y13-Cb01-Cr01 ... */
+static void
+pack_i420 (guint8 * out, const guint8 * y1, const guint8 * y2,
+    const guint8 * u, const guint8 * v, guint pgroups)
+{
+  guint i;
+
+  for (i = 0; i < pgroups; i++) {
+    out[6 * i + 0] = y1[2 * i + 0];
+    out[6 * i + 1] = y1[2 * i + 1];
+    out[6 * i + 2] = y2[2 * i + 0];
+    out[6 * i + 3] = y2[2 * i + 1];
+    out[6 * i + 4] = u[i];
+    out[6 * i + 5] = v[i];
+  }
+}
+
+/* Cb0-Y0-Y1-Cr0-Y2-Y3 */
+static void
+pack_y41b (guint8 * out, const guint8 * y, const guint8 * u,
+    const guint8 * v, guint pgroups)
+{
+  guint i;
+
+  for (i = 0; i < pgroups; i++) {
+    out[6 * i + 0] = u[i];
+    out[6 * i + 1] = y[4 * i + 0];
+    out[6 * i + 2] = y[4 * i + 1];
+    out[6 * i + 3] = v[i];
+    out[6 * i + 4] = y[4 * i + 2];
+    out[6 * i + 5] = y[4 * i + 3];
+  }
+}
+
+/* returned by gst_rtp_vraw_pay_create_packet(), which can run from the
+ * payloading threads, for gst_rtp_vraw_pay_packet_error() to post the error
+ * from the streaming thread */
+#define FLOW_UNKNOWN_SAMPLING GST_FLOW_CUSTOM_ERROR
+#define FLOW_TOO_SMALL GST_FLOW_CUSTOM_ERROR_1
+
+static GstFlowReturn
+gst_rtp_vraw_pay_packet_error (GstRtpVRawPay * rtpvrawpay, GstFlowReturn ret)
+{
+  switch (ret) {
+    case FLOW_UNKNOWN_SAMPLING:
+      GST_ELEMENT_ERROR (rtpvrawpay, STREAM, FORMAT,
+          (NULL), ("unimplemented sampling"));
+      return GST_FLOW_NOT_SUPPORTED;
+    case FLOW_TOO_SMALL:
+      GST_ELEMENT_ERROR (rtpvrawpay, RESOURCE, NO_SPACE_LEFT,
+          (NULL), ("not enough space to send at least one pixel"));
+      return GST_FLOW_NOT_SUPPORTED;
+    default:
+      return ret;
+  }
+}
+
+/* Creates the packet starting at @line_p and @offset_p of @field, covering
+ * the lines up to @end_line, and moves @line_p and @offset_p to where the
+ * next packet starts. @headers is scratch space of @mtu bytes */
+static GstFlowReturn
+gst_rtp_vraw_pay_create_packet (GstRtpVRawPay * rtpvrawpay,
+    GstVideoFrame * frame, guint mtu, gint field, guint * line_p,
+    guint * offset_p, guint end_line, guint8 * headers, GstBuffer ** outbuf)
+{
+  GstRTPBasePayload *payload = GST_RTP_BASE_PAYLOAD (rtpvrawpay);
+  GstBuffer *buffer = frame->buffer;
+  GstRTPBuffer rtp = { NULL, };
+  guint8 *p0, *yp, *up, *vp;
+  guint ystride, uvstride;
+  gsize plane_offset;
+  guint xinc, yinc;
+  guint pgroup;
+  guint width, height;
+  GstVideoFormat format;
+  guint line, offset;
+  guint left, headers_len, data_len;
+  GstBuffer *out;
+  guint8 *outdata, *h;
+  gboolean next_line;
+  guint length, cont, pixels;
+
+  /* get pointer and strides of the planes */
+  p0 = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  yp = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
+  up = GST_VIDEO_FRAME_COMP_DATA (frame, 1);
+  vp = GST_VIDEO_FRAME_COMP_DATA (frame, 2);
+
+  ystride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+  uvstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 1);
+
+  /* where the first plane starts in the buffer, for referencing it */
+  plane_offset = GST_VIDEO_FRAME_PLANE_OFFSET (frame, 0);
+
+  /* amount of bytes for one pixel */
+  pgroup = rtpvrawpay->pgroup;
+  width = GST_VIDEO_INFO_WIDTH (&rtpvrawpay->vinfo);
+  height = GST_VIDEO_INFO_HEIGHT (&rtpvrawpay->vinfo);
+
+  format = GST_VIDEO_INFO_FORMAT (&rtpvrawpay->vinfo);
+
+  yinc = rtpvrawpay->yinc;
+  xinc = rtpvrawpay->xinc;
+
+  line = *line_p;
+  offset = *offset_p;
+
+  /* get the max allowed payload length size, we try to fill the complete MTU */
+  left = gst_rtp_buffer_calc_payload_len (mtu, 0, 0);
+
+  /*
+   *   0                   1                   2                   3
+   *   0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   *  |   Extended Sequence Number    |            Length             |
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   *  |F|          Line No            |C|           Offset            |
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   *  |            Length             |F|          Line No            |
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   *  |C|           Offset            |                               .
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+                               .
+   *  .                                                               .
+   *  .                 Two (partial) lines of video data             .
+   *  .                                                               .
+   *  +---------------------------------------------------------------+
+   */
+
+  /* need 2 bytes for the extended sequence number */
+  left -= 2;
+
+  /* make sure we can fit at least *one* header and pixel */
+  if (!(left > (6 + pgroup)))
+    goto too_small;
+
+  /* first pass, compute the headers and the amount of data */
+  h = headers;
+  data_len = 0;
+
+  /* while we can fit at least one header and one pixel */
+  while (left > (6 + pgroup)) {
+    /* we need a 6 bytes header */
+    left -= 6;
+
+    /* get how may bytes we need for the remaining pixels */
+    pixels = width - offset;
+    length = (pixels * pgroup) / xinc;
+
+    if (left >= length) {
+      /* pixels and header fit completely, we will write them and skip to the
+       * next line. */
+      next_line = TRUE;
+    } else {
+      /* line does not fit completely, see how many pixels fit */
+      pixels = (left / pgroup) * xinc;
+      length = (pixels * pgroup) / xinc;
+      next_line = FALSE;
+    }
+    GST_LOG_OBJECT (rtpvrawpay, "filling %u bytes in %u pixels", length,
+        pixels);
+    left -= length;
+    data_len += length;
+
+    /* write length */
+    *h++ = (length >> 8) & 0xff;
+    *h++ = length & 0xff;
+
+    /* write line no */
+    *h++ = ((line >> 8) & 0x7f) | ((field << 7) & 0x80);
+    *h++ = line & 0xff;
+
+    if (next_line) {
+      /* go to next line we do this here to make the check below easier */
+      line += yinc;
+    }
+
+    /* calculate continuation marker */
+    cont = (left > (6 + pgroup) && line < end_line) ? 0x80 : 0x00;
+
+    /* write offset and continuation marker */
+    *h++ = ((offset >> 8) & 0x7f) | cont;
+    *h++ = offset & 0xff;
+
+    if (next_line) {
+      /* reset offset */
+      offset = 0;
+      GST_LOG_OBJECT (rtpvrawpay, "go to next line %u", line);
+    } else {
+      offset += pixels;
+      GST_LOG_OBJECT (rtpvrawpay, "next offset %u", offset);
+    }
+
+    if (!cont)
+      break;
+  }
+  headers_len = h - headers;
+
+  GST_LOG_OBJECT (rtpvrawpay, "%u bytes of headers for %u bytes of data",
+      headers_len, data_len);
+
+  /* when the data is referenced, the packet only holds the headers */
+  out = gst_rtp_base_payload_allocate_output_buffer (payload,
+      2 + headers_len + (rtpvrawpay->zero_copy ? 0 : data_len), 0, 0);
+
+  if (field == 0) {
+    GST_BUFFER_PTS (out) = GST_BUFFER_PTS (buffer);
+  } else {
+    GST_BUFFER_PTS (out) = GST_BUFFER_PTS (buffer) +
+        GST_BUFFER_DURATION (buffer) / 2;
+  }
+
+  gst_rtp_buffer_map (out, GST_MAP_WRITE, &rtp);
+  outdata = gst_rtp_buffer_get_payload (&rtp);
+
+  /* extended sequence number */
+  *outdata++ = 0;
+  *outdata++ = 0;
+  memcpy (outdata, headers, headers_len);
+  outdata += headers_len;
+
+  /* second pass, read headers and write the data, unless it is
+   * referenced once the headers are written */
+  for (h = headers; h < headers + headers_len && !rtpvrawpay->zero_copy;
+      h += 6) {
+    guint offs, lin;
+
+    /* read length */
+    length = (h[0] << 8) | h[1];
+    lin = ((h[2] & 0x7f) << 8) | h[3];
+    offs = ((h[4] & 0x7f) << 8) | h[5];
+    pixels = length / pgroup;
+
+    GST_LOG_OBJECT (payload,
+        "writing length %u, line %u, offset %u", length, lin, offs);
+
+    switch (format) {
+      case GST_VIDEO_FORMAT_AYUV:
+        pack_ayuv (outdata, p0 + (lin * ystride) + (offs * 4), pixels);
+        break;
+      case GST_VIDEO_FORMAT_I420:
+      {
+        guint uvoff = (lin / yinc * uvstride) + (offs / xinc);
+        guint8 *yd1p = yp + (lin * ystride) + offs;
+
+        pack_i420 (outdata, yd1p, yd1p + ystride, up + uvoff, vp + uvoff,
+            pixels);
+        break;
+      }
+      case GST_VIDEO_FORMAT_Y41B:
+      {
+        guint uvoff = (lin / yinc * uvstride) + (offs / xinc);
+
+        pack_y41b (outdata, yp + (lin * ystride) + offs, up + uvoff,
+            vp + uvoff, pixels);
+        break;
+      }
+      default:
+        gst_rtp_buffer_unmap (&rtp);
+        gst_buffer_unref (out);
+        goto unknown_sampling;
+    }
+    outdata += length;
+  }
+
+  if (line >= height) {
+    GST_LOG_OBJECT (rtpvrawpay, "field/frame complete, set marker");
+    gst_rtp_buffer_set_marker (&rtp, TRUE);
+  }
+  gst_rtp_buffer_unmap (&rtp);
+
+  /* samples are packed just like gstreamer packs them, append the
+   * memory holding them after the headers. This must happen after
+   * unmapping, as mapping the payload would merge the memories */
+  for (h = headers; h < headers + headers_len && rtpvrawpay->zero_copy;
+      h += 6) {
+    guint offs, lin;
+
+    length = (h[0] << 8) | h[1];
+    lin = ((h[2] & 0x7f) << 8) | h[3];
+    offs = ((h[4] & 0x7f) << 8) | h[5];
+
+    gst_buffer_copy_into (out, buffer, GST_BUFFER_COPY_MEMORY,
+        plane_offset + (lin * ystride) + (offs / xinc * pgroup), length);
+  }
+
+  gst_rtp_copy_video_meta (rtpvrawpay, out, buffer);
+
+  *line_p = line;
+  *offset_p = offset;
+  *outbuf = out;
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+unknown_sampling:
+  {
+    GST_DEBUG_OBJECT (rtpvrawpay, "unimplemented sampling");
+    return FLOW_UNKNOWN_SAMPLING;
+  }
+too_small:
+  {
+    GST_DEBUG_OBJECT (rtpvrawpay, "not enough space for one pixel");
+    return FLOW_TOO_SMALL;
+  }
+}
+
+typedef struct
+{
+  GstRtpVRawPay *rtpvrawpay;
+  GstVideoFrame *frame;
+  guint mtu;
+  gint field;
+  guint start_line, end_line;
+  GPtrArray *packets;
+  GstFlowReturn ret;
+} VRawSlice;
+
+static void
+gst_rtp_vraw_pay_payload_slice (VRawSlice * slice)
+{
+  guint8 *headers = g_malloc (slice->mtu);
+  guint line = slice->start_line, offset = 0;
+
+  slice->ret = GST_FLOW_OK;
+
+  while (line < slice->end_line) {
+    GstBuffer *out;
+
+    slice->ret = gst_rtp_vraw_pay_create_packet (slice->rtpvrawpay,
+        slice->frame, slice->mtu, slice->field, &line, &offset,
+        slice->end_line, headers, &out);
+    if (slice->ret != GST_FLOW_OK)
+      break;
+
+    g_ptr_array_add (slice->packets, out);
+  }
+
+  g_free (headers);
+}
+
+static void
+gst_rtp_vraw_pay_slice_func (VRawSlice * slice, GstRtpVRawPay * rtpvrawpay)
+{
+  gst_rtp_vraw_pay_payload_slice (slice);
+
+  g_mutex_lock (&rtpvrawpay->slices_lock);
+  rtpvrawpay->slices_pending -= 1;
+  if (rtpvrawpay->slices_pending == 0)
+    g_cond_signal (&rtpvrawpay->slices_cond);
+  g_mutex_unlock (&rtpvrawpay->slices_lock);
+}
+
+/* Splits each field in @n_threads ranges of lines, payloads them in
+ * parallel and pushes all the packets of the frame in one list. Packets
+ * don't span two ranges, the sequence numbers are only assigned when the
+ * list is pushed */
+static GstFlowReturn
+gst_rtp_vraw_pay_handle_slices (GstRtpVRawPay * rtpvrawpay,
+    GstVideoFrame * frame, guint mtu, guint n_threads)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBufferList *list;
+  VRawSlice *slices;
+  guint height, yinc;
+  gint field, fields;
+  guint i, j, n_slices = 0, n_packets = 0;
+  gint max_threads;
+
+  height = GST_VIDEO_INFO_HEIGHT (&rtpvrawpay->vinfo);
+  yinc = rtpvrawpay->yinc;
+  fields = 1 + GST_VIDEO_INFO_IS_INTERLACED (&rtpvrawpay->vinfo);
+
+  slices = g_new0 (VRawSlice, n_threads * fields);
+
+  for (field = 0; field < fields; field++) {
+    guint pack_lines, n;
+
+    if ((guint) field >= height)
+      break;
+
+    pack_lines = (height - field + yinc - 1) / yinc;
+    n = MIN (n_threads, pack_lines);
+
+    for (i = 0; i < n; i++) {
+      VRawSlice *slice = &slices[n_slices++];
+
+      slice->rtpvrawpay = rtpvrawpay;
+      slice->frame = frame;
+      slice->mtu = mtu;
+      slice->field = field;
+      slice->start_line = field + (pack_lines * i / n) * yinc;
+      if (i + 1 < n)
+        slice->end_line = field + (pack_lines * (i + 1) / n) * yinc;
+      else
+        slice->end_line = height;
+      slice->packets = g_ptr_array_new ();
+    }
+  }
+
+  /* together with this thread, at most one thread per processor works on
+   * the ranges, the others wait in the pool */
+  max_threads = CLAMP (g_get_num_processors () - 1, 1, (gint) n_threads - 1);
+  if (!rtpvrawpay->pool) {
+    rtpvrawpay->pool =
+        g_thread_pool_new ((GFunc) gst_rtp_vraw_pay_slice_func, rtpvrawpay,
+        max_threads, FALSE, NULL);
+  } else if (g_thread_pool_get_max_threads (rtpvrawpay->pool) != max_threads) {
+    g_thread_pool_set_max_threads (rtpvrawpay->pool, max_threads, NULL);
+  }
+
+  g_mutex_lock (&rtpvrawpay->slices_lock);
+  rtpvrawpay->slices_pending = n_slices - 1;
+  g_mutex_unlock (&rtpvrawpay->slices_lock);
+
+  /* this thread takes the first range */
+  for (i = 1; i < n_slices; i++)
+    g_thread_pool_push (rtpvrawpay->pool, &slices[i], NULL);
+
+  gst_rtp_vraw_pay_payload_slice (&slices[0]);
+
+  g_mutex_lock (&rtpvrawpay->slices_lock);
+  while (rtpvrawpay->slices_pending)
+    g_cond_wait (&rtpvrawpay->slices_cond, &rtpvrawpay->slices_lock);
+  g_mutex_unlock (&rtpvrawpay->slices_lock);
+
+  for (i = 0; i < n_slices; i++) {
+    n_packets += slices[i].packets->len;
+    if (ret == GST_FLOW_OK)
+      ret = slices[i].ret;
+  }
+
+  list = gst_buffer_list_new_sized (n_packets);
+
+  for (i = 0; i < n_slices; i++) {
+    for (j = 0; j < slices[i].packets->len; j++)
+      gst_buffer_list_add (list, g_ptr_array_index (slices[i].packets, j));
+    g_ptr_array_unref (slices[i].packets);
+  }
+  g_free (slices);
+
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_list_unref (list);
+    return gst_rtp_vraw_pay_packet_error (rtpvrawpay, ret);
+  }
+
+  if (GST_BUFFER_IS_DISCONT (frame->buffer) && n_packets > 0) {
+    /* Only the first outputted buffer has the DISCONT flag */
+    GST_BUFFER_FLAG_SET (gst_buffer_list_get (list, 0),
+        GST_BUFFER_FLAG_DISCONT);
+  }
+
+  GST_LOG_OBJECT (rtpvrawpay, "pushing list of %u buffers from %u slices",
+      n_packets, n_slices);
+
+  return gst_rtp_base_payload_push_list (GST_RTP_BASE_PAYLOAD (rtpvrawpay),
+      list);
+}
+
 static GstFlowReturn
 gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
 {
@@ -272,20 +793,18 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
   guint lines_delay;            /* after how many packed lines we push out a buffer list */
   guint last_line;              /* last pack line number we pushed out a buffer list     */
   guint line, offset;
-  guint8 *p0, *yp, *up, *vp;
-  guint ystride, uvstride;
   guint xinc, yinc;
   guint pgroup;
   guint mtu;
   guint width, height;
+  guint n_threads;
   gint field, fields;
-  GstVideoFormat format;
   GstVideoFrame frame;
   gint interlaced;
   gboolean use_buffer_lists;
   GstBufferList *list = NULL;
-  GstRTPBuffer rtp = { NULL, };
   gboolean discont;
+  guint8 *headers;
 
   rtpvrawpay = GST_RTP_VRAW_PAY (payload);
 
@@ -299,16 +818,22 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
   GST_LOG_OBJECT (rtpvrawpay, "new frame of %" G_GSIZE_FORMAT " bytes",
       gst_buffer_get_size (buffer));
 
-  /* get pointer and strides of the planes */
-  p0 = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
-  yp = GST_VIDEO_FRAME_COMP_DATA (&frame, 0);
-  up = GST_VIDEO_FRAME_COMP_DATA (&frame, 1);
-  vp = GST_VIDEO_FRAME_COMP_DATA (&frame, 2);
+  mtu = GST_RTP_BASE_PAYLOAD_MTU (payload);
 
-  ystride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, 0);
-  uvstride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, 1);
+  /* there can't be more ranges of lines than lines, the number of threads
+   * that run at the same time is limited by the pool */
+  n_threads = rtpvrawpay->n_threads;
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+  n_threads = MIN (n_threads, (GST_VIDEO_INFO_HEIGHT (&rtpvrawpay->vinfo) +
+          rtpvrawpay->yinc - 1) / rtpvrawpay->yinc);
 
-  mtu = GST_RTP_BASE_PAYLOAD_MTU (payload);
+  if (n_threads > 1) {
+    ret = gst_rtp_vraw_pay_handle_slices (rtpvrawpay, &frame, mtu, n_threads);
+    gst_video_frame_unmap (&frame);
+    gst_buffer_unref (buffer);
+    return ret;
+  }
 
   /* amount of bytes for one pixel */
   pgroup = rtpvrawpay->pgroup;
@@ -317,8 +842,6 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
 
   interlaced = GST_VIDEO_INFO_IS_INTERLACED (&rtpvrawpay->vinfo);
 
-  format = GST_VIDEO_INFO_FORMAT (&rtpvrawpay->vinfo);
-
   yinc = rtpvrawpay->yinc;
   xinc = rtpvrawpay->xinc;
 
@@ -337,6 +860,10 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
 
   fields = 1 + interlaced;
 
+  /* the headers of a packet are computed before the packet is allocated,
+   * they can't take more than the MTU */
+  headers = g_malloc (mtu);
+
   /* start with line 0, offset 0 */
   for (field = 0; field < fields; field++) {
     line = field;
@@ -348,15 +875,16 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
 
     /* write all lines */
     while (line < height) {
-      guint left, pack_line;
+      guint pack_line;
       GstBuffer *out;
-      guint8 *outdata, *headers;
-      gboolean next_line, complete = FALSE;
-      guint length, cont, pixels;
+      gboolean complete;
 
-      /* get the max allowed payload length size, we try to fill the complete MTU */
-      left = gst_rtp_buffer_calc_payload_len (mtu, 0, 0);
-      out = gst_rtp_base_payload_allocate_output_buffer (payload, left, 0, 0);
+      ret = gst_rtp_vraw_pay_create_packet (rtpvrawpay, &frame, mtu, field,
+          &line, &offset, height, headers, &out);
+      if (ret != GST_FLOW_OK) {
+        ret = gst_rtp_vraw_pay_packet_error (rtpvrawpay, ret);
+        goto error;
+      }
 
       if (discont) {
         GST_BUFFER_FLAG_SET (out, GST_BUFFER_FLAG_DISCONT);
@@ -364,217 +892,7 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
         discont = FALSE;
       }
 
-      if (field == 0) {
-        GST_BUFFER_PTS (out) = GST_BUFFER_PTS (buffer);
-      } else {
-        GST_BUFFER_PTS (out) = GST_BUFFER_PTS (buffer) +
-            GST_BUFFER_DURATION (buffer) / 2;
-      }
-
-      gst_rtp_buffer_map (out, GST_MAP_WRITE, &rtp);
-      outdata = gst_rtp_buffer_get_payload (&rtp);
-
-      GST_LOG_OBJECT (rtpvrawpay, "created buffer of size %u for MTU %u", left,
-          mtu);
-
-      /*
-       *   0                   1                   2                   3
-       *   0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-       *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-       *  |   Extended Sequence Number    |            Length             |
-       *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-       *  |F|          Line No            |C|           Offset            |
-       *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-       *  |            Length             |F|          Line No            |
-       *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-       *  |C|           Offset            |                               .
-       *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+                               .
-       *  .                                                               .
-       *  .                 Two (partial) lines of video data             .
-       *  .                                                               .
-       *  +---------------------------------------------------------------+
-       */
-
-      /* need 2 bytes for the extended sequence number */
-      *outdata++ = 0;
-      *outdata++ = 0;
-      left -= 2;
-
-      /* the headers start here */
-      headers = outdata;
-
-      /* make sure we can fit at least *one* header and pixel */
-      if (!(left > (6 + pgroup))) {
-        gst_rtp_buffer_unmap (&rtp);
-        gst_buffer_unref (out);
-        goto too_small;
-      }
-
-      /* while we can fit at least one header and one pixel */
-      while (left > (6 + pgroup)) {
-        /* we need a 6 bytes header */
-        left -= 6;
-
-        /* get how may bytes we need for the remaining pixels */
-        pixels = width - offset;
-        length = (pixels * pgroup) / xinc;
-
-        if (left >= length) {
-          /* pixels and header fit completely, we will write them and skip to the
-           * next line. */
-          next_line = TRUE;
-        } else {
-          /* line does not fit completely, see how many pixels fit */
-          pixels = (left / pgroup) * xinc;
-          length = (pixels * pgroup) / xinc;
-          next_line = FALSE;
-        }
-        GST_LOG_OBJECT (rtpvrawpay, "filling %u bytes in %u pixels", length,
-            pixels);
-        left -= length;
-
-        /* write length */
-        *outdata++ = (length >> 8) & 0xff;
-        *outdata++ = length & 0xff;
-
-        /* write line no */
-        *outdata++ = ((line >> 8) & 0x7f) | ((field << 7) & 0x80);
-        *outdata++ = line & 0xff;
-
-        if (next_line) {
-          /* go to next line we do this here to make the check below easier */
-          line += yinc;
-        }
-
-        /* calculate continuation marker */
-        cont = (left > (6 + pgroup) && line < height) ? 0x80 : 0x00;
-
-        /* write offset and continuation marker */
-        *outdata++ = ((offset >> 8) & 0x7f) | cont;
-        *outdata++ = offset & 0xff;
-
-        if (next_line) {
-          /* reset offset */
-          offset = 0;
-          GST_LOG_OBJECT (rtpvrawpay, "go to next line %u", line);
-        } else {
-          offset += pixels;
-          GST_LOG_OBJECT (rtpvrawpay, "next offset %u", offset);
-        }
-
-        if (!cont)
-          break;
-      }
-      GST_LOG_OBJECT (rtpvrawpay, "consumed %u bytes",
-          (guint) (outdata - headers));
-
-      /* second pass, read headers and write the data */
-      while (TRUE) {
-        guint offs, lin;
-
-        /* read length and cont */
-        length = (headers[0] << 8) | headers[1];
-        lin = ((headers[2] & 0x7f) << 8) | headers[3];
-        offs = ((headers[4] & 0x7f) << 8) | headers[5];
-        cont = headers[4] & 0x80;
-        pixels = length / pgroup;
-        headers += 6;
-
-        GST_LOG_OBJECT (payload,
-            "writing length %u, line %u, offset %u, cont %d", length, lin, offs,
-            cont);
-
-        switch (format) {
-          case GST_VIDEO_FORMAT_RGB:
-          case GST_VIDEO_FORMAT_RGBA:
-          case GST_VIDEO_FORMAT_BGR:
-          case GST_VIDEO_FORMAT_BGRA:
-          case GST_VIDEO_FORMAT_UYVY:
-          case GST_VIDEO_FORMAT_UYVP:
-            offs /= xinc;
-            memcpy (outdata, p0 + (lin * ystride) + (offs * pgroup), length);
-            outdata += length;
-            break;
-          case GST_VIDEO_FORMAT_AYUV:
-          {
-            gint i;
-            guint8 *datap;
-
-            datap = p0 + (lin * ystride) + (offs * 4);
-
-            for (i = 0; i < pixels; i++) {
-              *outdata++ = datap[2];
-              *outdata++ = datap[1];
-              *outdata++ = datap[3];
-              datap += 4;
-            }
-            break;
-          }
-          case GST_VIDEO_FORMAT_I420:
-          {
-            gint i;
-            guint uvoff;
-            guint8 *yd1p, *yd2p, *udp, *vdp;
-
-            yd1p = yp + (lin * ystride) + (offs);
-            yd2p = yd1p + ystride;
-            uvoff = (lin / yinc * uvstride) + (offs / xinc);
-            udp = up + uvoff;
-            vdp = vp + uvoff;
-
-            for (i = 0; i < pixels; i++) {
-              *outdata++ = *yd1p++;
-              *outdata++ = *yd1p++;
-              *outdata++ = *yd2p++;
-              *outdata++ = *yd2p++;
-              *outdata++ = *udp++;
-              *outdata++ = *vdp++;
-            }
-            break;
-          }
-          case GST_VIDEO_FORMAT_Y41B:
-          {
-            gint i;
-            guint uvoff;
-            guint8 *ydp, *udp, *vdp;
-
-            ydp = yp + (lin * ystride) + offs;
-            uvoff = (lin / yinc * uvstride) + (offs / xinc);
-            udp = up + uvoff;
-            vdp = vp + uvoff;
-
-            for (i = 0; i < pixels; i++) {
-              *outdata++ = *udp++;
-              *outdata++ = *ydp++;
-              *outdata++ = *ydp++;
-              *outdata++ = *vdp++;
-              *outdata++ = *ydp++;
-              *outdata++ = *ydp++;
-            }
-            break;
-          }
-          default:
-            gst_rtp_buffer_unmap (&rtp);
-            gst_buffer_unref (out);
-            goto unknown_sampling;
-        }
-
-        if (!cont)
-          break;
-      }
-
-      if (line >= height) {
-        GST_LOG_OBJECT (rtpvrawpay, "field/frame complete, set marker");
-        gst_rtp_buffer_set_marker (&rtp, TRUE);
-        complete = TRUE;
-      }
-      gst_rtp_buffer_unmap (&rtp);
-      if (left > 0) {
-        GST_LOG_OBJECT (rtpvrawpay, "we have %u bytes left", left);
-        gst_buffer_resize (out, 0, gst_buffer_get_size (out) - left);
-      }
-
-      gst_rtp_copy_video_meta (rtpvrawpay, out, buffer);
+      complete = line >= height;
 
       /* Now either push out the buffer directly */
       if (!use_buffer_lists) {
@@ -600,27 +918,18 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
 
   }
 
+done:
+  g_free (headers);
   gst_video_frame_unmap (&frame);
   gst_buffer_unref (buffer);
 
   return ret;
 
-  /* ERRORS */
-unknown_sampling:
-  {
-    GST_ELEMENT_ERROR (payload, STREAM, FORMAT,
-        (NULL), ("unimplemented sampling"));
-    gst_video_frame_unmap (&frame);
-    gst_buffer_unref (buffer);
-    return GST_FLOW_NOT_SUPPORTED;
-  }
-too_small:
+error:
   {
-    GST_ELEMENT_ERROR (payload, RESOURCE, NO_SPACE_LEFT,
-        (NULL), ("not enough space to send at least one pixel"));
-    gst_video_frame_unmap (&frame);
-    gst_buffer_unref (buffer);
-    return GST_FLOW_NOT_SUPPORTED;
+    if (list)
+      gst_buffer_list_unref (list);
+    goto done;
   }
 }
 
@@ -636,6 +945,9 @@ gst_rtp_vraw_pay_set_property (GObject * object, guint prop_id,
     case PROP_CHUNKS_PER_FRAME:
       rtpvrawpay->chunks_per_frame = g_value_get_int (value);
       break;
+    case PROP_N_THREADS:
+      rtpvrawpay->n_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -654,6 +966,9 @@ gst_rtp_vraw_pay_get_property (GObject * object, guint prop_id,
     case PROP_CHUNKS_PER_FRAME:
       g_value_set_int (value, rtpvrawpay->chunks_per_frame);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, rtpvrawpay->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
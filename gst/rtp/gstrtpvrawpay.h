@@ -48,9 +48,18 @@ struct _GstRtpVRawPay
 
   gint pgroup;
   gint xinc, yinc;
+  /* lines are laid out like the pgroups, packets reference them */
+  gboolean zero_copy;
+
+  /* slices of a frame payloaded in parallel */
+  GThreadPool *pool;
+  GMutex slices_lock;
+  GCond slices_cond;
+  guint slices_pending;
 
   /* properties */
   guint chunks_per_frame;
+  guint n_threads;
 };
 
 struct _GstRtpVRawPayClass
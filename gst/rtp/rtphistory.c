@@ -0,0 +1,649 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * RtpHistory:
+ *
+ * Stores the recent packets of many RTP streams so they can be found again
+ * for retransmission or FEC recovery. It is used by rtpstorage and
+ * rtprtxsend.
+ *
+ * The packets of each SSRC are kept in a ring indexed by the sequence
+ * number, which makes looking up, adding and removing packets O(1). The
+ * ring covers a window of at most half the sequence number space starting
+ * at the oldest packet and grows with the window.
+ *
+ * Optionally the total size of the stored buffers is limited, in which
+ * case the packets stored first are removed first, whatever their stream.
+ *
+ * The history is not thread-safe, the users protect it with their own lock.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/base/gstqueuearray.h>
+
+#include "rtphistory.h"
+
+GST_DEBUG_CATEGORY_STATIC (rtp_history_debug);
+#define GST_CAT_DEFAULT rtp_history_debug
+
+#define MIN_RING_SIZE 64
+/* half of the sequence number space */
+#define MAX_RING_SIZE 32768
+/* packets older than the oldest stored packet by more than this are handled
+ * as a restart of the sequence numbers, like RTP_MAX_DROPOUT in rtpsource */
+#define MAX_MISORDER 3000
+
+typedef struct
+{
+  RtpHistoryPacket packet;
+  guint32 serial;
+} Slot;
+
+typedef struct
+{
+  guint32 ssrc;
+
+  /* ring of packets, indexed by seqnum & (size - 1) */
+  Slot *slots;
+  guint size;
+
+  /* the seqnums first_seqnum to first_seqnum + span - 1 are in the ring,
+   * the slots outside of that window are always empty */
+  guint16 first_seqnum;
+  guint span;
+
+  guint n_packets;
+  GstClockTime max_arrival;
+} Stream;
+
+/* a stored packet, in the order they were stored */
+typedef struct
+{
+  guint32 ssrc;
+  guint32 serial;
+  guint16 seqnum;
+} OrderEntry;
+
+struct _RtpHistory
+{
+  /* ssrc -> Stream */
+  GHashTable *streams;
+  /* most calls are for the same stream as the previous one */
+  Stream *last_stream;
+
+  gsize max_bytes;
+  gsize n_bytes;
+  guint n_packets;
+
+  /* only filled with a max_bytes limit */
+  GstQueueArray *order;
+  guint32 serial;
+};
+
+static void
+stream_free (Stream * stream)
+{
+  guint i;
+
+  for (i = 0; i < stream->size; i++)
+    gst_clear_buffer (&stream->slots[i].packet.buffer);
+  g_free (stream->slots);
+  g_slice_free (Stream, stream);
+}
+
+static inline Slot *
+stream_get_slot (Stream * stream, guint16 seqnum)
+{
+  return &stream->slots[seqnum & (stream->size - 1)];
+}
+
+/* the slot of @seqnum if it holds a packet */
+static inline Slot *
+stream_lookup (Stream * stream, guint16 seqnum)
+{
+  Slot *slot;
+
+  if ((guint16) (seqnum - stream->first_seqnum) >= stream->span)
+    return NULL;
+
+  slot = stream_get_slot (stream, seqnum);
+  return slot->packet.buffer ? slot : NULL;
+}
+
+static void
+stream_ensure_size (Stream * stream, guint span)
+{
+  Slot *slots;
+  guint size, i;
+
+  g_assert (span <= MAX_RING_SIZE);
+
+  if (span <= stream->size)
+    return;
+
+  size = MAX (stream->size, MIN_RING_SIZE);
+  while (size < span)
+    size *= 2;
+
+  slots = g_new0 (Slot, size);
+  for (i = 0; i < stream->span; i++) {
+    guint16 seqnum = stream->first_seqnum + i;
+    Slot *slot = stream_get_slot (stream, seqnum);
+
+    if (slot->packet.buffer)
+      slots[seqnum & (size - 1)] = *slot;
+  }
+  g_free (stream->slots);
+  stream->slots = slots;
+  stream->size = size;
+
+  GST_LOG ("ring of ssrc %08x grown to %u packets", stream->ssrc, size);
+}
+
+static Stream *
+rtp_history_get_stream (RtpHistory * history, guint32 ssrc, gboolean create)
+{
+  Stream *stream = history->last_stream;
+
+  if (stream && stream->ssrc == ssrc)
+    return stream;
+
+  stream = g_hash_table_lookup (history->streams, GUINT_TO_POINTER (ssrc));
+  if (!stream && create) {
+    stream = g_slice_new0 (Stream);
+    stream->ssrc = ssrc;
+    stream->max_arrival = GST_CLOCK_TIME_NONE;
+    g_hash_table_insert (history->streams, GUINT_TO_POINTER (ssrc), stream);
+  }
+  if (stream)
+    history->last_stream = stream;
+
+  return stream;
+}
+
+static void
+rtp_history_remove_slot (RtpHistory * history, Stream * stream, Slot * slot)
+{
+  history->n_bytes -= gst_buffer_get_size (slot->packet.buffer);
+  history->n_packets--;
+  stream->n_packets--;
+  gst_buffer_unref (slot->packet.buffer);
+  memset (slot, 0, sizeof (Slot));
+
+  /* shrink the window to the remaining packets */
+  if (stream->n_packets == 0) {
+    stream->span = 0;
+    return;
+  }
+  while (!stream_get_slot (stream, stream->first_seqnum)->packet.buffer) {
+    stream->first_seqnum++;
+    stream->span--;
+  }
+  while (!stream_get_slot (stream,
+          stream->first_seqnum + stream->span - 1)->packet.buffer)
+    stream->span--;
+}
+
+static void
+rtp_history_clear_stream (RtpHistory * history, Stream * stream)
+{
+  guint i;
+
+  for (i = 0; i < stream->size && stream->n_packets > 0; i++) {
+    Slot *slot = &stream->slots[i];
+
+    if (slot->packet.buffer)
+      rtp_history_remove_slot (history, stream, slot);
+  }
+}
+
+static gboolean
+order_entry_is_stored (RtpHistory * history, OrderEntry * entry)
+{
+  Stream *stream = rtp_history_get_stream (history, entry->ssrc, FALSE);
+  Slot *slot;
+
+  if (!stream || !(slot = stream_lookup (stream, entry->seqnum)))
+    return FALSE;
+
+  return slot->serial == entry->serial;
+}
+
+/* drops the entries of packets that were removed by other means */
+static void
+rtp_history_prune_order (RtpHistory * history)
+{
+  OrderEntry *entry;
+
+  while ((entry = gst_queue_array_peek_head_struct (history->order)) &&
+      !order_entry_is_stored (history, entry))
+    gst_queue_array_pop_head_struct (history->order);
+
+  if (gst_queue_array_get_length (history->order) >
+      2 * history->n_packets + 1024) {
+    guint i, len = gst_queue_array_get_length (history->order);
+
+    for (i = 0; i < len; i++) {
+      OrderEntry copy = *(OrderEntry *)
+          gst_queue_array_pop_head_struct (history->order);
+
+      if (order_entry_is_stored (history, &copy))
+        gst_queue_array_push_tail_struct (history->order, &copy);
+    }
+  }
+}
+
+static void
+rtp_history_enforce_max_bytes (RtpHistory * history)
+{
+  while (history->n_bytes > history->max_bytes) {
+    OrderEntry *entry = gst_queue_array_pop_head_struct (history->order);
+    Stream *stream;
+    Slot *slot;
+
+    if (!entry)
+      break;
+
+    stream = rtp_history_get_stream (history, entry->ssrc, FALSE);
+    if (!stream || !(slot = stream_lookup (stream, entry->seqnum)) ||
+        slot->serial != entry->serial)
+      continue;
+
+    GST_TRACE ("over %" G_GSIZE_FORMAT " bytes, removing seqnum %u of ssrc "
+        "%08x", history->max_bytes, entry->seqnum, entry->ssrc);
+    rtp_history_remove_slot (history, stream, slot);
+  }
+}
+
+static gint
+order_entry_compare (const OrderEntry * a, const OrderEntry * b)
+{
+  /* serials only wrap after 4G packets */
+  return (gint32) (a->serial - b->serial);
+}
+
+static void
+rtp_history_rebuild_order (RtpHistory * history)
+{
+  GArray *entries = g_array_sized_new (FALSE, FALSE, sizeof (OrderEntry),
+      history->n_packets);
+  GHashTableIter iter;
+  Stream *stream;
+  guint i;
+
+  gst_queue_array_clear (history->order);
+
+  g_hash_table_iter_init (&iter, history->streams);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & stream)) {
+    for (i = 0; i < stream->size; i++) {
+      Slot *slot = &stream->slots[i];
+      OrderEntry entry;
+
+      if (!slot->packet.buffer)
+        continue;
+
+      entry.ssrc = stream->ssrc;
+      entry.serial = slot->serial;
+      entry.seqnum = slot->packet.seqnum;
+      g_array_append_val (entries, entry);
+    }
+  }
+
+  g_array_sort (entries, (GCompareFunc) order_entry_compare);
+  for (i = 0; i < entries->len; i++)
+    gst_queue_array_push_tail_struct (history->order,
+        &g_array_index (entries, OrderEntry, i));
+  g_array_unref (entries);
+}
+
+/**
+ * rtp_history_new:
+ *
+ * Returns: a new, empty #RtpHistory without a size limit
+ */
+RtpHistory *
+rtp_history_new (void)
+{
+  static gsize debug_init = 0;
+  RtpHistory *history;
+
+  if (g_once_init_enter (&debug_init)) {
+    GST_DEBUG_CATEGORY_INIT (rtp_history_debug, "rtphistory", 0,
+        "RTP packet history");
+    g_once_init_leave (&debug_init, 1);
+  }
+
+  history = g_slice_new0 (RtpHistory);
+  history->streams = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) stream_free);
+  history->order = gst_queue_array_new_for_struct (sizeof (OrderEntry), 256);
+
+  return history;
+}
+
+void
+rtp_history_free (RtpHistory * history)
+{
+  g_hash_table_unref (history->streams);
+  gst_queue_array_free (history->order);
+  g_slice_free (RtpHistory, history);
+}
+
+/**
+ * rtp_history_set_max_bytes:
+ * @history: an #RtpHistory
+ * @max_bytes: the total size of the buffers to keep, 0 for no limit
+ *
+ * Limits the total size of the stored buffers of all streams together.
+ * When the limit is exceeded, the packets that were stored first are
+ * removed.
+ */
+void
+rtp_history_set_max_bytes (RtpHistory * history, gsize max_bytes)
+{
+  gsize old_max_bytes = history->max_bytes;
+
+  history->max_bytes = max_bytes;
+
+  if (max_bytes == 0) {
+    gst_queue_array_clear (history->order);
+    return;
+  }
+
+  if (old_max_bytes == 0)
+    rtp_history_rebuild_order (history);
+  rtp_history_enforce_max_bytes (history);
+}
+
+gsize
+rtp_history_get_max_bytes (RtpHistory * history)
+{
+  return history->max_bytes;
+}
+
+/**
+ * rtp_history_add_packet:
+ * @history: an #RtpHistory
+ * @ssrc: the SSRC of @buffer
+ * @buffer: (transfer none): an RTP packet
+ * @seqnum: the sequence number of @buffer
+ * @pt: the payload type of @buffer
+ * @rtptime: the RTP timestamp of @buffer
+ *
+ * Stores a reference to @buffer. Packets that were already stored, and
+ * packets too old to fit in the window of the stream, are not stored.
+ *
+ * Returns: %TRUE if @buffer was stored
+ */
+gboolean
+rtp_history_add_packet (RtpHistory * history, guint32 ssrc,
+    GstBuffer * buffer, guint16 seqnum, guint8 pt, guint32 rtptime)
+{
+  Stream *stream = rtp_history_get_stream (history, ssrc, TRUE);
+  GstClockTime arrival = GST_BUFFER_DTS_OR_PTS (buffer);
+  Slot *slot;
+
+  if (GST_CLOCK_TIME_IS_VALID (arrival) &&
+      (!GST_CLOCK_TIME_IS_VALID (stream->max_arrival) ||
+          arrival > stream->max_arrival))
+    stream->max_arrival = arrival;
+
+  if (stream->span == 0) {
+    stream_ensure_size (stream, 1);
+    stream->first_seqnum = seqnum;
+    stream->span = 1;
+  } else {
+    guint16 offset = seqnum - stream->first_seqnum;
+    guint16 newest = stream->first_seqnum + stream->span - 1;
+
+    if (offset < stream->span) {
+      /* inside the window */
+    } else if ((gint16) (seqnum - newest) > 0) {
+      /* newer, drop the packets that don't fit in the window anymore */
+      while (stream->n_packets > 0 &&
+          (guint16) (seqnum - stream->first_seqnum) >= MAX_RING_SIZE) {
+        rtp_history_remove_slot (history, stream,
+            stream_get_slot (stream, stream->first_seqnum));
+      }
+      if (stream->n_packets == 0) {
+        stream->first_seqnum = seqnum;
+        stream->span = 1;
+      } else {
+        guint span = (guint16) (seqnum - stream->first_seqnum) + 1;
+
+        stream_ensure_size (stream, span);
+        stream->span = span;
+      }
+    } else {
+      guint16 back = stream->first_seqnum - seqnum;
+
+      if (back > MAX_MISORDER) {
+        GST_DEBUG ("seqnum %u of ssrc %08x is far behind %u, restarting",
+            seqnum, ssrc, stream->first_seqnum);
+        rtp_history_clear_stream (history, stream);
+        stream_ensure_size (stream, 1);
+        stream->first_seqnum = seqnum;
+        stream->span = 1;
+      } else if (back + stream->span <= MAX_RING_SIZE) {
+        /* older than the oldest packet */
+        stream_ensure_size (stream, back + stream->span);
+        stream->first_seqnum = seqnum;
+        stream->span += back;
+      } else {
+        GST_DEBUG ("seqnum %u of ssrc %08x is too old", seqnum, ssrc);
+        return FALSE;
+      }
+    }
+  }
+
+  slot = stream_get_slot (stream, seqnum);
+  if (slot->packet.buffer) {
+    GST_LOG ("seqnum %u of ssrc %08x is already stored", seqnum, ssrc);
+    return FALSE;
+  }
+
+  slot->packet.buffer = gst_buffer_ref (buffer);
+  slot->packet.arrival = arrival;
+  slot->packet.rtptime = rtptime;
+  slot->packet.seqnum = seqnum;
+  slot->packet.pt = pt;
+  slot->serial = history->serial++;
+
+  stream->n_packets++;
+  history->n_packets++;
+  history->n_bytes += gst_buffer_get_size (buffer);
+
+  if (history->max_bytes > 0) {
+    OrderEntry entry = { ssrc, slot->serial, seqnum };
+
+    rtp_history_prune_order (history);
+    gst_queue_array_push_tail_struct (history->order, &entry);
+    rtp_history_enforce_max_bytes (history);
+  }
+
+  return TRUE;
+}
+
+/**
+ * rtp_history_lookup:
+ * @history: an #RtpHistory
+ * @ssrc: an SSRC
+ * @seqnum: a sequence number
+ *
+ * Returns: (nullable): the packet with @seqnum of @ssrc, or %NULL if it is
+ * not stored
+ */
+const RtpHistoryPacket *
+rtp_history_lookup (RtpHistory * history, guint32 ssrc, guint16 seqnum)
+{
+  Stream *stream = rtp_history_get_stream (history, ssrc, FALSE);
+  Slot *slot;
+
+  if (!stream || !(slot = stream_lookup (stream, seqnum)))
+    return NULL;
+
+  return &slot->packet;
+}
+
+/**
+ * rtp_history_get_oldest:
+ * @history: an #RtpHistory
+ * @ssrc: an SSRC
+ *
+ * Returns: (nullable): the stored packet of @ssrc with the lowest sequence
+ * number
+ */
+const RtpHistoryPacket *
+rtp_history_get_oldest (RtpHistory * history, guint32 ssrc)
+{
+  Stream *stream = rtp_history_get_stream (history, ssrc, FALSE);
+
+  if (!stream || stream->n_packets == 0)
+    return NULL;
+
+  return &stream_get_slot (stream, stream->first_seqnum)->packet;
+}
+
+/**
+ * rtp_history_get_newest:
+ * @history: an #RtpHistory
+ * @ssrc: an SSRC
+ *
+ * Returns: (nullable): the stored packet of @ssrc with the highest sequence
+ * number
+ */
+const RtpHistoryPacket *
+rtp_history_get_newest (RtpHistory * history, guint32 ssrc)
+{
+  Stream *stream = rtp_history_get_stream (history, ssrc, FALSE);
+
+  if (!stream || stream->n_packets == 0)
+    return NULL;
+
+  return &stream_get_slot (stream,
+      stream->first_seqnum + stream->span - 1)->packet;
+}
+
+/**
+ * rtp_history_get_max_arrival:
+ * @history: an #RtpHistory
+ * @ssrc: an SSRC
+ *
+ * Returns: the highest DTS or PTS of the packets added for @ssrc, or
+ * %GST_CLOCK_TIME_NONE
+ */
+GstClockTime
+rtp_history_get_max_arrival (RtpHistory * history, guint32 ssrc)
+{
+  Stream *stream = rtp_history_get_stream (history, ssrc, FALSE);
+
+  return stream ? stream->max_arrival : GST_CLOCK_TIME_NONE;
+}
+
+void
+rtp_history_remove_oldest (RtpHistory * history, guint32 ssrc)
+{
+  Stream *stream = rtp_history_get_stream (history, ssrc, FALSE);
+
+  if (!stream || stream->n_packets == 0)
+    return;
+
+  rtp_history_remove_slot (history, stream,
+      stream_get_slot (stream, stream->first_seqnum));
+}
+
+void
+rtp_history_remove_stream (RtpHistory * history, guint32 ssrc)
+{
+  Stream *stream = rtp_history_get_stream (history, ssrc, FALSE);
+
+  if (!stream)
+    return;
+
+  rtp_history_clear_stream (history, stream);
+  if (history->last_stream == stream)
+    history->last_stream = NULL;
+  g_hash_table_remove (history->streams, GUINT_TO_POINTER (ssrc));
+}
+
+void
+rtp_history_clear (RtpHistory * history)
+{
+  history->last_stream = NULL;
+  g_hash_table_remove_all (history->streams);
+  gst_queue_array_clear (history->order);
+  history->n_bytes = 0;
+  history->n_packets = 0;
+}
+
+gboolean
+rtp_history_has_stream (RtpHistory * history, guint32 ssrc)
+{
+  return rtp_history_get_stream (history, ssrc, FALSE) != NULL;
+}
+
+guint
+rtp_history_get_n_packets (RtpHistory * history, guint32 ssrc)
+{
+  Stream *stream = rtp_history_get_stream (history, ssrc, FALSE);
+
+  return stream ? stream->n_packets : 0;
+}
+
+/**
+ * rtp_history_get_n_bytes:
+ * @history: an #RtpHistory
+ *
+ * Returns: the total size of the stored buffers of all streams
+ */
+gsize
+rtp_history_get_n_bytes (RtpHistory * history)
+{
+  return history->n_bytes;
+}
+
+/**
+ * rtp_history_get_overhead:
+ * @history: an #RtpHistory
+ *
+ * Returns: the approximate memory used by the history itself, without the
+ * stored buffers
+ */
+gsize
+rtp_history_get_overhead (RtpHistory * history)
+{
+  GHashTableIter iter;
+  Stream *stream;
+  gsize overhead = sizeof (RtpHistory);
+
+  g_hash_table_iter_init (&iter, history->streams);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & stream)) {
+    /* the hash table needs about a key, a value and a hash per stream */
+    overhead += sizeof (Stream) + stream->size * sizeof (Slot) +
+        2 * sizeof (gpointer) + sizeof (guint);
+  }
+  overhead += gst_queue_array_get_length (history->order) *
+      sizeof (OrderEntry);
+
+  return overhead;
+}
@@ -0,0 +1,103 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __RTP_HISTORY_H__
+#define __RTP_HISTORY_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _RtpHistory RtpHistory;
+
+/**
+ * RtpHistoryPacket:
+ * @buffer: the stored RTP packet
+ * @arrival: the DTS or PTS of @buffer
+ * @rtptime: the RTP timestamp of @buffer
+ * @seqnum: the sequence number of @buffer
+ * @pt: the payload type of @buffer
+ *
+ * A packet in the history. It is owned by the history and only valid until
+ * the history is modified.
+ */
+typedef struct
+{
+  GstBuffer *buffer;
+  GstClockTime arrival;
+  guint32 rtptime;
+  guint16 seqnum;
+  guint8 pt;
+} RtpHistoryPacket;
+
+G_GNUC_INTERNAL
+RtpHistory *             rtp_history_new              (void);
+G_GNUC_INTERNAL
+void                     rtp_history_free             (RtpHistory * history);
+
+G_GNUC_INTERNAL
+void                     rtp_history_set_max_bytes    (RtpHistory * history,
+                                                       gsize max_bytes);
+G_GNUC_INTERNAL
+gsize                    rtp_history_get_max_bytes    (RtpHistory * history);
+
+G_GNUC_INTERNAL
+gboolean                 rtp_history_add_packet       (RtpHistory * history,
+                                                       guint32 ssrc,
+                                                       GstBuffer * buffer,
+                                                       guint16 seqnum,
+                                                       guint8 pt,
+                                                       guint32 rtptime);
+
+G_GNUC_INTERNAL
+const RtpHistoryPacket * rtp_history_lookup           (RtpHistory * history,
+                                                       guint32 ssrc,
+                                                       guint16 seqnum);
+G_GNUC_INTERNAL
+const RtpHistoryPacket * rtp_history_get_oldest       (RtpHistory * history,
+                                                       guint32 ssrc);
+G_GNUC_INTERNAL
+const RtpHistoryPacket * rtp_history_get_newest       (RtpHistory * history,
+                                                       guint32 ssrc);
+G_GNUC_INTERNAL
+GstClockTime             rtp_history_get_max_arrival  (RtpHistory * history,
+                                                       guint32 ssrc);
+
+G_GNUC_INTERNAL
+void                     rtp_history_remove_oldest    (RtpHistory * history,
+                                                       guint32 ssrc);
+G_GNUC_INTERNAL
+void                     rtp_history_remove_stream    (RtpHistory * history,
+                                                       guint32 ssrc);
+G_GNUC_INTERNAL
+void                     rtp_history_clear            (RtpHistory * history);
+
+G_GNUC_INTERNAL
+gboolean                 rtp_history_has_stream       (RtpHistory * history,
+                                                       guint32 ssrc);
+G_GNUC_INTERNAL
+guint                    rtp_history_get_n_packets    (RtpHistory * history,
+                                                       guint32 ssrc);
+G_GNUC_INTERNAL
+gsize                    rtp_history_get_n_bytes      (RtpHistory * history);
+G_GNUC_INTERNAL
+gsize                    rtp_history_get_overhead     (RtpHistory * history);
+
+G_END_DECLS
+
+#endif /* __RTP_HISTORY_H__ */
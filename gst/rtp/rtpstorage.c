@@ -21,8 +21,8 @@
 #include <gst/rtp/gstrtpbuffer.h>
 
 #include "rtpstorage.h"
-#include "rtpstoragestream.h"
 
+GST_DEBUG_CATEGORY_EXTERN (gst_rtp_storage_debug);
 #define GST_CAT_DEFAULT (gst_rtp_storage_debug)
 
 enum
@@ -35,17 +35,23 @@ static guint rtp_storage_signals[LAST_SIGNAL] = { 0 };
 
 G_DEFINE_TYPE (RtpStorage, rtp_storage, G_TYPE_OBJECT);
 
-#define STORAGE_LOCK(s)   g_mutex_lock   (&(s)->streams_lock)
-#define STORAGE_UNLOCK(s) g_mutex_unlock (&(s)->streams_lock)
+#define STORAGE_LOCK(s)   g_mutex_lock   (&(s)->lock)
+#define STORAGE_UNLOCK(s) g_mutex_unlock (&(s)->lock)
 #define DEFAULT_SIZE_TIME (0)
 
+/* These limits match those of the jittebuffer, we keep a couple more
+ * packets to avoid races as it can be queried after the output of the
+ * jitterbuffer. The history already limits the seqnum difference of a
+ * stream to half the seqnum space.
+ */
+#define MAX_STREAM_PACKETS (10100)
+
 static void
 rtp_storage_init (RtpStorage * self)
 {
   self->size_time = DEFAULT_SIZE_TIME;
-  self->streams = g_hash_table_new_full (NULL, NULL, NULL,
-      (GDestroyNotify) rtp_storage_stream_free);
-  g_mutex_init (&self->streams_lock);
+  self->history = rtp_history_new ();
+  g_mutex_init (&self->lock);
 }
 
 static void
@@ -53,13 +59,22 @@ rtp_storage_dispose (GObject * obj)
 {
   RtpStorage *self = RTP_STORAGE (obj);
   STORAGE_LOCK (self);
-  g_hash_table_unref (self->streams);
-  self->streams = NULL;
+  if (self->history) {
+    rtp_history_free (self->history);
+    self->history = NULL;
+  }
   STORAGE_UNLOCK (self);
-  g_mutex_clear (&self->streams_lock);
   G_OBJECT_CLASS (rtp_storage_parent_class)->dispose (obj);
 }
 
+static void
+rtp_storage_finalize (GObject * obj)
+{
+  RtpStorage *self = RTP_STORAGE (obj);
+  g_mutex_clear (&self->lock);
+  G_OBJECT_CLASS (rtp_storage_parent_class)->finalize (obj);
+}
+
 static void
 rtp_storage_class_init (RtpStorageClass * klass)
 {
@@ -70,6 +85,102 @@ rtp_storage_class_init (RtpStorageClass * klass)
       G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1, GST_TYPE_BUFFER);
 
   gobject_class->dispose = rtp_storage_dispose;
+  gobject_class->finalize = rtp_storage_finalize;
+}
+
+/* Must be called with the lock */
+static GstBufferList *
+rtp_storage_find_packets_for_recovery (RtpStorage * self, guint8 pt_fec,
+    guint32 ssrc, guint16 lost_seq)
+{
+  const RtpHistoryPacket *packet;
+  guint ret_length = 0;
+  guint16 start = 0, end = 0, seq, newest_seq;
+  gboolean have_start = FALSE, have_end = FALSE;
+  gboolean saw_fec = TRUE;      /* To initialize the start in the loop below */
+
+  /* Looking for media stream chunk with FEC packets at the end, which could
+   * can have the lost packet. For example:
+   *
+   *   |#0|  |#1|  |#2|  |#3 FEC|  |#4 FEC|  |#5 FEC|  |#6| ... |#8|  |#9 FEC|  |#10 FEC|
+   *
+   * Say @lost_seq = 7. Want to return bufferlist with packets [#6 : #10]. Other
+   * packets are not relevant for recovery of packet 7.
+   *
+   * Or the lost packet can be in the storage. In that case single packet is returned.
+   * It can happen if:
+   * - it could have arrived right after it was considered lost (more of a corner case)
+   * - it was recovered together with the other lost packet (most likely)
+   */
+  seq = rtp_history_get_oldest (self->history, ssrc)->seqnum;
+  newest_seq = rtp_history_get_newest (self->history, ssrc)->seqnum;
+
+  /* Iterating from oldest sequence numbers to newest */
+  for (packet = rtp_history_lookup (self->history, ssrc, seq); packet;) {
+    const RtpHistoryPacket *next = NULL;
+    guint16 next_seq = seq;
+    gboolean found_end = FALSE;
+
+    /* Is the buffer we lost in the storage? */
+    if (seq == lost_seq) {
+      start = end = seq;
+      have_start = have_end = TRUE;
+      ret_length = 1;
+      break;
+    }
+
+    /* the window of the history can have holes */
+    while (next_seq != newest_seq && !next)
+      next = rtp_history_lookup (self->history, ssrc, ++next_seq);
+
+    if (pt_fec == packet->pt) {
+      gint seq_diff = gst_rtp_buffer_compare_seqnum (lost_seq, seq);
+
+      if (seq_diff >= 0) {
+        if (next)
+          found_end = pt_fec != next->pt;
+        else
+          found_end = TRUE;
+      }
+      saw_fec = TRUE;
+    } else if (saw_fec) {
+      saw_fec = FALSE;
+      start = seq;
+      have_start = TRUE;
+      ret_length = 0;
+    }
+
+    ++ret_length;
+    if (found_end) {
+      end = seq;
+      have_end = TRUE;
+      break;
+    }
+
+    packet = next;
+    seq = next_seq;
+  }
+
+  if (have_end && !have_start)
+    start = end;
+
+  if (have_end) {
+    GstBufferList *ret = gst_buffer_list_new_sized (ret_length);
+
+    GST_LOG ("Found %u buffers with lost seq=%d for ssrc=%08x, creating %"
+        GST_PTR_FORMAT, ret_length, lost_seq, ssrc, ret);
+
+    for (seq = start;; seq++) {
+      packet = rtp_history_lookup (self->history, ssrc, seq);
+      if (packet)
+        gst_buffer_list_add (ret, gst_buffer_ref (packet->buffer));
+      if (seq == end)
+        break;
+    }
+    return ret;
+  }
+
+  return NULL;
 }
 
 GstBufferList *
@@ -77,7 +188,6 @@ rtp_storage_get_packets_for_recovery (RtpStorage * self, gint fec_pt,
     guint32 ssrc, guint16 lost_seq)
 {
   GstBufferList *ret = NULL;
-  RtpStorageStream *stream;
 
   if (0 == self->size_time) {
     GST_WARNING_OBJECT (self, "Received request for recovery RTP packets"
@@ -87,24 +197,16 @@ rtp_storage_get_packets_for_recovery (RtpStorage * self, gint fec_pt,
   }
 
   STORAGE_LOCK (self);
-  stream = g_hash_table_lookup (self->streams, GUINT_TO_POINTER (ssrc));
-  STORAGE_UNLOCK (self);
-
-  if (NULL == stream) {
+  if (!rtp_history_has_stream (self->history, ssrc)) {
     GST_ERROR_OBJECT (self, "Can't find ssrc = 0x08%x", ssrc);
+  } else if (rtp_history_get_n_packets (self->history, ssrc) > 0) {
+    GST_LOG_OBJECT (self, "Looking for recovery packets for fec_pt=%u around"
+        " lost_seq=%u for ssrc=%08x", fec_pt, lost_seq, ssrc);
+    ret = rtp_storage_find_packets_for_recovery (self, fec_pt, ssrc, lost_seq);
   } else {
-    STREAM_LOCK (stream);
-    if (stream->queue.length > 0) {
-      GST_LOG_OBJECT (self, "Looking for recovery packets for fec_pt=%u around"
-          " lost_seq=%u for ssrc=%08x", fec_pt, lost_seq, ssrc);
-      ret =
-          rtp_storage_stream_get_packets_for_recovery (stream, fec_pt,
-          lost_seq);
-    } else {
-      GST_DEBUG_OBJECT (self, "Empty RTP storage for ssrc=%08x", ssrc);
-    }
-    STREAM_UNLOCK (stream);
+    GST_DEBUG_OBJECT (self, "Empty RTP storage for ssrc=%08x", ssrc);
   }
+  STORAGE_UNLOCK (self);
 
   return ret;
 }
@@ -113,8 +215,8 @@ GstBuffer *
 rtp_storage_get_redundant_packet (RtpStorage * self, guint32 ssrc,
     guint16 lost_seq)
 {
+  const RtpHistoryPacket *packet;
   GstBuffer *ret = NULL;
-  RtpStorageStream *stream;
 
   if (0 == self->size_time) {
     GST_WARNING_OBJECT (self, "Received request for redundant RTP packet with"
@@ -123,104 +225,138 @@ rtp_storage_get_redundant_packet (RtpStorage * self, guint32 ssrc,
   }
 
   STORAGE_LOCK (self);
-  stream = g_hash_table_lookup (self->streams, GUINT_TO_POINTER (ssrc));
-  STORAGE_UNLOCK (self);
-
-  if (NULL == stream) {
+  if (!rtp_history_has_stream (self->history, ssrc)) {
     GST_ERROR_OBJECT (self, "Can't find ssrc = 0x%x", ssrc);
-  } else {
-    STREAM_LOCK (stream);
-    if (stream->queue.length > 0) {
-      ret = rtp_storage_stream_get_redundant_packet (stream, lost_seq);
+  } else if (rtp_history_get_n_packets (self->history, ssrc) > 0) {
+    packet = rtp_history_lookup (self->history, ssrc, lost_seq);
+    if (packet) {
+      GST_LOG ("Found buffer pt=%u seq=%u for ssrc=%08x %" GST_PTR_FORMAT,
+          packet->pt, packet->seqnum, ssrc, packet->buffer);
+      ret = gst_buffer_ref (packet->buffer);
     } else {
-      GST_DEBUG_OBJECT (self, "Empty RTP storage for ssrc=%08x", ssrc);
+      GST_DEBUG ("Could not find packet with seq=%u for ssrc=%08x",
+          lost_seq, ssrc);
     }
-    STREAM_UNLOCK (stream);
+  } else {
+    GST_DEBUG_OBJECT (self, "Empty RTP storage for ssrc=%08x", ssrc);
   }
+  STORAGE_UNLOCK (self);
 
   return ret;
 }
 
-static void
-rtp_storage_do_put_recovered_packet (RtpStorage * self,
+void
+rtp_storage_put_recovered_packet (RtpStorage * self,
     GstBuffer * buffer, guint8 pt, guint32 ssrc, guint16 seq)
 {
-  RtpStorageStream *stream;
-
-  STORAGE_LOCK (self);
-  stream = g_hash_table_lookup (self->streams, GUINT_TO_POINTER (ssrc));
-  STORAGE_UNLOCK (self);
-
-  g_assert (stream);
-
   GST_LOG_OBJECT (self,
       "Storing recovered RTP packet with ssrc=%08x pt=%u seq=%u %"
       GST_PTR_FORMAT, ssrc, pt, seq, buffer);
 
-  STREAM_LOCK (stream);
-  rtp_storage_stream_add_item (stream, buffer, pt, seq);
-  STREAM_UNLOCK (stream);
+  STORAGE_LOCK (self);
+  g_assert (rtp_history_has_stream (self->history, ssrc));
+  /* the RTP timestamp is not used by the storage */
+  rtp_history_add_packet (self->history, ssrc, buffer, seq, pt, 0);
+  STORAGE_UNLOCK (self);
+
+  g_signal_emit (self, rtp_storage_signals[SIGNAL_PACKET_RECOVERED], 0, buffer);
+  gst_buffer_unref (buffer);
 }
 
-void
-rtp_storage_put_recovered_packet (RtpStorage * self,
-    GstBuffer * buffer, guint8 pt, guint32 ssrc, guint16 seq)
+/* Removes the packets that arrived more than size-time before
+ * @max_arrival, along with the packets without timestamp before them.
+ * Must be called with the lock */
+static void
+rtp_storage_resize_stream (RtpStorage * self, guint32 ssrc,
+    GstClockTime max_arrival)
 {
-  rtp_storage_do_put_recovered_packet (self, buffer, pt, ssrc, seq);
-  g_signal_emit (self, rtp_storage_signals[SIGNAL_PACKET_RECOVERED], 0, buffer);
+  guint16 seq, newest_seq;
+  guint i, too_old_buffers_num = 0;
+
+  g_assert (GST_CLOCK_TIME_IS_VALID (max_arrival));
+  g_assert_cmpint (self->size_time, >, 0);
+
+  seq = rtp_history_get_oldest (self->history, ssrc)->seqnum;
+  newest_seq = rtp_history_get_newest (self->history, ssrc)->seqnum;
+
+  /* Iterating from oldest sequence numbers to newest */
+  for (i = 0;; seq++) {
+    const RtpHistoryPacket *packet =
+        rtp_history_lookup (self->history, ssrc, seq);
+
+    if (packet) {
+      ++i;
+      if (GST_CLOCK_TIME_IS_VALID (packet->arrival)) {
+        if (max_arrival - packet->arrival > self->size_time)
+          too_old_buffers_num = i;
+        else
+          break;
+      }
+    }
+    if (seq == newest_seq)
+      break;
+  }
+
+  for (i = 0; i < too_old_buffers_num; ++i) {
+    GST_TRACE ("Removing %u/%u buffers for ssrc=%08x", i,
+        too_old_buffers_num, ssrc);
+    rtp_history_remove_oldest (self->history, ssrc);
+  }
 }
 
 gboolean
 rtp_storage_append_buffer (RtpStorage * self, GstBuffer * buf)
 {
   GstRTPBuffer rtpbuf = GST_RTP_BUFFER_INIT;
-  RtpStorageStream *stream;
-  guint32 ssrc;
+  GstClockTime arrival_time, max_arrival;
+  guint32 ssrc, rtptime;
   guint8 pt;
   guint16 seq;
 
   if (0 == self->size_time)
     return TRUE;
 
-  /* We are about to save it in the queue, it so it is better take a ref before
-   * mapping the buffer */
-  gst_buffer_ref (buf);
-
   if (!gst_rtp_buffer_map (buf, GST_MAP_READ |
-          GST_RTP_BUFFER_MAP_FLAG_SKIP_PADDING, &rtpbuf)) {
-    gst_buffer_unref (buf);
+          GST_RTP_BUFFER_MAP_FLAG_SKIP_PADDING, &rtpbuf))
     return TRUE;
-  }
 
   ssrc = gst_rtp_buffer_get_ssrc (&rtpbuf);
   pt = gst_rtp_buffer_get_payload_type (&rtpbuf);
   seq = gst_rtp_buffer_get_seq (&rtpbuf);
+  rtptime = gst_rtp_buffer_get_timestamp (&rtpbuf);
+  gst_rtp_buffer_unmap (&rtpbuf);
 
   STORAGE_LOCK (self);
 
-  stream = g_hash_table_lookup (self->streams, GUINT_TO_POINTER (ssrc));
-  if (NULL == stream) {
+  if (!rtp_history_has_stream (self->history, ssrc)) {
     GST_DEBUG_OBJECT (self,
         "New media stream (ssrc=0x%08x, pt=%u) detected", ssrc, pt);
-    stream = rtp_storage_stream_new (ssrc);
-    g_hash_table_insert (self->streams, GUINT_TO_POINTER (ssrc), stream);
   }
 
-  STORAGE_UNLOCK (self);
-
   GST_LOG_OBJECT (self,
       "Storing RTP packet with ssrc=%08x pt=%u seq=%u %" GST_PTR_FORMAT,
       ssrc, pt, seq, buf);
 
-  STREAM_LOCK (stream);
+  if (rtp_history_get_n_packets (self->history, ssrc) > MAX_STREAM_PACKETS) {
+    GST_WARNING ("Queue too big, removing seq=%d for ssrc=%08x",
+        rtp_history_get_oldest (self->history, ssrc)->seqnum, ssrc);
+    rtp_history_remove_oldest (self->history, ssrc);
+  }
 
-  /* Saving the buffer, now the storage owns it */
-  rtp_storage_stream_resize_and_add_item (stream, self->size_time, buf, pt,
-      seq);
+  arrival_time = GST_BUFFER_DTS_OR_PTS (buf);
+  if (G_LIKELY (GST_CLOCK_TIME_IS_VALID (arrival_time)) &&
+      rtp_history_get_n_packets (self->history, ssrc) > 0) {
+    max_arrival = rtp_history_get_max_arrival (self->history, ssrc);
+    if (!GST_CLOCK_TIME_IS_VALID (max_arrival) || arrival_time > max_arrival)
+      max_arrival = arrival_time;
 
-  STREAM_UNLOCK (stream);
+    rtp_storage_resize_stream (self, ssrc, max_arrival);
+  }
 
-  gst_rtp_buffer_unmap (&rtpbuf);
+  /* Saving a reference to the buffer */
+  rtp_history_add_packet (self->history, ssrc, buf, seq, pt, rtptime);
+
+  STORAGE_UNLOCK (self);
 
   if (GST_BUFFER_FLAG_IS_SET (buf, GST_RTP_BUFFER_FLAG_REDUNDANT)) {
     gst_buffer_unref (buf);
@@ -234,7 +370,7 @@ void
 rtp_storage_clear (RtpStorage * self)
 {
   STORAGE_LOCK (self);
-  g_hash_table_remove_all (self->streams);
+  rtp_history_clear (self->history);
   STORAGE_UNLOCK (self);
 }
 
@@ -252,6 +388,36 @@ rtp_storage_get_size (RtpStorage * self)
   return self->size_time;
 }
 
+/**
+ * rtp_storage_set_size_bytes:
+ * @self: an #RtpStorage
+ * @size: the total size of the stored packets of all streams, 0 for no
+ *   limit
+ *
+ * Limits the memory used by the stored packets in addition to size-time.
+ * Above the limit the packets stored first are removed, whatever their
+ * stream.
+ */
+void
+rtp_storage_set_size_bytes (RtpStorage * self, guint64 size)
+{
+  STORAGE_LOCK (self);
+  rtp_history_set_max_bytes (self->history, MIN (size, G_MAXSIZE));
+  STORAGE_UNLOCK (self);
+}
+
+guint64
+rtp_storage_get_size_bytes (RtpStorage * self)
+{
+  guint64 size;
+
+  STORAGE_LOCK (self);
+  size = rtp_history_get_max_bytes (self->history);
+  STORAGE_UNLOCK (self);
+
+  return size;
+}
+
 RtpStorage *
 rtp_storage_new (void)
 {
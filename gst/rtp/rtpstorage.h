@@ -23,6 +23,8 @@
 
 #include <gst/gst.h>
 
+#include "rtphistory.h"
+
 G_BEGIN_DECLS
 
 #define RTP_TYPE_STORAGE \
@@ -46,8 +48,8 @@ struct _RtpStorageClass {
 struct _RtpStorage {
   GObject parent;
   GstClockTime size_time;
-  GHashTable *streams;
-  GMutex streams_lock;
+  RtpHistory *history;
+  GMutex lock;
 };
 
 GstBufferList * rtp_storage_get_packets_for_recovery (RtpStorage * self, gint fec_pt,
@@ -61,6 +63,8 @@ void            rtp_storage_clear                    (RtpStorage *self);
 RtpStorage    * rtp_storage_new                      (void);
 void            rtp_storage_set_size                 (RtpStorage *self, GstClockTime size);
 GstClockTime    rtp_storage_get_size                 (RtpStorage *self);
+void            rtp_storage_set_size_bytes           (RtpStorage *self, guint64 size);
+guint64         rtp_storage_get_size_bytes           (RtpStorage *self);
 
 GType rtp_storage_get_type (void);
 
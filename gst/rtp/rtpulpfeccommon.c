@@ -20,6 +20,7 @@
 
 #include <string.h>
 #include "rtpulpfeccommon.h"
+#include "rtpfecorc.h"
 
 #define MIN_RTP_HEADER_LEN 12
 
@@ -117,26 +118,6 @@ fec_hdr_get_timestamp_recovery (RtpUlpFecHeader const *fec_hdr)
   return g_ntohl (fec_hdr->timestamp);
 }
 
-static void
-_xor_mem (guint8 * restrict dst, const guint8 * restrict src, gsize length)
-{
-  guint i;
-
-  for (i = 0; i < (length / sizeof (guint64)); ++i) {
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-    GST_WRITE_UINT64_LE (dst,
-        GST_READ_UINT64_LE (dst) ^ GST_READ_UINT64_LE (src));
-#else
-    GST_WRITE_UINT64_BE (dst,
-        GST_READ_UINT64_BE (dst) ^ GST_READ_UINT64_BE (src));
-#endif
-    dst += sizeof (guint64);
-    src += sizeof (guint64);
-  }
-  for (i = 0; i < (length % sizeof (guint64)); ++i)
-    dst[i] ^= src[i];
-}
-
 guint16
 rtp_ulpfec_hdr_get_protection_len (RtpUlpFecHeader const *fec_hdr)
 {
@@ -246,7 +227,7 @@ rtp_buffer_to_ulpfec_bitstring (GstRTPBuffer * rtp, GArray * dst_arr,
 
     *((guint64 *) dst) ^= *((const guint64 *) src);
     ((RtpUlpFecHeader *) dst)->len ^= g_htons (len);
-    _xor_mem (dst + dst_offset, src + src_offset, len);
+    rtp_fec_orc_xor (dst + dst_offset, src + src_offset, len);
   }
 }
 
@@ -352,6 +352,7 @@ enum
 #define DEFAULT_MAX_STREAMS          G_MAXUINT
 #define DEFAULT_MAX_TS_OFFSET_ADJUSTMENT G_GUINT64_CONSTANT(0)
 #define DEFAULT_MAX_TS_OFFSET        G_GINT64_CONSTANT(3000000000)
+#define DEFAULT_SHARED_TIMERS        FALSE
 
 enum
 {
@@ -381,6 +382,7 @@ enum
   PROP_MAX_TS_OFFSET,
   PROP_FEC_DECODERS,
   PROP_FEC_ENCODERS,
+  PROP_SHARED_TIMERS,
 };
 
 #define GST_RTP_BIN_RTCP_SYNC_TYPE (gst_rtp_bin_rtcp_sync_get_type())
@@ -1862,6 +1864,8 @@ create_stream (GstRtpBinSession * session, guint32 ssrc)
   if (g_object_class_find_property (jb_class, "max-ts-offset-adjustment"))
     g_object_set (buffer, "max-ts-offset-adjustment",
         rtpbin->max_ts_offset_adjustment, NULL);
+  if (g_object_class_find_property (jb_class, "shared-timers"))
+    g_object_set (buffer, "shared-timers", rtpbin->shared_timers, NULL);
 
   g_signal_emit (rtpbin, gst_rtp_bin_signals[SIGNAL_NEW_JITTERBUFFER], 0,
       buffer, session->id, ssrc);
@@ -2765,6 +2769,21 @@ gst_rtp_bin_class_init (GstRtpBinClass * klass)
           "fec-encoders='fec,0=\"rtpst2022-1-fecenc\\ rows\\=5\\ columns\\=5\";'",
           GST_TYPE_STRUCTURE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRtpBin:shared-timers:
+   *
+   * Handle the timers of the jitterbuffers from a small pool of threads
+   * shared by all jitterbuffers instead of one thread per jitterbuffer.
+   * This is useful when receiving many streams.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_SHARED_TIMERS,
+      g_param_spec_boolean ("shared-timers", "Shared timers",
+          "Use timer threads shared between jitterbuffers instead of a "
+          "dedicated timer thread per jitterbuffer", DEFAULT_SHARED_TIMERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_rtp_bin_change_state);
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_rtp_bin_request_new_pad);
@@ -2849,6 +2868,7 @@ gst_rtp_bin_init (GstRtpBin * rtpbin)
   rtpbin->rfc7273_sync = DEFAULT_RFC7273_SYNC;
   rtpbin->max_streams = DEFAULT_MAX_STREAMS;
   rtpbin->max_ts_offset_adjustment = DEFAULT_MAX_TS_OFFSET_ADJUSTMENT;
+  rtpbin->shared_timers = DEFAULT_SHARED_TIMERS;
   rtpbin->max_ts_offset = DEFAULT_MAX_TS_OFFSET;
   rtpbin->max_ts_offset_is_set = FALSE;
 
@@ -3171,6 +3191,11 @@ gst_rtp_bin_set_property (GObject * object, guint prop_id,
     case PROP_FEC_ENCODERS:
       gst_rtp_bin_set_fec_encoders_struct (rtpbin, g_value_get_boxed (value));
       break;
+    case PROP_SHARED_TIMERS:
+      GST_RTP_BIN_LOCK (rtpbin);
+      rtpbin->shared_timers = g_value_get_boolean (value);
+      GST_RTP_BIN_UNLOCK (rtpbin);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3271,6 +3296,11 @@ gst_rtp_bin_get_property (GObject * object, guint prop_id,
     case PROP_FEC_ENCODERS:
       g_value_take_boxed (value, gst_rtp_bin_get_fec_encoders_struct (rtpbin));
       break;
+    case PROP_SHARED_TIMERS:
+      GST_RTP_BIN_LOCK (rtpbin);
+      g_value_set_boolean (value, rtpbin->shared_timers);
+      GST_RTP_BIN_UNLOCK (rtpbin);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
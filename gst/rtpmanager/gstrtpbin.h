@@ -78,6 +78,7 @@ struct _GstRtpBin {
   guint64         max_ts_offset_adjustment;
   gint64          max_ts_offset;
   gboolean        max_ts_offset_is_set;
+  gboolean        shared_timers;
 
   /* a list of session */
   GSList         *sessions;
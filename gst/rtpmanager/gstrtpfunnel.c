@@ -218,21 +218,19 @@ done:
 }
 
 static void
-gst_rtp_funnel_set_twcc_seqnum (GstRtpFunnel * funnel,
-    GstPad * pad, GstBuffer ** buf)
+gst_rtp_funnel_set_twcc_seqnum (GstRtpFunnel * funnel, GstBuffer ** buf)
 {
-  GstRtpFunnelPad *fpad = GST_RTP_FUNNEL_PAD_CAST (pad);
   guint8 twcc_seq[2] = { 0, };
   GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
   guint ext_id = gst_rtp_header_extension_get_id (funnel->twcc_ext);
   guint8 *existing;
+  guint8 appbits;
   guint size;
 
-  if (!funnel->twcc_ext || !fpad->has_twcc)
-    return;
-
   *buf = gst_buffer_make_writable (*buf);
 
+  /* the extension is called for every packet so that it always advances its
+   * twcc-seqnum, and it maps the packet itself, so only map it here after */
   gst_rtp_header_extension_write (funnel->twcc_ext, *buf,
       GST_RTP_HEADER_EXTENSION_ONE_BYTE, *buf, twcc_seq, sizeof (twcc_seq));
 
@@ -240,13 +238,14 @@ gst_rtp_funnel_set_twcc_seqnum (GstRtpFunnel * funnel,
     goto map_failed;
 
   if (gst_rtp_buffer_get_extension_onebyte_header (&rtp, ext_id,
+          0, (gpointer) & existing, &size) ||
+      gst_rtp_buffer_get_extension_twobyte_header (&rtp, &appbits, ext_id,
           0, (gpointer) & existing, &size)) {
-    if (size >= gst_rtp_header_extension_get_max_size (funnel->twcc_ext, *buf)) {
+    if (size >= sizeof (twcc_seq)) {
       existing[0] = twcc_seq[0];
       existing[1] = twcc_seq[1];
     }
   }
-  /* TODO: two-byte variant */
 
   gst_rtp_buffer_unmap (&rtp);
 
@@ -258,10 +257,30 @@ map_failed:
   }
 }
 
+static GstBufferList *
+gst_rtp_funnel_set_twcc_seqnum_list (GstRtpFunnel * funnel,
+    GstBufferList * list)
+{
+  guint i, len = gst_buffer_list_length (list);
+
+  list = gst_buffer_list_make_writable (list);
+
+  for (i = 0; i < len; i++) {
+    GstBuffer *buf = gst_buffer_list_get_writable (list, i);
+
+    /* the list owns the buffer and it is already writable, so it stays the
+     * same buffer */
+    gst_rtp_funnel_set_twcc_seqnum (funnel, &buf);
+  }
+
+  return list;
+}
+
 static GstFlowReturn
 gst_rtp_funnel_sink_chain_object (GstPad * pad, GstRtpFunnel * funnel,
     gboolean is_list, GstMiniObject * obj)
 {
+  GstRtpFunnelPad *fpad = GST_RTP_FUNNEL_PAD_CAST (pad);
   GstFlowReturn res;
 
   GST_DEBUG_OBJECT (pad, "received %" GST_PTR_FORMAT, obj);
@@ -272,10 +291,16 @@ gst_rtp_funnel_sink_chain_object (GstPad * pad, GstRtpFunnel * funnel,
   gst_rtp_funnel_forward_segment (funnel, pad);
 
   if (is_list) {
-    res = gst_pad_push_list (funnel->srcpad, GST_BUFFER_LIST_CAST (obj));
+    GstBufferList *list = GST_BUFFER_LIST_CAST (obj);
+
+    if (funnel->twcc_ext && fpad->has_twcc)
+      list = gst_rtp_funnel_set_twcc_seqnum_list (funnel, list);
+    res = gst_pad_push_list (funnel->srcpad, list);
   } else {
     GstBuffer *buf = GST_BUFFER_CAST (obj);
-    gst_rtp_funnel_set_twcc_seqnum (funnel, pad, &buf);
+
+    if (funnel->twcc_ext && fpad->has_twcc)
+      gst_rtp_funnel_set_twcc_seqnum (funnel, &buf);
     res = gst_pad_push (funnel->srcpad, buf);
   }
   GST_PAD_STREAM_UNLOCK (funnel->srcpad);
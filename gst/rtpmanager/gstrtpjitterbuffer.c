@@ -154,6 +154,7 @@ enum
 #define DEFAULT_MAX_MISORDER_TIME   2000
 #define DEFAULT_RFC7273_SYNC        FALSE
 #define DEFAULT_FASTSTART_MIN_PACKETS 0
+#define DEFAULT_SHARED_TIMERS       FALSE
 
 #define DEFAULT_AUTO_RTX_DELAY (20 * GST_MSECOND)
 #define DEFAULT_AUTO_RTX_TIMEOUT (40 * GST_MSECOND)
@@ -186,7 +187,8 @@ enum
   PROP_MAX_DROPOUT_TIME,
   PROP_MAX_MISORDER_TIME,
   PROP_RFC7273_SYNC,
-  PROP_FASTSTART_MIN_PACKETS
+  PROP_FASTSTART_MIN_PACKETS,
+  PROP_SHARED_TIMERS
 };
 
 #define JBUF_LOCK(priv)   G_STMT_START {			\
@@ -310,6 +312,13 @@ struct _GstRtpJitterBufferPrivate
   gboolean timer_running;
   GThread *timer_thread;
 
+  /* timers handled by the shared timer threads */
+  gboolean timer_shared;
+  gboolean timer_queued;
+  gboolean timer_busy;
+  gboolean timer_rerun;
+  GstClockTime timer_now;
+
   /* properties */
   guint latency_ms;
   guint64 latency_ns;
@@ -334,6 +343,7 @@ struct _GstRtpJitterBufferPrivate
   guint32 max_dropout_time;
   guint32 max_misorder_time;
   guint faststart_min_packets;
+  gboolean shared_timers;
 
   /* the last seqnum we pushed out */
   guint32 last_popped_seqnum;
@@ -518,6 +528,9 @@ static void do_handle_sync (GstRtpJitterBuffer * jitterbuffer);
 static void unschedule_current_timer (GstRtpJitterBuffer * jitterbuffer);
 
 static void wait_next_timeout (GstRtpJitterBuffer * jitterbuffer);
+static void schedule_shared_timer (GstRtpJitterBuffer * jitterbuffer);
+static gboolean shared_timer_expired (GstClock * clock, GstClockTime time,
+    GstClockID id, gpointer user_data);
 
 static GstStructure *gst_rtp_jitter_buffer_create_stats (GstRtpJitterBuffer *
     jitterbuffer);
@@ -902,6 +915,26 @@ gst_rtp_jitter_buffer_class_init (GstRtpJitterBufferClass * klass)
           0, G_MAXUINT, DEFAULT_FASTSTART_MIN_PACKETS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRtpJitterBuffer:shared-timers:
+   *
+   * Handle timers from a small pool of threads shared by all jitterbuffers
+   * in the process instead of a dedicated thread per jitterbuffer. This
+   * avoids having one mostly idle thread per stream when receiving many
+   * streams. Expired timers of a jitterbuffer are handled in small batches
+   * so that a single stream can't delay the timers of other streams.
+   *
+   * Changing this property only takes effect when going from READY to
+   * PAUSED.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_SHARED_TIMERS,
+      g_param_spec_boolean ("shared-timers", "Shared timers",
+          "Use timer threads shared with other jitterbuffers instead of a "
+          "dedicated timer thread", DEFAULT_SHARED_TIMERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstRtpJitterBuffer::request-pt-map:
    * @buffer: the object which received the signal
@@ -1031,6 +1064,7 @@ gst_rtp_jitter_buffer_init (GstRtpJitterBuffer * jitterbuffer)
   priv->max_dropout_time = DEFAULT_MAX_DROPOUT_TIME;
   priv->max_misorder_time = DEFAULT_MAX_MISORDER_TIME;
   priv->faststart_min_packets = DEFAULT_FASTSTART_MIN_PACKETS;
+  priv->shared_timers = DEFAULT_SHARED_TIMERS;
 
   priv->ts_offset_remainder = 0;
   priv->last_dts = -1;
@@ -1675,8 +1709,11 @@ gst_rtp_jitter_buffer_change_state (GstElement * element,
       priv->blocked = TRUE;
       priv->timer_running = TRUE;
       priv->srcresult = GST_FLOW_OK;
-      priv->timer_thread =
-          g_thread_new ("timer", (GThreadFunc) wait_next_timeout, jitterbuffer);
+      priv->timer_shared = priv->shared_timers;
+      priv->timer_now = 0;
+      if (!priv->timer_shared)
+        priv->timer_thread = g_thread_new ("timer",
+            (GThreadFunc) wait_next_timeout, jitterbuffer);
       JBUF_UNLOCK (priv);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
@@ -1685,6 +1722,8 @@ gst_rtp_jitter_buffer_change_state (GstElement * element,
       priv->blocked = FALSE;
       JBUF_SIGNAL_EVENT (priv);
       JBUF_SIGNAL_TIMER (priv);
+      if (priv->timer_shared)
+        schedule_shared_timer (jitterbuffer);
       JBUF_UNLOCK (priv);
       break;
     default:
@@ -1705,6 +1744,8 @@ gst_rtp_jitter_buffer_change_state (GstElement * element,
       /* block to stop streaming when PAUSED */
       priv->blocked = TRUE;
       unschedule_current_timer (jitterbuffer);
+      if (priv->timer_shared)
+        schedule_shared_timer (jitterbuffer);
       JBUF_UNLOCK (priv);
       if (ret != GST_STATE_CHANGE_FAILURE)
         ret = GST_STATE_CHANGE_NO_PREROLL;
@@ -1718,9 +1759,14 @@ gst_rtp_jitter_buffer_change_state (GstElement * element,
       JBUF_SIGNAL_TIMER (priv);
       JBUF_SIGNAL_QUERY (priv, FALSE);
       JBUF_SIGNAL_QUEUE (priv);
+      /* a shared timer thread might still be handling our timers */
+      while (priv->timer_busy)
+        JBUF_WAIT_TIMER (priv);
       JBUF_UNLOCK (priv);
-      g_thread_join (priv->timer_thread);
-      priv->timer_thread = NULL;
+      if (priv->timer_thread) {
+        g_thread_join (priv->timer_thread);
+        priv->timer_thread = NULL;
+      }
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
@@ -2174,6 +2220,9 @@ unschedule_current_timer (GstRtpJitterBuffer * jitterbuffer)
   if (priv->clock_id) {
     GST_DEBUG_OBJECT (jitterbuffer, "unschedule current timer");
     gst_clock_id_unschedule (priv->clock_id);
+    /* with shared timers nobody is waiting on the clock id and we own it */
+    if (priv->timer_shared)
+      gst_clock_id_unref (priv->clock_id);
     priv->clock_id = NULL;
   }
 }
@@ -2202,11 +2251,14 @@ update_current_timer (GstRtpJitterBuffer * jitterbuffer)
   JBUF_SIGNAL_TIMER (priv);
 
   /* no need to wait if the current wait is earlier or later */
-  if (timer->timeout != -1 && timer->timeout >= priv->timer_timeout)
+  if (priv->clock_id && timer->timeout != -1
+      && timer->timeout >= priv->timer_timeout)
     return;
 
   /* for other cases, force a reschedule of the timer thread */
   unschedule_current_timer (jitterbuffer);
+  if (priv->timer_shared)
+    schedule_shared_timer (jitterbuffer);
 }
 
 /* get the extra delay to wait before sending RTX */
@@ -3580,6 +3632,8 @@ pop_and_push_next (GstRtpJitterBuffer * jitterbuffer, guint seqnum)
     while (rtp_timer_queue_length (priv->timers) > 0) {
       /* Stopping timers */
       unschedule_current_timer (jitterbuffer);
+      if (priv->timer_shared)
+        schedule_shared_timer (jitterbuffer);
       JBUF_WAIT_TIMER (priv);
     }
   }
@@ -4065,6 +4119,26 @@ push_rtx_events (GstRtpJitterBuffer * jitterbuffer, GQueue * events)
   JBUF_LOCK (priv);
 }
 
+/* get the running time to expire timers against, @now is returned when there
+ * is no clock */
+static GstClockTime
+get_timer_now (GstRtpJitterBuffer * jitterbuffer, GstClockTime now)
+{
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+
+  GST_OBJECT_LOCK (jitterbuffer);
+  if (priv->eos) {
+    now = GST_CLOCK_TIME_NONE;
+  } else if (GST_ELEMENT_CLOCK (jitterbuffer)) {
+    now =
+        gst_clock_get_time (GST_ELEMENT_CLOCK (jitterbuffer)) -
+        GST_ELEMENT_CAST (jitterbuffer)->base_time;
+  }
+  GST_OBJECT_UNLOCK (jitterbuffer);
+
+  return now;
+}
+
 /* called when we need to wait for the next timeout.
  *
  * We loop over the array of recorded timeouts and wait for the earliest one.
@@ -4096,15 +4170,7 @@ wait_next_timeout (GstRtpJitterBuffer * jitterbuffer)
      * expire), and also for the very first loop iteration now would
      * otherwise always be 0
      */
-    GST_OBJECT_LOCK (jitterbuffer);
-    if (priv->eos) {
-      now = GST_CLOCK_TIME_NONE;
-    } else if (GST_ELEMENT_CLOCK (jitterbuffer)) {
-      now =
-          gst_clock_get_time (GST_ELEMENT_CLOCK (jitterbuffer)) -
-          GST_ELEMENT_CAST (jitterbuffer)->base_time;
-    }
-    GST_OBJECT_UNLOCK (jitterbuffer);
+    now = get_timer_now (jitterbuffer, now);
 
     GST_DEBUG_OBJECT (jitterbuffer, "now %" GST_TIME_FORMAT,
         GST_TIME_ARGS (now));
@@ -4203,6 +4269,168 @@ stopping:
   return;
 }
 
+/* Shared timers
+ *
+ * Instead of a dedicated timer thread, the timers of the jitterbuffer can be
+ * handled by a pool of threads shared by all jitterbuffers. A jitterbuffer
+ * has at most one pending async clock wait for its earliest timer. When it
+ * expires, or when the timers changed, the jitterbuffer is queued in the
+ * thread pool which handles the expired timers and schedules the next wait.
+ */
+#define SHARED_TIMER_MAX_TIMEOUTS 16
+
+static void
+shared_timer_run (GstRtpJitterBuffer * jitterbuffer, gpointer user_data)
+{
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+  GQueue events = G_QUEUE_INIT;
+  gboolean yield = FALSE;
+
+  JBUF_LOCK (priv);
+  priv->timer_queued = FALSE;
+  priv->timer_busy = TRUE;
+
+  do {
+    RtpTimer *timer;
+    GstClock *clock;
+    GstClockTime now, sync_time;
+    guint n_timeouts = 0;
+
+    priv->timer_rerun = FALSE;
+
+    /* don't produce data in paused, we get rescheduled when going to
+     * playing */
+    if (!priv->timer_running || priv->blocked)
+      break;
+
+    /* drop the current wait, we schedule a new one for the earliest timer */
+    if (priv->clock_id) {
+      gst_clock_id_unschedule (priv->clock_id);
+      gst_clock_id_unref (priv->clock_id);
+      priv->clock_id = NULL;
+    }
+
+    now = priv->timer_now = get_timer_now (jitterbuffer, priv->timer_now);
+
+    GST_DEBUG_OBJECT (jitterbuffer, "now %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (now));
+
+    /* Clear expired rtx-stats timers */
+    if (priv->do_retransmission)
+      rtp_timer_queue_remove_until (priv->rtx_stats_timers, now);
+
+    /* Iterate expired "normal" timers, leaving some time to the other
+     * jitterbuffers if there are many of them */
+    while ((timer = rtp_timer_queue_pop_until (priv->timers, now))) {
+      do_timeout (jitterbuffer, timer, now, &events);
+      if (++n_timeouts == SHARED_TIMER_MAX_TIMEOUTS) {
+        yield = TRUE;
+        break;
+      }
+    }
+    if (yield)
+      break;
+
+    timer = rtp_timer_queue_peek_earliest (priv->timers);
+    if (timer == NULL)
+      break;
+
+    g_assert (GST_CLOCK_TIME_IS_VALID (timer->timeout));
+
+    GST_OBJECT_LOCK (jitterbuffer);
+    clock = GST_ELEMENT_CLOCK (jitterbuffer);
+    if (!clock) {
+      GST_OBJECT_UNLOCK (jitterbuffer);
+      /* let's just push if there is no clock */
+      GST_DEBUG_OBJECT (jitterbuffer, "No clock, timeout right away");
+      priv->timer_now = timer->timeout;
+      priv->timer_rerun = TRUE;
+      continue;
+    }
+
+    sync_time = timer->timeout + GST_ELEMENT_CAST (jitterbuffer)->base_time;
+    sync_time += priv->peer_latency;
+
+    GST_DEBUG_OBJECT (jitterbuffer, "timer #%i sync to timestamp %"
+        GST_TIME_FORMAT " with sync time %" GST_TIME_FORMAT, timer->seqnum,
+        GST_TIME_ARGS (get_pts_timeout (timer)), GST_TIME_ARGS (sync_time));
+
+    priv->clock_id = gst_clock_new_single_shot_id (clock, sync_time);
+    priv->timer_timeout = timer->timeout;
+    priv->timer_seqnum = timer->seqnum;
+    GST_OBJECT_UNLOCK (jitterbuffer);
+
+    gst_clock_id_wait_async (priv->clock_id, shared_timer_expired,
+        gst_object_ref (jitterbuffer), (GDestroyNotify) gst_object_unref);
+  } while (priv->timer_rerun);
+  JBUF_UNLOCK (priv);
+
+  push_rtx_events_unlocked (jitterbuffer, &events);
+
+  JBUF_LOCK (priv);
+  priv->timer_busy = FALSE;
+  if (yield || priv->timer_rerun)
+    schedule_shared_timer (jitterbuffer);
+  /* wake up the pushing thread draining the timers on EOS, or the state
+   * change waiting for us to finish */
+  JBUF_SIGNAL_TIMER (priv);
+  JBUF_UNLOCK (priv);
+
+  gst_object_unref (jitterbuffer);
+}
+
+static gpointer
+create_shared_timer_pool (gpointer user_data)
+{
+  return g_thread_pool_new ((GFunc) shared_timer_run, NULL,
+      g_get_num_processors (), FALSE, NULL);
+}
+
+/* queue @jitterbuffer in the shared timer threads, called with JBUF_LOCK */
+static void
+schedule_shared_timer (GstRtpJitterBuffer * jitterbuffer)
+{
+  static GOnce pool_once = G_ONCE_INIT;
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+
+  if (!priv->timer_running)
+    return;
+
+  /* already running, make it check the timers again before finishing */
+  if (priv->timer_busy) {
+    priv->timer_rerun = TRUE;
+    return;
+  }
+
+  if (priv->timer_queued)
+    return;
+
+  g_once (&pool_once, create_shared_timer_pool, NULL);
+
+  priv->timer_queued = TRUE;
+  g_thread_pool_push (pool_once.retval, gst_object_ref (jitterbuffer), NULL);
+}
+
+static gboolean
+shared_timer_expired (GstClock * clock, GstClockTime time, GstClockID id,
+    gpointer user_data)
+{
+  GstRtpJitterBuffer *jitterbuffer = user_data;
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+
+  JBUF_LOCK (priv);
+  /* ignore waits that got replaced in the meantime */
+  if (priv->clock_id == id) {
+    GST_DEBUG_OBJECT (jitterbuffer, "sync done, #%d", priv->timer_seqnum);
+    gst_clock_id_unref (priv->clock_id);
+    priv->clock_id = NULL;
+    schedule_shared_timer (jitterbuffer);
+  }
+  JBUF_UNLOCK (priv);
+
+  return TRUE;
+}
+
 /*
  * This function implements the main pushing loop on the source pad.
  *
@@ -4741,6 +4969,11 @@ gst_rtp_jitter_buffer_set_property (GObject * object,
       priv->faststart_min_packets = g_value_get_uint (value);
       JBUF_UNLOCK (priv);
       break;
+    case PROP_SHARED_TIMERS:
+      JBUF_LOCK (priv);
+      priv->shared_timers = g_value_get_boolean (value);
+      JBUF_UNLOCK (priv);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -4897,6 +5130,11 @@ gst_rtp_jitter_buffer_get_property (GObject * object,
       g_value_set_uint (value, priv->faststart_min_packets);
       JBUF_UNLOCK (priv);
       break;
+    case PROP_SHARED_TIMERS:
+      JBUF_LOCK (priv);
+      g_value_set_boolean (value, priv->shared_timers);
+      JBUF_UNLOCK (priv);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -53,6 +53,7 @@ GST_DEBUG_CATEGORY_STATIC (gst_rtp_rtx_send_debug);
 #define DEFAULT_RTX_PAYLOAD_TYPE 0
 #define DEFAULT_MAX_SIZE_TIME    0
 #define DEFAULT_MAX_SIZE_PACKETS 100
+#define DEFAULT_MAX_SIZE_BYTES   0
 
 enum
 {
@@ -64,6 +65,7 @@ enum
   PROP_NUM_RTX_REQUESTS,
   PROP_NUM_RTX_PACKETS,
   PROP_CLOCK_RATE_MAP,
+  PROP_MAX_SIZE_BYTES,
 };
 
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
@@ -109,28 +111,11 @@ G_DEFINE_TYPE_WITH_CODE (GstRtpRtxSend, gst_rtp_rtx_send, GST_TYPE_ELEMENT,
 GST_ELEMENT_REGISTER_DEFINE (rtprtxsend, "rtprtxsend", GST_RANK_NONE,
     GST_TYPE_RTP_RTX_SEND);
 
-typedef struct
-{
-  guint16 seqnum;
-  guint32 timestamp;
-  GstBuffer *buffer;
-} BufferQueueItem;
-
-static void
-buffer_queue_item_free (BufferQueueItem * item)
-{
-  gst_buffer_unref (item->buffer);
-  g_slice_free (BufferQueueItem, item);
-}
-
 typedef struct
 {
   guint32 rtx_ssrc;
   guint16 seqnum_base, next_seqnum;
   gint clock_rate;
-
-  /* history of rtp packets */
-  GSequence *queue;
 } SSRCRtxData;
 
 static SSRCRtxData *
@@ -140,7 +125,6 @@ ssrc_rtx_data_new (guint32 rtx_ssrc)
 
   data->rtx_ssrc = rtx_ssrc;
   data->next_seqnum = data->seqnum_base = g_random_int_range (0, G_MAXUINT16);
-  data->queue = g_sequence_new ((GDestroyNotify) buffer_queue_item_free);
 
   return data;
 }
@@ -148,7 +132,6 @@ ssrc_rtx_data_new (guint32 rtx_ssrc)
 static void
 ssrc_rtx_data_free (SSRCRtxData * data)
 {
-  g_sequence_free (data->queue);
   g_slice_free (SSRCRtxData, data);
 }
 
@@ -202,6 +185,21 @@ gst_rtp_rtx_send_class_init (GstRtpRtxSendClass * klass)
           "Map of payload types to their clock rates",
           GST_TYPE_STRUCTURE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRtpRtxSend:max-size-bytes:
+   *
+   * The maximum size of the packets kept for retransmission, for all the
+   * streams together. When exceeded the packets that were queued first are
+   * removed, whatever their stream.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BYTES,
+      g_param_spec_uint ("max-size-bytes", "Max Size Bytes",
+          "Amount of bytes to queue for all streams (0 = unlimited)", 0,
+          G_MAXUINT, DEFAULT_MAX_SIZE_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_factory);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_factory);
 
@@ -221,6 +219,7 @@ gst_rtp_rtx_send_reset (GstRtpRtxSend * rtx)
   gst_data_queue_flush (rtx->queue);
   g_hash_table_remove_all (rtx->ssrc_data);
   g_hash_table_remove_all (rtx->rtx_ssrcs);
+  rtp_history_clear (rtx->history);
   rtx->num_rtx_requests = 0;
   rtx->num_rtx_packets = 0;
   GST_OBJECT_UNLOCK (rtx);
@@ -233,6 +232,7 @@ gst_rtp_rtx_send_finalize (GObject * object)
 
   g_hash_table_unref (rtx->ssrc_data);
   g_hash_table_unref (rtx->rtx_ssrcs);
+  rtp_history_free (rtx->history);
   if (rtx->external_ssrc_map)
     gst_structure_free (rtx->external_ssrc_map);
   g_hash_table_unref (rtx->rtx_pt_map);
@@ -280,6 +280,7 @@ gst_rtp_rtx_send_init (GstRtpRtxSend * rtx)
   rtx->ssrc_data = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, (GDestroyNotify) ssrc_rtx_data_free);
   rtx->rtx_ssrcs = g_hash_table_new (g_direct_hash, g_direct_equal);
+  rtx->history = rtp_history_new ();
   rtx->rtx_pt_map = g_hash_table_new (g_direct_hash, g_direct_equal);
   rtx->clock_rate_map = g_hash_table_new (g_direct_hash, g_direct_equal);
 
@@ -451,16 +452,6 @@ gst_rtp_rtx_buffer_new (GstRtpRtxSend * rtx, GstBuffer * buffer)
   return new_buffer;
 }
 
-static gint
-buffer_queue_items_cmp (BufferQueueItem * a, BufferQueueItem * b,
-    gpointer user_data)
-{
-  /* gst_rtp_buffer_compare_seqnum returns the opposite of what we want,
-   * it returns negative when seqnum1 > seqnum2 and we want negative
-   * when b > a, i.e. a is smaller, so it comes first in the sequence */
-  return gst_rtp_buffer_compare_seqnum (b->seqnum, a->seqnum);
-}
-
 static gboolean
 gst_rtp_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -492,30 +483,19 @@ gst_rtp_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
         GST_OBJECT_LOCK (rtx);
         /* check if request is for us */
         if (g_hash_table_contains (rtx->ssrc_data, GUINT_TO_POINTER (ssrc))) {
-          SSRCRtxData *data;
-          GSequenceIter *iter;
-          BufferQueueItem search_item;
+          const RtpHistoryPacket *item;
 
           /* update statistics */
           ++rtx->num_rtx_requests;
 
-          data = gst_rtp_rtx_send_get_ssrc_data (rtx, ssrc);
-
-          search_item.seqnum = seqnum;
-          iter = g_sequence_lookup (data->queue, &search_item,
-              (GCompareDataFunc) buffer_queue_items_cmp, NULL);
-          if (iter) {
-            BufferQueueItem *item = g_sequence_get (iter);
+          item = rtp_history_lookup (rtx->history, ssrc, seqnum);
+          if (item) {
             GST_LOG_OBJECT (rtx, "found %u", item->seqnum);
             rtx_buf = gst_rtp_rtx_buffer_new (rtx, item->buffer);
           }
 #ifndef GST_DISABLE_DEBUG
           else {
-            BufferQueueItem *item = NULL;
-
-            iter = g_sequence_get_begin_iter (data->queue);
-            if (!g_sequence_iter_is_end (iter))
-              item = g_sequence_get (iter);
+            item = rtp_history_get_oldest (rtx->history, ssrc);
 
             if (item && seqnum < item->seqnum) {
               GST_DEBUG_OBJECT (rtx, "requested seqnum %u has already been "
@@ -581,6 +561,7 @@ gst_rtp_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
             g_hash_table_remove (rtx->rtx_ssrcs,
                 GUINT_TO_POINTER (data->rtx_ssrc));
             g_hash_table_remove (rtx->ssrc_data, GUINT_TO_POINTER (ssrc));
+            rtp_history_remove_stream (rtx->history, ssrc);
           }
 
           GST_OBJECT_UNLOCK (rtx);
@@ -686,22 +667,21 @@ gst_rtp_rtx_send_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 
 /* like rtp_jitter_buffer_get_ts_diff() */
 static guint32
-gst_rtp_rtx_send_get_ts_diff (SSRCRtxData * data)
+gst_rtp_rtx_send_get_ts_diff (GstRtpRtxSend * rtx, guint32 ssrc,
+    SSRCRtxData * data)
 {
   guint64 high_ts, low_ts;
-  BufferQueueItem *high_buf, *low_buf;
+  const RtpHistoryPacket *high_buf, *low_buf;
   guint32 result;
 
-  high_buf =
-      g_sequence_get (g_sequence_iter_prev (g_sequence_get_end_iter
-          (data->queue)));
-  low_buf = g_sequence_get (g_sequence_get_begin_iter (data->queue));
+  high_buf = rtp_history_get_newest (rtx->history, ssrc);
+  low_buf = rtp_history_get_oldest (rtx->history, ssrc);
 
   if (!high_buf || !low_buf || high_buf == low_buf)
     return 0;
 
-  high_ts = high_buf->timestamp;
-  low_ts = low_buf->timestamp;
+  high_ts = high_buf->rtptime;
+  low_ts = low_buf->rtptime;
 
   /* it needs to work if ts wraps */
   if (high_ts >= low_ts) {
@@ -719,7 +699,6 @@ static void
 process_buffer (GstRtpRtxSend * rtx, GstBuffer * buffer)
 {
   GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
-  BufferQueueItem *item;
   SSRCRtxData *data;
   guint16 seqnum;
   guint8 payload_type;
@@ -746,21 +725,21 @@ process_buffer (GstRtpRtxSend * rtx, GstBuffer * buffer)
               GUINT_TO_POINTER (payload_type)));
     }
 
-    /* add current rtp buffer to queue history */
-    item = g_slice_new0 (BufferQueueItem);
-    item->seqnum = seqnum;
-    item->timestamp = rtptime;
-    item->buffer = gst_buffer_ref (buffer);
-    g_sequence_append (data->queue, item);
+    /* add current rtp buffer to queue history, which also removes the
+     * oldest packets of all streams above max-size-bytes */
+    rtp_history_add_packet (rtx->history, ssrc, buffer, seqnum, payload_type,
+        rtptime);
 
     /* remove oldest packets from history if they are too many */
     if (rtx->max_size_packets) {
-      while (g_sequence_get_length (data->queue) > rtx->max_size_packets)
-        g_sequence_remove (g_sequence_get_begin_iter (data->queue));
+      while (rtp_history_get_n_packets (rtx->history,
+              ssrc) > rtx->max_size_packets)
+        rtp_history_remove_oldest (rtx->history, ssrc);
     }
     if (rtx->max_size_time) {
-      while (gst_rtp_rtx_send_get_ts_diff (data) > rtx->max_size_time)
-        g_sequence_remove (g_sequence_get_begin_iter (data->queue));
+      while (gst_rtp_rtx_send_get_ts_diff (rtx, ssrc,
+              data) > rtx->max_size_time)
+        rtp_history_remove_oldest (rtx->history, ssrc);
     }
   }
 }
@@ -899,6 +878,11 @@ gst_rtp_rtx_send_get_property (GObject * object,
       g_value_set_boxed (value, rtx->clock_rate_map_structure);
       GST_OBJECT_UNLOCK (rtx);
       break;
+    case PROP_MAX_SIZE_BYTES:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtp_history_get_max_bytes (rtx->history));
+      GST_OBJECT_UNLOCK (rtx);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -965,6 +949,11 @@ gst_rtp_rtx_send_set_property (GObject * object,
           structure_to_hash_table, rtx->clock_rate_map);
       GST_OBJECT_UNLOCK (rtx);
       break;
+    case PROP_MAX_SIZE_BYTES:
+      GST_OBJECT_LOCK (rtx);
+      rtp_history_set_max_bytes (rtx->history, g_value_get_uint (value));
+      GST_OBJECT_UNLOCK (rtx);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
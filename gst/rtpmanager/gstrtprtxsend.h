@@ -28,6 +28,8 @@
 #include <gst/rtp/gstrtpbuffer.h>
 #include <gst/base/gstdataqueue.h>
 
+#include "../rtp/rtphistory.h"
+
 G_BEGIN_DECLS
 #define GST_TYPE_RTP_RTX_SEND (gst_rtp_rtx_send_get_type())
 #define GST_RTP_RTX_SEND(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_RTP_RTX_SEND, GstRtpRtxSend))
@@ -54,6 +56,9 @@ struct _GstRtpRtxSend
   /* rtx ssrc -> master ssrc */
   GHashTable *rtx_ssrcs;
 
+  /* history of rtp packets of all ssrcs */
+  RtpHistory *history;
+
   /* master ssrc -> rtx ssrc (property) */
   GstStructure *external_ssrc_map;
 
@@ -111,6 +111,7 @@
 
 #include "gstrtpsession.h"
 #include "rtpsession.h"
+#include "rtpbwe.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_rtp_session_debug);
 #define GST_CAT_DEFAULT gst_rtp_session_debug
@@ -222,6 +223,10 @@ enum
 #define DEFAULT_RTP_PROFILE          GST_RTP_PROFILE_AVP
 #define DEFAULT_NTP_TIME_SOURCE      GST_RTP_NTP_TIME_SOURCE_NTP
 #define DEFAULT_RTCP_SYNC_SEND_TIME  TRUE
+#define DEFAULT_BANDWIDTH_ESTIMATION FALSE
+#define DEFAULT_BWE_MIN_BITRATE      30000
+#define DEFAULT_BWE_START_BITRATE    300000
+#define DEFAULT_BWE_MAX_BITRATE      10000000
 
 enum
 {
@@ -243,7 +248,12 @@ enum
   PROP_TWCC_STATS,
   PROP_RTP_PROFILE,
   PROP_NTP_TIME_SOURCE,
-  PROP_RTCP_SYNC_SEND_TIME
+  PROP_RTCP_SYNC_SEND_TIME,
+  PROP_BANDWIDTH_ESTIMATION,
+  PROP_BWE_MIN_BITRATE,
+  PROP_BWE_START_BITRATE,
+  PROP_BWE_MAX_BITRATE,
+  PROP_TARGET_BITRATE
 };
 
 #define GST_RTP_SESSION_LOCK(sess)   g_mutex_lock (&(sess)->priv->lock)
@@ -279,8 +289,19 @@ struct _GstRtpSessionPrivate
   guint recv_rtx_req_count;
   guint sent_rtx_req_count;
 
+  /* the counters of the last TWCC stats, the structure is only made when
+   * the property is read */
+  RTPTWCCStats twcc_stats;
+  gboolean have_twcc_stats;
   GstStructure *last_twcc_stats;
 
+  /* sender bandwidth estimation from the TWCC feedback */
+  gboolean bandwidth_estimation;
+  guint bwe_min_bitrate;
+  guint bwe_start_bitrate;
+  guint bwe_max_bitrate;
+  RTPBandwidthEstimator *bwe;
+
   /*
    * This is the list of processed packets in the receive path when upstream
    * pushed a buffer list.
@@ -307,7 +328,8 @@ static GstClockTime gst_rtp_session_request_time (RTPSession * session,
 static void gst_rtp_session_notify_nack (RTPSession * sess,
     guint16 seqnum, guint16 blp, guint32 ssrc, gpointer user_data);
 static void gst_rtp_session_notify_twcc (RTPSession * sess,
-    GstStructure * twcc_packets, GstStructure * twcc_stats, gpointer user_data);
+    GArray * twcc_packets, const RTPTWCCStats * twcc_stats,
+    gpointer user_data);
 static void gst_rtp_session_reconfigure (RTPSession * sess, gpointer user_data);
 static void gst_rtp_session_notify_early_rtcp (RTPSession * sess,
     gpointer user_data);
@@ -755,6 +777,12 @@ gst_rtp_session_class_init (GstRtpSessionClass * klass)
    * * "recv-nack-count"    G_TYPE_UINT   Number of NACKs received
    * * "source-stats"       G_TYPE_BOXED  GValueArray of #RTPSource:stats for all
    *      RTP sources (Since 1.8)
+   * * "rtcp-generation-count" G_TYPE_UINT64  Number of times RTCP was
+   *      generated (Since 1.20)
+   * * "rtcp-generation-time" G_TYPE_UINT64  Time spent generating RTCP the
+   *      last time, in nanoseconds (Since 1.20)
+   * * "rtcp-generation-time-max" G_TYPE_UINT64  Maximum time spent
+   *      generating RTCP, in nanoseconds (Since 1.20)
    *
    * Since: 1.4
    */
@@ -805,6 +833,75 @@ gst_rtp_session_class_init (GstRtpSessionClass * klass)
           DEFAULT_RTCP_SYNC_SEND_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRtpSession:bandwidth-estimation:
+   *
+   * Estimate the bandwidth available to the sender from the received TWCC
+   * feedback and expose it in #GstRtpSession:target-bitrate.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_BANDWIDTH_ESTIMATION,
+      g_param_spec_boolean ("bandwidth-estimation", "Bandwidth Estimation",
+          "Estimate the available bandwidth from the TWCC feedback",
+          DEFAULT_BANDWIDTH_ESTIMATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpSession:bwe-min-bitrate:
+   *
+   * The lowest bitrate the bandwidth estimation will target.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_BWE_MIN_BITRATE,
+      g_param_spec_uint ("bwe-min-bitrate", "BWE Minimum Bitrate",
+          "Lowest target bitrate of the bandwidth estimation in bits/s",
+          0, G_MAXUINT, DEFAULT_BWE_MIN_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpSession:bwe-start-bitrate:
+   *
+   * The target bitrate of the bandwidth estimation before any feedback was
+   * received.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_BWE_START_BITRATE,
+      g_param_spec_uint ("bwe-start-bitrate", "BWE Start Bitrate",
+          "Initial target bitrate of the bandwidth estimation in bits/s",
+          0, G_MAXUINT, DEFAULT_BWE_START_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpSession:bwe-max-bitrate:
+   *
+   * The highest bitrate the bandwidth estimation will target.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_BWE_MAX_BITRATE,
+      g_param_spec_uint ("bwe-max-bitrate", "BWE Maximum Bitrate",
+          "Highest target bitrate of the bandwidth estimation in bits/s",
+          0, G_MAXUINT, DEFAULT_BWE_MAX_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRtpSession:target-bitrate:
+   *
+   * The bitrate in bits per second the sender should aim for, as estimated
+   * from the TWCC feedback when #GstRtpSession:bandwidth-estimation is
+   * enabled. Encoders can follow it by connecting to its notify signal.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_TARGET_BITRATE,
+      g_param_spec_uint ("target-bitrate", "Target Bitrate",
+          "Estimated bitrate the sender should aim for in bits/s",
+          0, G_MAXUINT, DEFAULT_BWE_START_BITRATE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_rtp_session_change_state);
   gstelement_class->request_new_pad =
@@ -902,6 +999,14 @@ gst_rtp_session_init (GstRtpSession * rtpsession)
   rtpsession->priv->sent_rtx_req_count = 0;
 
   rtpsession->priv->ntp_time_source = DEFAULT_NTP_TIME_SOURCE;
+
+  rtpsession->priv->bandwidth_estimation = DEFAULT_BANDWIDTH_ESTIMATION;
+  rtpsession->priv->bwe_min_bitrate = DEFAULT_BWE_MIN_BITRATE;
+  rtpsession->priv->bwe_start_bitrate = DEFAULT_BWE_START_BITRATE;
+  rtpsession->priv->bwe_max_bitrate = DEFAULT_BWE_MAX_BITRATE;
+  rtpsession->priv->bwe =
+      rtp_bandwidth_estimator_new (DEFAULT_BWE_MIN_BITRATE,
+      DEFAULT_BWE_START_BITRATE, DEFAULT_BWE_MAX_BITRATE);
 }
 
 static void
@@ -918,10 +1023,21 @@ gst_rtp_session_finalize (GObject * object)
   g_object_unref (rtpsession->priv->session);
   if (rtpsession->priv->last_twcc_stats)
     gst_structure_free (rtpsession->priv->last_twcc_stats);
+  rtp_bandwidth_estimator_free (rtpsession->priv->bwe);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+/* called with the session lock */
+static void
+gst_rtp_session_reset_bwe (GstRtpSession * rtpsession)
+{
+  GstRtpSessionPrivate *priv = rtpsession->priv;
+
+  rtp_bandwidth_estimator_reset (priv->bwe, priv->bwe_min_bitrate,
+      priv->bwe_start_bitrate, priv->bwe_max_bitrate);
+}
+
 static void
 gst_rtp_session_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -977,6 +1093,34 @@ gst_rtp_session_set_property (GObject * object, guint prop_id,
     case PROP_RTCP_SYNC_SEND_TIME:
       priv->rtcp_sync_send_time = g_value_get_boolean (value);
       break;
+    case PROP_BANDWIDTH_ESTIMATION:
+      GST_RTP_SESSION_LOCK (rtpsession);
+      priv->bandwidth_estimation = g_value_get_boolean (value);
+      gst_rtp_session_reset_bwe (rtpsession);
+      GST_RTP_SESSION_UNLOCK (rtpsession);
+      g_object_notify (object, "target-bitrate");
+      break;
+    case PROP_BWE_MIN_BITRATE:
+      GST_RTP_SESSION_LOCK (rtpsession);
+      priv->bwe_min_bitrate = g_value_get_uint (value);
+      gst_rtp_session_reset_bwe (rtpsession);
+      GST_RTP_SESSION_UNLOCK (rtpsession);
+      g_object_notify (object, "target-bitrate");
+      break;
+    case PROP_BWE_START_BITRATE:
+      GST_RTP_SESSION_LOCK (rtpsession);
+      priv->bwe_start_bitrate = g_value_get_uint (value);
+      gst_rtp_session_reset_bwe (rtpsession);
+      GST_RTP_SESSION_UNLOCK (rtpsession);
+      g_object_notify (object, "target-bitrate");
+      break;
+    case PROP_BWE_MAX_BITRATE:
+      GST_RTP_SESSION_LOCK (rtpsession);
+      priv->bwe_max_bitrate = g_value_get_uint (value);
+      gst_rtp_session_reset_bwe (rtpsession);
+      GST_RTP_SESSION_UNLOCK (rtpsession);
+      g_object_notify (object, "target-bitrate");
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1044,6 +1188,9 @@ gst_rtp_session_get_property (GObject * object, guint prop_id,
       break;
     case PROP_TWCC_STATS:
       GST_RTP_SESSION_LOCK (rtpsession);
+      if (priv->have_twcc_stats && !priv->last_twcc_stats)
+        priv->last_twcc_stats =
+            rtp_twcc_stats_get_stats_structure (&priv->twcc_stats);
       g_value_set_boxed (value, priv->last_twcc_stats);
       GST_RTP_SESSION_UNLOCK (rtpsession);
       break;
@@ -1056,6 +1203,32 @@ gst_rtp_session_get_property (GObject * object, guint prop_id,
     case PROP_RTCP_SYNC_SEND_TIME:
       g_value_set_boolean (value, priv->rtcp_sync_send_time);
       break;
+    case PROP_BANDWIDTH_ESTIMATION:
+      GST_RTP_SESSION_LOCK (rtpsession);
+      g_value_set_boolean (value, priv->bandwidth_estimation);
+      GST_RTP_SESSION_UNLOCK (rtpsession);
+      break;
+    case PROP_BWE_MIN_BITRATE:
+      GST_RTP_SESSION_LOCK (rtpsession);
+      g_value_set_uint (value, priv->bwe_min_bitrate);
+      GST_RTP_SESSION_UNLOCK (rtpsession);
+      break;
+    case PROP_BWE_START_BITRATE:
+      GST_RTP_SESSION_LOCK (rtpsession);
+      g_value_set_uint (value, priv->bwe_start_bitrate);
+      GST_RTP_SESSION_UNLOCK (rtpsession);
+      break;
+    case PROP_BWE_MAX_BITRATE:
+      GST_RTP_SESSION_LOCK (rtpsession);
+      g_value_set_uint (value, priv->bwe_max_bitrate);
+      GST_RTP_SESSION_UNLOCK (rtpsession);
+      break;
+    case PROP_TARGET_BITRATE:
+      GST_RTP_SESSION_LOCK (rtpsession);
+      g_value_set_uint (value,
+          rtp_bandwidth_estimator_get_target_bitrate (priv->bwe));
+      GST_RTP_SESSION_UNLOCK (rtpsession);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2849,27 +3022,41 @@ gst_rtp_session_notify_nack (RTPSession * sess, guint16 seqnum,
 
 static void
 gst_rtp_session_notify_twcc (RTPSession * sess,
-    GstStructure * twcc_packets, GstStructure * twcc_stats, gpointer user_data)
+    GArray * twcc_packets, const RTPTWCCStats * twcc_stats,
+    gpointer user_data)
 {
   GstRtpSession *rtpsession = GST_RTP_SESSION (user_data);
+  GstRtpSessionPrivate *priv = rtpsession->priv;
   GstEvent *event;
   GstPad *send_rtp_sink;
+  gboolean target_changed = FALSE;
 
   GST_RTP_SESSION_LOCK (rtpsession);
   if ((send_rtp_sink = rtpsession->send_rtp_sink))
     gst_object_ref (send_rtp_sink);
-  if (rtpsession->priv->last_twcc_stats)
-    gst_structure_free (rtpsession->priv->last_twcc_stats);
-  rtpsession->priv->last_twcc_stats = twcc_stats;
+  if (priv->bandwidth_estimation)
+    target_changed =
+        rtp_bandwidth_estimator_process_packets (priv->bwe, twcc_packets);
+  priv->twcc_stats = *twcc_stats;
+  /* only the counters are kept */
+  priv->twcc_stats.packets = NULL;
+  priv->have_twcc_stats = TRUE;
+  if (priv->last_twcc_stats) {
+    gst_structure_free (priv->last_twcc_stats);
+    priv->last_twcc_stats = NULL;
+  }
   GST_RTP_SESSION_UNLOCK (rtpsession);
 
   if (send_rtp_sink) {
-    event = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM, twcc_packets);
+    event = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+        rtp_twcc_stats_get_packets_structure (twcc_packets));
     gst_pad_push_event (send_rtp_sink, event);
     gst_object_unref (send_rtp_sink);
   }
 
   g_object_notify (G_OBJECT (rtpsession), "twcc-stats");
+  if (target_changed)
+    g_object_notify (G_OBJECT (rtpsession), "target-bitrate");
 }
 
 static void
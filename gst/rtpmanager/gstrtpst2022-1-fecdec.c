@@ -38,8 +38,18 @@
  * already received a corresponding packet in both the column and row the packet
  * belongs to, and if so goes through the first step listed above.
  *
- * This process is repeated recursively, allowing for recoveries over one
- * dimension to unblock recoveries over the other.
+ * This process is repeated in passes over the FEC packets that may have become
+ * usable, allowing for recoveries over one dimension to unblock recoveries over
+ * the other. Which media packets are present is tracked in a bitmap, so that
+ * FEC packets still missing more than one media packet are skipped without
+ * looking packets up.
+ *
+ * All the reconstructions found in one pass are independent, and can be
+ * spread over #GstRTPST_2022_1_FecDec:recovery-threads threads when bursts of
+ * loss make many of them possible at once. The time spent reconstructing
+ * packets upon receiving a packet can be bounded with
+ * #GstRTPST_2022_1_FecDec:latency-budget, in which case the remaining passes
+ * are performed upon receiving the next packet.
  *
  * In perfect networking conditions, this incurs next to no overhead as FEC
  * packets will arrive after the media packets, causing no reconstruction to
@@ -87,11 +97,17 @@
 #include <gst/rtp/gstrtpbuffer.h>
 
 #include "gstrtpst2022-1-fecdec.h"
+#include "rtpfecorc.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_rtpst_2022_1_fecdec_debug);
 #define GST_CAT_DEFAULT gst_rtpst_2022_1_fecdec_debug
 
 #define DEFAULT_SIZE_TIME (GST_SECOND)
+#define DEFAULT_LATENCY_BUDGET (0)
+#define DEFAULT_RECOVERY_THREADS (1)
+
+/* One bit per media seqnum */
+#define RECEIVED_BITMAP_SIZE (G_MAXUINT16 / 32 + 1)
 
 typedef struct
 {
@@ -99,9 +115,6 @@ typedef struct
   GstBuffer *buffer;
 } Item;
 
-static GstFlowReturn store_media_item (GstRTPST_2022_1_FecDec * dec,
-    GstRTPBuffer * rtp, Item * item);
-
 static void
 free_item (Item * item)
 {
@@ -120,6 +133,8 @@ enum
 {
   PROP_0,
   PROP_SIZE_TIME,
+  PROP_LATENCY_BUDGET,
+  PROP_RECOVERY_THREADS,
 };
 
 struct _GstRTPST_2022_1_FecDecClass
@@ -147,8 +162,31 @@ struct _GstRTPST_2022_1_FecDec
   GstClockTime size_time;
   GstClockTime max_arrival_time;
   GstClockTime max_fec_arrival_time[2];
+
+  /* Whether each seqnum is present in packets */
+  guint32 *received;
+  /* FEC packets to check in the next recovery pass, as D << 16 | SNBase */
+  GQueue pending_fec;
+
+  GstClockTime latency_budget;
+  guint recovery_threads;
+
+  GThreadPool *recovery_pool;
+  GMutex recovery_lock;
+  GCond recovery_cond;
+  guint recovery_jobs;
 };
 
+typedef struct
+{
+  GstRTPST_2022_1_FecDec *dec;
+  GstBuffer *fec_buffer;
+  /* The media buffers protected by fec_buffer, except the missing one */
+  GList *packets;
+  guint16 seq;
+  GstBuffer *recovered;
+} RecoveryJob;
+
 #define RTP_CAPS "application/x-rtp"
 
 typedef struct
@@ -195,6 +233,21 @@ G_DEFINE_TYPE (GstRTPST_2022_1_FecDec, gst_rtpst_2022_1_fecdec,
 GST_ELEMENT_REGISTER_DEFINE (rtpst2022_1_fecdec, "rtpst2022-1-fecdec",
     GST_RANK_NONE, GST_TYPE_RTPST_2022_1_FECDEC);
 
+static inline void
+set_received (GstRTPST_2022_1_FecDec * dec, guint16 seq, gboolean received)
+{
+  if (received)
+    dec->received[seq >> 5] |= 1U << (seq & 31);
+  else
+    dec->received[seq >> 5] &= ~(1U << (seq & 31));
+}
+
+static inline gboolean
+is_received (GstRTPST_2022_1_FecDec * dec, guint16 seq)
+{
+  return (dec->received[seq >> 5] >> (seq & 31)) & 1;
+}
+
 static void
 trim_items (GstRTPST_2022_1_FecDec * dec)
 {
@@ -221,6 +274,13 @@ trim_items (GstRTPST_2022_1_FecDec * dec)
     GST_TRACE_OBJECT (dec,
         "Trimming packets up to %" GST_TIME_FORMAT " (seq: %u)",
         GST_TIME_ARGS (GST_BUFFER_DTS_OR_PTS (item->buffer)), item->seq);
+
+    for (tmp_iter = g_sequence_get_begin_iter (dec->packets); tmp_iter != iter;
+        tmp_iter = g_sequence_iter_next (tmp_iter)) {
+      item = g_sequence_get (tmp_iter);
+      set_received (dec, item->seq, FALSE);
+    }
+
     g_sequence_remove_range (g_sequence_get_begin_iter (dec->packets), iter);
   }
 }
@@ -369,27 +429,57 @@ done:
   return ret;
 }
 
-static void
-_xor_mem (guint8 * restrict dst, const guint8 * restrict src, gsize length)
+static Item *
+lookup_fec_packet (GstRTPST_2022_1_FecDec * dec, guint D, guint16 seqnum)
 {
-  guint i;
+  Item *ret = NULL;
 
-  for (i = 0; i < (length / sizeof (guint64)); ++i) {
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-    GST_WRITE_UINT64_LE (dst,
-        GST_READ_UINT64_LE (dst) ^ GST_READ_UINT64_LE (src));
-#else
-    GST_WRITE_UINT64_BE (dst,
-        GST_READ_UINT64_BE (dst) ^ GST_READ_UINT64_BE (src));
-#endif
-    dst += sizeof (guint64);
-    src += sizeof (guint64);
+  if (D) {
+    GSequenceIter *iter;
+    Item dummy = { seqnum, NULL };
+
+    iter =
+        g_sequence_lookup (dec->fec_packets[1], &dummy,
+        (GCompareDataFunc) cmp_items, NULL);
+
+    if (iter)
+      ret = g_sequence_get (iter);
+  } else {
+    ret = get_column_fec (dec, seqnum);
+
+    if (ret && ret->seq != seqnum)
+      ret = NULL;
   }
-  for (i = 0; i < (length % sizeof (guint64)); ++i)
-    dst[i] ^= src[i];
+
+  return ret;
 }
 
-static GstFlowReturn
+/* Returns the number of media packets protected by the FEC packet with
+ * SNBase @seqnum that are missing, and the seqnum of the last one of them
+ * in @missing_seq */
+static guint
+count_missing (GstRTPST_2022_1_FecDec * dec, guint D, guint16 seqnum,
+    guint16 * missing_seq)
+{
+  guint n_packets, stride;
+  guint i, n_missing = 0;
+
+  n_packets = D ? dec->l : dec->d;
+  stride = D ? 1 : dec->l;
+
+  for (i = 0; i < n_packets; i++) {
+    guint16 seq = seqnum + i * stride;
+
+    if (!is_received (dec, seq)) {
+      *missing_seq = seq;
+      n_missing += 1;
+    }
+  }
+
+  return n_missing;
+}
+
+static GstBuffer *
 xor_items (GstRTPST_2022_1_FecDec * dec, Rtp2DFecHeader * fec, GList * packets,
     guint16 seqnum)
 {
@@ -397,11 +487,9 @@ xor_items (GstRTPST_2022_1_FecDec * dec, Rtp2DFecHeader * fec, GList * packets,
   guint32 xored_timestamp;
   guint8 xored_pt;
   guint16 xored_payload_len;
-  Item *item;
   GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
   GList *tmp;
-  GstFlowReturn ret = GST_FLOW_OK;
-  GstBuffer *buffer;
+  GstBuffer *buffer = NULL;
   gboolean xored_marker;
   gboolean xored_padding;
   gboolean xored_extension;
@@ -410,9 +498,8 @@ xor_items (GstRTPST_2022_1_FecDec * dec, Rtp2DFecHeader * fec, GList * packets,
   xored_payload_len = fec->len;
   for (tmp = packets; tmp; tmp = tmp->next) {
     GstRTPBuffer media_rtp = GST_RTP_BUFFER_INIT;
-    Item *item = (Item *) tmp->data;
 
-    gst_rtp_buffer_map (item->buffer, GST_MAP_READ, &media_rtp);
+    gst_rtp_buffer_map (tmp->data, GST_MAP_READ, &media_rtp);
     xored_payload_len ^= gst_rtp_buffer_get_payload_len (&media_rtp);
     gst_rtp_buffer_unmap (&media_rtp);
   }
@@ -423,10 +510,8 @@ xor_items (GstRTPST_2022_1_FecDec * dec, Rtp2DFecHeader * fec, GList * packets,
     goto done;
   }
 
-  item = g_malloc0 (sizeof (Item));
-  item->seq = seqnum;
-  item->buffer = gst_rtp_buffer_new_allocate (xored_payload_len, 0, 0);
-  gst_rtp_buffer_map (item->buffer, GST_MAP_WRITE, &rtp);
+  buffer = gst_rtp_buffer_new_allocate (xored_payload_len, 0, 0);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp);
 
   xored = gst_rtp_buffer_get_payload (&rtp);
   memcpy (xored, fec->payload, xored_payload_len);
@@ -438,10 +523,9 @@ xor_items (GstRTPST_2022_1_FecDec * dec, Rtp2DFecHeader * fec, GList * packets,
 
   for (tmp = packets; tmp; tmp = tmp->next) {
     GstRTPBuffer media_rtp = GST_RTP_BUFFER_INIT;
-    Item *item = (Item *) tmp->data;
 
-    gst_rtp_buffer_map (item->buffer, GST_MAP_READ, &media_rtp);
-    _xor_mem (xored, gst_rtp_buffer_get_payload (&media_rtp),
+    gst_rtp_buffer_map (tmp->data, GST_MAP_READ, &media_rtp);
+    rtp_fec_orc_xor (xored, gst_rtp_buffer_get_payload (&media_rtp),
         MIN (gst_rtp_buffer_get_payload_len (&media_rtp), xored_payload_len));
     xored_timestamp ^= gst_rtp_buffer_get_timestamp (&media_rtp);
     xored_pt ^= gst_rtp_buffer_get_payload_type (&media_rtp);
@@ -456,8 +540,6 @@ xor_items (GstRTPST_2022_1_FecDec * dec, Rtp2DFecHeader * fec, GList * packets,
       "Recovered buffer through %s FEC with seqnum %u, payload len %u and timestamp %u",
       fec->D ? "row" : "column", seqnum, xored_payload_len, xored_timestamp);
 
-  GST_BUFFER_DTS (item->buffer) = dec->max_arrival_time;
-
   gst_rtp_buffer_set_timestamp (&rtp, xored_timestamp);
   gst_rtp_buffer_set_seq (&rtp, seqnum);
   gst_rtp_buffer_set_payload_type (&rtp, xored_pt);
@@ -467,149 +549,271 @@ xor_items (GstRTPST_2022_1_FecDec * dec, Rtp2DFecHeader * fec, GList * packets,
 
   gst_rtp_buffer_unmap (&rtp);
 
-  /* Store a ref on item->buffer as store_media_item may
-   * recurse and call this method again, potentially releasing
-   * the object lock and leaving our item unprotected in
-   * dec->packets
-   */
-  buffer = gst_buffer_ref (item->buffer);
-
-  /* It is right that we should celebrate,
-   * for your brother was dead, and is alive again */
-  gst_rtp_buffer_map (item->buffer, GST_MAP_READ, &rtp);
-  ret = store_media_item (dec, &rtp, item);
+done:
+  return buffer;
+}
+
+/* Only touches the buffers referenced by the job, and can thus run
+ * without the object lock */
+static void
+recovery_job_run (RecoveryJob * job)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  Rtp2DFecHeader fec;
+
+  gst_rtp_buffer_map (job->fec_buffer, GST_MAP_READ, &rtp);
+  parse_header (&rtp, &fec);
+  job->recovered = xor_items (job->dec, &fec, job->packets, job->seq);
   gst_rtp_buffer_unmap (&rtp);
+}
 
-  if (ret == GST_FLOW_OK) {
-    /* Unlocking here is safe */
-    GST_OBJECT_UNLOCK (dec);
-    ret = gst_pad_push (dec->srcpad, buffer);
-    GST_OBJECT_LOCK (dec);
-  } else {
-    gst_buffer_unref (buffer);
-  }
+static void
+recovery_job_func (RecoveryJob * job, GstRTPST_2022_1_FecDec * dec)
+{
+  recovery_job_run (job);
 
-done:
-  return ret;
+  g_mutex_lock (&dec->recovery_lock);
+  dec->recovery_jobs -= 1;
+  if (dec->recovery_jobs == 0)
+    g_cond_signal (&dec->recovery_cond);
+  g_mutex_unlock (&dec->recovery_lock);
 }
 
-/* Returns a flow value if we should discard the packet, GST_FLOW_CUSTOM_SUCCESS otherwise */
-static GstFlowReturn
-check_fec (GstRTPST_2022_1_FecDec * dec, Rtp2DFecHeader * fec)
+static void
+recovery_job_free (RecoveryJob * job)
 {
-  GList *packets = NULL;
-  gint missing_seq = -1;
-  guint n_packets = 0;
-  guint required_n_packets;
-  GstFlowReturn ret = GST_FLOW_OK;
+  gst_buffer_unref (job->fec_buffer);
+  g_list_free_full (job->packets, (GDestroyNotify) gst_buffer_unref);
+  if (job->recovered)
+    gst_buffer_unref (job->recovered);
+  g_free (job);
+}
 
-  if (fec->D) {
-    guint i = 0;
+/* Returns a job if the FEC packet can reconstruct a media packet */
+static RecoveryJob *
+prepare_recovery (GstRTPST_2022_1_FecDec * dec, guint D, guint16 seqnum)
+{
+  RecoveryJob *job;
+  Item *fec_item;
+  guint16 missing_seq = 0;
+  guint n_missing, n_packets, stride, i;
+
+  if (!(fec_item = lookup_fec_packet (dec, D, seqnum)))
+    return NULL;
+
+  n_missing = count_missing (dec, D, seqnum, &missing_seq);
+
+  if (n_missing == 0) {
+    GST_LOG_OBJECT (dec, "All media packets present for %s FEC packet %u",
+        D ? "row" : "column", seqnum);
+    return NULL;
+  } else if (n_missing > 1) {
+    GST_LOG_OBJECT (dec, "Too many media packets missing for %s FEC packet %u",
+        D ? "row" : "column", seqnum);
+    return NULL;
+  }
 
-    required_n_packets = dec->l;
+  GST_LOG_OBJECT (dec, "We have enough info to reconstruct %u", missing_seq);
 
-    for (i = 0; i < dec->l; i++) {
-      Item *item = lookup_media_packet (dec, fec->seq + i);
+  job = g_new0 (RecoveryJob, 1);
+  job->dec = dec;
+  job->fec_buffer = gst_buffer_ref (fec_item->buffer);
+  job->seq = missing_seq;
 
-      if (item) {
-        packets = g_list_prepend (packets, item);
-        n_packets += 1;
-      } else {
-        missing_seq = fec->seq + i;
-      }
-    }
-  } else {
-    guint i = 0;
+  n_packets = D ? dec->l : dec->d;
+  stride = D ? 1 : dec->l;
 
-    required_n_packets = dec->d;
+  for (i = 0; i < n_packets; i++) {
+    guint16 seq = seqnum + i * stride;
+    Item *item;
 
-    for (i = 0; i < dec->d; i++) {
-      Item *item = lookup_media_packet (dec, fec->seq + i * dec->l);
+    if (seq == missing_seq)
+      continue;
 
-      if (item) {
-        packets = g_list_prepend (packets, item);
-        n_packets += 1;
-      } else {
-        missing_seq = fec->seq + i * dec->l;
-      }
+    if (!(item = lookup_media_packet (dec, seq))) {
+      GST_WARNING_OBJECT (dec, "Media packet %u went missing", seq);
+      recovery_job_free (job);
+      return NULL;
     }
-  }
 
-  if (n_packets == required_n_packets) {
-    g_assert (missing_seq == -1);
-    GST_LOG_OBJECT (dec,
-        "All media packets present, we can discard that FEC packet");
-  } else if (n_packets + 1 == required_n_packets) {
-    g_assert (missing_seq != -1);
-    ret = xor_items (dec, fec, packets, missing_seq);
-    GST_LOG_OBJECT (dec, "We have enough info to reconstruct %u", missing_seq);
-  } else {
-    ret = GST_FLOW_CUSTOM_SUCCESS;
-    GST_LOG_OBJECT (dec, "Too many media packets missing, storing FEC packet");
+    job->packets = g_list_prepend (job->packets, gst_buffer_ref (item->buffer));
   }
-  g_list_free (packets);
 
-  return ret;
+  return job;
 }
 
-static GstFlowReturn
-check_fec_item (GstRTPST_2022_1_FecDec * dec, Item * item)
+static void
+run_recovery_jobs (GstRTPST_2022_1_FecDec * dec, GPtrArray * jobs)
 {
-  Rtp2DFecHeader fec;
-  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
-  GstFlowReturn ret;
+  guint n_threads, i;
 
-  gst_rtp_buffer_map (item->buffer, GST_MAP_READ, &rtp);
+  n_threads = dec->recovery_threads;
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+  n_threads = MIN (n_threads, jobs->len);
 
-  parse_header (&rtp, &fec);
+  if (n_threads < 2) {
+    for (i = 0; i < jobs->len; i++)
+      recovery_job_run (g_ptr_array_index (jobs, i));
+    return;
+  }
 
-  ret = check_fec (dec, &fec);
+  /* This thread takes a share of the jobs too */
+  if (!dec->recovery_pool) {
+    dec->recovery_pool =
+        g_thread_pool_new ((GFunc) recovery_job_func, dec, n_threads - 1,
+        FALSE, NULL);
+  } else if ((guint) g_thread_pool_get_max_threads (dec->recovery_pool) <
+      n_threads - 1) {
+    g_thread_pool_set_max_threads (dec->recovery_pool, n_threads - 1, NULL);
+  }
 
-  gst_rtp_buffer_unmap (&rtp);
+  g_mutex_lock (&dec->recovery_lock);
+  dec->recovery_jobs = jobs->len - 1;
+  g_mutex_unlock (&dec->recovery_lock);
 
-  return ret;
+  for (i = 1; i < jobs->len; i++)
+    g_thread_pool_push (dec->recovery_pool, g_ptr_array_index (jobs, i), NULL);
+
+  recovery_job_run (g_ptr_array_index (jobs, 0));
+
+  g_mutex_lock (&dec->recovery_lock);
+  while (dec->recovery_jobs)
+    g_cond_wait (&dec->recovery_cond, &dec->recovery_lock);
+  g_mutex_unlock (&dec->recovery_lock);
 }
 
-static GstFlowReturn
-store_media_item (GstRTPST_2022_1_FecDec * dec, GstRTPBuffer * rtp, Item * item)
+/* Queues the FEC packets protecting @seq for the next recovery pass */
+static void
+queue_fec_for_media (GstRTPST_2022_1_FecDec * dec, guint16 seq)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
   Item *fec_item;
-  guint16 seq;
 
-  seq = gst_rtp_buffer_get_seq (rtp);
+  if ((fec_item = get_row_fec (dec, seq)))
+    g_queue_push_tail (&dec->pending_fec,
+        GUINT_TO_POINTER (1 << 16 | fec_item->seq));
+
+  if ((fec_item = get_column_fec (dec, seq)))
+    g_queue_push_tail (&dec->pending_fec, GUINT_TO_POINTER (fec_item->seq));
+}
 
+static void
+store_media_item (GstRTPST_2022_1_FecDec * dec, Item * item)
+{
   g_sequence_insert_sorted (dec->packets, item, (GCompareDataFunc) cmp_items,
       NULL);
+  set_received (dec, item->seq, TRUE);
+  queue_fec_for_media (dec, item->seq);
+}
+
+/* Checks the queued FEC packets, one pass over all of them at a time:
+ * the reconstructions found in a pass are independent from each other,
+ * and the packets they recover queue the FEC packets of the other dimension
+ * for the next pass. Recovered buffers are appended to @recovered.
+ *
+ * Once the latency budget is exhausted, the remaining FEC packets stay
+ * queued until the next packet is received. */
+static void
+recover_pending (GstRTPST_2022_1_FecDec * dec, GQueue * recovered)
+{
+  GPtrArray *jobs;
+  gint64 deadline = 0;
+  guint n_passes = 0;
 
-  if ((fec_item = get_row_fec (dec, seq))) {
-    ret = check_fec_item (dec, fec_item);
-    if (ret == GST_FLOW_CUSTOM_SUCCESS)
-      ret = GST_FLOW_OK;
+  if (g_queue_is_empty (&dec->pending_fec))
+    return;
+
+  if (dec->latency_budget)
+    deadline = g_get_monotonic_time () + dec->latency_budget / GST_USECOND;
+
+  jobs = g_ptr_array_new_with_free_func ((GDestroyNotify) recovery_job_free);
+
+  while (!g_queue_is_empty (&dec->pending_fec)) {
+    guint n_pending, i, j;
+
+    if (n_passes && deadline && g_get_monotonic_time () >= deadline) {
+      GST_DEBUG_OBJECT (dec, "Latency budget exhausted after %u passes, "
+          "deferring %u FEC packets", n_passes,
+          g_queue_get_length (&dec->pending_fec));
+      break;
+    }
+
+    n_pending = g_queue_get_length (&dec->pending_fec);
+    for (i = 0; i < n_pending; i++) {
+      guint key = GPOINTER_TO_UINT (g_queue_pop_head (&dec->pending_fec));
+      RecoveryJob *job = prepare_recovery (dec, key >> 16, key & 0xffff);
+
+      if (!job)
+        continue;
+
+      /* The row and the column of a packet may both allow reconstructing it */
+      for (j = 0; j < jobs->len; j++) {
+        if (((RecoveryJob *) g_ptr_array_index (jobs, j))->seq == job->seq)
+          break;
+      }
+
+      if (j < jobs->len)
+        recovery_job_free (job);
+      else
+        g_ptr_array_add (jobs, job);
+    }
+
+    run_recovery_jobs (dec, jobs);
+
+    for (i = 0; i < jobs->len; i++) {
+      RecoveryJob *job = g_ptr_array_index (jobs, i);
+      Item *item;
+
+      if (!job->recovered)
+        continue;
+
+      GST_BUFFER_DTS (job->recovered) = dec->max_arrival_time;
+
+      /* It is right that we should celebrate,
+       * for your brother was dead, and is alive again */
+      item = g_malloc0 (sizeof (Item));
+      item->seq = job->seq;
+      item->buffer = job->recovered;
+      job->recovered = NULL;
+      store_media_item (dec, item);
+
+      g_queue_push_tail (recovered, gst_buffer_ref (item->buffer));
+    }
+
+    g_ptr_array_set_size (jobs, 0);
+    n_passes += 1;
   }
 
-  if (ret == GST_FLOW_OK && (fec_item = get_column_fec (dec, seq))) {
-    ret = check_fec_item (dec, fec_item);
-    if (ret == GST_FLOW_CUSTOM_SUCCESS)
-      ret = GST_FLOW_OK;
+  g_ptr_array_unref (jobs);
+}
+
+static GstFlowReturn
+push_recovered (GstRTPST_2022_1_FecDec * dec, GQueue * recovered)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBuffer *buffer;
+
+  while ((buffer = g_queue_pop_head (recovered))) {
+    if (ret == GST_FLOW_OK)
+      ret = gst_pad_push (dec->srcpad, buffer);
+    else
+      gst_buffer_unref (buffer);
   }
 
   return ret;
 }
 
-static GstFlowReturn
+static void
 store_media (GstRTPST_2022_1_FecDec * dec, GstRTPBuffer * rtp,
     GstBuffer * buffer)
 {
   Item *item;
-  guint16 seq;
 
-  seq = gst_rtp_buffer_get_seq (rtp);
   item = g_malloc0 (sizeof (Item));
   item->buffer = gst_buffer_ref (buffer);
-  item->seq = seq;
+  item->seq = gst_rtp_buffer_get_seq (rtp);
 
-  return store_media_item (dec, rtp, item);
+  store_media_item (dec, item);
 }
 
 static GstFlowReturn
@@ -620,9 +824,10 @@ gst_rtpst_2022_1_fecdec_sink_chain_fec (GstPad * pad, GstObject * parent,
   Rtp2DFecHeader fec = { 0, };
   guint payload_len;
   guint8 *payload;
-  GstFlowReturn ret = GST_FLOW_OK;
   Item *item;
   GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GQueue recovered = G_QUEUE_INIT;
+  guint16 missing_seq;
 
   GST_OBJECT_LOCK (dec);
 
@@ -677,35 +882,39 @@ gst_rtpst_2022_1_fecdec_sink_chain_fec (GstPad * pad, GstObject * parent,
   dec->max_fec_arrival_time[fec.D] = GST_BUFFER_DTS_OR_PTS (buffer);
   trim_fec_items (dec, fec.D);
 
-  ret = check_fec (dec, &fec);
+  if (count_missing (dec, fec.D, fec.seq, &missing_seq) == 0) {
+    GST_LOG_OBJECT (dec,
+        "All media packets present, we can discard that FEC packet");
+    goto discard;
+  }
 
-  if (ret == GST_FLOW_CUSTOM_SUCCESS) {
-    item = g_malloc0 (sizeof (Item));
-    item->buffer = buffer;
-    item->seq = fec.seq;
+  gst_rtp_buffer_unmap (&rtp);
 
-    if (!fec.D) {
-      guint i;
-      guint16 seq;
+  item = g_malloc0 (sizeof (Item));
+  item->buffer = buffer;
+  item->seq = fec.seq;
 
-      for (i = 0; i < dec->d; i++) {
-        seq = fec.seq + i * dec->l;
-        g_hash_table_insert (dec->column_fec_packets, GUINT_TO_POINTER (seq),
-            item);
-      }
+  if (!fec.D) {
+    guint i;
+    guint16 seq;
+
+    for (i = 0; i < dec->d; i++) {
+      seq = fec.seq + i * dec->l;
+      g_hash_table_insert (dec->column_fec_packets, GUINT_TO_POINTER (seq),
+          item);
     }
-    g_sequence_insert_sorted (dec->fec_packets[fec.D], item,
-        (GCompareDataFunc) cmp_items, NULL);
-    ret = GST_FLOW_OK;
-  } else {
-    goto discard;
   }
+  g_sequence_insert_sorted (dec->fec_packets[fec.D], item,
+      (GCompareDataFunc) cmp_items, NULL);
 
-  gst_rtp_buffer_unmap (&rtp);
+  g_queue_push_tail (&dec->pending_fec,
+      GUINT_TO_POINTER ((guint) fec.D << 16 | fec.seq));
 
 done:
+  recover_pending (dec, &recovered);
   GST_OBJECT_UNLOCK (dec);
-  return ret;
+
+  return push_recovered (dec, &recovered);
 
 discard:
   if (rtp.buffer != NULL)
@@ -723,6 +932,7 @@ gst_rtpst_2022_1_fecdec_sink_chain (GstPad * pad, GstObject * parent,
   GstRTPST_2022_1_FecDec *dec = GST_RTPST_2022_1_FECDEC_CAST (parent);
   GstFlowReturn ret = GST_FLOW_OK;
   GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GQueue recovered = G_QUEUE_INIT;
 
   if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
     GST_WARNING_OBJECT (pad, "Chained buffer isn't valid RTP");
@@ -733,13 +943,19 @@ gst_rtpst_2022_1_fecdec_sink_chain (GstPad * pad, GstObject * parent,
   dec->max_arrival_time =
       MAX (dec->max_arrival_time, GST_BUFFER_DTS_OR_PTS (buffer));
   trim_items (dec);
-  ret = store_media (dec, &rtp, buffer);
+  store_media (dec, &rtp, buffer);
+  recover_pending (dec, &recovered);
   GST_OBJECT_UNLOCK (dec);
 
   gst_rtp_buffer_unmap (&rtp);
 
+  /* Packets recovered thanks to this one precede it */
+  ret = push_recovered (dec, &recovered);
+
   if (ret == GST_FLOW_OK)
     ret = gst_pad_push (dec->srcpad, buffer);
+  else
+    gst_buffer_unref (buffer);
 
 done:
   return ret;
@@ -781,9 +997,13 @@ gst_rtpst_2022_1_fecdec_reset (GstRTPST_2022_1_FecDec * dec, gboolean allocate)
     dec->column_fec_packets = NULL;
   }
 
+  g_clear_pointer (&dec->received, g_free);
+  g_queue_clear (&dec->pending_fec);
+
   if (allocate) {
     dec->packets = g_sequence_new ((GDestroyNotify) free_item);
     dec->column_fec_packets = g_hash_table_new (g_direct_hash, g_direct_equal);
+    dec->received = g_new0 (guint32, RECEIVED_BITMAP_SIZE);
   }
 
   for (i = 0; i < 2; i++) {
@@ -832,6 +1052,11 @@ gst_rtpst_2022_1_fecdec_finalize (GObject * object)
 
   gst_rtpst_2022_1_fecdec_reset (dec, FALSE);
 
+  if (dec->recovery_pool)
+    g_thread_pool_free (dec->recovery_pool, FALSE, TRUE);
+  g_mutex_clear (&dec->recovery_lock);
+  g_cond_clear (&dec->recovery_cond);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -845,6 +1070,16 @@ gst_rtpst_2022_1_fecdec_set_property (GObject * object, guint prop_id,
     case PROP_SIZE_TIME:
       dec->size_time = g_value_get_uint64 (value);
       break;
+    case PROP_LATENCY_BUDGET:
+      GST_OBJECT_LOCK (dec);
+      dec->latency_budget = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (dec);
+      break;
+    case PROP_RECOVERY_THREADS:
+      GST_OBJECT_LOCK (dec);
+      dec->recovery_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (dec);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -861,6 +1096,16 @@ gst_rtpst_2022_1_fecdec_get_property (GObject * object, guint prop_id,
     case PROP_SIZE_TIME:
       g_value_set_uint64 (value, dec->size_time);
       break;
+    case PROP_LATENCY_BUDGET:
+      GST_OBJECT_LOCK (dec);
+      g_value_set_uint64 (value, dec->latency_budget);
+      GST_OBJECT_UNLOCK (dec);
+      break;
+    case PROP_RECOVERY_THREADS:
+      GST_OBJECT_LOCK (dec);
+      g_value_set_uint (value, dec->recovery_threads);
+      GST_OBJECT_UNLOCK (dec);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -965,6 +1210,21 @@ gst_rtpst_2022_1_fecdec_class_init (GstRTPST_2022_1_FecDecClass * klass)
           G_MAXUINT64, DEFAULT_SIZE_TIME,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_LATENCY_BUDGET,
+      g_param_spec_uint64 ("latency-budget", "Latency budget (in ns)",
+          "Maximum time spent reconstructing packets upon receiving a packet, "
+          "the rest being done upon receiving the next one "
+          "(in ns, 0-unlimited)",
+          0, G_MAXUINT64, DEFAULT_LATENCY_BUDGET,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_RECOVERY_THREADS,
+      g_param_spec_uint ("recovery-threads", "Recovery threads",
+          "Number of threads reconstructing packets when several can be "
+          "reconstructed at once (0 = number of processors)", 0,
+          G_MAXINT, DEFAULT_RECOVERY_THREADS,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_rtpst_2022_1_fecdec_change_state);
   gstelement_class->request_new_pad =
@@ -1009,4 +1269,8 @@ gst_rtpst_2022_1_fecdec_init (GstRTPST_2022_1_FecDec * dec)
 
   dec->d = G_MAXUINT;
   dec->l = G_MAXUINT;
+
+  g_queue_init (&dec->pending_fec);
+  g_mutex_init (&dec->recovery_lock);
+  g_cond_init (&dec->recovery_cond);
 }
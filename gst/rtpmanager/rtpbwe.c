@@ -0,0 +1,553 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * A sender-side bandwidth estimator fed with the packets reported by TWCC
+ * feedback, along the lines of Google Congestion Control
+ * (draft-ietf-rmcat-gcc-02).
+ *
+ * The delay-based part groups the packets sent in bursts and measures how
+ * much longer the groups took to arrive than to be sent. A trendline of the
+ * accumulated delay variation tells whether the queues along the path are
+ * building up, and an adaptive threshold turns that into an overuse,
+ * underuse or normal signal. The target bitrate is decreased to a fraction
+ * of the bitrate the receiver acknowledged on overuse, held on underuse
+ * and increased otherwise.
+ *
+ * The loss-based part decreases the target when more than 10% of the
+ * packets are lost and prevents it from increasing above 2% of loss.
+ *
+ * All times are taken from the reported packets, which makes the estimator
+ * deterministic for a given sequence of feedback.
+ */
+
+#include <math.h>
+
+#include "rtpbwe.h"
+#include <gst/base/gstqueuearray.h>
+
+GST_DEBUG_CATEGORY_EXTERN (rtp_session_debug);
+#define GST_CAT_DEFAULT rtp_session_debug
+
+/* packets sent within this interval are handled as one group */
+#define BURST_INTERVAL (5 * GST_MSECOND)
+
+#define TRENDLINE_WINDOW 20
+#define TRENDLINE_SMOOTHING 0.9
+#define TRENDLINE_GAIN 4.0
+#define TRENDLINE_MAX_DELTAS 60
+
+/* thresholds are in milliseconds */
+#define THRESHOLD_INITIAL 12.5
+#define THRESHOLD_MIN 6.0
+#define THRESHOLD_MAX 600.0
+#define THRESHOLD_K_UP 0.0087
+#define THRESHOLD_K_DOWN 0.039
+#define THRESHOLD_MAX_STEP 15.0
+#define OVERUSE_TIME_THRESHOLD 10.0
+
+#define ACKED_WINDOW (500 * GST_MSECOND)
+#define ACKED_MIN_SPAN (100 * GST_MSECOND)
+
+#define DECREASE_FACTOR 0.85
+/* increase per second, faster until the first overuse is seen */
+#define INCREASE_FACTOR 1.08
+#define STARTUP_INCREASE_FACTOR 1.5
+#define MIN_INCREASE 1000
+
+#define LOSS_MIN_PACKETS 20
+#define LOSS_HIGH 0.10
+#define LOSS_LOW 0.02
+
+typedef struct
+{
+  GstClockTime first_send;
+  GstClockTime last_send;
+  GstClockTime last_arrival;
+} PacketGroup;
+
+typedef struct
+{
+  GstClockTime arrival;
+  guint size;
+} AckedPacket;
+
+typedef enum
+{
+  RATE_CONTROL_HOLD,
+  RATE_CONTROL_INCREASE,
+} RateControlState;
+
+struct _RTPBandwidthEstimator
+{
+  guint min_bitrate;
+  guint max_bitrate;
+  guint target_bitrate;
+
+  /* packet groups */
+  PacketGroup group;
+  PacketGroup prev_group;
+
+  /* trendline of the delay variation */
+  guint num_deltas;
+  gdouble accumulated_delay;
+  gdouble smoothed_delay;
+  gdouble first_arrival_ms;
+  gdouble history_x[TRENDLINE_WINDOW];
+  gdouble history_y[TRENDLINE_WINDOW];
+  guint history_len;
+  guint history_pos;
+  gdouble trend;
+  gdouble prev_trend;
+
+  /* overuse detector */
+  gdouble threshold;
+  gdouble last_threshold_update_ms;
+  gdouble time_over_using;
+  guint overuse_count;
+  RTPBandwidthUsage usage;
+
+  /* rate control */
+  RateControlState rate_state;
+  GstClockTime last_change;
+  gboolean seen_overuse;
+  gboolean loss_hold;
+
+  /* packets acknowledged within the last ACKED_WINDOW */
+  GstQueueArray *acked;
+  guint64 acked_bits;
+
+  guint loss_total;
+  guint loss_lost;
+};
+
+static gdouble
+time_to_ms (GstClockTimeDiff diff)
+{
+  return (gdouble) diff / GST_MSECOND;
+}
+
+/**
+ * rtp_bandwidth_estimator_new:
+ * @min_bitrate: the lowest target bitrate in bits per second
+ * @start_bitrate: the target bitrate before any feedback
+ * @max_bitrate: the highest target bitrate in bits per second
+ *
+ * Returns: a new #RTPBandwidthEstimator. Free with
+ * rtp_bandwidth_estimator_free().
+ */
+RTPBandwidthEstimator *
+rtp_bandwidth_estimator_new (guint min_bitrate, guint start_bitrate,
+    guint max_bitrate)
+{
+  RTPBandwidthEstimator *bwe = g_new0 (RTPBandwidthEstimator, 1);
+
+  bwe->acked = gst_queue_array_new_for_struct (sizeof (AckedPacket), 128);
+  rtp_bandwidth_estimator_reset (bwe, min_bitrate, start_bitrate,
+      max_bitrate);
+
+  return bwe;
+}
+
+void
+rtp_bandwidth_estimator_free (RTPBandwidthEstimator * bwe)
+{
+  gst_queue_array_free (bwe->acked);
+  g_free (bwe);
+}
+
+/**
+ * rtp_bandwidth_estimator_reset:
+ * @bwe: an #RTPBandwidthEstimator
+ * @min_bitrate: the lowest target bitrate in bits per second
+ * @start_bitrate: the target bitrate to restart from
+ * @max_bitrate: the highest target bitrate in bits per second
+ *
+ * Forgets everything learned from previous feedback.
+ */
+void
+rtp_bandwidth_estimator_reset (RTPBandwidthEstimator * bwe,
+    guint min_bitrate, guint start_bitrate, guint max_bitrate)
+{
+  bwe->min_bitrate = min_bitrate;
+  bwe->max_bitrate = MAX (min_bitrate, max_bitrate);
+  bwe->target_bitrate = CLAMP (start_bitrate, bwe->min_bitrate,
+      bwe->max_bitrate);
+
+  bwe->group.first_send = GST_CLOCK_TIME_NONE;
+  bwe->prev_group.first_send = GST_CLOCK_TIME_NONE;
+
+  bwe->num_deltas = 0;
+  bwe->accumulated_delay = 0.0;
+  bwe->smoothed_delay = 0.0;
+  bwe->first_arrival_ms = -1.0;
+  bwe->history_len = 0;
+  bwe->history_pos = 0;
+  bwe->trend = 0.0;
+  bwe->prev_trend = 0.0;
+
+  bwe->threshold = THRESHOLD_INITIAL;
+  bwe->last_threshold_update_ms = -1.0;
+  bwe->time_over_using = -1.0;
+  bwe->overuse_count = 0;
+  bwe->usage = RTP_BANDWIDTH_USAGE_NORMAL;
+
+  bwe->rate_state = RATE_CONTROL_HOLD;
+  bwe->last_change = GST_CLOCK_TIME_NONE;
+  bwe->seen_overuse = FALSE;
+  bwe->loss_hold = FALSE;
+
+  gst_queue_array_clear (bwe->acked);
+  bwe->acked_bits = 0;
+
+  bwe->loss_total = 0;
+  bwe->loss_lost = 0;
+}
+
+static void
+add_acked_packet (RTPBandwidthEstimator * bwe, GstClockTime arrival,
+    guint size)
+{
+  AckedPacket packet = { arrival, size };
+  AckedPacket *head;
+
+  gst_queue_array_push_tail_struct (bwe->acked, &packet);
+  bwe->acked_bits += size * 8;
+
+  while ((head = gst_queue_array_peek_head_struct (bwe->acked)) &&
+      head->arrival + ACKED_WINDOW < arrival) {
+    bwe->acked_bits -= head->size * 8;
+    gst_queue_array_pop_head_struct (bwe->acked);
+  }
+}
+
+/**
+ * rtp_bandwidth_estimator_get_acked_bitrate:
+ * @bwe: an #RTPBandwidthEstimator
+ *
+ * Returns: the bitrate the receiver reported to have received over the
+ * last 500 milliseconds, or 0 when not known yet.
+ */
+guint
+rtp_bandwidth_estimator_get_acked_bitrate (RTPBandwidthEstimator * bwe)
+{
+  AckedPacket *head, *tail;
+  GstClockTime span;
+
+  if (gst_queue_array_get_length (bwe->acked) < 2)
+    return 0;
+
+  head = gst_queue_array_peek_head_struct (bwe->acked);
+  tail = gst_queue_array_peek_tail_struct (bwe->acked);
+  if (tail->arrival < head->arrival + ACKED_MIN_SPAN)
+    return 0;
+  span = tail->arrival - head->arrival;
+
+  /* the first packet only marks the start of the window */
+  return gst_util_uint64_scale (bwe->acked_bits - head->size * 8,
+      GST_SECOND, span);
+}
+
+static void
+update_threshold (RTPBandwidthEstimator * bwe, gdouble modified_trend,
+    gdouble now_ms)
+{
+  gdouble abs_trend = fabs (modified_trend);
+  gdouble k;
+
+  if (bwe->last_threshold_update_ms < 0)
+    bwe->last_threshold_update_ms = now_ms;
+
+  /* don't let single spikes move the threshold */
+  if (abs_trend > bwe->threshold + THRESHOLD_MAX_STEP) {
+    bwe->last_threshold_update_ms = now_ms;
+    return;
+  }
+
+  k = abs_trend < bwe->threshold ? THRESHOLD_K_DOWN : THRESHOLD_K_UP;
+  bwe->threshold += k * (abs_trend - bwe->threshold) *
+      MIN (now_ms - bwe->last_threshold_update_ms, 100.0);
+  bwe->threshold = CLAMP (bwe->threshold, THRESHOLD_MIN, THRESHOLD_MAX);
+  bwe->last_threshold_update_ms = now_ms;
+}
+
+static void
+detect_usage (RTPBandwidthEstimator * bwe, gdouble send_delta_ms,
+    gdouble now_ms)
+{
+  gdouble modified_trend;
+
+  if (bwe->num_deltas < 2) {
+    bwe->usage = RTP_BANDWIDTH_USAGE_NORMAL;
+    return;
+  }
+
+  modified_trend = MIN (bwe->num_deltas, TRENDLINE_MAX_DELTAS) *
+      bwe->trend * TRENDLINE_GAIN;
+
+  if (modified_trend > bwe->threshold) {
+    if (bwe->time_over_using < 0)
+      bwe->time_over_using = send_delta_ms / 2;
+    else
+      bwe->time_over_using += send_delta_ms;
+    bwe->overuse_count++;
+
+    /* only signal an overuse that lasts and keeps growing */
+    if (bwe->time_over_using > OVERUSE_TIME_THRESHOLD &&
+        bwe->overuse_count > 1 && bwe->trend >= bwe->prev_trend) {
+      bwe->time_over_using = 0;
+      bwe->overuse_count = 0;
+      bwe->usage = RTP_BANDWIDTH_USAGE_OVERUSE;
+    }
+  } else if (modified_trend < -bwe->threshold) {
+    bwe->time_over_using = -1;
+    bwe->overuse_count = 0;
+    bwe->usage = RTP_BANDWIDTH_USAGE_UNDERUSE;
+  } else {
+    bwe->time_over_using = -1;
+    bwe->overuse_count = 0;
+    bwe->usage = RTP_BANDWIDTH_USAGE_NORMAL;
+  }
+  bwe->prev_trend = bwe->trend;
+
+  update_threshold (bwe, modified_trend, now_ms);
+}
+
+static void
+update_trendline (RTPBandwidthEstimator * bwe, gdouble delay_ms,
+    gdouble send_delta_ms, gdouble arrival_ms)
+{
+  guint i;
+
+  bwe->num_deltas = MIN (bwe->num_deltas + 1, 1000);
+  bwe->accumulated_delay += delay_ms;
+  bwe->smoothed_delay = TRENDLINE_SMOOTHING * bwe->smoothed_delay +
+      (1 - TRENDLINE_SMOOTHING) * bwe->accumulated_delay;
+
+  if (bwe->first_arrival_ms < 0)
+    bwe->first_arrival_ms = arrival_ms;
+
+  bwe->history_x[bwe->history_pos] = arrival_ms - bwe->first_arrival_ms;
+  bwe->history_y[bwe->history_pos] = bwe->smoothed_delay;
+  bwe->history_pos = (bwe->history_pos + 1) % TRENDLINE_WINDOW;
+  bwe->history_len = MIN (bwe->history_len + 1, TRENDLINE_WINDOW);
+
+  /* the slope of the linear regression of the smoothed delay */
+  if (bwe->history_len == TRENDLINE_WINDOW) {
+    gdouble mean_x = 0, mean_y = 0, num = 0, den = 0;
+
+    for (i = 0; i < TRENDLINE_WINDOW; i++) {
+      mean_x += bwe->history_x[i];
+      mean_y += bwe->history_y[i];
+    }
+    mean_x /= TRENDLINE_WINDOW;
+    mean_y /= TRENDLINE_WINDOW;
+
+    for (i = 0; i < TRENDLINE_WINDOW; i++) {
+      gdouble dx = bwe->history_x[i] - mean_x;
+
+      num += dx * (bwe->history_y[i] - mean_y);
+      den += dx * dx;
+    }
+
+    if (den != 0)
+      bwe->trend = num / den;
+  }
+
+  detect_usage (bwe, send_delta_ms, arrival_ms);
+}
+
+static void
+add_received_packet (RTPBandwidthEstimator * bwe, RTPTWCCPacket * pkt)
+{
+  PacketGroup *group = &bwe->group;
+
+  add_acked_packet (bwe, pkt->remote_ts, pkt->size);
+
+  if (GST_CLOCK_TIME_IS_VALID (group->first_send) &&
+      pkt->local_ts <= group->first_send + BURST_INTERVAL) {
+    group->last_send = MAX (group->last_send, pkt->local_ts);
+    group->last_arrival = MAX (group->last_arrival, pkt->remote_ts);
+    return;
+  }
+
+  /* the packet starts a new group, compare the completed group with the
+   * one before */
+  if (GST_CLOCK_TIME_IS_VALID (group->first_send)) {
+    PacketGroup *prev = &bwe->prev_group;
+
+    if (GST_CLOCK_TIME_IS_VALID (prev->first_send)) {
+      gdouble send_delta_ms =
+          time_to_ms (GST_CLOCK_DIFF (prev->last_send, group->last_send));
+      gdouble arrival_delta_ms =
+          time_to_ms (GST_CLOCK_DIFF (prev->last_arrival,
+              group->last_arrival));
+
+      update_trendline (bwe, arrival_delta_ms - send_delta_ms,
+          send_delta_ms, time_to_ms (group->last_arrival));
+    }
+    *prev = *group;
+  }
+
+  group->first_send = pkt->local_ts;
+  group->last_send = pkt->local_ts;
+  group->last_arrival = pkt->remote_ts;
+}
+
+static void
+update_loss (RTPBandwidthEstimator * bwe, GstClockTime now)
+{
+  gdouble loss;
+
+  if (bwe->loss_total < LOSS_MIN_PACKETS)
+    return;
+
+  loss = (gdouble) bwe->loss_lost / bwe->loss_total;
+  bwe->loss_total = 0;
+  bwe->loss_lost = 0;
+
+  if (loss > LOSS_HIGH) {
+    bwe->target_bitrate = MAX (bwe->min_bitrate,
+        (guint) (bwe->target_bitrate * (1 - 0.5 * loss)));
+    bwe->rate_state = RATE_CONTROL_HOLD;
+    bwe->last_change = now;
+
+    GST_DEBUG ("%.1f%% loss, decreasing target to %u", loss * 100,
+        bwe->target_bitrate);
+  }
+
+  bwe->loss_hold = loss >= LOSS_LOW;
+}
+
+static void
+update_rate (RTPBandwidthEstimator * bwe, GstClockTime now)
+{
+  guint acked_bitrate = rtp_bandwidth_estimator_get_acked_bitrate (bwe);
+  guint target = bwe->target_bitrate;
+
+  if (!GST_CLOCK_TIME_IS_VALID (bwe->last_change))
+    bwe->last_change = now;
+
+  if (bwe->usage == RTP_BANDWIDTH_USAGE_OVERUSE) {
+    guint decreased = DECREASE_FACTOR *
+        (acked_bitrate > 0 ? acked_bitrate : target);
+
+    bwe->seen_overuse = TRUE;
+    target = MIN (target, decreased);
+    bwe->rate_state = RATE_CONTROL_HOLD;
+    bwe->last_change = now;
+  } else if (bwe->usage == RTP_BANDWIDTH_USAGE_UNDERUSE || bwe->loss_hold) {
+    /* let the queues drain */
+    bwe->rate_state = RATE_CONTROL_HOLD;
+    bwe->last_change = now;
+  } else if (bwe->rate_state == RATE_CONTROL_HOLD) {
+    bwe->rate_state = RATE_CONTROL_INCREASE;
+    bwe->last_change = now;
+  } else {
+    gdouble elapsed =
+        MIN ((gdouble) GST_CLOCK_DIFF (bwe->last_change, now) / GST_SECOND,
+        1.0);
+    gdouble factor =
+        bwe->seen_overuse ? INCREASE_FACTOR : STARTUP_INCREASE_FACTOR;
+    gdouble increased = target * pow (factor, elapsed);
+
+    increased = MAX (increased, target + MIN_INCREASE * elapsed);
+    /* don't run away from what actually gets through */
+    if (acked_bitrate > 0)
+      increased = MIN (increased, 1.5 * acked_bitrate + 10000);
+    increased = MIN (increased, bwe->max_bitrate);
+    target = MAX (target, (guint) increased);
+    bwe->last_change = now;
+  }
+
+  bwe->target_bitrate = CLAMP (target, bwe->min_bitrate, bwe->max_bitrate);
+}
+
+/**
+ * rtp_bandwidth_estimator_process_packets:
+ * @bwe: an #RTPBandwidthEstimator
+ * @twcc_packets: the #RTPTWCCPacket of a parsed TWCC feedback
+ *
+ * Updates the estimate with the packets of a feedback. Packets that could
+ * not be matched with a sent packet are ignored.
+ *
+ * Returns: %TRUE if the target bitrate changed
+ */
+gboolean
+rtp_bandwidth_estimator_process_packets (RTPBandwidthEstimator * bwe,
+    GArray * twcc_packets)
+{
+  GstClockTime now = GST_CLOCK_TIME_NONE;
+  guint old_target = bwe->target_bitrate;
+  guint i;
+
+  for (i = 0; i < twcc_packets->len; i++) {
+    RTPTWCCPacket *pkt = &g_array_index (twcc_packets, RTPTWCCPacket, i);
+
+    if (!GST_CLOCK_TIME_IS_VALID (pkt->local_ts))
+      continue;
+
+    if (!GST_CLOCK_TIME_IS_VALID (now) || pkt->local_ts > now)
+      now = pkt->local_ts;
+
+    bwe->loss_total++;
+    if (pkt->status == RTP_TWCC_PACKET_STATUS_NOT_RECV ||
+        !GST_CLOCK_TIME_IS_VALID (pkt->remote_ts)) {
+      bwe->loss_lost++;
+      continue;
+    }
+
+    add_received_packet (bwe, pkt);
+  }
+
+  if (!GST_CLOCK_TIME_IS_VALID (now))
+    return FALSE;
+
+  update_loss (bwe, now);
+  update_rate (bwe, now);
+
+  GST_LOG ("usage: %d, trend: %f, threshold: %f, acked: %u, target: %u",
+      bwe->usage, bwe->trend, bwe->threshold,
+      rtp_bandwidth_estimator_get_acked_bitrate (bwe), bwe->target_bitrate);
+
+  return bwe->target_bitrate != old_target;
+}
+
+/**
+ * rtp_bandwidth_estimator_get_target_bitrate:
+ * @bwe: an #RTPBandwidthEstimator
+ *
+ * Returns: the bitrate in bits per second the sender should aim for
+ */
+guint
+rtp_bandwidth_estimator_get_target_bitrate (RTPBandwidthEstimator * bwe)
+{
+  return bwe->target_bitrate;
+}
+
+/**
+ * rtp_bandwidth_estimator_get_usage:
+ * @bwe: an #RTPBandwidthEstimator
+ *
+ * Returns: the last detected #RTPBandwidthUsage
+ */
+RTPBandwidthUsage
+rtp_bandwidth_estimator_get_usage (RTPBandwidthEstimator * bwe)
+{
+  return bwe->usage;
+}
@@ -0,0 +1,58 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __RTP_BWE_H__
+#define __RTP_BWE_H__
+
+#include <gst/gst.h>
+#include "rtptwcc.h"
+
+typedef struct _RTPBandwidthEstimator RTPBandwidthEstimator;
+
+/**
+ * RTPBandwidthUsage:
+ * @RTP_BANDWIDTH_USAGE_NORMAL: the delay between packets is stable
+ * @RTP_BANDWIDTH_USAGE_UNDERUSE: queues along the path are draining
+ * @RTP_BANDWIDTH_USAGE_OVERUSE: queues along the path are building up
+ *
+ * The state of the path as detected from the delay variation of the
+ * reported packets.
+ */
+typedef enum
+{
+  RTP_BANDWIDTH_USAGE_NORMAL,
+  RTP_BANDWIDTH_USAGE_UNDERUSE,
+  RTP_BANDWIDTH_USAGE_OVERUSE,
+} RTPBandwidthUsage;
+
+RTPBandwidthEstimator * rtp_bandwidth_estimator_new (guint min_bitrate,
+    guint start_bitrate, guint max_bitrate);
+void rtp_bandwidth_estimator_free (RTPBandwidthEstimator * bwe);
+
+void rtp_bandwidth_estimator_reset (RTPBandwidthEstimator * bwe,
+    guint min_bitrate, guint start_bitrate, guint max_bitrate);
+
+gboolean rtp_bandwidth_estimator_process_packets (RTPBandwidthEstimator * bwe,
+    GArray * twcc_packets);
+
+guint rtp_bandwidth_estimator_get_target_bitrate (RTPBandwidthEstimator * bwe);
+guint rtp_bandwidth_estimator_get_acked_bitrate (RTPBandwidthEstimator * bwe);
+RTPBandwidthUsage rtp_bandwidth_estimator_get_usage (
+    RTPBandwidthEstimator * bwe);
+
+#endif /* __RTP_BWE_H__ */
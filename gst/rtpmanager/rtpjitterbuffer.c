@@ -30,6 +30,13 @@ GST_DEBUG_CATEGORY_STATIC (rtp_jitter_buffer_debug);
 #define MAX_WINDOW	RTP_JITTER_BUFFER_MAX_WINDOW
 #define MAX_TIME	(2 * GST_SECOND)
 
+/* the seqnum index grows in powers of two up to one slot per seqnum */
+#define INDEX_MIN_SIZE	256
+#define INDEX_MAX_SIZE	65536
+/* how many seqnums to look back in the index for the previous packet before
+ * falling back to walking the queue */
+#define INDEX_MAX_SCAN	64
+
 /* signals and args */
 enum
 {
@@ -678,6 +685,126 @@ no_skew:
   return out_time;
 }
 
+static inline RTPJitterBufferItem *
+index_lookup (RTPJitterBuffer * jbuf, guint16 seqnum)
+{
+  RTPJitterBufferItem *item;
+
+  if (G_UNLIKELY (jbuf->index == NULL))
+    return NULL;
+
+  item = jbuf->index[seqnum & jbuf->index_mask];
+  if (item && item->seqnum == seqnum)
+    return item;
+
+  return NULL;
+}
+
+static void
+index_resize (RTPJitterBuffer * jbuf, guint size)
+{
+  GList *list;
+
+  GST_DEBUG ("resizing seqnum index to %u", size);
+
+  g_free (jbuf->index);
+  jbuf->index = g_new0 (RTPJitterBufferItem *, size);
+  jbuf->index_mask = size - 1;
+
+  /* seqnums that did not collide in a smaller index don't collide in a
+   * bigger one either */
+  for (list = jbuf->packets.head; list; list = list->next) {
+    RTPJitterBufferItem *item = (RTPJitterBufferItem *) list;
+
+    if (item->seqnum != -1)
+      jbuf->index[item->seqnum & jbuf->index_mask] = item;
+  }
+}
+
+static void
+index_add (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item)
+{
+  if (G_UNLIKELY (jbuf->index == NULL))
+    index_resize (jbuf, INDEX_MIN_SIZE);
+
+  /* duplicates never make it here, so with one slot per seqnum there can't
+   * be any collisions */
+  while (jbuf->index[item->seqnum & jbuf->index_mask] != NULL) {
+    g_assert (jbuf->index_mask + 1 < INDEX_MAX_SIZE);
+    index_resize (jbuf, (jbuf->index_mask + 1) * 2);
+  }
+
+  jbuf->index[item->seqnum & jbuf->index_mask] = item;
+}
+
+static void
+index_remove (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item)
+{
+  RTPJitterBufferItem **slot;
+
+  if (item->seqnum == -1 || jbuf->index == NULL)
+    return;
+
+  slot = &jbuf->index[item->seqnum & jbuf->index_mask];
+  if (*slot == item)
+    *slot = NULL;
+}
+
+/* Find the item after which an item with @seqnum is to be inserted using the
+ * seqnum index. This handles in order, reordered and lost packets without
+ * walking the queue. Returns %FALSE if the queue needs to be walked, for
+ * example when there is a big gap before @seqnum. */
+static gboolean
+queue_find_position (RTPJitterBuffer * jbuf, guint16 seqnum, GList ** position)
+{
+  RTPJitterBufferItem *first, *last, *prev = NULL;
+  GList *list, *next;
+  guint i;
+
+  last = (RTPJitterBufferItem *) jbuf->packets.tail;
+  while (last && last->seqnum == -1)
+    last = (RTPJitterBufferItem *) last->prev;
+
+  /* no packets or newer than all packets, append */
+  if (last == NULL || gst_rtp_buffer_compare_seqnum (last->seqnum,
+          seqnum) > 0) {
+    *position = jbuf->packets.tail;
+    return TRUE;
+  }
+
+  first = (RTPJitterBufferItem *) jbuf->packets.head;
+  while (first->seqnum == -1)
+    first = (RTPJitterBufferItem *) first->next;
+
+  /* the packets span more than half the seqnum space, their order is
+   * ambiguous */
+  if (gst_rtp_buffer_compare_seqnum (first->seqnum, last->seqnum) < 0)
+    return FALSE;
+
+  if (gst_rtp_buffer_compare_seqnum (seqnum, first->seqnum) > 0) {
+    /* older than all packets, insert after the events at the head */
+    for (list = NULL, next = jbuf->packets.head;
+        ((RTPJitterBufferItem *) next)->seqnum == -1; next = next->next)
+      list = next;
+    *position = list;
+    return TRUE;
+  }
+
+  for (i = 1; i <= INDEX_MAX_SCAN && prev == NULL; i++)
+    prev = index_lookup (jbuf, seqnum - i);
+
+  if (prev == NULL)
+    return FALSE;
+
+  /* insert after the events following the previous packet */
+  list = (GList *) prev;
+  while (list->next && ((RTPJitterBufferItem *) list->next)->seqnum == -1)
+    list = list->next;
+  *position = list;
+
+  return TRUE;
+}
+
 static void
 queue_do_insert (RTPJitterBuffer * jbuf, GList * list, GList * item)
 {
@@ -1016,6 +1143,12 @@ rtp_jitter_buffer_insert (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item,
 
   seqnum = item->seqnum;
 
+  if (G_UNLIKELY (index_lookup (jbuf, seqnum)))
+    goto duplicate;
+
+  if (G_LIKELY (queue_find_position (jbuf, seqnum, &list)))
+    goto insert;
+
   /* loop the list to skip strictly larger seqnum buffers */
   for (; list; list = g_list_previous (list)) {
     guint16 qseq;
@@ -1054,6 +1187,9 @@ rtp_jitter_buffer_insert (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item,
   if (event)
     list = event;
 
+insert:
+  index_add (jbuf, item);
+
 append:
   queue_do_insert (jbuf, list, (GList *) item);
 
@@ -1255,6 +1391,7 @@ rtp_jitter_buffer_pop (RTPJitterBuffer * jbuf, gint * percent)
     else
       queue->tail = NULL;
     queue->length--;
+    index_remove (jbuf, (RTPJitterBufferItem *) item);
   }
 
   /* buffering mode, update buffer stats */
@@ -1310,6 +1447,10 @@ rtp_jitter_buffer_flush (RTPJitterBuffer * jbuf, GFunc free_func,
 
   while ((item = g_queue_pop_head_link (&jbuf->packets)))
     free_func ((RTPJitterBufferItem *) item, user_data);
+
+  g_free (jbuf->index);
+  jbuf->index = NULL;
+  jbuf->index_mask = 0;
 }
 
 /**
@@ -74,6 +74,9 @@ struct _RTPJitterBuffer {
   GObject        object;
 
   GQueue         packets;
+  /* packets in @packets indexed by seqnum & index_mask */
+  RTPJitterBufferItem **index;
+  guint          index_mask;
 
   RTPJitterBufferMode mode;
 
@@ -594,6 +594,13 @@ rtp_session_class_init (RTPSessionClass * klass)
    * *  "recv-nack-count" G_TYPE_UINT   Number of NACKs received
    * *  "source-stats"    G_TYPE_BOXED  GValueArray of #RTPSource:stats for all
    *      RTP sources (Since 1.8)
+   * *  "rtcp-generation-count" G_TYPE_UINT64  Number of times RTCP was
+   *      generated (Since 1.20)
+   * *  "rtcp-generation-time" G_TYPE_UINT64  Time spent generating RTCP the
+   *      last time, in nanoseconds, not counting the time the session lock
+   *      was released for other threads (Since 1.20)
+   * *  "rtcp-generation-time-max" G_TYPE_UINT64  Maximum time spent
+   *      generating RTCP, in nanoseconds (Since 1.20)
    *
    * Since: 1.4
    */
@@ -755,6 +762,11 @@ rtp_session_finalize (GObject * object)
   g_object_unref (sess->twcc);
   rtp_twcc_stats_free (sess->twcc_stats);
 
+  if (sess->rtcp_pool) {
+    gst_buffer_pool_set_active (sess->rtcp_pool, FALSE);
+    gst_object_unref (sess->rtcp_pool);
+  }
+
   g_mutex_clear (&sess->lock);
 
   G_OBJECT_CLASS (rtp_session_parent_class)->finalize (object);
@@ -816,7 +828,11 @@ rtp_session_create_stats (RTPSession * sess)
   s = gst_structure_new ("application/x-rtp-session-stats",
       "rtx-drop-count", G_TYPE_UINT, sess->stats.nacks_dropped,
       "sent-nack-count", G_TYPE_UINT, sess->stats.nacks_sent,
-      "recv-nack-count", G_TYPE_UINT, sess->stats.nacks_received, NULL);
+      "recv-nack-count", G_TYPE_UINT, sess->stats.nacks_received,
+      "rtcp-generation-count", G_TYPE_UINT64, sess->rtcp_generation_count,
+      "rtcp-generation-time", G_TYPE_UINT64, sess->rtcp_generation_time,
+      "rtcp-generation-time-max", G_TYPE_UINT64,
+      sess->rtcp_generation_time_max, NULL);
 
   size = g_hash_table_size (sess->ssrcs[sess->mask_idx]);
   source_stats = g_value_array_new (size);
@@ -2875,28 +2891,34 @@ rtp_session_process_twcc (RTPSession * sess, guint32 sender_ssrc,
     guint32 media_ssrc, guint8 * fci_data, guint fci_length)
 {
   GArray *twcc_packets;
-  GstStructure *twcc_packets_s;
-  GstStructure *twcc_stats_s;
+  RTPTWCCStats *twcc_stats = sess->twcc_stats;
+  RTPTWCCStats stats;
 
   twcc_packets = rtp_twcc_manager_parse_fci (sess->twcc,
       fci_data, fci_length * sizeof (guint32));
   if (twcc_packets == NULL)
     return;
 
-  twcc_packets_s = rtp_twcc_stats_get_packets_structure (twcc_packets);
-  twcc_stats_s =
-      rtp_twcc_stats_process_packets (sess->twcc_stats, twcc_packets);
+  rtp_twcc_stats_process_packets (twcc_stats, twcc_packets);
 
-  GST_DEBUG_OBJECT (sess, "Parsed TWCC: %" GST_PTR_FORMAT, twcc_packets_s);
-  GST_INFO_OBJECT (sess, "Current TWCC stats %" GST_PTR_FORMAT, twcc_stats_s);
-
-  g_array_unref (twcc_packets);
+  GST_DEBUG_OBJECT (sess, "Parsed TWCC: %u packets", twcc_packets->len);
+  GST_INFO_OBJECT (sess, "Current TWCC stats: bitrate-sent: %u, "
+      "bitrate-recv: %u, packets-sent: %u, packets-recv: %u, "
+      "packet-loss-pct: %f, avg-delta-of-delta: %" GST_STIME_FORMAT,
+      twcc_stats->bitrate_sent, twcc_stats->bitrate_recv,
+      twcc_stats->packets_sent, twcc_stats->packets_recv,
+      twcc_stats->packet_loss_pct,
+      GST_STIME_ARGS (twcc_stats->avg_delta_of_delta));
 
+  /* notify a copy of the counters, they can change once unlocked */
+  stats = *twcc_stats;
   RTP_SESSION_UNLOCK (sess);
   if (sess->callbacks.notify_twcc)
-    sess->callbacks.notify_twcc (sess, twcc_packets_s, twcc_stats_s,
+    sess->callbacks.notify_twcc (sess, twcc_packets, &stats,
         sess->notify_twcc_user_data);
   RTP_SESSION_LOCK (sess);
+
+  g_array_unref (twcc_packets);
 }
 
 static void
@@ -3558,8 +3580,93 @@ typedef struct
   gboolean may_suppress;
   GQueue output;
   guint nacked_seqnums;
+  GPtrArray *sources;
+  /* the remote senders that need a report block in this generation */
+  GPtrArray *report_sources;
+  guint n_walked;
+  /* time in microseconds the session lock was released for other threads */
+  gint64 yield_time;
 } ReportData;
 
+/* number of sources handled before giving other threads a chance to take the
+ * session lock while generating RTCP */
+#define REPORT_SOURCES_PER_LOCK 32
+
+/* called with the session lock after handling source @i of data->sources,
+ * never while iterating the ssrcs hashtable or while building an RTCP
+ * packet as both may be modified by other threads. Returns the index of the
+ * next source to handle. */
+static guint
+session_yield_lock (RTPSession * sess, ReportData * data, guint i)
+{
+  guint j, next = i + 1;
+  gint64 start_time;
+
+  if (++data->n_walked % REPORT_SOURCES_PER_LOCK != 0)
+    return next;
+
+  start_time = g_get_monotonic_time ();
+  RTP_SESSION_UNLOCK (sess);
+  g_thread_yield ();
+  RTP_SESSION_LOCK (sess);
+  data->yield_time += g_get_monotonic_time () - start_time;
+
+  /* the session might have been reset in the meantime, forget about the
+   * sources that are gone */
+  for (j = 0; j < data->sources->len;) {
+    RTPSource *source = g_ptr_array_index (data->sources, j);
+
+    if (find_source (sess, source->ssrc) != source) {
+      g_ptr_array_remove_index (data->sources, j);
+      if (j < next)
+        next--;
+    } else {
+      j++;
+    }
+  }
+  for (j = 0; j < data->report_sources->len;) {
+    RTPSource *source = g_ptr_array_index (data->report_sources, j);
+
+    if (find_source (sess, source->ssrc) != source)
+      g_ptr_array_remove_index (data->report_sources, j);
+    else
+      j++;
+  }
+
+  return next;
+}
+
+/* RTCP packets are built in buffers of a pool, they are returned to it once
+ * they have been sent */
+static GstBuffer *
+session_acquire_rtcp_buffer (RTPSession * sess)
+{
+  GstBuffer *buffer = NULL;
+
+  if (sess->rtcp_pool == NULL || sess->rtcp_pool_size != sess->mtu) {
+    GstStructure *config;
+
+    if (sess->rtcp_pool) {
+      gst_buffer_pool_set_active (sess->rtcp_pool, FALSE);
+      gst_object_unref (sess->rtcp_pool);
+    }
+
+    sess->rtcp_pool = gst_buffer_pool_new ();
+    sess->rtcp_pool_size = sess->mtu;
+    config = gst_buffer_pool_get_config (sess->rtcp_pool);
+    gst_buffer_pool_config_set_params (config, NULL, sess->mtu, 0, 0);
+    if (!gst_buffer_pool_set_config (sess->rtcp_pool, config) ||
+        !gst_buffer_pool_set_active (sess->rtcp_pool, TRUE))
+      GST_WARNING ("failed to activate RTCP buffer pool");
+  }
+
+  if (gst_buffer_pool_acquire_buffer (sess->rtcp_pool, &buffer,
+          NULL) != GST_FLOW_OK)
+    buffer = gst_rtcp_buffer_new (sess->mtu);
+
+  return buffer;
+}
+
 static void
 session_start_rtcp (RTPSession * sess, ReportData * data)
 {
@@ -3567,10 +3674,12 @@ session_start_rtcp (RTPSession * sess, ReportData * data)
   RTPSource *own = data->source;
   GstRTCPBuffer *rtcp = &data->rtcpbuf;
 
-  data->rtcp = gst_rtcp_buffer_new (sess->mtu);
+  data->rtcp = session_acquire_rtcp_buffer (sess);
   data->has_sdes = FALSE;
 
   gst_rtcp_buffer_map (data->rtcp, GST_MAP_READWRITE, rtcp);
+  /* recycled buffers contain the previous packets */
+  memset (rtcp->map.data, 0, rtcp->map.size);
 
   if (data->is_early && sess->reduced_size_rtcp)
     return;
@@ -3647,11 +3756,40 @@ session_report_blocks (const gchar * key, RTPSource * source, ReportData * data)
     goto reported;
   }
 
-  GST_DEBUG ("create RB for SSRC %08x", source->ssrc);
+  if (source->last_rr.is_valid && source->last_rr_report_id == sess->report_id) {
+    /* another internal source already reported on this source in this RTCP
+     * round, reuse its report block */
+    GST_DEBUG ("reuse RB for SSRC %08x", source->ssrc);
+    fractionlost = source->last_rr.fractionlost;
+    packetslost = source->last_rr.packetslost;
+    exthighestseq = source->last_rr.exthighestseq;
+    jitter = source->last_rr.jitter;
+    lsr = source->last_rr.lsr;
+    dlsr = source->last_rr.dlsr;
+  } else if (source->last_rr.is_valid &&
+      source->last_rr_received == source->stats.packets_received &&
+      source->last_rr_extended_max ==
+      source->stats.cycles + source->stats.max_seq) {
+    /* nothing was received since the last report block, nothing was lost in
+     * the interval and only the delay since the last SR moved on */
+    GST_DEBUG ("update RB for SSRC %08x", source->ssrc);
+    fractionlost = 0;
+    packetslost = source->last_rr.packetslost;
+    exthighestseq = source->last_rr.exthighestseq;
+    jitter = source->last_rr.jitter;
+    rtp_source_get_new_lsr (source, data->current_time, &lsr, &dlsr);
+    source->last_rr_report_id = sess->report_id;
+  } else {
+    GST_DEBUG ("create RB for SSRC %08x", source->ssrc);
 
-  /* get new stats */
-  rtp_source_get_new_rb (source, data->current_time, &fractionlost,
-      &packetslost, &exthighestseq, &jitter, &lsr, &dlsr);
+    /* get new stats */
+    rtp_source_get_new_rb (source, data->current_time, &fractionlost,
+        &packetslost, &exthighestseq, &jitter, &lsr, &dlsr);
+    source->last_rr_report_id = sess->report_id;
+    source->last_rr_received = source->stats.packets_received;
+    source->last_rr_extended_max = source->stats.cycles +
+        source->stats.max_seq;
+  }
 
   /* store last generated RR packet */
   source->last_rr.is_valid = TRUE;
@@ -4016,9 +4154,20 @@ session_cleanup (const gchar * key, RTPSource * source, ReportData * data)
 
       on_sender_timeout (sess, source);
     }
-    /* count how many source to report in this generation */
-    if (((gint16) (source->generation - sess->generation)) <= 0)
-      data->num_to_report++;
+    if (!source->internal && RTP_SOURCE_IS_SENDER (source) &&
+        !source->disable_rtcp) {
+      /* count how many source to report in this generation */
+      if (((gint16) (source->generation - sess->generation)) <= 0) {
+        data->num_to_report++;
+        g_ptr_array_add (data->report_sources, g_object_ref (source));
+      }
+    } else {
+      /* nothing to report, keep the source in the current generation so
+       * that it is reported right away once it sends */
+      source->generation = sess->generation;
+      if (g_hash_table_size (source->reported_in_sr_of) > 0)
+        g_hash_table_remove_all (source->reported_in_sr_of);
+    }
   }
   source->closing = remove;
 }
@@ -4203,9 +4352,9 @@ is_rtcp_time (RTPSession * sess, GstClockTime current_time, ReportData * data)
 }
 
 static void
-clone_ssrcs_hashtable (gchar * key, RTPSource * source, GHashTable * hash_table)
+clone_ssrcs_array (gchar * key, RTPSource * source, GPtrArray * array)
 {
-  g_hash_table_insert (hash_table, key, g_object_ref (source));
+  g_ptr_array_add (array, g_object_ref (source));
 }
 
 static gboolean
@@ -4287,10 +4436,13 @@ generate_rtcp (const gchar * key, RTPSource * source, ReportData * data)
     make_source_bye (sess, source, data);
     is_bye = TRUE;
   } else if (!data->is_early) {
-    /* loop over all known sources and add report blocks. If we are early, we
-     * just make a minimal RTCP packet and skip this step */
-    g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
-        (GHFunc) session_report_blocks, data);
+    guint i;
+
+    /* loop over the sources that need one and add report blocks. If we are
+     * early, we just make a minimal RTCP packet and skip this step */
+    for (i = 0; i < data->report_sources->len; i++)
+      session_report_blocks (NULL,
+          g_ptr_array_index (data->report_sources, i), data);
   }
   if (!data->has_sdes && (!data->is_early || !sess->reduced_size_rtcp))
     session_sdes (sess, data);
@@ -4403,9 +4555,11 @@ rtp_session_on_timeout (RTPSession * sess, GstClockTime current_time,
 {
   GstFlowReturn result = GST_FLOW_OK;
   ReportData data = { GST_RTCP_BUFFER_INIT };
-  GHashTable *table_copy;
   ReportOutput *output;
   gboolean all_empty = FALSE;
+  gint64 start_time, yield_time;
+  GstClockTime generation_time;
+  guint i;
 
   g_return_val_if_fail (RTP_IS_SESSION (sess), GST_FLOW_ERROR);
 
@@ -4420,6 +4574,8 @@ rtp_session_on_timeout (RTPSession * sess, GstClockTime current_time,
   data.num_to_report = 0;
   data.may_suppress = FALSE;
   data.nacked_seqnums = 0;
+  data.n_walked = 0;
+  data.yield_time = 0;
   g_queue_init (&data.output);
 
   RTP_SESSION_LOCK (sess);
@@ -4446,21 +4602,36 @@ rtp_session_on_timeout (RTPSession * sess, GstClockTime current_time,
   sess->conflicting_addresses =
       timeout_conflicting_addresses (sess->conflicting_addresses, current_time);
 
-  /* Make a local copy of the hashtable. We need to do this because the
-   * cleanup stage below releases the session lock. */
-  table_copy = g_hash_table_new_full (NULL, NULL, NULL,
-      (GDestroyNotify) g_object_unref);
+  /* Make a local copy of the sources. We need to do this because the cleanup
+   * and the RTCP generation below release the session lock, the latter every
+   * REPORT_SOURCES_PER_LOCK sources so that the streaming threads don't have
+   * to wait for all sources of a big session to be handled. Sources added in
+   * the meantime are handled on the next timeout. */
+  data.sources = g_ptr_array_new_full (g_hash_table_size (sess->ssrcs
+          [sess->mask_idx]), (GDestroyNotify) g_object_unref);
   g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
-      (GHFunc) clone_ssrcs_hashtable, table_copy);
+      (GHFunc) clone_ssrcs_array, data.sources);
+  data.report_sources = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      g_object_unref);
 
   /* Clean up the session, mark the source for removing, this might release the
    * session lock. */
-  g_hash_table_foreach (table_copy, (GHFunc) session_cleanup, &data);
-  g_hash_table_destroy (table_copy);
+  for (i = 0; i < data.sources->len;) {
+    session_cleanup (NULL, g_ptr_array_index (data.sources, i), &data);
+    i = session_yield_lock (sess, &data, i);
+  }
 
   /* Now remove the marked sources */
   g_hash_table_foreach_remove (sess->ssrcs[sess->mask_idx],
       (GHRFunc) remove_closing_sources, &data);
+  for (i = 0; i < data.sources->len;) {
+    RTPSource *source = g_ptr_array_index (data.sources, i);
+
+    if (source->closing)
+      g_ptr_array_remove_index (data.sources, i);
+    else
+      i++;
+  }
 
   /* update point-to-point status */
   session_update_ptp (sess);
@@ -4472,20 +4643,35 @@ rtp_session_on_timeout (RTPSession * sess, GstClockTime current_time,
   /* check if all the buffers are empty after generation */
   all_empty = TRUE;
 
+  start_time = g_get_monotonic_time ();
+  yield_time = data.yield_time;
+  sess->report_id++;
+
   GST_DEBUG
       ("doing RTCP generation %u for %u sources, early %d, may suppress %d",
       sess->generation, data.num_to_report, data.is_early, data.may_suppress);
 
-  /* generate RTCP for all internal sources */
-  g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
-      (GHFunc) generate_rtcp, &data);
+  /* generate RTCP for all internal sources, the lock is only released
+   * between complete packets */
+  for (i = 0; i < data.sources->len;) {
+    generate_rtcp (NULL, g_ptr_array_index (data.sources, i), &data);
+    i = session_yield_lock (sess, &data, i);
+  }
 
-  g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
-      (GHFunc) generate_twcc, &data);
+  for (i = 0; i < data.sources->len; i++)
+    generate_twcc (NULL, g_ptr_array_index (data.sources, i), &data);
 
   /* update the generation for all the sources that have been reported */
-  g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
-      (GHFunc) update_generation, &data);
+  for (i = 0; i < data.report_sources->len; i++)
+    update_generation (NULL, g_ptr_array_index (data.report_sources, i),
+        &data);
+
+  generation_time = (g_get_monotonic_time () - start_time -
+      (data.yield_time - yield_time)) * GST_USECOND;
+  sess->rtcp_generation_count++;
+  sess->rtcp_generation_time = generation_time;
+  sess->rtcp_generation_time_max =
+      MAX (sess->rtcp_generation_time_max, generation_time);
 
   /* we keep track of the last report time in order to timeout inactive
    * receivers or senders */
@@ -4510,6 +4696,9 @@ rtp_session_on_timeout (RTPSession * sess, GstClockTime current_time,
 done:
   RTP_SESSION_UNLOCK (sess);
 
+  g_ptr_array_unref (data.report_sources);
+  g_ptr_array_unref (data.sources);
+
   /* notify about updated statistics */
   g_object_notify (G_OBJECT (sess), "stats");
 
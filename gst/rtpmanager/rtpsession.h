@@ -159,12 +159,15 @@ typedef void (*RTPSessionNotifyNACK) (RTPSession *sess,
 
 /**
  * RTPSessionNotifyTWCC:
+ * @twcc_packets: an array of #RTPTWCCPacket
+ * @twcc_stats: the updated #RTPTWCCStats
  * @user_data: user data specified when registering
  *
  * Notifies of Transport-wide congestion control packets and stats.
  */
 typedef void (*RTPSessionNotifyTWCC) (RTPSession *sess,
-    GstStructure * twcc_packets, GstStructure * twcc_stats, gpointer user_data);
+    GArray * twcc_packets, const RTPTWCCStats * twcc_stats,
+    gpointer user_data);
 
 /**
  * RTPSessionReconfigure:
@@ -314,6 +317,14 @@ struct _RTPSession {
   RTPTWCCStats *twcc_stats;
   guint8 twcc_recv_ext_id;
   guint8 twcc_send_ext_id;
+
+  /* RTCP generation */
+  GstBufferPool *rtcp_pool;
+  guint         rtcp_pool_size;
+  guint         report_id;
+  guint64       rtcp_generation_count;
+  GstClockTime  rtcp_generation_time;
+  GstClockTime  rtcp_generation_time_max;
 };
 
 /**
@@ -1625,10 +1625,9 @@ rtp_source_get_new_rb (RTPSource * src, GstClockTime time,
 {
   RTPSourceStats *stats;
   guint64 extended_max, expected;
-  guint64 expected_interval, received_interval, ntptime;
+  guint64 expected_interval, received_interval;
   gint64 lost, lost_interval;
-  guint32 fraction, LSR, DLSR;
-  GstClockTime sr_time;
+  guint32 fraction;
 
   stats = &src->stats;
 
@@ -1660,6 +1659,40 @@ rtp_source_get_new_rb (RTPSource * src, GstClockTime time,
       ", extseq %" G_GUINT64_FORMAT ", jitter %d", fraction, lost,
       extended_max, stats->jitter >> 4);
 
+  rtp_source_get_new_lsr (src, time, lsr, dlsr);
+
+  if (fractionlost)
+    *fractionlost = fraction;
+  if (packetslost)
+    *packetslost = lost;
+  if (exthighestseq)
+    *exthighestseq = extended_max;
+  if (jitter)
+    *jitter = stats->jitter >> 4;
+
+  return TRUE;
+}
+
+/**
+ * rtp_source_get_new_lsr:
+ * @src: an #RTPSource
+ * @time: the current time of the system clock
+ * @lsr: the time of the last SR packet on this source
+ *   (in NTP Short Format, 16.16 fixed point)
+ * @dlsr: the delay since the last SR packet
+ *   (in NTP Short Format, 16.16 fixed point)
+ *
+ * Get the LSR and DLSR values to put into a new report block from this
+ * source, without starting a new loss interval like rtp_source_get_new_rb().
+ */
+void
+rtp_source_get_new_lsr (RTPSource * src, GstClockTime time, guint32 * lsr,
+    guint32 * dlsr)
+{
+  guint64 ntptime;
+  guint32 LSR, DLSR;
+  GstClockTime sr_time;
+
   if (rtp_source_get_last_sr (src, &sr_time, &ntptime, NULL, NULL, NULL)) {
     GstClockTime diff;
 
@@ -1678,20 +1711,10 @@ rtp_source_get_new_rb (RTPSource * src, GstClockTime time,
   GST_DEBUG ("LSR %04x:%04x, DLSR %04x:%04x", LSR >> 16, LSR & 0xffff,
       DLSR >> 16, DLSR & 0xffff);
 
-  if (fractionlost)
-    *fractionlost = fraction;
-  if (packetslost)
-    *packetslost = lost;
-  if (exthighestseq)
-    *exthighestseq = extended_max;
-  if (jitter)
-    *jitter = stats->jitter >> 4;
   if (lsr)
     *lsr = LSR;
   if (dlsr)
     *dlsr = DLSR;
-
-  return TRUE;
 }
 
 /**
@@ -185,6 +185,13 @@ struct _RTPSource {
 
   RTPSourceStats stats;
   RTPReceiverReport last_rr;
+  /* report of the session that last_rr was generated in, the report block is
+   * reused for the other internal sources of that report */
+  guint         last_rr_report_id;
+  /* the receiver stats last_rr was computed from, it is reused as long as
+   * nothing is received */
+  guint64       last_rr_received;
+  guint64       last_rr_extended_max;
 
   GList         *conflicting_addresses;
 
@@ -259,6 +266,8 @@ gboolean        rtp_source_get_new_sr          (RTPSource *src, guint64 ntpnstim
 gboolean        rtp_source_get_new_rb          (RTPSource *src, GstClockTime time, guint8 *fractionlost,
                                                 gint32 *packetslost, guint32 *exthighestseq, guint32 *jitter,
                                                 guint32 *lsr, guint32 *dlsr);
+void            rtp_source_get_new_lsr         (RTPSource *src, GstClockTime time, guint32 *lsr,
+                                                guint32 *dlsr);
 
 gboolean        rtp_source_get_last_sr         (RTPSource *src, GstClockTime *time, guint64 *ntptime,
                                                 guint32 *rtptime, guint32 *packet_count,
@@ -658,8 +658,8 @@ rtp_twcc_stats_free (RTPTWCCStats * stats)
   g_free (stats);
 }
 
-static GstStructure *
-rtp_twcc_stats_get_stats_structure (RTPTWCCStats * stats)
+GstStructure *
+rtp_twcc_stats_get_stats_structure (const RTPTWCCStats * stats)
 {
   return gst_structure_new ("RTPTWCCStats",
       "bitrate-sent", G_TYPE_UINT, stats->bitrate_sent,
@@ -670,11 +670,10 @@ rtp_twcc_stats_get_stats_structure (RTPTWCCStats * stats)
       "avg-delta-of-delta", G_TYPE_INT64, stats->avg_delta_of_delta, NULL);
 }
 
-GstStructure *
+void
 rtp_twcc_stats_process_packets (RTPTWCCStats * stats, GArray * twcc_packets)
 {
   rtp_twcc_stats_calculate_stats (stats, twcc_packets);
   g_array_append_vals (stats->packets, twcc_packets->data, twcc_packets->len);
   rtp_twcc_stats_calculate_windowed_stats (stats);
-  return rtp_twcc_stats_get_stats_structure (stats);
 }
@@ -24,12 +24,24 @@
 
 #include "rtptimerqueue.h"
 
+/* The timer wheel has one slot per tick of about 1ms and wraps after about
+ * one second. Each slot points to one of the timers with a timeout in that
+ * tick, which is used as starting point to find where to insert a timer in
+ * the sorted list. */
+#define WHEEL_TICK_SHIFT 20
+#define WHEEL_SIZE 1024
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+/* how many earlier ticks to look at when the tick of a timer is empty */
+#define WHEEL_MAX_SCAN 64
+
 struct _RtpTimerQueue
 {
   GObject parent;
 
   GQueue timers;
   GHashTable *hashtable;
+
+  RtpTimer *wheel[WHEEL_SIZE];
 };
 
 G_DEFINE_TYPE (RtpTimerQueue, rtp_timer_queue, G_TYPE_OBJECT);
@@ -39,7 +51,15 @@ G_DEFINE_TYPE (RtpTimerQueue, rtp_timer_queue, G_TYPE_OBJECT);
 static RtpTimer *
 rtp_timer_new (void)
 {
-  return g_slice_new0 (RtpTimer);
+  RtpTimer *timer = g_slice_new0 (RtpTimer);
+  timer->wheel_slot = -1;
+  return timer;
+}
+
+static inline guint64
+rtp_timer_get_tick (RtpTimer * timer)
+{
+  return timer->timeout >> WHEEL_TICK_SHIFT;
 }
 
 static inline void
@@ -98,82 +118,6 @@ rtp_timer_is_sooner (RtpTimer * timer, RtpTimer * prev)
   return FALSE;
 }
 
-static inline gboolean
-rtp_timer_is_closer_to_head (RtpTimer * timer, RtpTimer * head)
-{
-  RtpTimer *prev = rtp_timer_get_prev (timer);
-  GstClockTimeDiff prev_delta = 0;
-  GstClockTimeDiff head_delta = 0;
-
-  if (prev == NULL)
-    return FALSE;
-
-  if (rtp_timer_is_sooner (timer, head))
-    return TRUE;
-
-  if (rtp_timer_is_later (timer, prev))
-    return FALSE;
-
-  if (prev->timeout == head->timeout) {
-    gint prev_gap, head_gap;
-
-    prev_gap = gst_rtp_buffer_compare_seqnum (timer->seqnum, prev->seqnum);
-    head_gap = gst_rtp_buffer_compare_seqnum (head->seqnum, timer->seqnum);
-
-    if (head_gap < prev_gap)
-      return TRUE;
-  }
-
-  if (GST_CLOCK_TIME_IS_VALID (timer->timeout) &&
-      GST_CLOCK_TIME_IS_VALID (head->timeout)) {
-    prev_delta = GST_CLOCK_DIFF (timer->timeout, prev->timeout);
-    head_delta = GST_CLOCK_DIFF (head->timeout, timer->timeout);
-
-    if (head_delta < prev_delta)
-      return TRUE;
-  }
-
-  return FALSE;
-}
-
-static inline gboolean
-rtp_timer_is_closer_to_tail (RtpTimer * timer, RtpTimer * tail)
-{
-  RtpTimer *next = rtp_timer_get_next (timer);
-  GstClockTimeDiff tail_delta = 0;
-  GstClockTimeDiff next_delta = 0;
-
-  if (next == NULL)
-    return FALSE;
-
-  if (rtp_timer_is_later (timer, tail))
-    return TRUE;
-
-  if (rtp_timer_is_sooner (timer, next))
-    return FALSE;
-
-  if (tail->timeout == next->timeout) {
-    gint tail_gap, next_gap;
-
-    tail_gap = gst_rtp_buffer_compare_seqnum (timer->seqnum, tail->seqnum);
-    next_gap = gst_rtp_buffer_compare_seqnum (next->seqnum, timer->seqnum);
-
-    if (tail_gap < next_gap)
-      return TRUE;
-  }
-
-  if (GST_CLOCK_TIME_IS_VALID (timer->timeout) &&
-      GST_CLOCK_TIME_IS_VALID (next->timeout)) {
-    tail_delta = GST_CLOCK_DIFF (timer->timeout, tail->timeout);
-    next_delta = GST_CLOCK_DIFF (next->timeout, timer->timeout);
-
-    if (tail_delta < next_delta)
-      return TRUE;
-  }
-
-  return FALSE;
-}
-
 static inline RtpTimer *
 rtp_timer_queue_get_tail (RtpTimerQueue * queue)
 {
@@ -288,6 +232,113 @@ rtp_timer_queue_insert_head (RtpTimerQueue * queue, RtpTimer * timer)
     rtp_timer_queue_insert_before (queue, it, timer);
 }
 
+/* Make @timer the wheel entry for its tick */
+static void
+rtp_timer_queue_wheel_add (RtpTimerQueue * queue, RtpTimer * timer)
+{
+  guint slot;
+
+  if (!GST_CLOCK_TIME_IS_VALID (timer->timeout))
+    return;
+
+  slot = rtp_timer_get_tick (timer) & WHEEL_MASK;
+  if (queue->wheel[slot])
+    queue->wheel[slot]->wheel_slot = -1;
+
+  queue->wheel[slot] = timer;
+  timer->wheel_slot = slot;
+}
+
+static inline gboolean
+rtp_timer_queue_wheel_can_take (RtpTimer * timer, gint slot)
+{
+  return timer && timer->wheel_slot == -1 &&
+      GST_CLOCK_TIME_IS_VALID (timer->timeout) &&
+      (rtp_timer_get_tick (timer) & WHEEL_MASK) == (guint) slot;
+}
+
+/* Remove @timer from the wheel, must be called before unlinking it as one of
+ * its neighbours takes over the slot if it's in the same tick. */
+static void
+rtp_timer_queue_wheel_remove (RtpTimerQueue * queue, RtpTimer * timer)
+{
+  RtpTimer *other;
+  gint slot = timer->wheel_slot;
+
+  if (slot < 0)
+    return;
+
+  g_assert (queue->wheel[slot] == timer);
+  timer->wheel_slot = -1;
+  queue->wheel[slot] = NULL;
+
+  other = rtp_timer_get_prev (timer);
+  if (!rtp_timer_queue_wheel_can_take (other, slot))
+    other = rtp_timer_get_next (timer);
+
+  if (rtp_timer_queue_wheel_can_take (other, slot)) {
+    queue->wheel[slot] = other;
+    other->wheel_slot = slot;
+  }
+}
+
+/* Find a queued timer close to where @timer has to be inserted, that is a
+ * timer in the same tick or in the closest earlier tick. */
+static RtpTimer *
+rtp_timer_queue_wheel_find (RtpTimerQueue * queue, RtpTimer * timer)
+{
+  guint64 tick = rtp_timer_get_tick (timer);
+  guint i;
+
+  for (i = 0; i < WHEEL_MAX_SCAN && i <= tick; i++) {
+    RtpTimer *it = queue->wheel[(tick - i) & WHEEL_MASK];
+
+    /* the slot may be used by a timer one or more wheel turns away */
+    if (it && GST_CLOCK_TIME_IS_VALID (it->timeout) &&
+        rtp_timer_get_tick (it) == tick - i)
+      return it;
+  }
+
+  return NULL;
+}
+
+static void
+rtp_timer_queue_unlink (RtpTimerQueue * queue, RtpTimer * timer)
+{
+  rtp_timer_queue_wheel_remove (queue, timer);
+  g_queue_unlink (&queue->timers, (GList *) timer);
+}
+
+/* Insert @timer in the sorted list, starting from a close timer found in the
+ * wheel. The list needs to be walked when there is no timer around the new
+ * timeout, which is fast for the common case of timers scheduled later than
+ * all others. */
+static void
+rtp_timer_queue_insert_sorted (RtpTimerQueue * queue, RtpTimer * timer)
+{
+  RtpTimer *it;
+
+  if (!GST_CLOCK_TIME_IS_VALID (timer->timeout)) {
+    rtp_timer_queue_insert_head (queue, timer);
+    return;
+  }
+
+  it = rtp_timer_queue_wheel_find (queue, timer);
+  if (it == NULL) {
+    rtp_timer_queue_insert_tail (queue, timer);
+  } else if (rtp_timer_is_sooner (timer, it)) {
+    while (rtp_timer_is_sooner (timer, rtp_timer_get_prev (it)))
+      it = rtp_timer_get_prev (it);
+    rtp_timer_queue_insert_before (queue, it, timer);
+  } else {
+    while (rtp_timer_is_later (timer, rtp_timer_get_next (it)))
+      it = rtp_timer_get_next (it);
+    rtp_timer_queue_insert_after (queue, it, timer);
+  }
+
+  rtp_timer_queue_wheel_add (queue, timer);
+}
+
 static void
 rtp_timer_queue_init (RtpTimerQueue * queue)
 {
@@ -345,6 +396,7 @@ rtp_timer_dup (const RtpTimer * timer)
   memcpy (copy, timer, sizeof (RtpTimer));
   memset (&copy->list, 0, sizeof (GList));
   copy->queued = FALSE;
+  copy->wheel_slot = -1;
   return copy;
 }
 
@@ -394,9 +446,9 @@ rtp_timer_queue_new (void)
  * @timer: (transfer full): the #RtpTimer to insert
  *
  * Insert a timer into the queue. Earliest timer are at the head and then
- * timer are sorted by seqnum (smaller seqnum first). This function is o(n)
- * but it is expected that most timers added are schedule later, in which case
- * the insertion will be faster.
+ * timer are sorted by seqnum (smaller seqnum first). This function is o(1)
+ * when there are other timers within a few milliseconds of the new timer, or
+ * when it is scheduled later than all other timers, and o(n) otherwise.
  *
  * Returns: %FALSE if a timer with the same seqnum already existed
  */
@@ -411,10 +463,7 @@ rtp_timer_queue_insert (RtpTimerQueue * queue, RtpTimer * timer)
     return FALSE;
   }
 
-  if (timer->timeout == -1)
-    rtp_timer_queue_insert_head (queue, timer);
-  else
-    rtp_timer_queue_insert_tail (queue, timer);
+  rtp_timer_queue_insert_sorted (queue, timer);
 
   g_hash_table_insert (queue->hashtable,
       GINT_TO_POINTER (timer->seqnum), timer);
@@ -429,49 +478,33 @@ rtp_timer_queue_insert (RtpTimerQueue * queue, RtpTimer * timer)
  * @timer: the #RtpTimer to reschedule
  *
  * This function moves @timer inside the queue to put it back to it's new
- * location. This function is o(n) but it is assumed that nearby modification
- * of the timeout will occure.
+ * location. This has the same complexity as rtp_timer_queue_insert().
  *
  * Returns: %TRUE if the timer was moved
  */
 gboolean
 rtp_timer_queue_reschedule (RtpTimerQueue * queue, RtpTimer * timer)
 {
-  RtpTimer *it = timer;
+  RtpTimer *next;
 
   g_return_val_if_fail (timer->queued == TRUE, FALSE);
 
-  if (rtp_timer_is_closer_to_head (timer, rtp_timer_queue_get_head (queue))) {
-    g_queue_unlink (&queue->timers, (GList *) timer);
-    rtp_timer_queue_insert_head (queue, timer);
-    return TRUE;
-  }
-
-  while (rtp_timer_is_sooner (timer, rtp_timer_get_prev (it)))
-    it = rtp_timer_get_prev (it);
-
-  if (it != timer) {
-    g_queue_unlink (&queue->timers, (GList *) timer);
-    rtp_timer_queue_insert_before (queue, it, timer);
-    return TRUE;
-  }
+  /* the timer may have moved to another tick without changing place */
+  rtp_timer_queue_wheel_remove (queue, timer);
 
-  if (rtp_timer_is_closer_to_tail (timer, rtp_timer_queue_get_tail (queue))) {
-    g_queue_unlink (&queue->timers, (GList *) timer);
-    rtp_timer_queue_insert_tail (queue, timer);
-    return TRUE;
+  next = rtp_timer_get_next (timer);
+  if (!rtp_timer_is_sooner (timer, rtp_timer_get_prev (timer)) &&
+      !rtp_timer_is_later (timer, next) &&
+      (next == NULL || GST_CLOCK_TIME_IS_VALID (next->timeout) ||
+          !GST_CLOCK_TIME_IS_VALID (timer->timeout))) {
+    rtp_timer_queue_wheel_add (queue, timer);
+    return FALSE;
   }
 
-  while (rtp_timer_is_later (timer, rtp_timer_get_next (it)))
-    it = rtp_timer_get_next (it);
-
-  if (it != timer) {
-    g_queue_unlink (&queue->timers, (GList *) timer);
-    rtp_timer_queue_insert_after (queue, it, timer);
-    return TRUE;
-  }
+  g_queue_unlink (&queue->timers, (GList *) timer);
+  rtp_timer_queue_insert_sorted (queue, timer);
 
-  return FALSE;
+  return TRUE;
 }
 
 /**
@@ -487,7 +520,7 @@ rtp_timer_queue_unschedule (RtpTimerQueue * queue, RtpTimer * timer)
 {
   g_return_if_fail (timer->queued == TRUE);
 
-  g_queue_unlink (&queue->timers, (GList *) timer);
+  rtp_timer_queue_unlink (queue, timer);
   g_hash_table_remove (queue->hashtable, GINT_TO_POINTER (timer->seqnum));
   timer->queued = FALSE;
 }
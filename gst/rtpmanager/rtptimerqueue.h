@@ -58,6 +58,7 @@ typedef struct
 {
   GList list;
   gboolean queued;
+  gint wheel_slot;
 
   guint16 seqnum;
   RtpTimerType type;
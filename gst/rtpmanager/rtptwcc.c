@@ -34,6 +34,11 @@ GST_DEBUG_CATEGORY_EXTERN (rtp_session_debug);
 #define STATUS_VECTOR_MAX_CAPACITY 14
 #define STATUS_VECTOR_TWO_BIT_MAX_CAPACITY 7
 
+/* sent packets are kept in a ring indexed by twcc-seqnum, which grows up to
+   the number of possible seqnums */
+#define SENT_PACKETS_MIN_SIZE 256
+#define SENT_PACKETS_MAX_SIZE 65536
+
 typedef enum
 {
   RTP_TWCC_CHUNK_TYPE_RUN_LENGTH = 0,
@@ -51,12 +56,11 @@ typedef struct
 typedef struct
 {
   GstClockTime ts;
+  gint32 delta;
   guint16 seqnum;
-
-  gint64 delta;
-  RTPTWCCPacketStatus status;
   guint16 missing_run;
   guint equal_run;
+  guint8 status;
 } RecvPacket;
 
 typedef struct
@@ -81,11 +85,23 @@ struct _RTPTWCCManager
   guint mtu;
   guint max_packets_per_rtcp;
   GArray *recv_packets;
+  GArray *packet_chunks;
+
+  /* state of the recv packets whose delta, status and runs are computed */
+  guint recv_computed;
+  GstClockTime recv_ts_rounded;
+  guint recv_deltas_size;
+  guint recv_symbol_size;
+  gint recv_equal_idx;
 
   guint64 fb_pkt_count;
   gint32 last_seqnum;
 
-  GArray *sent_packets;
+  SentPacket *sent_packets;
+  guint sent_packets_size;
+  guint sent_packets_len;
+  guint16 sent_packets_first;
+
   GArray *parsed_packets;
   GQueue *rtcp_buffers;
 
@@ -109,7 +125,7 @@ static void
 rtp_twcc_manager_init (RTPTWCCManager * twcc)
 {
   twcc->recv_packets = g_array_new (FALSE, FALSE, sizeof (RecvPacket));
-  twcc->sent_packets = g_array_new (FALSE, FALSE, sizeof (SentPacket));
+  twcc->packet_chunks = g_array_new (FALSE, FALSE, 2);
   twcc->parsed_packets = g_array_new (FALSE, FALSE, sizeof (RecvPacket));
 
   twcc->rtcp_buffers = g_queue_new ();
@@ -130,7 +146,8 @@ rtp_twcc_manager_finalize (GObject * object)
   RTPTWCCManager *twcc = RTP_TWCC_MANAGER_CAST (object);
 
   g_array_unref (twcc->recv_packets);
-  g_array_unref (twcc->sent_packets);
+  g_array_unref (twcc->packet_chunks);
+  g_free (twcc->sent_packets);
   g_array_unref (twcc->parsed_packets);
   g_queue_free_full (twcc->rtcp_buffers, (GDestroyNotify) gst_buffer_unref);
 
@@ -223,6 +240,15 @@ rtp_twcc_manager_set_mtu (RTPTWCCManager * twcc, guint mtu)
      packet_chunk 2 bytes +  
      recv_deltas (2 * 7) 14 bytes */
   twcc->max_packets_per_rtcp = ((twcc->mtu - 32) * 7) / (2 + 14);
+
+  /* a feedback never holds more packets, so the array does not have to
+     grow while receiving */
+  if (twcc->recv_packets->len < twcc->max_packets_per_rtcp) {
+    guint len = twcc->recv_packets->len;
+
+    g_array_set_size (twcc->recv_packets, twcc->max_packets_per_rtcp);
+    g_array_set_size (twcc->recv_packets, len);
+  }
 }
 
 void
@@ -296,11 +322,9 @@ rtp_twcc_manager_get_recv_twcc_seqnum (RTPTWCCManager * twcc,
 }
 
 static gint
-_twcc_seqnum_sort (gconstpointer a, gconstpointer b)
+_twcc_seqnum_compare (guint16 seqa, guint16 seqb)
 {
-  gint32 seqa = ((RecvPacket *) a)->seqnum;
-  gint32 seqb = ((RecvPacket *) b)->seqnum;
-  gint res = seqa - seqb;
+  gint res = (gint) seqa - (gint) seqb;
   if (res < -65000)
     res = 1;
   if (res > 65000)
@@ -451,33 +475,94 @@ rtp_twcc_write_status_vector_chunk (ChunkBitWriter * writer, RecvPacket * pkt)
   chunk_bit_writer_write (writer, pkt->status);
 }
 
-typedef struct
+static void
+run_length_update (RTPTWCCManager * twcc, guint idx)
 {
+  RecvPacket *pkt = &g_array_index (twcc->recv_packets, RecvPacket, idx);
   RecvPacket *equal;
-} RunLengthHelper;
 
-static void
-run_lenght_helper_update (RunLengthHelper * rlh, RecvPacket * pkt)
-{
   /* for missing packets we reset */
   if (pkt->missing_run > 0) {
-    rlh->equal = NULL;
+    twcc->recv_equal_idx = -1;
   }
 
   /* all status equal run */
-  if (rlh->equal == NULL) {
-    rlh->equal = pkt;
-    rlh->equal->equal_run = 0;
+  if (twcc->recv_equal_idx == -1) {
+    twcc->recv_equal_idx = idx;
+    pkt->equal_run = 0;
   }
 
-  if (rlh->equal->status == pkt->status) {
-    rlh->equal->equal_run++;
+  equal = &g_array_index (twcc->recv_packets, RecvPacket,
+      twcc->recv_equal_idx);
+  if (equal->status == pkt->status) {
+    equal->equal_run++;
   } else {
-    rlh->equal = pkt;
-    rlh->equal->equal_run = 1;
+    twcc->recv_equal_idx = idx;
+    pkt->equal_run = 1;
   }
 }
 
+/* Calculates the deltas, status and runs of the packets that were stored
+   since the last call. Packets arrive in order most of the time, so this
+   is done for one packet as it arrives and the feedback only has to pack
+   the chunks. A reordered packet makes all the packets be recalculated. */
+static void
+rtp_twcc_manager_update_recv_packets (RTPTWCCManager * twcc)
+{
+  guint i;
+
+  if (twcc->recv_computed == 0 && twcc->recv_packets->len > 0) {
+    RecvPacket *first = &g_array_index (twcc->recv_packets, RecvPacket, 0);
+
+    twcc->recv_ts_rounded = (first->ts / REF_TIME_UNIT) * REF_TIME_UNIT;
+    twcc->recv_deltas_size = 0;
+    twcc->recv_symbol_size = 1;
+    twcc->recv_equal_idx = -1;
+  }
+
+  for (i = twcc->recv_computed; i < twcc->recv_packets->len; i++) {
+    RecvPacket *pkt = &g_array_index (twcc->recv_packets, RecvPacket, i);
+    GstClockTimeDiff delta_ts;
+    gint64 delta;
+    gint64 delta_ts_rounded;
+
+    pkt->missing_run = 0;
+    pkt->equal_run = 0;
+    if (i != 0) {
+      RecvPacket *prev = pkt - 1;
+      pkt->missing_run = pkt->seqnum - prev->seqnum - 1;
+    }
+
+    delta_ts = GST_CLOCK_DIFF (twcc->recv_ts_rounded, pkt->ts);
+    delta = delta_ts / DELTA_UNIT;
+    delta_ts_rounded = delta * DELTA_UNIT;
+    twcc->recv_ts_rounded += delta_ts_rounded;
+    /* only the lower 16 bits are ever written */
+    pkt->delta = delta;
+
+    if (delta_ts_rounded < 0 || delta_ts_rounded > MAX_TS_DELTA) {
+      pkt->status = RTP_TWCC_PACKET_STATUS_LARGE_NEGATIVE_DELTA;
+      twcc->recv_deltas_size += 2;
+      twcc->recv_symbol_size = 2;
+    } else {
+      pkt->status = RTP_TWCC_PACKET_STATUS_SMALL_DELTA;
+      twcc->recv_deltas_size += 1;
+    }
+    run_length_update (twcc, i);
+
+    GST_LOG ("pkt: #%u, ts: %" GST_TIME_FORMAT
+        " ts_rounded: %" GST_TIME_FORMAT
+        " delta_ts: %" GST_STIME_FORMAT
+        " delta_ts_rounded: %" GST_STIME_FORMAT
+        " missing_run: %u, status: %u", pkt->seqnum,
+        GST_TIME_ARGS (pkt->ts), GST_TIME_ARGS (twcc->recv_ts_rounded),
+        GST_STIME_ARGS (delta_ts), GST_STIME_ARGS (delta_ts_rounded),
+        pkt->missing_run, pkt->status);
+  }
+
+  twcc->recv_computed = twcc->recv_packets->len;
+}
+
 static guint
 _get_max_packets_capacity (guint symbol_size)
 {
@@ -559,27 +644,22 @@ rtp_twcc_write_chunks (GArray * packet_chunks,
 static void
 rtp_twcc_manager_add_fci (RTPTWCCManager * twcc, GstRTCPPacket * packet)
 {
-  RecvPacket *first, *last, *prev;
+  RecvPacket *first, *last;
   guint16 packet_count;
   GstClockTime base_time;
-  GstClockTime ts_rounded;
-  guint i;
-  GArray *packet_chunks = g_array_new (FALSE, FALSE, 2);
+  GArray *packet_chunks = twcc->packet_chunks;
   RTPTWCCHeader header;
   guint header_size = sizeof (RTPTWCCHeader);
   guint packet_chunks_size;
-  guint recv_deltas_size = 0;
+  guint recv_deltas_size;
   guint16 fci_length;
   guint16 fci_chunks;
   guint8 *fci_data;
   guint8 *fci_data_ptr;
-  RunLengthHelper rlh = { NULL };
-  guint symbol_size = 1;
-  GstClockTimeDiff delta_ts;
-  gint64 delta_ts_rounded;
   guint8 fb_pkt_count;
 
-  g_array_sort (twcc->recv_packets, _twcc_seqnum_sort);
+  /* the packets are stored in order and normally already calculated */
+  rtp_twcc_manager_update_recv_packets (twcc);
 
   /* get first and last packet */
   first = &g_array_index (twcc->recv_packets, RecvPacket, 0);
@@ -597,7 +677,6 @@ rtp_twcc_manager_add_fci (RTPTWCCManager * twcc, GstRTCPPacket * packet)
   GST_WRITE_UINT8 (header.fb_pkt_count, fb_pkt_count);
 
   base_time *= REF_TIME_UNIT;
-  ts_rounded = base_time;
 
   GST_DEBUG ("Created TWCC feedback: base_seqnum: #%u, packet_count: %u, "
       "base_time %" GST_TIME_FORMAT " fb_pkt_count: %u",
@@ -606,42 +685,11 @@ rtp_twcc_manager_add_fci (RTPTWCCManager * twcc, GstRTCPPacket * packet)
   twcc->fb_pkt_count++;
   twcc->expected_recv_seqnum = first->seqnum + packet_count;
 
-  /* calculate all deltas and check for gaps etc */
-  prev = first;
-  for (i = 0; i < twcc->recv_packets->len; i++) {
-    RecvPacket *pkt = &g_array_index (twcc->recv_packets, RecvPacket, i);
-    if (i != 0) {
-      pkt->missing_run = pkt->seqnum - prev->seqnum - 1;
-    }
-
-    delta_ts = GST_CLOCK_DIFF (ts_rounded, pkt->ts);
-    pkt->delta = delta_ts / DELTA_UNIT;
-    delta_ts_rounded = pkt->delta * DELTA_UNIT;
-    ts_rounded += delta_ts_rounded;
-
-    if (delta_ts_rounded < 0 || delta_ts_rounded > MAX_TS_DELTA) {
-      pkt->status = RTP_TWCC_PACKET_STATUS_LARGE_NEGATIVE_DELTA;
-      recv_deltas_size += 2;
-      symbol_size = 2;
-    } else {
-      pkt->status = RTP_TWCC_PACKET_STATUS_SMALL_DELTA;
-      recv_deltas_size += 1;
-    }
-    run_lenght_helper_update (&rlh, pkt);
-
-    GST_LOG ("pkt: #%u, ts: %" GST_TIME_FORMAT
-        " ts_rounded: %" GST_TIME_FORMAT
-        " delta_ts: %" GST_STIME_FORMAT
-        " delta_ts_rounded: %" GST_STIME_FORMAT
-        " missing_run: %u, status: %u", pkt->seqnum,
-        GST_TIME_ARGS (pkt->ts), GST_TIME_ARGS (ts_rounded),
-        GST_STIME_ARGS (delta_ts), GST_STIME_ARGS (delta_ts_rounded),
-        pkt->missing_run, pkt->status);
-    prev = pkt;
-  }
-
-  rtp_twcc_write_chunks (packet_chunks, twcc->recv_packets, symbol_size);
+  g_array_set_size (packet_chunks, 0);
+  rtp_twcc_write_chunks (packet_chunks, twcc->recv_packets,
+      twcc->recv_symbol_size);
 
+  recv_deltas_size = twcc->recv_deltas_size;
   packet_chunks_size = packet_chunks->len * 2;
   fci_length = header_size + packet_chunks_size + recv_deltas_size;
   fci_chunks = (fci_length - 1) / sizeof (guint32) + 1;
@@ -667,8 +715,8 @@ rtp_twcc_manager_add_fci (RTPTWCCManager * twcc, GstRTCPPacket * packet)
       packet_chunks_size);
   GST_MEMDUMP ("full fci:", fci_data, fci_length);
 
-  g_array_unref (packet_chunks);
   g_array_set_size (twcc->recv_packets, 0);
+  twcc->recv_computed = 0;
 }
 
 static void
@@ -735,6 +783,39 @@ _many_packets_some_lost (RTPTWCCManager * twcc, guint16 seqnum)
   return FALSE;
 }
 
+/* stores the packet in seqnum order, returns FALSE for duplicates */
+static gboolean
+rtp_twcc_manager_store_recv_packet (RTPTWCCManager * twcc,
+    RecvPacket * packet)
+{
+  guint idx = twcc->recv_packets->len;
+
+  /* find the place of the packet starting from the end, where in order
+     packets go */
+  while (idx > 0) {
+    RecvPacket *prev = &g_array_index (twcc->recv_packets, RecvPacket,
+        idx - 1);
+    gint res = _twcc_seqnum_compare (prev->seqnum, packet->seqnum);
+
+    if (res == 0)
+      return FALSE;
+    if (res < 0)
+      break;
+    idx--;
+  }
+
+  if (idx == twcc->recv_packets->len) {
+    g_array_append_val (twcc->recv_packets, *packet);
+  } else {
+    g_array_insert_val (twcc->recv_packets, idx, *packet);
+    twcc->recv_computed = 0;
+  }
+
+  rtp_twcc_manager_update_recv_packets (twcc);
+
+  return TRUE;
+}
+
 gboolean
 rtp_twcc_manager_recv_packet (RTPTWCCManager * twcc, RTPPacketInfo * pinfo)
 {
@@ -770,20 +851,12 @@ rtp_twcc_manager_recv_packet (RTPTWCCManager * twcc, RTPPacketInfo * pinfo)
     return FALSE;
   }
 
-  if (twcc->recv_packets->len > 0) {
-    RecvPacket *last = &g_array_index (twcc->recv_packets, RecvPacket,
-        twcc->recv_packets->len - 1);
-
-    diff = gst_rtp_buffer_compare_seqnum (last->seqnum, seqnum);
-    if (diff == 0) {
-      GST_INFO ("Received duplicate packet (%u), dropping", seqnum);
-      return FALSE;
-    }
-  }
-
   /* store the packet for Transport-wide RTCP feedback message */
   recv_packet_init (&packet, seqnum, pinfo);
-  g_array_append_val (twcc->recv_packets, packet);
+  if (!rtp_twcc_manager_store_recv_packet (twcc, &packet)) {
+    GST_INFO ("Received duplicate packet (%u), dropping", seqnum);
+    return FALSE;
+  }
   twcc->last_seqnum = seqnum;
 
   GST_LOG ("Receive: twcc-seqnum: %u, pt: %u, marker: %d, ts: %"
@@ -853,6 +926,63 @@ sent_packet_init (SentPacket * packet, guint16 seqnum, RTPPacketInfo * pinfo)
   packet->lost = FALSE;
 }
 
+static void
+sent_packets_grow (RTPTWCCManager * twcc)
+{
+  guint size = MAX (twcc->sent_packets_size * 2, SENT_PACKETS_MIN_SIZE);
+  SentPacket *packets = g_new (SentPacket, size);
+  guint i;
+
+  for (i = 0; i < twcc->sent_packets_len; i++) {
+    guint16 seqnum = twcc->sent_packets_first + i;
+
+    packets[seqnum & (size - 1)] =
+        twcc->sent_packets[seqnum & (twcc->sent_packets_size - 1)];
+  }
+
+  g_free (twcc->sent_packets);
+  twcc->sent_packets = packets;
+  twcc->sent_packets_size = size;
+}
+
+/* the twcc-seqnums of sent packets follow each other */
+static void
+sent_packets_push (RTPTWCCManager * twcc, SentPacket * packet)
+{
+  if (twcc->sent_packets_len == twcc->sent_packets_size) {
+    if (twcc->sent_packets_size < SENT_PACKETS_MAX_SIZE) {
+      sent_packets_grow (twcc);
+    } else {
+      /* every twcc-seqnum is waiting for feedback, forget the oldest */
+      twcc->sent_packets_first++;
+      twcc->sent_packets_len--;
+    }
+  }
+
+  if (twcc->sent_packets_len == 0)
+    twcc->sent_packets_first = packet->seqnum;
+
+  twcc->sent_packets[packet->seqnum & (twcc->sent_packets_size - 1)] =
+      *packet;
+  twcc->sent_packets_len++;
+}
+
+static SentPacket *
+sent_packets_lookup (RTPTWCCManager * twcc, guint16 seqnum)
+{
+  guint16 idx = seqnum - twcc->sent_packets_first;
+  SentPacket *packet;
+
+  if (idx >= twcc->sent_packets_len)
+    return NULL;
+
+  packet = &twcc->sent_packets[seqnum & (twcc->sent_packets_size - 1)];
+  if (packet->seqnum != seqnum)
+    return NULL;
+
+  return packet;
+}
+
 void
 rtp_twcc_manager_send_packet (RTPTWCCManager * twcc, RTPPacketInfo * pinfo)
 {
@@ -865,8 +995,7 @@ rtp_twcc_manager_send_packet (RTPTWCCManager * twcc, RTPPacketInfo * pinfo)
   seqnum = rtp_twcc_manager_set_send_twcc_seqnum (twcc, pinfo);
 
   sent_packet_init (&packet, seqnum, pinfo);
-  g_array_append_val (twcc->sent_packets, packet);
-
+  sent_packets_push (twcc, &packet);
 
   GST_LOG ("Send: twcc-seqnum: %u, pt: %u, marker: %d, ts: %"
       GST_TIME_FORMAT, seqnum, pinfo->pt, pinfo->marker,
@@ -934,20 +1063,20 @@ _parse_status_vector_chunk (GstBitReader * reader, GArray * twcc_packets,
 static void
 _prune_sent_packets (RTPTWCCManager * twcc, GArray * twcc_packets)
 {
-  SentPacket *first;
   RTPTWCCPacket *last;
   guint16 last_idx;
 
-  if (twcc_packets->len == 0 || twcc->sent_packets->len == 0)
+  if (twcc_packets->len == 0 || twcc->sent_packets_len == 0)
     return;
 
-  first = &g_array_index (twcc->sent_packets, SentPacket, 0);
   last = &g_array_index (twcc_packets, RTPTWCCPacket, twcc_packets->len - 1);
 
-  last_idx = last->seqnum - first->seqnum;
+  last_idx = last->seqnum - twcc->sent_packets_first;
 
-  if (last_idx < twcc->sent_packets->len)
-    g_array_remove_range (twcc->sent_packets, 0, last_idx);
+  if (last_idx < twcc->sent_packets_len) {
+    twcc->sent_packets_first += last_idx;
+    twcc->sent_packets_len -= last_idx;
+  }
 }
 
 static void
@@ -1014,7 +1143,6 @@ rtp_twcc_manager_parse_fci (RTPTWCCManager * twcc,
   guint packets_parsed = 0;
   guint fci_parsed;
   guint i;
-  SentPacket *first_sent_pkt = NULL;
 
   if (fci_length < 10) {
     GST_WARNING ("Malformed TWCC RTCP feedback packet");
@@ -1055,14 +1183,12 @@ rtp_twcc_manager_parse_fci (RTPTWCCManager * twcc,
     fci_parsed += 2;
   }
 
-  if (twcc->sent_packets->len > 0)
-    first_sent_pkt = &g_array_index (twcc->sent_packets, SentPacket, 0);
-
   ts_rounded = base_time;
   for (i = 0; i < twcc_packets->len; i++) {
     RTPTWCCPacket *pkt = &g_array_index (twcc_packets, RTPTWCCPacket, i);
     gint16 delta = 0;
     GstClockTimeDiff delta_ts;
+    SentPacket *found;
 
     if (pkt->status == RTP_TWCC_PACKET_STATUS_SMALL_DELTA) {
       delta = fci_data[fci_parsed];
@@ -1090,23 +1216,18 @@ rtp_twcc_manager_parse_fci (RTPTWCCManager * twcc,
           pkt->status);
     }
 
-    if (first_sent_pkt) {
-      SentPacket *found = NULL;
-      guint16 sent_idx = pkt->seqnum - first_sent_pkt->seqnum;
-      if (sent_idx < twcc->sent_packets->len)
-        found = &g_array_index (twcc->sent_packets, SentPacket, sent_idx);
-      if (found && found->seqnum == pkt->seqnum) {
-        if (GST_CLOCK_TIME_IS_VALID (found->socket_ts)) {
-          pkt->local_ts = found->socket_ts;
-        } else {
-          pkt->local_ts = found->ts;
-        }
-        pkt->size = found->size;
-        pkt->pt = found->pt;
-
-        GST_LOG ("matching pkt: #%u with local_ts: %" GST_TIME_FORMAT
-            " size: %u", pkt->seqnum, GST_TIME_ARGS (pkt->local_ts), pkt->size);
+    found = sent_packets_lookup (twcc, pkt->seqnum);
+    if (found) {
+      if (GST_CLOCK_TIME_IS_VALID (found->socket_ts)) {
+        pkt->local_ts = found->socket_ts;
+      } else {
+        pkt->local_ts = found->ts;
       }
+      pkt->size = found->size;
+      pkt->pt = found->pt;
+
+      GST_LOG ("matching pkt: #%u with local_ts: %" GST_TIME_FORMAT
+          " size: %u", pkt->seqnum, GST_TIME_ARGS (pkt->local_ts), pkt->size);
     }
   }
 
@@ -116,6 +116,7 @@
 
 #include "gstrtspelements.h"
 #include "gstrtspsrc.h"
+#include "gstrtspworker.h"
 
 GST_DEBUG_CATEGORY_STATIC (rtspsrc_debug);
 #define GST_CAT_DEFAULT (rtspsrc_debug)
@@ -293,6 +294,14 @@ gst_rtsp_backchannel_get_type (void)
 #define DEFAULT_ONVIF_RATE_CONTROL TRUE
 #define DEFAULT_IS_LIVE TRUE
 #define DEFAULT_IGNORE_X_SERVER_REPLY FALSE
+#define DEFAULT_INTERLEAVED_CHUNK_SIZE 0
+#define DEFAULT_SHARED_LOOP FALSE
+#define DEFAULT_PIPELINE_REQUESTS FALSE
+#define DEFAULT_CACHE_SDP FALSE
+
+/* large enough for the biggest interleaved frame */
+#define MIN_INTERLEAVED_CHUNK_SIZE (4 + G_MAXUINT16)
+#define MAX_FREE_CHUNKS 4
 
 enum
 {
@@ -341,7 +350,11 @@ enum
   PROP_ONVIF_MODE,
   PROP_ONVIF_RATE_CONTROL,
   PROP_IS_LIVE,
-  PROP_IGNORE_X_SERVER_REPLY
+  PROP_IGNORE_X_SERVER_REPLY,
+  PROP_INTERLEAVED_CHUNK_SIZE,
+  PROP_SHARED_LOOP,
+  PROP_PIPELINE_REQUESTS,
+  PROP_CACHE_SDP
 };
 
 #define GST_TYPE_RTSP_NAT_METHOD (gst_rtsp_nat_method_get_type())
@@ -410,6 +423,8 @@ static GstRTSPResult gst_rtspsrc_open (GstRTSPSrc * src, gboolean async);
 static GstRTSPResult gst_rtspsrc_play (GstRTSPSrc * src, GstSegment * segment,
     gboolean async, const gchar * seek_style);
 static GstRTSPResult gst_rtspsrc_pause (GstRTSPSrc * src, gboolean async);
+static void gst_rtspsrc_pipeline_play (GstRTSPSrc * src,
+    const gchar * pipelined_request_id);
 static GstRTSPResult gst_rtspsrc_close (GstRTSPSrc * src, gboolean async,
     gboolean only_close);
 
@@ -419,6 +434,9 @@ static gchar *gst_rtspsrc_uri_get_uri (GstURIHandler * handler);
 
 static gboolean gst_rtspsrc_activate_streams (GstRTSPSrc * src);
 static gboolean gst_rtspsrc_loop (GstRTSPSrc * src);
+static void gst_rtspsrc_thread (GstRTSPSrc * src);
+static void gst_rtspsrc_schedule_dispatch (GstRTSPSrc * src);
+static void gst_rtspsrc_watch_start (GstRTSPSrc * src);
 static gboolean gst_rtspsrc_stream_push_event (GstRTSPSrc * src,
     GstRTSPStream * stream, GstEvent * event);
 static gboolean gst_rtspsrc_push_event (GstRTSPSrc * src, GstEvent * event);
@@ -1043,6 +1061,90 @@ gst_rtspsrc_class_init (GstRTSPSrcClass * klass)
           DEFAULT_IGNORE_X_SERVER_REPLY,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRTSPSrc:interleaved-chunk-size
+   *
+   * When receiving RTP and RTCP interleaved in the RTSP connection over TCP,
+   * read all the data that is available into chunks of this size and push
+   * the frames downstream as buffer lists of sub-buffers of the chunks,
+   * instead of allocating a message and a buffer for every frame. Sizes
+   * smaller than the largest possible frame are rounded up. This is not
+   * done for tunneled or TLS connections.
+   *
+   * 0 reads one frame at a time.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_INTERLEAVED_CHUNK_SIZE,
+      g_param_spec_uint ("interleaved-chunk-size", "Interleaved chunk size",
+          "Size of the chunks that interleaved data is read into over TCP "
+          "(0 = one frame at a time)", 0, G_MAXUINT,
+          DEFAULT_INTERLEAVED_CHUNK_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRTSPSrc:shared-loop
+   *
+   * Handle the RTSP connection from a small pool of threads that is shared by
+   * all rtspsrc elements with this property enabled, instead of from a
+   * thread per element. The RTP and RTCP data that is interleaved in the
+   * connection is handled from the shared threads when it is read in chunks,
+   * see #GstRTSPSrc:interleaved-chunk-size. Commands, server messages and
+   * everything else that can wait for the server run from a separate pool
+   * of threads that only exist while there is such work. Tunneled and TLS
+   * connections always use their own thread.
+   *
+   * This does not change the threads of the other elements: with UDP
+   * transport, each udpsrc and the jitterbuffers of the session still have
+   * their own threads.
+   *
+   * This only has an effect when changing to the READY state.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_SHARED_LOOP,
+      g_param_spec_boolean ("shared-loop", "Shared loop",
+          "Handle the connection from threads shared with other elements",
+          DEFAULT_SHARED_LOOP, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRTSPSrc:pipeline-requests
+   *
+   * Send the SETUP requests of all streams without waiting for the reply to
+   * the previous one, once the first SETUP has established the session and
+   * the transport. When the streams are interleaved in the TCP connection,
+   * the server supports aggregate control and the element is about to start
+   * playing, the PLAY request is sent along with them. This saves a round
+   * trip per request when starting a session. RTSP 2.0 sessions always
+   * pipeline their SETUP requests.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_PIPELINE_REQUESTS,
+      g_param_spec_boolean ("pipeline-requests", "Pipeline requests",
+          "Send SETUP and PLAY requests without waiting for previous replies",
+          DEFAULT_PIPELINE_REQUESTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRTSPSrc:cache-sdp
+   *
+   * Remember the SDP and the supported methods of the last session per URL,
+   * in a cache shared by all rtspsrc elements with this property enabled.
+   * Opening a URL that is in the cache, including when reconnecting, skips
+   * the OPTIONS and DESCRIBE requests. Entries are also specific to the
+   * credentials, #GstRTSPSrc:backchannel, #GstRTSPSrc:onvif-mode and
+   * #GstRTSPSrc:user-agent, which can change the reply of the server. When
+   * the session can't be set up from a cached description, it is removed
+   * from the cache.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_CACHE_SDP,
+      g_param_spec_boolean ("cache-sdp", "Cache SDP",
+          "Reuse the SDP of the last session with the same URL and settings",
+          DEFAULT_CACHE_SDP, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstRTSPSrc::handle-request:
    * @rtspsrc: a #GstRTSPSrc
@@ -1448,6 +1550,10 @@ gst_rtspsrc_init (GstRTSPSrc * src)
   src->onvif_mode = DEFAULT_ONVIF_MODE;
   src->onvif_rate_control = DEFAULT_ONVIF_RATE_CONTROL;
   src->is_live = DEFAULT_IS_LIVE;
+  src->interleaved_chunk_size = DEFAULT_INTERLEAVED_CHUNK_SIZE;
+  src->shared_loop = DEFAULT_SHARED_LOOP;
+  src->pipeline_requests = DEFAULT_PIPELINE_REQUESTS;
+  src->cache_sdp = DEFAULT_CACHE_SDP;
   src->seek_seqnum = GST_SEQNUM_INVALID;
   src->group_id = GST_GROUP_ID_INVALID;
 
@@ -1475,6 +1581,9 @@ gst_rtspsrc_init (GstRTSPSrc * src)
 
   g_mutex_init (&src->group_lock);
 
+  src->interleaved_cancellable = g_cancellable_new ();
+  g_queue_init (&src->free_chunks);
+
   GST_OBJECT_FLAG_SET (src, GST_ELEMENT_FLAG_SOURCE);
   gst_bin_set_suppressed_flags (GST_BIN (src),
       GST_ELEMENT_FLAG_SOURCE | GST_ELEMENT_FLAG_SINK);
@@ -1522,6 +1631,9 @@ gst_rtspsrc_finalize (GObject * object)
   if (rtspsrc->tls_interaction)
     g_object_unref (rtspsrc->tls_interaction);
 
+  gst_rtspsrc_free_chunks (rtspsrc);
+  g_object_unref (rtspsrc->interleaved_cancellable);
+
   /* free locks */
   g_rec_mutex_clear (&rtspsrc->stream_rec_lock);
   g_rec_mutex_clear (&rtspsrc->state_rec_lock);
@@ -1789,6 +1901,18 @@ gst_rtspsrc_set_property (GObject * object, guint prop_id, const GValue * value,
     case PROP_IGNORE_X_SERVER_REPLY:
       rtspsrc->ignore_x_server_reply = g_value_get_boolean (value);
       break;
+    case PROP_INTERLEAVED_CHUNK_SIZE:
+      rtspsrc->interleaved_chunk_size = g_value_get_uint (value);
+      break;
+    case PROP_SHARED_LOOP:
+      rtspsrc->shared_loop = g_value_get_boolean (value);
+      break;
+    case PROP_PIPELINE_REQUESTS:
+      rtspsrc->pipeline_requests = g_value_get_boolean (value);
+      break;
+    case PROP_CACHE_SDP:
+      rtspsrc->cache_sdp = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1959,6 +2083,18 @@ gst_rtspsrc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_IGNORE_X_SERVER_REPLY:
       g_value_set_boolean (value, rtspsrc->ignore_x_server_reply);
       break;
+    case PROP_INTERLEAVED_CHUNK_SIZE:
+      g_value_set_uint (value, rtspsrc->interleaved_chunk_size);
+      break;
+    case PROP_SHARED_LOOP:
+      g_value_set_boolean (value, rtspsrc->shared_loop);
+      break;
+    case PROP_PIPELINE_REQUESTS:
+      g_value_set_boolean (value, rtspsrc->pipeline_requests);
+      break;
+    case PROP_CACHE_SDP:
+      g_value_set_boolean (value, rtspsrc->cache_sdp);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2503,6 +2639,8 @@ gst_rtspsrc_cleanup (GstRTSPSrc * src)
   g_free (src->control);
   src->control = NULL;
 
+  src->pipelined_play = FALSE;
+
   if (src->range)
     gst_rtsp_range_free (src->range);
   src->range = NULL;
@@ -5268,6 +5406,10 @@ gst_rtspsrc_connection_flush (GstRTSPSrc * src, gboolean flush)
   if (src->conninfo.connection && src->conninfo.flushing != flush) {
     GST_DEBUG_OBJECT (src, "connection flush");
     gst_rtsp_connection_flush (src->conninfo.connection, flush);
+    if (flush)
+      g_cancellable_cancel (src->interleaved_cancellable);
+    else
+      g_cancellable_reset (src->interleaved_cancellable);
     src->conninfo.flushing = flush;
   }
   for (walk = src->streams; walk; walk = g_list_next (walk)) {
@@ -5405,66 +5547,46 @@ send_error:
   }
 }
 
-static GstFlowReturn
-gst_rtspsrc_handle_data (GstRTSPSrc * src, GstRTSPMessage * message)
+/* finds the pad to push the data received on @channel to, or %NULL when the
+ * data is not for us */
+static GstPad *
+gst_rtspsrc_get_channel_pad (GstRTSPSrc * src, gint channel,
+    const guint8 * data, gsize size, GstRTSPStream ** stream_out,
+    gboolean * is_rtcp)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
-  gint channel;
   GstRTSPStream *stream;
   GstPad *outpad = NULL;
-  guint8 *data;
-  guint size;
-  GstBuffer *buf;
-  gboolean is_rtcp;
-
-  channel = message->type_data.data.channel;
 
   stream = find_stream (src, &channel, (gpointer) find_stream_by_channel);
   if (!stream)
-    goto unknown_stream;
+    return NULL;
 
   if (channel == stream->channel[0]) {
     outpad = stream->channelpad[0];
-    is_rtcp = FALSE;
+    *is_rtcp = FALSE;
   } else if (channel == stream->channel[1]) {
     outpad = stream->channelpad[1];
-    is_rtcp = TRUE;
+    *is_rtcp = TRUE;
   } else {
-    is_rtcp = FALSE;
+    *is_rtcp = FALSE;
   }
 
-  /* take a look at the body to figure out what we have */
-  gst_rtsp_message_get_body (message, &data, &size);
-  if (size < 2)
-    goto invalid_length;
-
   /* channels are not correct on some servers, do extra check */
   if (data[1] >= 200 && data[1] <= 204) {
     /* hmm RTCP message switch to the RTCP pad of the same stream. */
     outpad = stream->channelpad[1];
-    is_rtcp = TRUE;
+    *is_rtcp = TRUE;
   }
 
-  /* we have no clue what this is, just ignore then. */
-  if (outpad == NULL)
-    goto unknown_stream;
-
-  /* take the message body for further processing */
-  gst_rtsp_message_steal_body (message, &data, &size);
-
-  /* strip the trailing \0 */
-  size -= 1;
-
-  buf = gst_buffer_new ();
-  gst_buffer_append_memory (buf,
-      gst_memory_new_wrapped (0, data, size, 0, size, data, g_free));
-
-  /* don't need message anymore */
-  gst_rtsp_message_unset (message);
-
-  GST_DEBUG_OBJECT (src, "pushing data of size %d on channel %d", size,
-      channel);
+  *stream_out = stream;
+  return outpad;
+}
 
+/* activates the streams and sends the events needed before the first data
+ * of @stream */
+static void
+gst_rtspsrc_prepare_data (GstRTSPSrc * src, GstRTSPStream * stream)
+{
   if (src->need_activate) {
     gchar *stream_id;
     GstEvent *event;
@@ -5600,30 +5722,94 @@ gst_rtspsrc_handle_data (GstRTSPSrc * src, GstRTSPMessage * message)
 
     stream->need_caps = FALSE;
   }
+}
+
+/* pushes @buf, or @list when @buf is %NULL, received on the interleaved
+ * connection for @stream */
+static GstFlowReturn
+gst_rtspsrc_push_data (GstRTSPSrc * src, GstRTSPStream * stream,
+    GstPad * outpad, gboolean is_rtcp, GstBuffer * buf, GstBufferList * list)
+{
+  GstFlowReturn ret;
+
+  gst_rtspsrc_prepare_data (src, stream);
 
   if (stream->discont && !is_rtcp) {
+    GstBuffer *first = buf ? buf : gst_buffer_list_get_writable (list, 0);
+
     /* mark first RTP buffer as discont */
-    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+    GST_BUFFER_FLAG_SET (first, GST_BUFFER_FLAG_DISCONT);
     stream->discont = FALSE;
     /* first buffer gets the timestamp, other buffers are not timestamped and
      * their presentation time will be interpollated from the rtp timestamps. */
     GST_DEBUG_OBJECT (src, "setting timestamp %" GST_TIME_FORMAT,
         GST_TIME_ARGS (src->base_time));
 
-    GST_BUFFER_TIMESTAMP (buf) = src->base_time;
+    GST_BUFFER_TIMESTAMP (first) = src->base_time;
   }
 
   /* chain to the peer pad */
-  if (GST_PAD_IS_SINK (outpad))
-    ret = gst_pad_chain (outpad, buf);
-  else
-    ret = gst_pad_push (outpad, buf);
+  if (buf) {
+    if (GST_PAD_IS_SINK (outpad))
+      ret = gst_pad_chain (outpad, buf);
+    else
+      ret = gst_pad_push (outpad, buf);
+  } else {
+    if (GST_PAD_IS_SINK (outpad))
+      ret = gst_pad_chain_list (outpad, list);
+    else
+      ret = gst_pad_push_list (outpad, list);
+  }
 
   if (!is_rtcp) {
     /* combine all stream flows for the data transport */
     ret = gst_rtspsrc_combine_flows (src, stream, ret);
   }
   return ret;
+}
+
+static GstFlowReturn
+gst_rtspsrc_handle_data (GstRTSPSrc * src, GstRTSPMessage * message)
+{
+  gint channel;
+  GstRTSPStream *stream = NULL;
+  GstPad *outpad;
+  guint8 *data;
+  guint size;
+  GstBuffer *buf;
+  gboolean is_rtcp;
+
+  channel = message->type_data.data.channel;
+
+  /* take a look at the body to figure out what we have */
+  gst_rtsp_message_get_body (message, &data, &size);
+  if (size < 2)
+    goto invalid_length;
+
+  outpad = gst_rtspsrc_get_channel_pad (src, channel, data, size, &stream,
+      &is_rtcp);
+
+  /* we have no clue what this is, just ignore then. */
+  if (outpad == NULL)
+    goto unknown_stream;
+
+  /* take the message body for further processing */
+  gst_rtsp_message_steal_body (message, &data, &size);
+
+  /* strip the trailing \0 */
+  size -= 1;
+
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf,
+      gst_memory_new_wrapped (0, data, size, 0, size, data, g_free));
+
+  /* don't need message anymore */
+  gst_rtsp_message_unset (message);
+
+  GST_DEBUG_OBJECT (src, "pushing data of size %d on channel %d", size,
+      channel);
+
+  return gst_rtspsrc_push_data (src, stream, outpad, is_rtcp, buf, NULL);
 
   /* ERRORS */
 unknown_stream:
@@ -5641,24 +5827,318 @@ invalid_length:
   }
 }
 
+/* whether the connection reads straight from its socket, without tunneling
+ * or TLS in between */
+static gboolean
+gst_rtspsrc_connection_is_plain (GstRTSPSrc * src)
+{
+  if (src->conninfo.connection == NULL)
+    return FALSE;
+
+  if (gst_rtsp_connection_is_tunneled (src->conninfo.connection))
+    return FALSE;
+
+  if (src->conninfo.url &&
+      (src->conninfo.url->transports & GST_RTSP_LOWER_TRANS_TLS))
+    return FALSE;
+
+  return TRUE;
+}
+
+/* chunked reads are only done on plain TCP connections, where the socket
+ * is what the connection reads from */
+static gboolean
+gst_rtspsrc_use_chunks (GstRTSPSrc * src)
+{
+  return src->interleaved_chunk_size > 0 &&
+      gst_rtspsrc_connection_is_plain (src);
+}
+
+static void
+gst_rtspsrc_retire_chunk (GstRTSPSrc * src)
+{
+  if (src->chunk == NULL)
+    return;
+
+  gst_memory_unmap (src->chunk, &src->chunk_map);
+  if (g_queue_get_length (&src->free_chunks) < MAX_FREE_CHUNKS)
+    g_queue_push_tail (&src->free_chunks, src->chunk);
+  else
+    gst_memory_unref (src->chunk);
+  src->chunk = NULL;
+}
+
+static gboolean
+gst_rtspsrc_acquire_chunk (GstRTSPSrc * src)
+{
+  gsize size = MAX (src->interleaved_chunk_size, MIN_INTERLEAVED_CHUNK_SIZE);
+  GstMemory *mem = NULL;
+  GList *walk, *next;
+
+  /* reuse a chunk when all buffers that were sliced out of it are gone */
+  for (walk = src->free_chunks.head; walk; walk = next) {
+    GstMemory *m = walk->data;
+
+    next = walk->next;
+    if (m->size != size) {
+      g_queue_delete_link (&src->free_chunks, walk);
+      gst_memory_unref (m);
+    } else if (GST_MINI_OBJECT_REFCOUNT_VALUE (m) == 1) {
+      g_queue_delete_link (&src->free_chunks, walk);
+      mem = m;
+      break;
+    }
+  }
+  /* chunks come from the system allocator, so the data of a chunk that is
+   * unmapped again while frames still point into it stays in place */
+  if (mem == NULL)
+    mem = gst_allocator_alloc (NULL, size, NULL);
+
+  if (!gst_memory_map (mem, &src->chunk_map, GST_MAP_WRITE)) {
+    gst_memory_unref (mem);
+    return FALSE;
+  }
+  src->chunk = mem;
+  src->chunk_offset = 0;
+
+  return TRUE;
+}
+
+static void
+gst_rtspsrc_free_chunks (GstRTSPSrc * src)
+{
+  GstMemory *mem;
+
+  gst_rtspsrc_retire_chunk (src);
+  while ((mem = g_queue_pop_head (&src->free_chunks)))
+    gst_memory_unref (mem);
+}
+
+/* returns the size of the complete interleaved frames at the start of @data */
+static gsize
+gst_rtspsrc_scan_frames (const guint8 * data, gsize size)
+{
+  gsize offset = 0;
+
+  while (offset + 4 <= size && data[offset] == '$') {
+    gsize len = GST_READ_UINT16_BE (data + offset + 2);
+
+    if (offset + 4 + len > size)
+      break;
+    offset += 4 + len;
+  }
+  return offset;
+}
+
+static GstRTSPResult
+gst_rtspsrc_socket_result (GstRTSPSrc * src, GError * err)
+{
+  GstRTSPResult res;
+
+  GST_DEBUG_OBJECT (src, "socket error: %s", err->message);
+  if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_TIMED_OUT))
+    res = GST_RTSP_ETIMEOUT;
+  else if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    res = GST_RTSP_EINTR;
+  else
+    res = GST_RTSP_ESYS;
+  g_error_free (err);
+
+  return res;
+}
+
+/* reads all complete interleaved frames that are available on the connection
+ * into one chunk of memory and pushes them downstream as sub-buffers, grouped
+ * in buffer lists. Anything that is not a complete interleaved frame, like
+ * RTSP messages from the server, is left on the connection and @n_frames is
+ * set to 0 so that it can be read with gst_rtspsrc_connection_receive(). */
+static GstRTSPResult
+gst_rtspsrc_receive_chunk (GstRTSPSrc * src, GstFlowReturn * flow,
+    guint * n_frames)
+{
+  GstRTSPResult res = GST_RTSP_OK;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GSocket *socket;
+  GInputVector vector;
+  gint flags;
+  GError *err = NULL;
+  gssize received;
+  gsize avail, size, pos, base;
+  guint8 *data;
+  GstBufferList *list = NULL;
+  GstRTSPStream *list_stream = NULL;
+  GstPad *list_pad = NULL;
+  gboolean list_is_rtcp = FALSE;
+  guint n = 0;
+
+  g_mutex_lock (&src->conninfo.recv_lock);
+  socket = gst_rtsp_connection_get_read_socket (src->conninfo.connection);
+  if (socket == NULL)
+    goto done;
+
+  if (!g_socket_condition_timed_wait (socket, G_IO_IN,
+          src->tcp_timeout ? (gint64) src->tcp_timeout : -1,
+          src->interleaved_cancellable, &err))
+    goto socket_error;
+
+  while (TRUE) {
+    if (src->chunk && src->chunk_offset == src->chunk_map.size)
+      gst_rtspsrc_retire_chunk (src);
+    if (src->chunk == NULL && !gst_rtspsrc_acquire_chunk (src))
+      goto done;
+
+    base = src->chunk_offset;
+    data = src->chunk_map.data + base;
+    avail = src->chunk_map.size - base;
+
+    /* look at what is there without taking it from the connection yet */
+    vector.buffer = data;
+    vector.size = avail;
+    flags = G_SOCKET_MSG_PEEK;
+    received = g_socket_receive_message (socket, NULL, &vector, 1, NULL, NULL,
+        &flags, NULL, &err);
+    if (received < 0)
+      goto socket_error;
+    if (received == 0) {
+      res = GST_RTSP_EEOF;
+      goto done;
+    }
+
+    size = gst_rtspsrc_scan_frames (data, received);
+    if (size > 0)
+      break;
+
+    /* the first frame might not fit in what is left of the chunk */
+    if (base == 0 || (gsize) received < avail)
+      goto done;
+
+    gst_rtspsrc_retire_chunk (src);
+  }
+
+  /* now take exactly the complete frames, they end up in the same place */
+  for (pos = 0; pos < size; pos += received) {
+    received = g_socket_receive (socket, (gchar *) data + pos, size - pos,
+        NULL, &err);
+    if (received < 0)
+      goto socket_error;
+    if (received == 0) {
+      res = GST_RTSP_EEOF;
+      goto done;
+    }
+  }
+  src->chunk_offset += size;
+  g_mutex_unlock (&src->conninfo.recv_lock);
+
+  for (pos = 0; pos < size && ret == GST_FLOW_OK;) {
+    gint channel = data[pos + 1];
+    guint len = GST_READ_UINT16_BE (data + pos + 2);
+    GstRTSPStream *stream = NULL;
+    GstPad *outpad;
+    gboolean is_rtcp = FALSE;
+    GstBuffer *buf;
+
+    pos += 4;
+    n++;
+
+    if (len < 2) {
+      GST_ELEMENT_WARNING (src, RESOURCE, READ, (NULL),
+          ("Short message received, ignoring."));
+      pos += len;
+      continue;
+    }
+
+    outpad = gst_rtspsrc_get_channel_pad (src, channel, data + pos, len,
+        &stream, &is_rtcp);
+
+    if (list && outpad != list_pad) {
+      ret = gst_rtspsrc_push_data (src, list_stream, list_pad, list_is_rtcp,
+          NULL, list);
+      list = NULL;
+    }
+
+    if (outpad == NULL) {
+      GST_DEBUG_OBJECT (src, "unknown stream on channel %d, ignored", channel);
+    } else if (ret == GST_FLOW_OK) {
+      if (list == NULL) {
+        list = gst_buffer_list_new ();
+        list_stream = stream;
+        list_pad = outpad;
+        list_is_rtcp = is_rtcp;
+      }
+
+      GST_LOG_OBJECT (src, "adding data of size %u on channel %d", len,
+          channel);
+
+      /* the chunk stays mapped writable to receive more frames in what is
+       * left of it, which gst_memory_share() refuses. Wrap the frame instead,
+       * keeping the chunk alive and out of reuse until the buffer is gone */
+      buf = gst_buffer_new ();
+      gst_buffer_append_memory (buf,
+          gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+              src->chunk_map.data, src->chunk_map.size, base + pos, len,
+              gst_memory_ref (src->chunk), (GDestroyNotify) gst_memory_unref));
+      gst_buffer_list_add (list, buf);
+    }
+    pos += len;
+  }
+
+  if (list) {
+    if (ret == GST_FLOW_OK)
+      ret = gst_rtspsrc_push_data (src, list_stream, list_pad, list_is_rtcp,
+          NULL, list);
+    else
+      gst_buffer_list_unref (list);
+  }
+
+  GST_DEBUG_OBJECT (src, "handled %u frames of %" G_GSIZE_FORMAT " bytes", n,
+      size);
+
+  *flow = ret;
+  *n_frames = n;
+
+  return GST_RTSP_OK;
+
+socket_error:
+  res = gst_rtspsrc_socket_result (src, err);
+done:
+  g_mutex_unlock (&src->conninfo.recv_lock);
+  *flow = GST_FLOW_OK;
+  *n_frames = 0;
+
+  return res;
+}
+
+/* receives and handles data and messages from the server, until an error
+ * or after one message when @once is set */
 static GstFlowReturn
-gst_rtspsrc_loop_interleaved (GstRTSPSrc * src)
+gst_rtspsrc_loop_interleaved (GstRTSPSrc * src, gboolean once)
 {
   GstRTSPMessage message = { 0 };
   GstRTSPResult res;
   GstFlowReturn ret = GST_FLOW_OK;
+  guint n_frames;
 
-  while (TRUE) {
+  do {
     gst_rtsp_message_unset (&message);
 
     if (src->conninfo.flushing) {
       /* do not attempt to receive if flushing */
       res = GST_RTSP_EINTR;
     } else {
+      res = GST_RTSP_OK;
+      if (gst_rtspsrc_use_chunks (src)) {
+        res = gst_rtspsrc_receive_chunk (src, &ret, &n_frames);
+        if (res == GST_RTSP_OK && n_frames > 0) {
+          if (ret != GST_FLOW_OK)
+            goto handle_data_failed;
+          continue;
+        }
+      }
       /* protect the connection with the connection lock so that we can see when
        * we are finished doing server communication */
-      res = gst_rtspsrc_connection_receive (src, &src->conninfo, &message,
-          src->tcp_timeout);
+      if (res == GST_RTSP_OK)
+        res = gst_rtspsrc_connection_receive (src, &src->conninfo, &message,
+            src->tcp_timeout);
     }
 
     switch (res) {
@@ -5706,8 +6186,10 @@ gst_rtspsrc_loop_interleaved (GstRTSPSrc * src)
             message.type);
         break;
     }
-  }
-  g_assert_not_reached ();
+  } while (!once);
+
+  gst_rtsp_message_unset (&message);
+  return GST_FLOW_OK;
 
   /* ERRORS */
 server_eof:
@@ -5753,14 +6235,18 @@ handle_data_failed:
   }
 }
 
+/* handles messages from the server and keeps the session alive, until an
+ * error or after one message when @once is set */
 static GstFlowReturn
-gst_rtspsrc_loop_udp (GstRTSPSrc * src)
+gst_rtspsrc_loop_udp (GstRTSPSrc * src, gboolean once)
 {
   GstRTSPResult res;
   GstRTSPMessage message = { 0 };
-  gint retry = 0;
 
-  while (TRUE) {
+  if (!once)
+    src->loop_auth_retry = 0;
+
+  do {
     gint64 timeout;
 
     /* get the next timeout interval */
@@ -5831,13 +6317,14 @@ gst_rtspsrc_loop_udp (GstRTSPSrc * src)
         DEBUG_RTSP (src, &message);
         if (message.type_data.response.code == GST_RTSP_STS_UNAUTHORIZED) {
           GST_DEBUG_OBJECT (src, "but is Unauthorized response ...");
-          if (gst_rtspsrc_setup_auth (src, &message) && !(retry++)) {
+          if (gst_rtspsrc_setup_auth (src, &message) &&
+              !(src->loop_auth_retry++)) {
             GST_DEBUG_OBJECT (src, "so retrying keep-alive");
             if ((res = gst_rtspsrc_send_keep_alive (src)) == GST_RTSP_EINTR)
               goto interrupt;
           }
         } else {
-          retry = 0;
+          src->loop_auth_retry = 0;
         }
         break;
       case GST_RTSP_MESSAGE_DATA:
@@ -5849,8 +6336,10 @@ gst_rtspsrc_loop_udp (GstRTSPSrc * src)
             message.type);
         break;
     }
-  }
-  g_assert_not_reached ();
+  } while (!once);
+
+  gst_rtsp_message_unset (&message);
+  return GST_FLOW_OK;
 
   /* we get here when the connection got interrupted */
 interrupt:
@@ -6158,6 +6647,8 @@ gst_rtspsrc_loop_send_cmd (GstRTSPSrc * src, gint cmd, gint mask)
   }
   if (src->task)
     gst_task_start (src->task);
+  else if (src->loop_context)
+    gst_rtspsrc_schedule_dispatch (src);
   GST_OBJECT_UNLOCK (src);
 
   return flushed;
@@ -6185,6 +6676,35 @@ gst_rtspsrc_loop_send_cmd_and_wait (GstRTSPSrc * src, gint cmd, gint mask,
   return flushed;
 }
 
+/* stops streaming because of @ret */
+static void
+gst_rtspsrc_loop_pause (GstRTSPSrc * src, GstFlowReturn ret)
+{
+  const gchar *reason = gst_flow_get_name (ret);
+
+  GST_DEBUG_OBJECT (src, "pausing task, reason %s", reason);
+  src->running = FALSE;
+  if (ret == GST_FLOW_EOS) {
+    /* perform EOS logic */
+    if (src->segment.flags & GST_SEEK_FLAG_SEGMENT) {
+      gst_element_post_message (GST_ELEMENT_CAST (src),
+          gst_message_new_segment_done (GST_OBJECT_CAST (src),
+              src->segment.format, src->segment.position));
+      gst_rtspsrc_push_event (src,
+          gst_event_new_segment_done (src->segment.format,
+              src->segment.position));
+    } else {
+      gst_rtspsrc_push_event (src, gst_event_new_eos ());
+    }
+  } else if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS) {
+    /* for fatal errors we post an error message, post the error before the
+     * EOS so the app knows about the error first. */
+    GST_ELEMENT_FLOW_ERROR (src, ret);
+    gst_rtspsrc_push_event (src, gst_event_new_eos ());
+  }
+  gst_rtspsrc_loop_send_cmd (src, CMD_WAIT, CMD_LOOP);
+}
+
 static gboolean
 gst_rtspsrc_loop (GstRTSPSrc * src)
 {
@@ -6194,9 +6714,9 @@ gst_rtspsrc_loop (GstRTSPSrc * src)
     goto no_connection;
 
   if (src->interleaved)
-    ret = gst_rtspsrc_loop_interleaved (src);
+    ret = gst_rtspsrc_loop_interleaved (src, FALSE);
   else
-    ret = gst_rtspsrc_loop_udp (src);
+    ret = gst_rtspsrc_loop_udp (src, FALSE);
 
   if (ret != GST_FLOW_OK)
     goto pause;
@@ -6212,33 +6732,290 @@ no_connection:
   }
 pause:
   {
-    const gchar *reason = gst_flow_get_name (ret);
-
-    GST_DEBUG_OBJECT (src, "pausing task, reason %s", reason);
-    src->running = FALSE;
-    if (ret == GST_FLOW_EOS) {
-      /* perform EOS logic */
-      if (src->segment.flags & GST_SEEK_FLAG_SEGMENT) {
-        gst_element_post_message (GST_ELEMENT_CAST (src),
-            gst_message_new_segment_done (GST_OBJECT_CAST (src),
-                src->segment.format, src->segment.position));
-        gst_rtspsrc_push_event (src,
-            gst_event_new_segment_done (src->segment.format,
-                src->segment.position));
-      } else {
-        gst_rtspsrc_push_event (src, gst_event_new_eos ());
-      }
-    } else if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS) {
-      /* for fatal errors we post an error message, post the error before the
-       * EOS so the app knows about the error first. */
-      GST_ELEMENT_FLOW_ERROR (src, ret);
-      gst_rtspsrc_push_event (src, gst_event_new_eos ());
-    }
-    gst_rtspsrc_loop_send_cmd (src, CMD_WAIT, CMD_LOOP);
+    gst_rtspsrc_loop_pause (src, ret);
     return FALSE;
   }
 }
 
+/* In shared loop mode the commands are dispatched from a thread that is shared
+ * with other rtspsrc elements, instead of from our own task. While looping,
+ * the connection is watched from that thread. The shared thread never waits
+ * for the stream lock and only takes complete interleaved frames from the
+ * socket, everything else that can block, like a server message that is not
+ * complete yet or reconnecting when the server closed the connection, is
+ * handled from the blocking work pool. All of it runs with the stream lock,
+ * like the task does. */
+static void
+gst_rtspsrc_watch_stop (GstRTSPSrc * src)
+{
+  if (src->watch_source) {
+    g_source_destroy (src->watch_source);
+    g_source_unref (src->watch_source);
+    src->watch_source = NULL;
+  }
+  if (src->keep_alive_source) {
+    g_source_destroy (src->keep_alive_source);
+    g_source_unref (src->keep_alive_source);
+    src->keep_alive_source = NULL;
+  }
+}
+
+/* handles what the shared thread left on the connection, from the blocking
+ * work pool */
+static void
+gst_rtspsrc_watch_read (GstRTSPSrc * src)
+{
+  GstFlowReturn ret;
+  gboolean scheduled;
+
+  GST_RTSP_STREAM_LOCK (src);
+  GST_OBJECT_LOCK (src);
+  scheduled = src->watch_read_scheduled && src->pending_cmd == CMD_LOOP &&
+      src->task == NULL;
+  src->watch_read_scheduled = FALSE;
+  GST_OBJECT_UNLOCK (src);
+
+  /* stopped, another command came in, or the watch was restarted */
+  if (!scheduled || (src->watch_source &&
+          !g_source_is_destroyed (src->watch_source)))
+    goto done;
+
+  GST_OBJECT_LOCK (src);
+  src->busy_cmd = CMD_LOOP;
+  GST_OBJECT_UNLOCK (src);
+
+  if (src->interleaved)
+    ret = gst_rtspsrc_loop_interleaved (src, TRUE);
+  else
+    ret = gst_rtspsrc_loop_udp (src, TRUE);
+
+  GST_OBJECT_LOCK (src);
+  src->busy_cmd = CMD_WAIT;
+  GST_OBJECT_UNLOCK (src);
+
+  if (ret != GST_FLOW_OK) {
+    gst_rtspsrc_loop_pause (src, ret);
+    gst_rtspsrc_watch_stop (src);
+  } else {
+    /* watch again, the socket is a new one after a reconnect */
+    gst_rtspsrc_watch_start (src);
+  }
+
+done:
+  GST_RTSP_STREAM_UNLOCK (src);
+
+  gst_object_unref (src);
+}
+
+static gboolean
+gst_rtspsrc_watch_cb (GSocket * socket, GIOCondition condition,
+    GstRTSPSrc * src)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstRTSPResult res;
+  guint n_frames = 0;
+
+  /* a command might hold the stream lock while it waits for the server */
+  if (!g_rec_mutex_trylock (GST_RTSP_STREAM_GET_LOCK (src)))
+    goto defer;
+
+  if (g_source_is_destroyed (g_main_current_source ())) {
+    GST_RTSP_STREAM_UNLOCK (src);
+    return G_SOURCE_REMOVE;
+  }
+
+  GST_OBJECT_LOCK (src);
+  if (src->pending_cmd != CMD_LOOP) {
+    /* the dispatch of the pending command takes care of the watch */
+    GST_OBJECT_UNLOCK (src);
+    GST_RTSP_STREAM_UNLOCK (src);
+    return G_SOURCE_CONTINUE;
+  }
+  src->busy_cmd = CMD_LOOP;
+  GST_OBJECT_UNLOCK (src);
+
+  /* complete interleaved frames are taken without blocking */
+  res = GST_RTSP_OK;
+  if (src->interleaved && gst_rtspsrc_use_chunks (src) &&
+      !src->conninfo.flushing)
+    res = gst_rtspsrc_receive_chunk (src, &ret, &n_frames);
+
+  GST_OBJECT_LOCK (src);
+  src->busy_cmd = CMD_WAIT;
+  GST_OBJECT_UNLOCK (src);
+
+  if (res == GST_RTSP_OK && n_frames > 0) {
+    if (ret != GST_FLOW_OK) {
+      gst_rtspsrc_loop_pause (src, ret);
+      gst_rtspsrc_watch_stop (src);
+      GST_RTSP_STREAM_UNLOCK (src);
+      return G_SOURCE_REMOVE;
+    }
+    GST_RTSP_STREAM_UNLOCK (src);
+    return G_SOURCE_CONTINUE;
+  }
+  GST_RTSP_STREAM_UNLOCK (src);
+
+defer:
+  /* stop watching until the blocking work pool handled the connection */
+  GST_OBJECT_LOCK (src);
+  if (!src->watch_read_scheduled) {
+    src->watch_read_scheduled = TRUE;
+    gst_rtsp_worker_push ((GFunc) gst_rtspsrc_watch_read,
+        gst_object_ref (src));
+  }
+  GST_OBJECT_UNLOCK (src);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gst_rtspsrc_keep_alive (GstRTSPSrc * src)
+{
+  GST_RTSP_STREAM_LOCK (src);
+  if (src->keep_alive_source &&
+      !g_source_is_destroyed (src->keep_alive_source) &&
+      src->conninfo.connection &&
+      gst_rtsp_connection_next_timeout_usec (src->conninfo.connection) == 0) {
+    GST_DEBUG_OBJECT (src, "timeout, sending keep-alive");
+    gst_rtspsrc_send_keep_alive (src);
+  }
+  GST_RTSP_STREAM_UNLOCK (src);
+
+  gst_object_unref (src);
+}
+
+static gboolean
+gst_rtspsrc_keep_alive_cb (GstRTSPSrc * src)
+{
+  gboolean timeout;
+
+  /* when busy, the connection is in use and we check again later */
+  if (!g_rec_mutex_trylock (GST_RTSP_STREAM_GET_LOCK (src)))
+    return G_SOURCE_CONTINUE;
+
+  timeout = !g_source_is_destroyed (g_main_current_source ()) &&
+      src->conninfo.connection &&
+      gst_rtsp_connection_next_timeout_usec (src->conninfo.connection) == 0;
+  GST_RTSP_STREAM_UNLOCK (src);
+
+  /* sending can block as well */
+  if (timeout)
+    gst_rtsp_worker_push ((GFunc) gst_rtspsrc_keep_alive,
+        gst_object_ref (src));
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+gst_rtspsrc_watch_start (GstRTSPSrc * src)
+{
+  GSocket *socket;
+
+  if (!src->conninfo.connection || !src->conninfo.connected) {
+    GST_WARNING_OBJECT (src, "we are not connected");
+    gst_rtspsrc_loop_pause (src, GST_FLOW_FLUSHING);
+    return;
+  }
+
+  if (!gst_rtspsrc_connection_is_plain (src)) {
+    /* the socket does not tell when there is something to read, after a
+     * redirect for example. Continue from our own task, like without the
+     * shared loop, it takes over the commands as well. */
+    GST_WARNING_OBJECT (src, "can't watch this connection, starting task");
+    gst_rtspsrc_watch_stop (src);
+    GST_OBJECT_LOCK (src);
+    if (src->task == NULL) {
+      src->task = gst_task_new ((GstTaskFunction) gst_rtspsrc_thread, src,
+          NULL);
+      gst_task_set_lock (src->task, GST_RTSP_STREAM_GET_LOCK (src));
+    }
+    gst_task_start (src->task);
+    GST_OBJECT_UNLOCK (src);
+    return;
+  }
+
+  if (src->watch_source) {
+    /* still watching, or removed itself to handle the connection from the
+     * blocking work pool */
+    if (!g_source_is_destroyed (src->watch_source))
+      return;
+    g_source_unref (src->watch_source);
+    src->watch_source = NULL;
+  }
+
+  GST_DEBUG_OBJECT (src, "watching the connection");
+
+  socket = gst_rtsp_connection_get_read_socket (src->conninfo.connection);
+  src->watch_source = g_socket_create_source (socket,
+      G_IO_IN | G_IO_ERR | G_IO_HUP, NULL);
+  g_source_set_callback (src->watch_source,
+      (GSourceFunc) gst_rtspsrc_watch_cb, gst_object_ref (src),
+      gst_object_unref);
+  g_source_attach (src->watch_source, src->loop_context);
+
+  if (src->keep_alive_source == NULL) {
+    src->keep_alive_source = g_timeout_source_new_seconds (1);
+    g_source_set_callback (src->keep_alive_source,
+        (GSourceFunc) gst_rtspsrc_keep_alive_cb, gst_object_ref (src),
+        gst_object_unref);
+    g_source_attach (src->keep_alive_source, src->loop_context);
+  }
+}
+
+/* runs the pending commands from the blocking work pool, they connect and
+ * wait for replies so they can't run from the shared thread */
+static void
+gst_rtspsrc_dispatch (GstRTSPSrc * src)
+{
+  gboolean again = TRUE;
+
+  GST_RTSP_STREAM_LOCK (src);
+  while (again) {
+    GST_OBJECT_LOCK (src);
+    if (!src->dispatch_scheduled || src->task) {
+      /* stopped, or our own task took over */
+      src->dispatch_scheduled = FALSE;
+      GST_OBJECT_UNLOCK (src);
+      break;
+    }
+
+    /* the connection is only watched while looping */
+    if (src->pending_cmd != CMD_LOOP) {
+      GST_OBJECT_UNLOCK (src);
+      gst_rtspsrc_watch_stop (src);
+    } else {
+      GST_OBJECT_UNLOCK (src);
+    }
+
+    gst_rtspsrc_thread (src);
+
+    /* continue with the next command, looping continues from the watch */
+    GST_OBJECT_LOCK (src);
+    again = src->pending_cmd != CMD_WAIT &&
+        (src->pending_cmd != CMD_LOOP || src->watch_source == NULL ||
+        (g_source_is_destroyed (src->watch_source) &&
+            !src->watch_read_scheduled));
+    if (!again)
+      src->dispatch_scheduled = FALSE;
+    GST_OBJECT_UNLOCK (src);
+  }
+  GST_RTSP_STREAM_UNLOCK (src);
+
+  gst_object_unref (src);
+}
+
+/* called with the object lock */
+static void
+gst_rtspsrc_schedule_dispatch (GstRTSPSrc * src)
+{
+  if (src->dispatch_scheduled)
+    return;
+
+  src->dispatch_scheduled = TRUE;
+  gst_rtsp_worker_push ((GFunc) gst_rtspsrc_dispatch, gst_object_ref (src));
+}
+
 #ifndef GST_DISABLE_GST_DEBUG
 static const gchar *
 gst_rtsp_auth_method_to_string (GstRTSPAuthMethod method)
@@ -6530,6 +7307,24 @@ server_eof:
 }
 
 
+/* receives the reply to a pipelined PLAY request that we are not going to
+ * handle anymore */
+static void
+gst_rtspsrc_discard_pipelined_play (GstRTSPSrc * src)
+{
+  GstRTSPMessage response = { 0 };
+
+  if (!src->pipelined_play)
+    return;
+
+  src->pipelined_play = FALSE;
+
+  GST_DEBUG_OBJECT (src, "discarding reply to pipelined PLAY");
+  if (gst_rtsp_src_receive_response (src, &src->conninfo, &response,
+          NULL) == GST_RTSP_OK)
+    gst_rtsp_message_unset (&response);
+}
+
 static GstRTSPResult
 gst_rtspsrc_try_send (GstRTSPSrc * src, GstRTSPConnInfo * conninfo,
     GstRTSPMessage * request, GstRTSPMessage * response,
@@ -7119,6 +7914,144 @@ gst_rtspsrc_stream_make_keymgmt (GstRTSPSrc * src, GstRTSPStream * stream)
   return result;
 }
 
+/* the result of the OPTIONS and DESCRIBE requests of the last session, by
+ * request URL and by the settings that can change the reply of the server */
+typedef struct
+{
+  GBytes *sdp;
+  gchar *content_base;
+  gint methods;
+  GstRTSPVersion version;
+} CachedDescription;
+
+#define MAX_CACHED_DESCRIPTIONS 64
+
+G_LOCK_DEFINE_STATIC (description_cache);
+static GHashTable *description_cache;
+
+static void
+cached_description_free (CachedDescription * desc)
+{
+  g_bytes_unref (desc->sdp);
+  g_free (desc->content_base);
+  g_free (desc);
+}
+
+/* returns the key of the description of the current URL in the cache, a
+ * checksum so that the cache doesn't keep a copy of the credentials */
+static gchar *
+gst_rtspsrc_description_key (GstRTSPSrc * src)
+{
+  GstRTSPUrl *url = src->conninfo.url;
+  gchar *str, *key;
+
+  if (src->conninfo.url_str == NULL)
+    return NULL;
+
+  str = g_strdup_printf ("%s\n%s\n%s\n%s\n%s\n%d\n%d\n%s",
+      src->conninfo.url_str, GST_STR_NULL (url ? url->user : NULL),
+      GST_STR_NULL (url ? url->passwd : NULL), GST_STR_NULL (src->user_id),
+      GST_STR_NULL (src->user_pw), src->backchannel, src->onvif_mode,
+      GST_STR_NULL (src->user_agent));
+  key = g_compute_checksum_for_string (G_CHECKSUM_SHA256, str, -1);
+  g_free (str);
+
+  return key;
+}
+
+static void
+gst_rtspsrc_cache_description (GstRTSPSrc * src, const guint8 * data,
+    guint size)
+{
+  CachedDescription *desc;
+  gchar *key;
+
+  if ((key = gst_rtspsrc_description_key (src)) == NULL)
+    return;
+
+  desc = g_new0 (CachedDescription, 1);
+  desc->sdp = g_bytes_new (data, size);
+  desc->content_base = g_strdup (src->content_base);
+  desc->methods = src->methods;
+  desc->version = src->version;
+
+  G_LOCK (description_cache);
+  if (description_cache == NULL) {
+    description_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, (GDestroyNotify) cached_description_free);
+  } else if (g_hash_table_size (description_cache) >= MAX_CACHED_DESCRIPTIONS
+      && !g_hash_table_contains (description_cache, key)) {
+    GHashTableIter iter;
+
+    /* make room by evicting any entry */
+    g_hash_table_iter_init (&iter, description_cache);
+    if (g_hash_table_iter_next (&iter, NULL, NULL))
+      g_hash_table_iter_remove (&iter);
+  }
+  g_hash_table_insert (description_cache, key, desc);
+  G_UNLOCK (description_cache);
+
+  GST_DEBUG_OBJECT (src, "cached description of %s", src->conninfo.url_str);
+}
+
+static void
+gst_rtspsrc_uncache_description (GstRTSPSrc * src)
+{
+  gchar *key;
+
+  if ((key = gst_rtspsrc_description_key (src)) == NULL)
+    return;
+
+  GST_DEBUG_OBJECT (src, "removing cached description of %s",
+      src->conninfo.url_str);
+
+  G_LOCK (description_cache);
+  if (description_cache)
+    g_hash_table_remove (description_cache, key);
+  G_UNLOCK (description_cache);
+  g_free (key);
+}
+
+/* restores the state that OPTIONS and DESCRIBE would have given us from the
+ * cache and parses the cached SDP into @sdp */
+static gboolean
+gst_rtspsrc_lookup_description (GstRTSPSrc * src, GstSDPMessage ** sdp)
+{
+  CachedDescription *desc;
+  GBytes *bytes = NULL;
+  gconstpointer data;
+  gsize size;
+  gchar *key;
+
+  if ((key = gst_rtspsrc_description_key (src)) == NULL)
+    return FALSE;
+
+  G_LOCK (description_cache);
+  if (description_cache &&
+      (desc = g_hash_table_lookup (description_cache, key))) {
+    bytes = g_bytes_ref (desc->sdp);
+    g_free (src->content_base);
+    src->content_base = g_strdup (desc->content_base);
+    src->methods = desc->methods;
+    src->version = desc->version;
+  }
+  G_UNLOCK (description_cache);
+  g_free (key);
+
+  if (bytes == NULL)
+    return FALSE;
+
+  GST_DEBUG_OBJECT (src, "using cached description of %s",
+      src->conninfo.url_str);
+
+  data = g_bytes_get_data (bytes, &size);
+  gst_sdp_message_new (sdp);
+  gst_sdp_message_parse_buffer (data, size, *sdp);
+  g_bytes_unref (bytes);
+
+  return TRUE;
+}
+
 static GstRTSPResult
 gst_rtsp_src_setup_stream_from_response (GstRTSPSrc * src,
     GstRTSPStream * stream, GstRTSPMessage * response,
@@ -7148,7 +8081,9 @@ gst_rtsp_src_setup_stream_from_response (GstRTSPSrc * src,
       if (protocols)
         *protocols = GST_RTSP_LOWER_TRANS_TCP;
       src->interleaved = TRUE;
-      if (src->version < GST_RTSP_VERSION_2_0) {
+      /* channels of pipelined requests were allocated when sending */
+      if (src->version < GST_RTSP_VERSION_2_0 &&
+          !stream->waiting_setup_response) {
         /* update free channels */
         src->free_channel = MAX (transport.interleaved.min, src->free_channel);
         src->free_channel = MAX (transport.interleaved.max, src->free_channel);
@@ -7262,13 +8197,13 @@ gst_rtspsrc_setup_streams_end (GstRTSPSrc * src, gboolean async)
 {
   GList *tmp;
   GstRTSPConnInfo *conninfo;
-
-  g_assert (src->version >= GST_RTSP_VERSION_2_0);
+  GstRTSPResult res;
 
   conninfo = &src->conninfo;
   for (tmp = src->streams; tmp; tmp = tmp->next) {
     GstRTSPStream *stream = (GstRTSPStream *) tmp->data;
     GstRTSPMessage response = { 0, };
+    GstRTSPStatusCode code = GST_RTSP_STS_OK;
 
     if (!stream->waiting_setup_response)
       continue;
@@ -7276,10 +8211,26 @@ gst_rtspsrc_setup_streams_end (GstRTSPSrc * src, gboolean async)
     if (!src->conninfo.connection)
       conninfo = &((GstRTSPStream *) tmp->data)->conninfo;
 
-    gst_rtsp_src_receive_response (src, conninfo, &response, NULL);
+    /* the replies come in the order of the requests */
+    res = gst_rtsp_src_receive_response (src, conninfo, &response, &code);
+    if (res < 0)
+      return res;
+
+    if (code != GST_RTSP_STS_OK) {
+      /* we can't try other transports anymore, skip the stream */
+      GST_WARNING_OBJECT (src, "pipelined SETUP of stream %p failed: %d",
+          stream, code);
+      stream->waiting_setup_response = FALSE;
+      gst_rtspsrc_stream_free_udp (stream);
+      gst_rtsp_message_unset (&response);
+      continue;
+    }
 
-    gst_rtsp_src_setup_stream_from_response (src, stream,
+    res = gst_rtsp_src_setup_stream_from_response (src, stream,
         &response, NULL, 0, NULL, NULL);
+    if (res == GST_RTSP_ERROR)
+      return res;
+    stream->waiting_setup_response = FALSE;
   }
 
   return GST_RTSP_OK;
@@ -7315,6 +8266,8 @@ gst_rtspsrc_setup_streams_start (GstRTSPSrc * src, gboolean async)
   GstRTSPUrl *url;
   gchar *hval;
   gchar *pipelined_request_id = NULL;
+  gboolean have_session = FALSE;
+  gboolean pipelined, any_pipelined = FALSE;
 
   if (src->conninfo.connection) {
     url = gst_rtsp_connection_get_url (src->conninfo.connection);
@@ -7458,6 +8411,12 @@ gst_rtspsrc_setup_streams_start (GstRTSPSrc * src, gboolean async)
     }
 
     GST_DEBUG_OBJECT (src, "transport is now %s", GST_STR_NULL (transports));
+    /* with RTSP 1.0 we only know the session and the transport after the
+     * first reply, the other requests can then be sent without waiting */
+    pipelined = src->version >= GST_RTSP_VERSION_2_0 ||
+        (src->pipeline_requests && have_session &&
+        src->conninfo.connection != NULL);
+
     /* create SETUP request */
     res =
         gst_rtspsrc_init_request (src, &request, GST_RTSP_SETUP,
@@ -7506,7 +8465,7 @@ gst_rtspsrc_setup_streams_start (GstRTSPSrc * src, gboolean async)
     /* handle the code ourselves */
     res =
         gst_rtspsrc_send (src, conninfo, &request,
-        pipelined_request_id ? NULL : &response, &code, NULL);
+        pipelined ? NULL : &response, &code, NULL);
     if (res < 0)
       goto send_error;
 
@@ -7547,7 +8506,7 @@ gst_rtspsrc_setup_streams_start (GstRTSPSrc * src, gboolean async)
     }
 
 
-    if (!pipelined_request_id) {
+    if (!pipelined) {
       /* parse response transport */
       res = gst_rtsp_src_setup_stream_from_response (src, stream,
           &response, &protocols, retry, &rtpport, &rtcpport);
@@ -7559,10 +8518,16 @@ gst_rtspsrc_setup_streams_start (GstRTSPSrc * src, gboolean async)
         default:
           break;
       }
+      have_session = TRUE;
     } else {
       stream->waiting_setup_response = TRUE;
+      any_pipelined = TRUE;
       /* we need to activate at least one stream when we detect activity */
       src->need_activate = TRUE;
+      /* the reply can't tell us the next free channels in time */
+      if (src->version < GST_RTSP_VERSION_2_0 &&
+          (protocols & GST_RTSP_LOWER_TRANS_TCP))
+        src->free_channel += 2;
     }
 
     {
@@ -7588,8 +8553,11 @@ gst_rtspsrc_setup_streams_start (GstRTSPSrc * src, gboolean async)
     gst_rtsp_message_unset (&request);
   }
 
-  if (pipelined_request_id) {
-    gst_rtspsrc_setup_streams_end (src, TRUE);
+  if (any_pipelined) {
+    gst_rtspsrc_pipeline_play (src, pipelined_request_id);
+
+    if ((res = gst_rtspsrc_setup_streams_end (src, TRUE)) < 0)
+      goto cleanup_error;
   }
 
   /* store the transport protocol that was configured */
@@ -7929,15 +8897,16 @@ gst_rtspsrc_open_from_sdp (GstRTSPSrc * src, GstSDPMessage * sdp,
 
   src->state = GST_RTSP_STATE_INIT;
 
-  /* setup streams */
-  if ((res = gst_rtspsrc_setup_streams_start (src, async)) < 0)
-    goto setup_failed;
-
-  /* reset our state */
+  /* reset our state, before the setup because it might already send the PLAY
+   * request */
   src->need_range = TRUE;
   src->server_side_trickmode = FALSE;
   src->trickmode_interval = 0;
 
+  /* setup streams */
+  if ((res = gst_rtspsrc_setup_streams_start (src, async)) < 0)
+    goto setup_failed;
+
   src->state = GST_RTSP_STATE_READY;
 
   return res;
@@ -7982,6 +8951,11 @@ restart:
   if ((res = gst_rtsp_conninfo_connect (src, &src->conninfo, async)) < 0)
     goto connect_failed;
 
+  src->sdp_cached = src->cache_sdp &&
+      gst_rtspsrc_lookup_description (src, sdp);
+  if (src->sdp_cached)
+    return GST_RTSP_OK;
+
   /* create OPTIONS */
   GST_DEBUG_OBJECT (src, "create options... (%s)", async ? "async" : "sync");
   res =
@@ -8091,6 +9065,9 @@ restart:
   gst_sdp_message_new (sdp);
   gst_sdp_message_parse_buffer (data, size, *sdp);
 
+  if (src->cache_sdp)
+    gst_rtspsrc_cache_description (src, data, size);
+
   /* clean up any messages */
   gst_rtsp_message_unset (&request);
   gst_rtsp_message_unset (&response);
@@ -8171,14 +9148,19 @@ gst_rtspsrc_open (GstRTSPSrc * src, gboolean async)
 
   src->methods =
       GST_RTSP_SETUP | GST_RTSP_PLAY | GST_RTSP_PAUSE | GST_RTSP_TEARDOWN;
+  src->sdp_cached = FALSE;
 
   if (src->sdp == NULL) {
     if ((ret = gst_rtspsrc_retrieve_sdp (src, &src->sdp, async)) < 0)
       goto no_sdp;
   }
 
-  if ((ret = gst_rtspsrc_open_from_sdp (src, src->sdp, async)) < 0)
+  if ((ret = gst_rtspsrc_open_from_sdp (src, src->sdp, async)) < 0) {
+    /* the server might have changed, describe it again next time */
+    if (src->sdp_cached)
+      gst_rtspsrc_uncache_description (src);
     goto open_failed;
+  }
 
   if (src->initial_seek) {
     if (!gst_rtspsrc_perform_seek (src, src->initial_seek))
@@ -8235,6 +9217,9 @@ gst_rtspsrc_close (GstRTSPSrc * src, gboolean async, gboolean only_close)
   if (only_close)
     goto close;
 
+  /* don't take the reply to a pipelined PLAY for the one to TEARDOWN */
+  gst_rtspsrc_discard_pipelined_play (src);
+
   /* construct a control url */
   control = get_aggregate_control (src);
 
@@ -8563,6 +9548,129 @@ clear_rtp_base (GstRTSPSrc * src, GstRTSPStream * stream)
   stream->need_caps = TRUE;
 }
 
+/* creates a PLAY request for @segment, @backchannel is TRUE when the request
+ * controls the ONVIF backchannel */
+static GstRTSPResult
+gst_rtspsrc_init_play_request (GstRTSPSrc * src, GstRTSPMessage * request,
+    const gchar * setup_url, GstSegment * segment, const gchar * seek_style,
+    gboolean backchannel)
+{
+  GstRTSPResult res;
+  gchar *hval;
+
+  res = gst_rtspsrc_init_request (src, request, GST_RTSP_PLAY, setup_url);
+  if (res < 0)
+    return res;
+
+  if (src->need_range && src->seekable >= 0.0) {
+    hval = gen_range_header (src, segment);
+
+    gst_rtsp_message_take_header (request, GST_RTSP_HDR_RANGE, hval);
+
+    /* store the newsegment event so it can be sent from the streaming
+     * thread. */
+    src->need_segment = TRUE;
+  }
+
+  if (segment->rate != 1.0) {
+    gchar scale_val[G_ASCII_DTOSTR_BUF_SIZE];
+    gchar speed_val[G_ASCII_DTOSTR_BUF_SIZE];
+
+    if (src->server_side_trickmode) {
+      g_ascii_dtostr (scale_val, sizeof (scale_val), segment->rate);
+      gst_rtsp_message_add_header (request, GST_RTSP_HDR_SCALE, scale_val);
+    } else if (segment->rate < 0.0) {
+      g_ascii_dtostr (scale_val, sizeof (scale_val), -1.0);
+      gst_rtsp_message_add_header (request, GST_RTSP_HDR_SCALE, scale_val);
+
+      if (ABS (segment->rate) != 1.0) {
+        g_ascii_dtostr (speed_val, sizeof (speed_val), ABS (segment->rate));
+        gst_rtsp_message_add_header (request, GST_RTSP_HDR_SPEED, speed_val);
+      }
+    } else {
+      g_ascii_dtostr (speed_val, sizeof (speed_val), segment->rate);
+      gst_rtsp_message_add_header (request, GST_RTSP_HDR_SPEED, speed_val);
+    }
+  }
+
+  if (src->onvif_mode) {
+    if (segment->flags & GST_SEEK_FLAG_TRICKMODE_KEY_UNITS) {
+      if (src->trickmode_interval)
+        hval =
+            g_strdup_printf ("intra/%" G_GUINT64_FORMAT,
+            src->trickmode_interval / GST_MSECOND);
+      else
+        hval = g_strdup ("intra");
+
+      gst_rtsp_message_add_header (request, GST_RTSP_HDR_FRAMES, hval);
+
+      g_free (hval);
+    } else if (segment->flags & GST_SEEK_FLAG_TRICKMODE_FORWARD_PREDICTED) {
+      gst_rtsp_message_add_header (request, GST_RTSP_HDR_FRAMES, "predicted");
+    }
+  }
+
+  if (seek_style)
+    gst_rtsp_message_add_header (request, GST_RTSP_HDR_SEEK_STYLE, seek_style);
+
+  /* when we have an ONVIF audio backchannel, the PLAY request must have the
+   * Require: header when doing either aggregate or non-aggregate control */
+  if (src->backchannel == BACKCHANNEL_ONVIF && backchannel)
+    gst_rtsp_message_add_header (request, GST_RTSP_HDR_REQUIRE,
+        BACKCHANNEL_ONVIF_HDR_REQUIRE_VAL);
+
+  if (src->onvif_mode) {
+    if (src->onvif_rate_control)
+      gst_rtsp_message_add_header (request, GST_RTSP_HDR_RATE_CONTROL, "yes");
+    else
+      gst_rtsp_message_add_header (request, GST_RTSP_HDR_RATE_CONTROL, "no");
+  }
+
+  return GST_RTSP_OK;
+}
+
+/* sends the PLAY request right after pipelined SETUP requests when we are
+ * going to play anyway, gst_rtspsrc_play() then only receives the reply */
+static void
+gst_rtspsrc_pipeline_play (GstRTSPSrc * src,
+    const gchar * pipelined_request_id)
+{
+  GstRTSPMessage request = { 0 };
+  const gchar *control;
+  gboolean play;
+
+  if (!src->pipeline_requests || !src->interleaved ||
+      !src->conninfo.connection || !(src->methods & GST_RTSP_PLAY) ||
+      src->initial_seek)
+    return;
+
+  if ((control = get_aggregate_control (src)) == NULL)
+    return;
+
+  GST_OBJECT_LOCK (src);
+  play = src->pending_cmd == CMD_PLAY || src->busy_cmd == CMD_PLAY;
+  GST_OBJECT_UNLOCK (src);
+  if (!play)
+    return;
+
+  if (gst_rtspsrc_init_play_request (src, &request, control, &src->segment,
+          NULL, TRUE) < 0)
+    return;
+
+  /* with RTSP 2.0 the server doesn't know the session yet */
+  if (pipelined_request_id)
+    gst_rtsp_message_add_header (&request, GST_RTSP_HDR_PIPELINED_REQUESTS,
+        pipelined_request_id);
+
+  GST_DEBUG_OBJECT (src, "pipelining PLAY request");
+
+  if (gst_rtspsrc_send (src, &src->conninfo, &request, NULL, NULL,
+          NULL) == GST_RTSP_OK)
+    src->pipelined_play = TRUE;
+
+  gst_rtsp_message_unset (&request);
+}
+
 static GstRTSPResult
 gst_rtspsrc_ensure_open (GstRTSPSrc * src, gboolean async)
 {
@@ -8648,85 +9756,30 @@ restart:
     }
 
     /* do play */
-    res = gst_rtspsrc_init_request (src, &request, GST_RTSP_PLAY, setup_url);
+    res = gst_rtspsrc_init_play_request (src, &request, setup_url, segment,
+        seek_style, control || stream->is_backchannel);
     if (res < 0)
       goto create_request_failed;
 
-    if (src->need_range && src->seekable >= 0.0) {
-      hval = gen_range_header (src, segment);
-
-      gst_rtsp_message_take_header (&request, GST_RTSP_HDR_RANGE, hval);
-
-      /* store the newsegment event so it can be sent from the streaming thread. */
-      src->need_segment = TRUE;
-    }
-
-    if (segment->rate != 1.0) {
-      gchar scale_val[G_ASCII_DTOSTR_BUF_SIZE];
-      gchar speed_val[G_ASCII_DTOSTR_BUF_SIZE];
-
-      if (src->server_side_trickmode) {
-        g_ascii_dtostr (scale_val, sizeof (scale_val), segment->rate);
-        gst_rtsp_message_add_header (&request, GST_RTSP_HDR_SCALE, scale_val);
-      } else if (segment->rate < 0.0) {
-        g_ascii_dtostr (scale_val, sizeof (scale_val), -1.0);
-        gst_rtsp_message_add_header (&request, GST_RTSP_HDR_SCALE, scale_val);
-
-        if (ABS (segment->rate) != 1.0) {
-          g_ascii_dtostr (speed_val, sizeof (speed_val), ABS (segment->rate));
-          gst_rtsp_message_add_header (&request, GST_RTSP_HDR_SPEED, speed_val);
-        }
-      } else {
-        g_ascii_dtostr (speed_val, sizeof (speed_val), segment->rate);
-        gst_rtsp_message_add_header (&request, GST_RTSP_HDR_SPEED, speed_val);
-      }
-    }
-
-    if (src->onvif_mode) {
-      if (segment->flags & GST_SEEK_FLAG_TRICKMODE_KEY_UNITS) {
-        gchar *hval;
-
-        if (src->trickmode_interval)
-          hval =
-              g_strdup_printf ("intra/%" G_GUINT64_FORMAT,
-              src->trickmode_interval / GST_MSECOND);
-        else
-          hval = g_strdup ("intra");
+    if (async)
+      GST_ELEMENT_PROGRESS (src, CONTINUE, "request", ("Sending PLAY request"));
 
-        gst_rtsp_message_add_header (&request, GST_RTSP_HDR_FRAMES, hval);
+    if (src->pipelined_play) {
+      GstRTSPStatusCode code = GST_RTSP_STS_OK;
 
-        g_free (hval);
-      } else if (segment->flags & GST_SEEK_FLAG_TRICKMODE_FORWARD_PREDICTED) {
-        gst_rtsp_message_add_header (&request, GST_RTSP_HDR_FRAMES,
-            "predicted");
+      /* the request was sent along with the SETUP requests, if it failed we
+       * try again the usual way */
+      src->pipelined_play = FALSE;
+      res = gst_rtsp_src_receive_response (src, conninfo, &response, &code);
+      if (res == GST_RTSP_OK && code != GST_RTSP_STS_OK) {
+        gst_rtsp_message_unset (&response);
+        res = gst_rtspsrc_send (src, conninfo, &request, &response, NULL,
+            NULL);
       }
+    } else {
+      res = gst_rtspsrc_send (src, conninfo, &request, &response, NULL, NULL);
     }
-
-    if (seek_style)
-      gst_rtsp_message_add_header (&request, GST_RTSP_HDR_SEEK_STYLE,
-          seek_style);
-
-    /* when we have an ONVIF audio backchannel, the PLAY request must have the
-     * Require: header when doing either aggregate or non-aggregate control */
-    if (src->backchannel == BACKCHANNEL_ONVIF &&
-        (control || stream->is_backchannel))
-      gst_rtsp_message_add_header (&request, GST_RTSP_HDR_REQUIRE,
-          BACKCHANNEL_ONVIF_HDR_REQUIRE_VAL);
-
-    if (src->onvif_mode) {
-      if (src->onvif_rate_control)
-        gst_rtsp_message_add_header (&request, GST_RTSP_HDR_RATE_CONTROL,
-            "yes");
-      else
-        gst_rtsp_message_add_header (&request, GST_RTSP_HDR_RATE_CONTROL, "no");
-    }
-
-    if (async)
-      GST_ELEMENT_PROGRESS (src, CONTINUE, "request", ("Sending PLAY request"));
-
-    if ((res =
-            gst_rtspsrc_send (src, conninfo, &request, &response, NULL, NULL))
-        < 0)
+    if (res < 0)
       goto send_error;
 
     if (src->need_redirect) {
@@ -8911,6 +9964,12 @@ gst_rtspsrc_pause (GstRTSPSrc * src, gboolean async)
   if (!(src->methods & GST_RTSP_PAUSE))
     goto not_supported;
 
+  /* the server is playing when we sent a pipelined PLAY */
+  if (src->pipelined_play) {
+    gst_rtspsrc_discard_pipelined_play (src);
+    src->state = GST_RTSP_STATE_PLAYING;
+  }
+
   if (src->state == GST_RTSP_STATE_READY)
     goto was_paused;
 
@@ -9156,7 +10215,10 @@ gst_rtspsrc_thread (GstRTSPSrc * src)
       gst_rtspsrc_set_parameter (src, req);
       break;
     case CMD_LOOP:
-      gst_rtspsrc_loop (src);
+      if (src->loop_context && src->task == NULL)
+        gst_rtspsrc_watch_start (src);
+      else
+        gst_rtspsrc_loop (src);
       break;
     case CMD_RECONNECT:
       gst_rtspsrc_reconnect (src, FALSE);
@@ -9187,7 +10249,12 @@ gst_rtspsrc_start (GstRTSPSrc * src)
 
   src->pending_cmd = CMD_WAIT;
 
-  if (src->task == NULL) {
+  if (src->shared_loop && !(src->conninfo.url &&
+          (src->conninfo.url->transports & (GST_RTSP_LOWER_TRANS_TLS |
+                  GST_RTSP_LOWER_TRANS_HTTP)))) {
+    if (src->loop_context == NULL)
+      src->loop_context = gst_rtsp_worker_acquire_context ();
+  } else if (src->task == NULL) {
     src->task = gst_task_new ((GstTaskFunction) gst_rtspsrc_thread, src, NULL);
     if (src->task == NULL)
       goto task_error;
@@ -9211,6 +10278,7 @@ static gboolean
 gst_rtspsrc_stop (GstRTSPSrc * src)
 {
   GstTask *task;
+  GMainContext *context;
 
   GST_DEBUG_OBJECT (src, "stopping");
 
@@ -9236,6 +10304,25 @@ gst_rtspsrc_stop (GstRTSPSrc * src)
 
     GST_OBJECT_LOCK (src);
   }
+  if ((context = src->loop_context)) {
+    src->loop_context = NULL;
+    GST_OBJECT_UNLOCK (src);
+
+    /* wait for the shared threads to be done with us, after this the
+     * callbacks that might still be dispatched see their source destroyed
+     * and a queued dispatch does nothing */
+    GST_RTSP_STREAM_LOCK (src);
+    GST_OBJECT_LOCK (src);
+    src->dispatch_scheduled = FALSE;
+    src->watch_read_scheduled = FALSE;
+    GST_OBJECT_UNLOCK (src);
+    gst_rtspsrc_watch_stop (src);
+    GST_RTSP_STREAM_UNLOCK (src);
+
+    gst_rtsp_worker_release_context (context);
+
+    GST_OBJECT_LOCK (src);
+  }
   GST_OBJECT_UNLOCK (src);
 
   /* ensure synchronously all is closed and clean */
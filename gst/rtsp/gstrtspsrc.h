@@ -279,6 +279,10 @@ struct _GstRTSPSrc {
   gboolean          onvif_rate_control;
   gboolean          is_live;
   gboolean          ignore_x_server_reply;
+  guint             interleaved_chunk_size;
+  gboolean          shared_loop;
+  gboolean          pipeline_requests;
+  gboolean          cache_sdp;
 
   /* state */
   GstRTSPState       state;
@@ -328,6 +332,25 @@ struct _GstRTSPSrc {
 
   guint group_id;
   GMutex group_lock;
+
+  /* chunked receiving of interleaved data */
+  GCancellable *interleaved_cancellable;
+  GstMemory *chunk;
+  GstMapInfo chunk_map;
+  gsize chunk_offset;
+  GQueue free_chunks;
+
+  /* shared loop mode */
+  GMainContext *loop_context;
+  gboolean dispatch_scheduled;
+  gboolean watch_read_scheduled;
+  GSource *watch_source;
+  GSource *keep_alive_source;
+  gint loop_auth_retry;
+
+  /* pipelined requests and cached descriptions */
+  gboolean pipelined_play;
+  gboolean sdp_cached;
 };
 
 struct _GstRTSPSrcClass {
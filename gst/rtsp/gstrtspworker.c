@@ -0,0 +1,148 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* A process wide pool of threads, each running a main context, that the
+ * rtspsrc elements in shared loop mode attach the sources that handle their
+ * connection to. There is at most one thread per processor, an element gets
+ * the context with the least users. Threads are started when needed and
+ * then kept for the lifetime of the process.
+ *
+ * Work that blocks, like connecting and waiting for the reply to a request,
+ * must not run from those threads, it would stall all the other connections.
+ * It is pushed to a separate thread pool instead, whose threads only exist
+ * while there is such work. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstrtspworker.h"
+
+typedef struct
+{
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+  guint users;
+} GstRTSPWorker;
+
+typedef struct
+{
+  GFunc func;
+  gpointer data;
+} GstRTSPWorkerJob;
+
+static GMutex workers_lock;
+static GPtrArray *workers;
+static GThreadPool *job_pool;
+
+static gpointer
+gst_rtsp_worker_thread (GstRTSPWorker * worker)
+{
+  g_main_context_push_thread_default (worker->context);
+  g_main_loop_run (worker->loop);
+  g_main_context_pop_thread_default (worker->context);
+
+  return NULL;
+}
+
+static GstRTSPWorker *
+gst_rtsp_worker_new (void)
+{
+  GstRTSPWorker *worker = g_new0 (GstRTSPWorker, 1);
+
+  worker->context = g_main_context_new ();
+  worker->loop = g_main_loop_new (worker->context, FALSE);
+  worker->thread = g_thread_new ("rtspsrc-worker",
+      (GThreadFunc) gst_rtsp_worker_thread, worker);
+
+  return worker;
+}
+
+/* returns the context of the least used worker thread */
+GMainContext *
+gst_rtsp_worker_acquire_context (void)
+{
+  GstRTSPWorker *best = NULL;
+  guint i;
+
+  g_mutex_lock (&workers_lock);
+  if (workers == NULL)
+    workers = g_ptr_array_new ();
+
+  for (i = 0; i < workers->len; i++) {
+    GstRTSPWorker *worker = g_ptr_array_index (workers, i);
+
+    if (best == NULL || worker->users < best->users)
+      best = worker;
+  }
+
+  if (best == NULL || (best->users > 0 &&
+          workers->len < (guint) g_get_num_processors ())) {
+    best = gst_rtsp_worker_new ();
+    g_ptr_array_add (workers, best);
+  }
+  best->users++;
+  g_mutex_unlock (&workers_lock);
+
+  return g_main_context_ref (best->context);
+}
+
+void
+gst_rtsp_worker_release_context (GMainContext * context)
+{
+  guint i;
+
+  g_mutex_lock (&workers_lock);
+  for (i = 0; workers && i < workers->len; i++) {
+    GstRTSPWorker *worker = g_ptr_array_index (workers, i);
+
+    if (worker->context == context) {
+      worker->users--;
+      break;
+    }
+  }
+  g_mutex_unlock (&workers_lock);
+
+  g_main_context_unref (context);
+}
+
+static void
+gst_rtsp_worker_run_job (GstRTSPWorkerJob * job, gpointer user_data)
+{
+  job->func (job->data, NULL);
+  g_free (job);
+}
+
+/* calls @func with @data from a thread of the blocking work pool */
+void
+gst_rtsp_worker_push (GFunc func, gpointer data)
+{
+  GstRTSPWorkerJob *job;
+
+  job = g_new (GstRTSPWorkerJob, 1);
+  job->func = func;
+  job->data = data;
+
+  g_mutex_lock (&workers_lock);
+  if (job_pool == NULL)
+    job_pool = g_thread_pool_new ((GFunc) gst_rtsp_worker_run_job, NULL, -1,
+        FALSE, NULL);
+  g_thread_pool_push (job_pool, job, NULL);
+  g_mutex_unlock (&workers_lock);
+}
@@ -44,6 +44,16 @@
 
 #include <gio/gnetworking.h>
 
+#ifdef __linux__
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_MAX_SEGMENTS
+#define UDP_MAX_SEGMENTS 64
+#endif
+#endif
+
 #include "gst/net/net.h"
 #include "gst/glib-compat-private.h"
 
@@ -52,6 +62,88 @@ GST_DEBUG_CATEGORY_STATIC (multiudpsink_debug);
 
 #define UDP_MAX_SIZE 65507
 
+#ifdef UDP_SEGMENT
+/* Control message for sending a buffer of several packets of a given segment
+ * size with generic segmentation offload */
+GType gst_udp_segment_message_get_type (void);
+
+#define GST_TYPE_UDP_SEGMENT_MESSAGE         (gst_udp_segment_message_get_type ())
+#define GST_UDP_SEGMENT_MESSAGE(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), GST_TYPE_UDP_SEGMENT_MESSAGE, GstUDPSegmentMessage))
+
+typedef struct _GstUDPSegmentMessage GstUDPSegmentMessage;
+typedef struct _GstUDPSegmentMessageClass GstUDPSegmentMessageClass;
+
+struct _GstUDPSegmentMessageClass
+{
+  GSocketControlMessageClass parent_class;
+};
+
+struct _GstUDPSegmentMessage
+{
+  GSocketControlMessage parent;
+
+  guint16 gso_size;
+};
+
+G_DEFINE_TYPE (GstUDPSegmentMessage, gst_udp_segment_message,
+    G_TYPE_SOCKET_CONTROL_MESSAGE);
+
+static gsize
+gst_udp_segment_message_get_size (GSocketControlMessage * message)
+{
+  return sizeof (guint16);
+}
+
+static int
+gst_udp_segment_message_get_level (GSocketControlMessage * message)
+{
+  return IPPROTO_UDP;
+}
+
+static int
+gst_udp_segment_message_get_msg_type (GSocketControlMessage * message)
+{
+  return UDP_SEGMENT;
+}
+
+static void
+gst_udp_segment_message_serialize (GSocketControlMessage * message,
+    gpointer data)
+{
+  GstUDPSegmentMessage *msg = GST_UDP_SEGMENT_MESSAGE (message);
+
+  memcpy (data, &msg->gso_size, sizeof (guint16));
+}
+
+static void
+gst_udp_segment_message_init (GstUDPSegmentMessage * message)
+{
+}
+
+static void
+gst_udp_segment_message_class_init (GstUDPSegmentMessageClass * class)
+{
+  GSocketControlMessageClass *scm_class;
+
+  scm_class = G_SOCKET_CONTROL_MESSAGE_CLASS (class);
+  scm_class->get_size = gst_udp_segment_message_get_size;
+  scm_class->get_level = gst_udp_segment_message_get_level;
+  scm_class->get_type = gst_udp_segment_message_get_msg_type;
+  scm_class->serialize = gst_udp_segment_message_serialize;
+}
+
+static GSocketControlMessage *
+gst_udp_segment_message_new (guint16 gso_size)
+{
+  GstUDPSegmentMessage *msg;
+
+  msg = g_object_new (GST_TYPE_UDP_SEGMENT_MESSAGE, NULL);
+  msg->gso_size = gso_size;
+
+  return G_SOCKET_CONTROL_MESSAGE (msg);
+}
+#endif
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -92,6 +184,16 @@ enum
 #define DEFAULT_BUFFER_SIZE        0
 #define DEFAULT_BIND_ADDRESS       NULL
 #define DEFAULT_BIND_PORT          0
+#define DEFAULT_GSO                FALSE
+#define DEFAULT_PACING_BITRATE     0
+#define DEFAULT_PACING_WINDOW      0
+#define DEFAULT_PACING_MAX_DELAY   GST_SECOND
+
+typedef struct
+{
+  GstBuffer *buffer;
+  gint64 send_time;             /* monotonic time in microseconds */
+} GstUDPPacedPacket;
 
 enum
 {
@@ -114,7 +216,13 @@ enum
   PROP_SEND_DUPLICATES,
   PROP_BUFFER_SIZE,
   PROP_BIND_ADDRESS,
-  PROP_BIND_PORT
+  PROP_BIND_PORT,
+  PROP_GSO,
+  PROP_PACING_BITRATE,
+  PROP_PACING_WINDOW,
+  PROP_PACING_MAX_DELAY,
+  PROP_PACING_QUEUE_DEPTH,
+  PROP_PACING_LAG
 };
 
 static void gst_multiudpsink_finalize (GObject * object);
@@ -128,6 +236,8 @@ static gboolean gst_multiudpsink_start (GstBaseSink * bsink);
 static gboolean gst_multiudpsink_stop (GstBaseSink * bsink);
 static gboolean gst_multiudpsink_unlock (GstBaseSink * bsink);
 static gboolean gst_multiudpsink_unlock_stop (GstBaseSink * bsink);
+static gboolean gst_multiudpsink_event (GstBaseSink * bsink, GstEvent * event);
+static void gst_multiudpsink_clear_paced_packets (GstMultiUDPSink * sink);
 
 static void gst_multiudpsink_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -216,7 +326,9 @@ gst_multiudpsink_class_init (GstMultiUDPSinkClass * klass)
    *
    * Returns: a GstStructure: bytes_sent, packets_sent, connect_time
    *           (in epoch nanoseconds), disconnect_time (in epoch
-   *           nanoseconds)
+   *           nanoseconds), messages_sent (since 1.20, number of send
+   *           operations, smaller than packets_sent when packets were
+   *           coalesced with #GstMultiUDPSink:gso)
    */
   gst_multiudpsink_signals[SIGNAL_GET_STATS] =
       g_signal_new ("get-stats", G_TYPE_FROM_CLASS (klass),
@@ -351,6 +463,93 @@ gst_multiudpsink_class_init (GstMultiUDPSinkClass * klass)
           "Port to bind the socket to", 0, G_MAXUINT16,
           DEFAULT_BIND_PORT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMultiUDPSink:gso:
+   *
+   * Coalesce consecutive packets of the same size for the same client into
+   * a single send with generic segmentation offload (UDP_SEGMENT), letting
+   * the kernel or the network card split them again. This is only
+   * available on Linux and is disabled automatically if the kernel refuses
+   * it.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_GSO,
+      g_param_spec_boolean ("gso", "GSO",
+          "Use UDP segmentation offload to send runs of equally sized "
+          "packets to the same client with a single message", DEFAULT_GSO,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiUDPSink:pacing-bitrate:
+   *
+   * Send packets at no more than this bitrate instead of in bursts. Packets
+   * are queued and sent by a separate thread, so rendering never blocks.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_PACING_BITRATE,
+      g_param_spec_uint64 ("pacing-bitrate", "Pacing Bitrate",
+          "Spread packets in time so that they are sent with at most this "
+          "bitrate in bits per second (0 = disabled)", 0, G_MAXUINT64,
+          DEFAULT_PACING_BITRATE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiUDPSink:pacing-window:
+   *
+   * Spread the packets of each buffer list evenly over this time window
+   * instead of sending them in one burst. Can be combined with
+   * #GstMultiUDPSink:pacing-bitrate, in which case the larger interval
+   * between two packets is used.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_PACING_WINDOW,
+      g_param_spec_uint64 ("pacing-window", "Pacing Window",
+          "Spread the packets of a buffer list over this time in nanoseconds "
+          "(0 = disabled)", 0, G_MAXUINT64, DEFAULT_PACING_WINDOW,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiUDPSink:pacing-max-delay:
+   *
+   * Maximum time a packet is held back by pacing. If data arrives faster
+   * than the pacing allows, packets are sent earlier than scheduled rather
+   * than queued without bound.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_PACING_MAX_DELAY,
+      g_param_spec_uint64 ("pacing-max-delay", "Pacing Max Delay",
+          "Maximum time in nanoseconds a packet is delayed by pacing",
+          0, G_MAXUINT64, DEFAULT_PACING_MAX_DELAY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiUDPSink:pacing-queue-depth:
+   *
+   * Number of packets currently waiting to be sent by the pacing thread.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_PACING_QUEUE_DEPTH,
+      g_param_spec_uint ("pacing-queue-depth", "Pacing Queue Depth",
+          "Number of packets waiting to be sent", 0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiUDPSink:pacing-lag:
+   *
+   * How late the last packet was sent compared to its scheduled time.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_PACING_LAG,
+      g_param_spec_uint64 ("pacing-lag", "Pacing Lag",
+          "How late the last packet was sent compared to its scheduled time "
+          "in nanoseconds", 0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &sink_template);
 
   gst_element_class_set_static_metadata (gstelement_class, "UDP packet sender",
@@ -365,6 +564,7 @@ gst_multiudpsink_class_init (GstMultiUDPSinkClass * klass)
   gstbasesink_class->stop = gst_multiudpsink_stop;
   gstbasesink_class->unlock = gst_multiudpsink_unlock;
   gstbasesink_class->unlock_stop = gst_multiudpsink_unlock_stop;
+  gstbasesink_class->event = gst_multiudpsink_event;
   klass->add = gst_multiudpsink_add;
   klass->remove = gst_multiudpsink_remove;
   klass->clear = gst_multiudpsink_clear;
@@ -419,6 +619,15 @@ gst_multiudpsink_init (GstMultiUDPSink * sink)
   sink->qos_dscp = DEFAULT_QOS_DSCP;
   sink->send_duplicates = DEFAULT_SEND_DUPLICATES;
   sink->multi_iface = g_strdup (DEFAULT_MULTICAST_IFACE);
+  sink->gso = DEFAULT_GSO;
+  sink->pacing_bitrate = DEFAULT_PACING_BITRATE;
+  sink->pacing_window = DEFAULT_PACING_WINDOW;
+  sink->pacing_max_delay = DEFAULT_PACING_MAX_DELAY;
+
+  g_mutex_init (&sink->pacing_lock);
+  g_cond_init (&sink->pacing_cond);
+  sink->pacing_queue =
+      gst_queue_array_new_for_struct (sizeof (GstUDPPacedPacket), 64);
 
   gst_multiudpsink_create_cancellable (sink);
 
@@ -557,10 +766,20 @@ gst_multiudpsink_finalize (GObject * object)
   sink->maps = NULL;
   g_free (sink->messages);
   sink->messages = NULL;
+  g_free (sink->gso_messages);
+  sink->gso_messages = NULL;
+  g_free (sink->gso_runs);
+  sink->gso_runs = NULL;
 
   g_free (sink->bind_address);
   sink->bind_address = NULL;
 
+  gst_multiudpsink_clear_paced_packets (sink);
+  gst_queue_array_free (sink->pacing_queue);
+  sink->pacing_queue = NULL;
+  g_mutex_clear (&sink->pacing_lock);
+  g_cond_clear (&sink->pacing_cond);
+
   g_mutex_clear (&sink->client_lock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -659,6 +878,10 @@ gst_multiudpsink_send_messages (GstMultiUDPSink * sink, GSocket * socket,
 
         g_clear_error (&err);
 
+        /* only the streaming thread can wait for preroll */
+        if (g_thread_self () == sink->pacing_thread)
+          return GST_FLOW_FLUSHING;
+
         flow_ret = gst_base_sink_wait_preroll (GST_BASE_SINK (sink));
 
         if (flow_ret == GST_FLOW_OK)
@@ -714,6 +937,276 @@ gst_multiudpsink_send_messages (GstMultiUDPSink * sink, GSocket * socket,
   return GST_FLOW_OK;
 }
 
+#ifdef UDP_SEGMENT
+/* Groups consecutive packets into runs that can be sent as a single
+ * UDP_SEGMENT message: all packets of a run have the segment size, except
+ * for the last one which may be smaller. Returns the number of runs. */
+static guint
+gst_multiudpsink_find_gso_runs (GstOutputMessage * msgs, guint num_buffers,
+    guint * run_starts, guint * run_lens, guint16 * seg_sizes)
+{
+  gboolean run_closed = TRUE;
+  gsize run_bytes = 0;
+  guint i, n_runs = 0;
+
+  for (i = 0; i < num_buffers; ++i) {
+    gsize size = gst_udp_calc_message_size (&msgs[i]);
+    guint r = n_runs - 1;
+
+    if (!run_closed && size > 0 && size <= seg_sizes[r]
+        && run_lens[r] < UDP_MAX_SEGMENTS && run_bytes + size <= UDP_MAX_SIZE) {
+      run_lens[r]++;
+      run_bytes += size;
+      /* a short packet terminates the run */
+      run_closed = (size < seg_sizes[r]);
+      continue;
+    }
+
+    run_starts[n_runs] = i;
+    run_lens[n_runs] = 1;
+    seg_sizes[n_runs] = MIN (size, G_MAXUINT16);
+    run_bytes = size;
+    run_closed = (size == 0 || size > UDP_MAX_SIZE);
+    n_runs++;
+  }
+
+  return n_runs;
+}
+
+static void
+gst_multiudpsink_mark_gso_runs_sent (GstUDPGsoRun * runs, guint n_runs)
+{
+  guint i, j;
+
+  for (i = 0; i < n_runs; ++i) {
+    runs[i].gso_sent = TRUE;
+    for (j = 0; j < runs[i].n_packets; ++j)
+      runs[i].first[j].bytes_sent =
+          gst_udp_calc_message_size (&runs[i].first[j]);
+  }
+}
+
+/* whether @err means that the kernel or the device can't do segmentation
+ * offload, as opposed to a failure to reach a client. EIO and ENOPROTOOPT
+ * have no GIOErrorEnum of their own and end up as G_IO_ERROR_FAILED */
+static gboolean
+gst_multiudpsink_is_gso_error (GError * err)
+{
+  return g_error_matches (err, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT) ||
+      g_error_matches (err, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED) ||
+      g_error_matches (err, G_IO_ERROR, G_IO_ERROR_FAILED);
+}
+
+/* Sends runs of packets with one UDP_SEGMENT message per run. If the kernel
+ * refuses that, GSO is disabled and the packets that were not sent yet are
+ * sent one by one. Other errors only make the packets of the failed run go
+ * out one by one, with the usual error handling. */
+static GstFlowReturn
+gst_multiudpsink_send_messages_gso (GstMultiUDPSink * sink, GSocket * socket,
+    GstOutputMessage * messages, GstUDPGsoRun * runs, guint num_messages)
+{
+  guint i, n_packets;
+
+  while (num_messages > 0 && sink->gso_active) {
+    GError *err = NULL;
+    gint ret, err_idx;
+
+    ret = g_socket_send_messages (socket, messages, num_messages, 0,
+        sink->cancellable, &err);
+
+    if (G_UNLIKELY (ret < 0)) {
+      GstFlowReturn flow_ret;
+
+      if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_clear_error (&err);
+
+        /* only the streaming thread can wait for preroll */
+        if (g_thread_self () == sink->pacing_thread)
+          return GST_FLOW_FLUSHING;
+
+        flow_ret = gst_base_sink_wait_preroll (GST_BASE_SINK (sink));
+
+        if (flow_ret == GST_FLOW_OK)
+          continue;
+
+        return flow_ret;
+      }
+
+      err_idx = gst_udp_messsages_find_first_not_sent (messages, num_messages);
+      if (err_idx < 0) {
+        /* everything went out after all */
+        g_clear_error (&err);
+        gst_multiudpsink_mark_gso_runs_sent (runs, num_messages);
+        return GST_FLOW_OK;
+      }
+
+      gst_multiudpsink_mark_gso_runs_sent (runs, err_idx);
+      messages += err_idx;
+      runs += err_idx;
+      num_messages -= err_idx;
+
+      if (gst_multiudpsink_is_gso_error (err)) {
+        GST_WARNING_OBJECT (sink, "Failed to send with UDP_SEGMENT, disabling "
+            "segmentation offload: %s", err->message);
+        g_clear_error (&err);
+        sink->gso_active = FALSE;
+        break;
+      }
+
+      GST_LOG_OBJECT (sink, "error sending UDP_SEGMENT message, sending its "
+          "packets one by one: %s", err->message);
+      g_clear_error (&err);
+
+      flow_ret = gst_multiudpsink_send_messages (sink, socket, runs[0].first,
+          runs[0].n_packets);
+      if (flow_ret != GST_FLOW_OK)
+        return flow_ret;
+
+      messages++;
+      runs++;
+      num_messages--;
+      continue;
+    }
+
+    g_assert (ret <= num_messages);
+
+    gst_multiudpsink_mark_gso_runs_sent (runs, ret);
+
+    messages += ret;
+    runs += ret;
+    num_messages -= ret;
+  }
+
+  if (num_messages == 0)
+    return GST_FLOW_OK;
+
+  /* the per-packet messages of all remaining runs are contiguous */
+  for (i = 0, n_packets = 0; i < num_messages; ++i)
+    n_packets += runs[i].n_packets;
+
+  return gst_multiudpsink_send_messages (sink, socket, runs[0].first,
+      n_packets);
+}
+
+/* Coalesces the per-packet messages of each client into UDP_SEGMENT
+ * messages and sends those. @client_msgs receives the number of messages
+ * sent to each client. */
+static GstFlowReturn
+gst_multiudpsink_render_gso (GstMultiUDPSink * sink, GstOutputMessage * msgs,
+    guint num_buffers, guint num_addr_v4, guint num_addr_v6,
+    guint * client_msgs)
+{
+  GstOutputMessage *gso_msgs;
+  GstUDPGsoRun *runs;
+  GstFlowReturn flow_ret;
+  guint *run_starts, *run_lens;
+  guint16 *seg_sizes;
+  guint num_addr, n_runs, num_gso_msgs;
+  guint i, j, k;
+
+  num_addr = num_addr_v4 + num_addr_v6;
+
+  run_starts = g_newa (guint, num_buffers);
+  run_lens = g_newa (guint, num_buffers);
+  seg_sizes = g_newa (guint16, num_buffers);
+
+  n_runs = gst_multiudpsink_find_gso_runs (msgs, num_buffers, run_starts,
+      run_lens, seg_sizes);
+
+  GST_LOG_OBJECT (sink, "coalesced %u packets into %u messages per client",
+      num_buffers, n_runs);
+
+  num_gso_msgs = num_addr * n_runs;
+  if (sink->n_gso_messages < num_gso_msgs) {
+    sink->n_gso_messages = GST_ROUND_UP_16 (num_gso_msgs);
+    g_free (sink->gso_messages);
+    sink->gso_messages = g_new (GstOutputMessage, sink->n_gso_messages);
+    g_free (sink->gso_runs);
+    sink->gso_runs = g_new (GstUDPGsoRun, sink->n_gso_messages);
+  }
+  gso_msgs = sink->gso_messages;
+  runs = sink->gso_runs;
+
+  for (i = 0; i < num_addr; ++i) {
+    for (j = 0; j < n_runs; ++j) {
+      GstOutputMessage *first = &msgs[i * num_buffers + run_starts[j]];
+      GstOutputMessage *msg = &gso_msgs[i * n_runs + j];
+      GstUDPGsoRun *run = &runs[i * n_runs + j];
+      guint num_vectors = 0;
+
+      for (k = 0; k < run_lens[j]; ++k)
+        num_vectors += first[k].num_vectors;
+
+      run->first = first;
+      run->n_packets = run_lens[j];
+      run->gso_sent = FALSE;
+      run->ctrl = NULL;
+      if (i == 0 && run_lens[j] > 1)
+        run->ctrl = gst_udp_segment_message_new (seg_sizes[j]);
+
+      /* the vectors of consecutive packets are consecutive too */
+      msg->address = first->address;
+      msg->vectors = first->vectors;
+      msg->num_vectors = num_vectors;
+      msg->bytes_sent = 0;
+      msg->control_messages = runs[j].ctrl ? &runs[j].ctrl : NULL;
+      msg->num_control_messages = runs[j].ctrl ? 1 : 0;
+    }
+  }
+
+  /* no IPv4 socket? Send it all from the IPv6 socket then.. */
+  if (sink->used_socket == NULL) {
+    flow_ret = gst_multiudpsink_send_messages_gso (sink, sink->used_socket_v6,
+        gso_msgs, runs, num_gso_msgs);
+  } else {
+    guint num_gso_msgs_v4 = n_runs * num_addr_v4;
+    guint num_gso_msgs_v6 = n_runs * num_addr_v6;
+
+    flow_ret = gst_multiudpsink_send_messages_gso (sink, sink->used_socket,
+        gso_msgs, runs, num_gso_msgs_v4);
+
+    if (flow_ret == GST_FLOW_OK)
+      flow_ret = gst_multiudpsink_send_messages_gso (sink,
+          sink->used_socket_v6, gso_msgs + num_gso_msgs_v4,
+          runs + num_gso_msgs_v4, num_gso_msgs_v6);
+  }
+
+  for (i = 0; i < num_addr; ++i) {
+    client_msgs[i] = 0;
+    for (j = 0; j < n_runs; ++j) {
+      GstUDPGsoRun *run = &runs[i * n_runs + j];
+
+      client_msgs[i] += run->gso_sent ? 1 : run->n_packets;
+    }
+  }
+
+  for (j = 0; j < n_runs; ++j)
+    g_clear_object (&runs[j].ctrl);
+
+  return flow_ret;
+}
+
+static gboolean
+gst_multiudpsink_probe_gso (GstMultiUDPSink * sink, GSocket * socket)
+{
+  GError *err = NULL;
+
+  if (socket == NULL)
+    return TRUE;
+
+  /* a segment size of 0 disables it again for sends without control
+   * message, we only care whether the kernel knows about the option */
+  if (!g_socket_set_option (socket, IPPROTO_UDP, UDP_SEGMENT, 0, &err)) {
+    GST_WARNING_OBJECT (sink, "UDP segmentation offload not supported: %s",
+        err->message);
+    g_clear_error (&err);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+#endif
+
 static GstFlowReturn
 gst_multiudpsink_render_buffers (GstMultiUDPSink * sink, GstBuffer ** buffers,
     guint num_buffers, guint8 * mem_nums, guint total_mem_num)
@@ -726,6 +1219,7 @@ gst_multiudpsink_render_buffers (GstMultiUDPSink * sink, GstBuffer ** buffers,
   GstFlowReturn flow_ret;
   guint num_addr_v4, num_addr_v6;
   guint num_addr, num_msgs;
+  guint *client_msgs = NULL;
   guint i, j, mem;
   gsize size = 0;
   GList *l;
@@ -810,8 +1304,15 @@ gst_multiudpsink_render_buffers (GstMultiUDPSink * sink, GstBuffer ** buffers,
 
   /* now send it! */
 
-  /* no IPv4 socket? Send it all from the IPv6 socket then.. */
+#ifdef UDP_SEGMENT
+  if (sink->gso_active && num_buffers > 1) {
+    client_msgs = g_newa (guint, num_addr);
+    flow_ret = gst_multiudpsink_render_gso (sink, msgs, num_buffers,
+        num_addr_v4, num_addr_v6, client_msgs);
+  } else
+#endif
   if (sink->used_socket == NULL) {
+    /* no IPv4 socket? Send it all from the IPv6 socket then.. */
     flow_ret = gst_multiudpsink_send_messages (sink, sink->used_socket_v6,
         msgs, num_msgs);
   } else {
@@ -847,6 +1348,7 @@ gst_multiudpsink_render_buffers (GstMultiUDPSink * sink, GstBuffer ** buffers,
       client->packets_sent++;
       sink->bytes_served += bytes_sent;
     }
+    client->messages_sent += client_msgs ? client_msgs[i] : num_buffers;
     gst_udp_client_unref (client);
   }
 
@@ -877,6 +1379,180 @@ cancelled:
   }
 }
 
+/* Queues the buffers for the pacing thread, spreading their send times over
+ * the pacing window and/or according to the pacing bitrate. Never blocks. */
+static GstFlowReturn
+gst_multiudpsink_pace_buffers (GstMultiUDPSink * sink, GstBuffer ** buffers,
+    guint num_buffers)
+{
+  GstUDPPacedPacket packet;
+  gint64 now, send_time, max_time, window_interval = 0;
+  GstFlowReturn flow_ret;
+  guint i;
+
+  g_mutex_lock (&sink->pacing_lock);
+  if (sink->pacing_flushing)
+    goto flushing;
+  if ((flow_ret = sink->pacing_flow) != GST_FLOW_OK)
+    goto send_error;
+
+  /* saturate instead of wrapping around for very large delays and windows */
+  now = g_get_monotonic_time ();
+  max_time = now + MIN (GST_TIME_AS_USECONDS (sink->pacing_max_delay),
+      G_MAXINT64 - now);
+  send_time = MAX (now, sink->pacing_next_time);
+
+  if (sink->pacing_window > 0)
+    window_interval = GST_TIME_AS_USECONDS (sink->pacing_window) / num_buffers;
+
+  for (i = 0; i < num_buffers; ++i) {
+    gint64 interval = window_interval;
+
+    if (gst_buffer_n_memory (buffers[i]) == 0)
+      continue;
+
+    if (sink->pacing_bitrate > 0)
+      interval = MAX (interval,
+          gst_util_uint64_scale (gst_buffer_get_size (buffers[i]) * 8,
+              G_USEC_PER_SEC, sink->pacing_bitrate));
+
+    packet.buffer = gst_buffer_ref (buffers[i]);
+    packet.send_time = MIN (send_time, max_time);
+    gst_queue_array_push_tail_struct (sink->pacing_queue, &packet);
+
+    send_time += MIN (interval, G_MAXINT64 - send_time);
+  }
+  sink->pacing_next_time = MIN (send_time, max_time);
+
+  GST_LOG_OBJECT (sink, "queued %u buffers, %u pending", num_buffers,
+      gst_queue_array_get_length (sink->pacing_queue));
+
+  g_cond_broadcast (&sink->pacing_cond);
+  g_mutex_unlock (&sink->pacing_lock);
+
+  return GST_FLOW_OK;
+
+flushing:
+  {
+    g_mutex_unlock (&sink->pacing_lock);
+    return GST_FLOW_FLUSHING;
+  }
+send_error:
+  {
+    g_mutex_unlock (&sink->pacing_lock);
+    return flow_ret;
+  }
+}
+
+static void
+gst_multiudpsink_clear_paced_packets (GstMultiUDPSink * sink)
+{
+  GstUDPPacedPacket *packet;
+
+  while ((packet = gst_queue_array_pop_head_struct (sink->pacing_queue)))
+    gst_buffer_unref (packet->buffer);
+}
+
+#define PACING_MAX_BATCH 64
+
+/* Sends the queued packets when they are due. Packets that became due at the
+ * same time are sent together with a single call. */
+static gpointer
+gst_multiudpsink_pacing_thread (GstMultiUDPSink * sink)
+{
+  GstBuffer *buffers[PACING_MAX_BATCH];
+  guint8 mem_nums[PACING_MAX_BATCH];
+
+  g_mutex_lock (&sink->pacing_lock);
+  while (sink->pacing_running) {
+    GstUDPPacedPacket *packet = NULL;
+    GstFlowReturn flow_ret;
+    guint i, n = 0, total_mems = 0;
+    gint64 now;
+
+    if (!sink->pacing_flushing)
+      packet = gst_queue_array_peek_head_struct (sink->pacing_queue);
+
+    if (packet == NULL) {
+      g_cond_wait (&sink->pacing_cond, &sink->pacing_lock);
+      continue;
+    }
+
+    now = g_get_monotonic_time ();
+    if (packet->send_time > now) {
+      g_cond_wait_until (&sink->pacing_cond, &sink->pacing_lock,
+          packet->send_time);
+      continue;
+    }
+
+    while (n < PACING_MAX_BATCH
+        && (packet = gst_queue_array_peek_head_struct (sink->pacing_queue))
+        && packet->send_time <= now) {
+      sink->pacing_lag = (now - packet->send_time) * GST_USECOND;
+      buffers[n] = packet->buffer;
+      mem_nums[n] = gst_buffer_n_memory (packet->buffer);
+      total_mems += mem_nums[n];
+      gst_queue_array_pop_head_struct (sink->pacing_queue);
+      n++;
+    }
+
+    sink->pacing_sending = TRUE;
+    g_mutex_unlock (&sink->pacing_lock);
+
+    flow_ret = gst_multiudpsink_render_buffers (sink, buffers, n, mem_nums,
+        total_mems);
+
+    for (i = 0; i < n; ++i)
+      gst_buffer_unref (buffers[i]);
+
+    g_mutex_lock (&sink->pacing_lock);
+    sink->pacing_sending = FALSE;
+    if (flow_ret != GST_FLOW_OK && flow_ret != GST_FLOW_FLUSHING)
+      sink->pacing_flow = flow_ret;
+    /* wake up anyone waiting for us to drain or go idle */
+    g_cond_broadcast (&sink->pacing_cond);
+  }
+  g_mutex_unlock (&sink->pacing_lock);
+
+  return NULL;
+}
+
+static void
+gst_multiudpsink_start_pacing (GstMultiUDPSink * sink)
+{
+  g_mutex_lock (&sink->pacing_lock);
+  sink->pacing_running = TRUE;
+  sink->pacing_flushing = FALSE;
+  sink->pacing_flow = GST_FLOW_OK;
+  sink->pacing_next_time = 0;
+  sink->pacing_lag = 0;
+  sink->pacing_thread = g_thread_new ("multiudpsink-pacing",
+      (GThreadFunc) gst_multiudpsink_pacing_thread, sink);
+  g_mutex_unlock (&sink->pacing_lock);
+}
+
+static void
+gst_multiudpsink_stop_pacing (GstMultiUDPSink * sink)
+{
+  GThread *thread;
+
+  g_mutex_lock (&sink->pacing_lock);
+  thread = sink->pacing_thread;
+  sink->pacing_running = FALSE;
+  g_cond_broadcast (&sink->pacing_cond);
+  g_mutex_unlock (&sink->pacing_lock);
+
+  if (thread == NULL)
+    return;
+
+  g_thread_join (thread);
+
+  g_mutex_lock (&sink->pacing_lock);
+  sink->pacing_thread = NULL;
+  gst_multiudpsink_clear_paced_packets (sink);
+  g_mutex_unlock (&sink->pacing_lock);
+}
+
 static GstFlowReturn
 gst_multiudpsink_render_list (GstBaseSink * bsink, GstBufferList * buffer_list)
 {
@@ -901,6 +1577,9 @@ gst_multiudpsink_render_list (GstBaseSink * bsink, GstBufferList * buffer_list)
     total_mems += mem_nums[i];
   }
 
+  if (sink->pacing_thread)
+    return gst_multiudpsink_pace_buffers (sink, buffers, num_buffers);
+
   flow = gst_multiudpsink_render_buffers (sink, buffers, num_buffers,
       mem_nums, total_mems);
 
@@ -924,10 +1603,12 @@ gst_multiudpsink_render (GstBaseSink * bsink, GstBuffer * buffer)
 
   n_mem = gst_buffer_n_memory (buffer);
 
-  if (n_mem > 0)
-    flow = gst_multiudpsink_render_buffers (sink, &buffer, 1, &n_mem, n_mem);
-  else
+  if (n_mem == 0)
     flow = GST_FLOW_OK;
+  else if (sink->pacing_thread)
+    flow = gst_multiudpsink_pace_buffers (sink, &buffer, 1);
+  else
+    flow = gst_multiudpsink_render_buffers (sink, &buffer, 1, &n_mem, n_mem);
 
   return flow;
 }
@@ -1094,6 +1775,24 @@ gst_multiudpsink_set_property (GObject * object, guint prop_id,
     case PROP_BIND_PORT:
       udpsink->bind_port = g_value_get_int (value);
       break;
+    case PROP_GSO:
+      udpsink->gso = g_value_get_boolean (value);
+      break;
+    case PROP_PACING_BITRATE:
+      g_mutex_lock (&udpsink->pacing_lock);
+      udpsink->pacing_bitrate = g_value_get_uint64 (value);
+      g_mutex_unlock (&udpsink->pacing_lock);
+      break;
+    case PROP_PACING_WINDOW:
+      g_mutex_lock (&udpsink->pacing_lock);
+      udpsink->pacing_window = g_value_get_uint64 (value);
+      g_mutex_unlock (&udpsink->pacing_lock);
+      break;
+    case PROP_PACING_MAX_DELAY:
+      g_mutex_lock (&udpsink->pacing_lock);
+      udpsink->pacing_max_delay = g_value_get_uint64 (value);
+      g_mutex_unlock (&udpsink->pacing_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1167,6 +1866,29 @@ gst_multiudpsink_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_BIND_PORT:
       g_value_set_int (value, udpsink->bind_port);
       break;
+    case PROP_GSO:
+      g_value_set_boolean (value, udpsink->gso);
+      break;
+    case PROP_PACING_BITRATE:
+      g_value_set_uint64 (value, udpsink->pacing_bitrate);
+      break;
+    case PROP_PACING_WINDOW:
+      g_value_set_uint64 (value, udpsink->pacing_window);
+      break;
+    case PROP_PACING_MAX_DELAY:
+      g_value_set_uint64 (value, udpsink->pacing_max_delay);
+      break;
+    case PROP_PACING_QUEUE_DEPTH:
+      g_mutex_lock (&udpsink->pacing_lock);
+      g_value_set_uint (value,
+          gst_queue_array_get_length (udpsink->pacing_queue));
+      g_mutex_unlock (&udpsink->pacing_lock);
+      break;
+    case PROP_PACING_LAG:
+      g_mutex_lock (&udpsink->pacing_lock);
+      g_value_set_uint64 (value, udpsink->pacing_lag);
+      g_mutex_unlock (&udpsink->pacing_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1428,6 +2150,20 @@ gst_multiudpsink_start (GstBaseSink * bsink)
   gst_multiudpsink_setup_qos_dscp (sink, sink->used_socket);
   gst_multiudpsink_setup_qos_dscp (sink, sink->used_socket_v6);
 
+  sink->gso_active = FALSE;
+  if (sink->gso) {
+#ifdef UDP_SEGMENT
+    sink->gso_active = gst_multiudpsink_probe_gso (sink, sink->used_socket)
+        && gst_multiudpsink_probe_gso (sink, sink->used_socket_v6);
+#else
+    GST_WARNING_OBJECT (sink, "UDP segmentation offload not supported on "
+        "this platform");
+#endif
+  }
+
+  if (sink->pacing_bitrate > 0 || sink->pacing_window > 0)
+    gst_multiudpsink_start_pacing (sink);
+
   /* look for multicast clients and join multicast groups appropriately
      set also ttl and multicast loopback delivery appropriately  */
   for (clients = sink->clients; clients; clients = g_list_next (clients)) {
@@ -1470,6 +2206,8 @@ gst_multiudpsink_stop (GstBaseSink * bsink)
 
   udpsink = GST_MULTIUDPSINK (bsink);
 
+  gst_multiudpsink_stop_pacing (udpsink);
+
   if (udpsink->used_socket) {
     if (udpsink->close_socket || !udpsink->external_socket) {
       GError *err = NULL;
@@ -1763,6 +2501,7 @@ gst_multiudpsink_get_stats (GstMultiUDPSink * sink, const gchar * host,
   gst_structure_set (result,
       "bytes-sent", G_TYPE_UINT64, client->bytes_sent,
       "packets-sent", G_TYPE_UINT64, client->packets_sent,
+      "messages-sent", G_TYPE_UINT64, client->messages_sent,
       "connect-time", G_TYPE_UINT64, client->connect_time,
       "disconnect-time", G_TYPE_UINT64, client->disconnect_time, NULL);
 
@@ -1791,6 +2530,16 @@ gst_multiudpsink_unlock (GstBaseSink * bsink)
 
   g_cancellable_cancel (sink->cancellable);
 
+  /* drop everything that is waiting for pacing and make sure the pacing
+   * thread is not using the cancellable anymore before it gets replaced */
+  g_mutex_lock (&sink->pacing_lock);
+  sink->pacing_flushing = TRUE;
+  gst_multiudpsink_clear_paced_packets (sink);
+  while (sink->pacing_sending)
+    g_cond_wait (&sink->pacing_cond, &sink->pacing_lock);
+  g_cond_broadcast (&sink->pacing_cond);
+  g_mutex_unlock (&sink->pacing_lock);
+
   return TRUE;
 }
 
@@ -1804,5 +2553,31 @@ gst_multiudpsink_unlock_stop (GstBaseSink * bsink)
   gst_multiudpsink_free_cancellable (sink);
   gst_multiudpsink_create_cancellable (sink);
 
+  g_mutex_lock (&sink->pacing_lock);
+  sink->pacing_flushing = FALSE;
+  sink->pacing_flow = GST_FLOW_OK;
+  sink->pacing_next_time = 0;
+  g_mutex_unlock (&sink->pacing_lock);
+
   return TRUE;
 }
+
+static gboolean
+gst_multiudpsink_event (GstBaseSink * bsink, GstEvent * event)
+{
+  GstMultiUDPSink *sink;
+
+  sink = GST_MULTIUDPSINK (bsink);
+
+  /* EOS is only posted once all paced packets went out */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS && sink->pacing_thread) {
+    g_mutex_lock (&sink->pacing_lock);
+    while (!sink->pacing_flushing && sink->pacing_running
+        && (sink->pacing_sending
+            || !gst_queue_array_is_empty (sink->pacing_queue)))
+      g_cond_wait (&sink->pacing_cond, &sink->pacing_lock);
+    g_mutex_unlock (&sink->pacing_lock);
+  }
+
+  return GST_BASE_SINK_CLASS (parent_class)->event (bsink, event);
+}
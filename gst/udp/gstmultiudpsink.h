@@ -22,6 +22,7 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasesink.h>
+#include <gst/base/gstqueuearray.h>
 #include <gio/gio.h>
 
 G_BEGIN_DECLS
@@ -51,10 +52,19 @@ typedef struct {
   /* Per-client stats */
   guint64 bytes_sent;
   guint64 packets_sent;
+  guint64 messages_sent;
   guint64 connect_time;
   guint64 disconnect_time;
 } GstUDPClient;
 
+/* A run of equally sized packets sent with a single UDP_SEGMENT message */
+typedef struct {
+  GstOutputMessage *first;      /* first per-packet message of the run */
+  guint n_packets;
+  GSocketControlMessage *ctrl;  /* segment size, only set for the first client */
+  gboolean gso_sent;            /* sent as one message or packet by packet */
+} GstUDPGsoRun;
+
 /* sends udp packets to multiple host/port pairs.
  */
 struct _GstMultiUDPSink {
@@ -81,6 +91,9 @@ struct _GstMultiUDPSink {
   guint             n_maps;
   GstOutputMessage *messages;
   guint             n_messages;
+  GstOutputMessage *gso_messages;
+  GstUDPGsoRun     *gso_runs;
+  guint             n_gso_messages;
 
   /* properties */
   guint64        bytes_to_serve;
@@ -102,6 +115,26 @@ struct _GstMultiUDPSink {
   gint           buffer_size;
   gchar         *bind_address;
   gint           bind_port;
+  gboolean       gso;
+
+  /* whether UDP_SEGMENT is currently used, cleared if the kernel refuses it */
+  gboolean       gso_active;
+
+  /* pacing */
+  guint64        pacing_bitrate;
+  GstClockTime   pacing_window;
+  GstClockTime   pacing_max_delay;
+
+  GMutex         pacing_lock;
+  GCond          pacing_cond;
+  GThread       *pacing_thread;
+  GstQueueArray *pacing_queue;   /* GstUDPPacedPacket, ordered by send time */
+  gboolean       pacing_running;
+  gboolean       pacing_flushing;
+  gboolean       pacing_sending;
+  gint64         pacing_next_time;
+  GstClockTime   pacing_lag;
+  GstFlowReturn  pacing_flow;
 };
 
 struct _GstMultiUDPSinkClass {
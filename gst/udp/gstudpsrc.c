@@ -53,6 +53,11 @@
  * for example, the default buffer size is typically 50K and can be increased to
  * maximally 100K.
  *
+ * The #GstUDPSrc:batch-size property can be used to read several packets per
+ * wakeup with a single system call where supported. The packets are then
+ * pushed downstream as a #GstBufferList, which reduces the per-packet overhead
+ * for high packet rates.
+ *
  * The #GstUDPSrc:skip-first-bytes property is used to strip off an arbitrary
  * number of bytes from the start of the raw udp packet and can be used to strip
  * off proprietary header, for example.
@@ -570,6 +575,18 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
 #define UDP_DEFAULT_LOOP               TRUE
 #define UDP_DEFAULT_RETRIEVE_SENDER_ADDRESS TRUE
 #define UDP_DEFAULT_MTU                (1492)
+#define UDP_DEFAULT_BATCH_SIZE         1
+
+/* One pending packet of a batched receive */
+struct _GstUDPSrcBatchSlot
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  GInputVector vec;
+  GSocketAddress *saddr;
+  GSocketControlMessage **msgs;
+  guint n_msgs;
+};
 
 enum
 {
@@ -593,6 +610,7 @@ enum
   PROP_RETRIEVE_SENDER_ADDRESS,
   PROP_MTU,
   PROP_SOCKET_TIMESTAMP,
+  PROP_BATCH_SIZE,
 };
 
 static void gst_udpsrc_uri_handler_init (gpointer g_iface, gpointer iface_data);
@@ -602,6 +620,9 @@ static gboolean gst_udpsrc_close (GstUDPSrc * src);
 static gboolean gst_udpsrc_unlock (GstBaseSrc * bsrc);
 static gboolean gst_udpsrc_unlock_stop (GstBaseSrc * bsrc);
 static GstFlowReturn gst_udpsrc_fill (GstPushSrc * psrc, GstBuffer * outbuf);
+static GstFlowReturn gst_udpsrc_create (GstBaseSrc * bsrc, guint64 offset,
+    guint length, GstBuffer ** buf);
+static void gst_udpsrc_free_batch (GstUDPSrc * udpsrc);
 
 static void gst_udpsrc_finalize (GObject * object);
 
@@ -779,6 +800,24 @@ gst_udpsrc_class_init (GstUDPSrcClass * klass)
           GST_SOCKET_TIMESTAMP_MODE, GST_SOCKET_TIMESTAMP_MODE_REALTIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstUDPSrc:batch-size:
+   *
+   * Maximum number of packets to receive per wakeup. When bigger than 1,
+   * packets are read with a single recvmmsg() call where available and
+   * pushed downstream as a #GstBufferList.
+   *
+   * In this mode packets bigger than #GstUDPSrc:mtu are dropped, so the mtu
+   * should be set to the largest expected packet size.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_BATCH_SIZE,
+      g_param_spec_uint ("batch-size", "Batch Size",
+          "Maximum number of packets to receive per wakeup and push as a "
+          "buffer list (1 = push single buffers)", 1, 1024,
+          UDP_DEFAULT_BATCH_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_template);
 
   gst_element_class_set_static_metadata (gstelement_class,
@@ -793,6 +832,7 @@ gst_udpsrc_class_init (GstUDPSrcClass * klass)
   gstbasesrc_class->unlock_stop = gst_udpsrc_unlock_stop;
   gstbasesrc_class->get_caps = gst_udpsrc_getcaps;
   gstbasesrc_class->decide_allocation = gst_udpsrc_decide_allocation;
+  gstbasesrc_class->create = gst_udpsrc_create;
 
   gstpushsrc_class->fill = gst_udpsrc_fill;
 
@@ -821,6 +861,7 @@ gst_udpsrc_init (GstUDPSrc * udpsrc)
   udpsrc->loop = UDP_DEFAULT_LOOP;
   udpsrc->retrieve_sender_address = UDP_DEFAULT_RETRIEVE_SENDER_ADDRESS;
   udpsrc->mtu = UDP_DEFAULT_MTU;
+  udpsrc->batch_size = UDP_DEFAULT_BATCH_SIZE;
 
   /* configure basesrc to be a live source */
   gst_base_src_set_live (GST_BASE_SRC (udpsrc), TRUE);
@@ -863,6 +904,8 @@ gst_udpsrc_finalize (GObject * object)
     gst_memory_unref (udpsrc->extra_mem);
   udpsrc->extra_mem = NULL;
 
+  gst_udpsrc_free_batch (udpsrc);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -912,6 +955,201 @@ gst_udpsrc_free_cancellable (GstUDPSrc * src)
   src->cancellable = NULL;
 }
 
+/* optimization: use messages only in multicast mode and
+ * if we can't let the kernel do the filtering for us */
+static gboolean
+gst_udpsrc_needs_control_messages (GstUDPSrc * udpsrc)
+{
+  gboolean res;
+
+  res =
+      g_inet_address_get_is_multicast (g_inet_socket_address_get_address
+      (udpsrc->addr));
+#ifdef IP_MULTICAST_ALL
+  if (g_inet_address_get_family (g_inet_socket_address_get_address
+          (udpsrc->addr)) == G_SOCKET_FAMILY_IPV4)
+    res = FALSE;
+#endif
+#ifdef SO_TIMESTAMPNS
+  if (udpsrc->socket_timestamp_mode == GST_SOCKET_TIMESTAMP_MODE_REALTIME)
+    res = TRUE;
+#endif
+
+  return res;
+}
+
+/* Waits until the socket becomes readable, posting timeout messages
+ * while doing so */
+static GstFlowReturn
+gst_udpsrc_wait_readable (GstUDPSrc * udpsrc)
+{
+  GError *err = NULL;
+  gboolean try_again;
+
+  do {
+    gint64 timeout;
+
+    try_again = FALSE;
+
+    if (udpsrc->timeout)
+      timeout = udpsrc->timeout / 1000;
+    else
+      timeout = -1;
+
+    GST_LOG_OBJECT (udpsrc, "doing select, timeout %" G_GINT64_FORMAT, timeout);
+
+    if (!g_socket_condition_timed_wait (udpsrc->used_socket, G_IO_IN | G_IO_PRI,
+            timeout, udpsrc->cancellable, &err)) {
+      if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_BUSY)
+          || g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        goto stopped;
+      } else if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_TIMED_OUT)) {
+        g_clear_error (&err);
+        /* timeout, post element message */
+        gst_element_post_message (GST_ELEMENT_CAST (udpsrc),
+            gst_message_new_element (GST_OBJECT_CAST (udpsrc),
+                gst_structure_new ("GstUDPSrcTimeout",
+                    "timeout", G_TYPE_UINT64, udpsrc->timeout, NULL)));
+      } else {
+        goto select_error;
+      }
+
+      try_again = TRUE;
+    }
+  } while (G_UNLIKELY (try_again));
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+select_error:
+  {
+    GST_ELEMENT_ERROR (udpsrc, RESOURCE, READ, (NULL),
+        ("select error: %s", err->message));
+    g_clear_error (&err);
+    return GST_FLOW_ERROR;
+  }
+stopped:
+  {
+    GST_DEBUG ("stop called");
+    g_clear_error (&err);
+    return GST_FLOW_FLUSHING;
+  }
+}
+
+/* Processes and frees the control messages received together with the packet
+ * in @outbuf. Sets the DTS from the socket timestamp if there is one and
+ * returns %FALSE if the packet was for a different multicast address and
+ * should be dropped. */
+static gboolean
+gst_udpsrc_handle_control_messages (GstUDPSrc * udpsrc, GstBuffer * outbuf,
+    GSocketControlMessage ** msgs, gint n_msgs)
+{
+  GInetAddress *iaddr = g_inet_socket_address_get_address (udpsrc->addr);
+  gboolean skip_packet = FALSE;
+  gsize iaddr_size = g_inet_address_get_native_size (iaddr);
+  const guint8 *iaddr_bytes = g_inet_address_to_bytes (iaddr);
+  gint i;
+
+  for (i = 0; i < n_msgs && !skip_packet; i++) {
+#ifdef IP_PKTINFO
+    if (GST_IS_IP_PKTINFO_MESSAGE (msgs[i])) {
+      GstIPPktinfoMessage *msg = GST_IP_PKTINFO_MESSAGE (msgs[i]);
+
+      if (sizeof (msg->addr) == iaddr_size
+          && memcmp (iaddr_bytes, &msg->addr, sizeof (msg->addr)))
+        skip_packet = TRUE;
+    }
+#endif
+#ifdef IPV6_PKTINFO
+    if (GST_IS_IPV6_PKTINFO_MESSAGE (msgs[i])) {
+      GstIPV6PktinfoMessage *msg = GST_IPV6_PKTINFO_MESSAGE (msgs[i]);
+
+      if (sizeof (msg->addr) == iaddr_size
+          && memcmp (iaddr_bytes, &msg->addr, sizeof (msg->addr)))
+        skip_packet = TRUE;
+    }
+#endif
+#ifdef IP_RECVDSTADDR
+    if (GST_IS_IP_RECVDSTADDR_MESSAGE (msgs[i])) {
+      GstIPRecvdstaddrMessage *msg = GST_IP_RECVDSTADDR_MESSAGE (msgs[i]);
+
+      if (sizeof (msg->addr) == iaddr_size
+          && memcmp (iaddr_bytes, &msg->addr, sizeof (msg->addr)))
+        skip_packet = TRUE;
+    }
+#endif
+#ifdef SO_TIMESTAMPNS
+    if (GST_IS_SOCKET_TIMESTAMP_MESSAGE (msgs[i])) {
+      GstSocketTimestampMessage *msg = GST_SOCKET_TIMESTAMP_MESSAGE (msgs[i]);
+      GstClock *clock;
+      GstClockTime socket_ts;
+
+      socket_ts = GST_TIMESPEC_TO_TIME (msg->socket_ts);
+      GST_TRACE_OBJECT (udpsrc,
+          "Got SCM_TIMESTAMPNS %" GST_TIME_FORMAT " in msg",
+          GST_TIME_ARGS (socket_ts));
+
+      clock = gst_element_get_clock (GST_ELEMENT_CAST (udpsrc));
+      if (clock != NULL) {
+        gint64 adjust_dts, cur_sys_time, delta;
+        GstClockTime base_time, cur_gst_clk_time, running_time;
+
+        /*
+         * We use g_get_real_time as the time reference for SCM timestamps
+         * is always CLOCK_REALTIME.
+         */
+        cur_sys_time = g_get_real_time () * GST_USECOND;
+        cur_gst_clk_time = gst_clock_get_time (clock);
+
+        delta = (gint64) cur_sys_time - (gint64) socket_ts;
+        if (delta < 0) {
+          /*
+           * The current system time will always be greater than the SCM
+           * timestamp as the packet would have been timestamped at least
+           * some clock cycles before. If it is not, then the system time
+           * was adjusted. Since we cannot rely on the delta calculation in
+           * such a case, set the DTS to current pipeline clock when this
+           * happens.
+           */
+          GST_LOG_OBJECT (udpsrc,
+              "Current system time is behind SCM timestamp, setting DTS to pipeline clock");
+          GST_BUFFER_DTS (outbuf) = cur_gst_clk_time;
+        } else {
+          base_time = gst_element_get_base_time (GST_ELEMENT_CAST (udpsrc));
+          running_time = cur_gst_clk_time - base_time;
+          adjust_dts = (gint64) running_time - delta;
+          /*
+           * If the system time was adjusted much further ahead, we might
+           * end up with delta > cur_gst_clk_time. Set the DTS to current
+           * pipeline clock for this scenario as well.
+           */
+          if (adjust_dts < 0) {
+            GST_LOG_OBJECT (udpsrc,
+                "Current system time much ahead in time, setting DTS to pipeline clock");
+            GST_BUFFER_DTS (outbuf) = cur_gst_clk_time;
+          } else {
+            GST_BUFFER_DTS (outbuf) = adjust_dts;
+            GST_LOG_OBJECT (udpsrc, "Setting DTS to %" GST_TIME_FORMAT,
+                GST_TIME_ARGS (GST_BUFFER_DTS (outbuf)));
+          }
+        }
+        g_object_unref (clock);
+      } else {
+        GST_ERROR_OBJECT (udpsrc,
+            "Failed to get element clock, not setting DTS");
+      }
+    }
+#endif
+  }
+
+  for (i = 0; i < n_msgs; i++) {
+    g_object_unref (msgs[i]);
+  }
+  g_free (msgs);
+
+  return !skip_packet;
+}
+
 static GstFlowReturn
 gst_udpsrc_fill (GstPushSrc * psrc, GstBuffer * outbuf)
 {
@@ -919,33 +1157,20 @@ gst_udpsrc_fill (GstPushSrc * psrc, GstBuffer * outbuf)
   GSocketAddress *saddr = NULL;
   GSocketAddress **p_saddr;
   gint flags = G_SOCKET_MSG_NONE;
-  gboolean try_again;
   GError *err = NULL;
+  GstFlowReturn ret;
   gssize res;
   gsize offset;
   GSocketControlMessage **msgs = NULL;
   GSocketControlMessage ***p_msgs;
-  gint n_msgs = 0, i;
+  gint n_msgs = 0;
   GstMapInfo info;
   GstMapInfo extra_info;
   GInputVector ivec[2];
 
   udpsrc = GST_UDPSRC_CAST (psrc);
 
-  /* optimization: use messages only in multicast mode and
-   * if we can't let the kernel do the filtering for us */
-  p_msgs =
-      (g_inet_address_get_is_multicast (g_inet_socket_address_get_address
-          (udpsrc->addr))) ? &msgs : NULL;
-#ifdef IP_MULTICAST_ALL
-  if (g_inet_address_get_family (g_inet_socket_address_get_address
-          (udpsrc->addr)) == G_SOCKET_FAMILY_IPV4)
-    p_msgs = NULL;
-#endif
-#ifdef SO_TIMESTAMPNS
-  if (udpsrc->socket_timestamp_mode == GST_SOCKET_TIMESTAMP_MODE_REALTIME)
-    p_msgs = &msgs;
-#endif
+  p_msgs = gst_udpsrc_needs_control_messages (udpsrc) ? &msgs : NULL;
 
   /* Retrieve sender address unless we've been configured not to do so */
   p_saddr = (udpsrc->retrieve_sender_address) ? &saddr : NULL;
@@ -988,37 +1213,8 @@ retry:
     saddr = NULL;
   }
 
-  do {
-    gint64 timeout;
-
-    try_again = FALSE;
-
-    if (udpsrc->timeout)
-      timeout = udpsrc->timeout / 1000;
-    else
-      timeout = -1;
-
-    GST_LOG_OBJECT (udpsrc, "doing select, timeout %" G_GINT64_FORMAT, timeout);
-
-    if (!g_socket_condition_timed_wait (udpsrc->used_socket, G_IO_IN | G_IO_PRI,
-            timeout, udpsrc->cancellable, &err)) {
-      if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_BUSY)
-          || g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
-        goto stopped;
-      } else if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_TIMED_OUT)) {
-        g_clear_error (&err);
-        /* timeout, post element message */
-        gst_element_post_message (GST_ELEMENT_CAST (udpsrc),
-            gst_message_new_element (GST_OBJECT_CAST (udpsrc),
-                gst_structure_new ("GstUDPSrcTimeout",
-                    "timeout", G_TYPE_UINT64, udpsrc->timeout, NULL)));
-      } else {
-        goto select_error;
-      }
-
-      try_again = TRUE;
-    }
-  } while (G_UNLIKELY (try_again));
+  if ((ret = gst_udpsrc_wait_readable (udpsrc)) != GST_FLOW_OK)
+    goto wait_failed;
 
   res =
       g_socket_receive_message (udpsrc->used_socket, p_saddr, ivec, 2,
@@ -1039,114 +1235,11 @@ retry:
 
   /* Retry if multicast and the destination address is not ours. We don't want
    * to receive arbitrary packets */
-  if (p_msgs) {
-    GInetAddress *iaddr = g_inet_socket_address_get_address (udpsrc->addr);
-    gboolean skip_packet = FALSE;
-    gsize iaddr_size = g_inet_address_get_native_size (iaddr);
-    const guint8 *iaddr_bytes = g_inet_address_to_bytes (iaddr);
-
-    for (i = 0; i < n_msgs && !skip_packet; i++) {
-#ifdef IP_PKTINFO
-      if (GST_IS_IP_PKTINFO_MESSAGE (msgs[i])) {
-        GstIPPktinfoMessage *msg = GST_IP_PKTINFO_MESSAGE (msgs[i]);
-
-        if (sizeof (msg->addr) == iaddr_size
-            && memcmp (iaddr_bytes, &msg->addr, sizeof (msg->addr)))
-          skip_packet = TRUE;
-      }
-#endif
-#ifdef IPV6_PKTINFO
-      if (GST_IS_IPV6_PKTINFO_MESSAGE (msgs[i])) {
-        GstIPV6PktinfoMessage *msg = GST_IPV6_PKTINFO_MESSAGE (msgs[i]);
-
-        if (sizeof (msg->addr) == iaddr_size
-            && memcmp (iaddr_bytes, &msg->addr, sizeof (msg->addr)))
-          skip_packet = TRUE;
-      }
-#endif
-#ifdef IP_RECVDSTADDR
-      if (GST_IS_IP_RECVDSTADDR_MESSAGE (msgs[i])) {
-        GstIPRecvdstaddrMessage *msg = GST_IP_RECVDSTADDR_MESSAGE (msgs[i]);
-
-        if (sizeof (msg->addr) == iaddr_size
-            && memcmp (iaddr_bytes, &msg->addr, sizeof (msg->addr)))
-          skip_packet = TRUE;
-      }
-#endif
-#ifdef SO_TIMESTAMPNS
-      if (GST_IS_SOCKET_TIMESTAMP_MESSAGE (msgs[i])) {
-        GstSocketTimestampMessage *msg = GST_SOCKET_TIMESTAMP_MESSAGE (msgs[i]);
-        GstClock *clock;
-        GstClockTime socket_ts;
-
-        socket_ts = GST_TIMESPEC_TO_TIME (msg->socket_ts);
-        GST_TRACE_OBJECT (udpsrc,
-            "Got SCM_TIMESTAMPNS %" GST_TIME_FORMAT " in msg",
-            GST_TIME_ARGS (socket_ts));
-
-        clock = gst_element_get_clock (GST_ELEMENT_CAST (udpsrc));
-        if (clock != NULL) {
-          gint64 adjust_dts, cur_sys_time, delta;
-          GstClockTime base_time, cur_gst_clk_time, running_time;
-
-          /*
-           * We use g_get_real_time as the time reference for SCM timestamps
-           * is always CLOCK_REALTIME.
-           */
-          cur_sys_time = g_get_real_time () * GST_USECOND;
-          cur_gst_clk_time = gst_clock_get_time (clock);
-
-          delta = (gint64) cur_sys_time - (gint64) socket_ts;
-          if (delta < 0) {
-            /*
-             * The current system time will always be greater than the SCM
-             * timestamp as the packet would have been timestamped at least
-             * some clock cycles before. If it is not, then the system time
-             * was adjusted. Since we cannot rely on the delta calculation in
-             * such a case, set the DTS to current pipeline clock when this
-             * happens.
-             */
-            GST_LOG_OBJECT (udpsrc,
-                "Current system time is behind SCM timestamp, setting DTS to pipeline clock");
-            GST_BUFFER_DTS (outbuf) = cur_gst_clk_time;
-          } else {
-            base_time = gst_element_get_base_time (GST_ELEMENT_CAST (udpsrc));
-            running_time = cur_gst_clk_time - base_time;
-            adjust_dts = (gint64) running_time - delta;
-            /*
-             * If the system time was adjusted much further ahead, we might
-             * end up with delta > cur_gst_clk_time. Set the DTS to current
-             * pipeline clock for this scenario as well.
-             */
-            if (adjust_dts < 0) {
-              GST_LOG_OBJECT (udpsrc,
-                  "Current system time much ahead in time, setting DTS to pipeline clock");
-              GST_BUFFER_DTS (outbuf) = cur_gst_clk_time;
-            } else {
-              GST_BUFFER_DTS (outbuf) = adjust_dts;
-              GST_LOG_OBJECT (udpsrc, "Setting DTS to %" GST_TIME_FORMAT,
-                  GST_TIME_ARGS (GST_BUFFER_DTS (outbuf)));
-            }
-          }
-          g_object_unref (clock);
-        } else {
-          GST_ERROR_OBJECT (udpsrc,
-              "Failed to get element clock, not setting DTS");
-        }
-      }
-#endif
-    }
-
-    for (i = 0; i < n_msgs; i++) {
-      g_object_unref (msgs[i]);
-    }
-    g_free (msgs);
-
-    if (skip_packet) {
-      GST_DEBUG_OBJECT (udpsrc,
-          "Dropping packet for a different multicast address");
-      goto retry;
-    }
+  if (p_msgs
+      && !gst_udpsrc_handle_control_messages (udpsrc, outbuf, msgs, n_msgs)) {
+    GST_DEBUG_OBJECT (udpsrc,
+        "Dropping packet for a different multicast address");
+    goto retry;
   }
 
   gst_buffer_unmap (outbuf, &info);
@@ -1192,22 +1285,11 @@ memory_map_error:
         ("Failed to map memory"));
     return GST_FLOW_ERROR;
   }
-select_error:
-  {
-    gst_buffer_unmap (outbuf, &info);
-    gst_memory_unmap (udpsrc->extra_mem, &extra_info);
-    GST_ELEMENT_ERROR (udpsrc, RESOURCE, READ, (NULL),
-        ("select error: %s", err->message));
-    g_clear_error (&err);
-    return GST_FLOW_ERROR;
-  }
-stopped:
+wait_failed:
   {
     gst_buffer_unmap (outbuf, &info);
     gst_memory_unmap (udpsrc->extra_mem, &extra_info);
-    GST_DEBUG ("stop called");
-    g_clear_error (&err);
-    return GST_FLOW_FLUSHING;
+    return ret;
   }
 receive_error:
   {
@@ -1234,6 +1316,276 @@ skip_error:
   }
 }
 
+static void
+gst_udpsrc_free_batch (GstUDPSrc * udpsrc)
+{
+  guint i;
+
+  for (i = 0; i < udpsrc->n_batch_slots; i++) {
+    GstUDPSrcBatchSlot *slot = &udpsrc->batch_slots[i];
+
+    if (slot->buffer) {
+      gst_buffer_unmap (slot->buffer, &slot->map);
+      gst_buffer_unref (slot->buffer);
+    }
+    g_clear_object (&slot->saddr);
+  }
+
+  g_free (udpsrc->batch_slots);
+  udpsrc->batch_slots = NULL;
+  g_free (udpsrc->batch_msgs);
+  udpsrc->batch_msgs = NULL;
+  udpsrc->n_batch_slots = 0;
+}
+
+/* Makes sure all batch slots have a mapped buffer to receive into. Buffers
+ * that were not used by the previous batch are kept mapped for the next one */
+static gboolean
+gst_udpsrc_prepare_batch (GstUDPSrc * udpsrc, gboolean with_saddr,
+    gboolean with_msgs)
+{
+  GstBufferPool *pool;
+  guint i;
+
+  if (udpsrc->n_batch_slots != udpsrc->batch_size) {
+    gst_udpsrc_free_batch (udpsrc);
+    udpsrc->batch_slots = g_new0 (GstUDPSrcBatchSlot, udpsrc->batch_size);
+    udpsrc->batch_msgs = g_new0 (GInputMessage, udpsrc->batch_size);
+    udpsrc->n_batch_slots = udpsrc->batch_size;
+  }
+
+  pool = gst_base_src_get_buffer_pool (GST_BASE_SRC_CAST (udpsrc));
+
+  for (i = 0; i < udpsrc->n_batch_slots; i++) {
+    GstUDPSrcBatchSlot *slot = &udpsrc->batch_slots[i];
+    GInputMessage *msg = &udpsrc->batch_msgs[i];
+
+    if (slot->buffer == NULL) {
+      if (pool) {
+        if (gst_buffer_pool_acquire_buffer (pool, &slot->buffer,
+                NULL) != GST_FLOW_OK)
+          goto acquire_failed;
+      } else {
+        slot->buffer = gst_buffer_new_allocate (NULL, udpsrc->mtu, NULL);
+      }
+
+      if (!gst_buffer_map (slot->buffer, &slot->map, GST_MAP_READWRITE)) {
+        gst_buffer_unref (slot->buffer);
+        slot->buffer = NULL;
+        goto acquire_failed;
+      }
+      slot->vec.buffer = slot->map.data;
+      slot->vec.size = slot->map.size;
+    }
+
+    msg->address = with_saddr ? &slot->saddr : NULL;
+    msg->vectors = &slot->vec;
+    msg->num_vectors = 1;
+    msg->bytes_received = 0;
+    msg->flags = G_SOCKET_MSG_NONE;
+    msg->control_messages = with_msgs ? &slot->msgs : NULL;
+    msg->num_control_messages = with_msgs ? &slot->n_msgs : NULL;
+  }
+
+  if (pool)
+    gst_object_unref (pool);
+
+  return TRUE;
+
+acquire_failed:
+  {
+    if (pool)
+      gst_object_unref (pool);
+    return FALSE;
+  }
+}
+
+/* Receives up to batch-size packets per wakeup and submits them downstream
+ * as a single buffer list */
+static GstFlowReturn
+gst_udpsrc_create_batch (GstUDPSrc * udpsrc)
+{
+  GstBufferList *list = NULL;
+  gboolean with_saddr, with_msgs;
+  GstClockTime running_time = GST_CLOCK_TIME_NONE;
+  GstClock *clock;
+  GError *err = NULL;
+  GstFlowReturn ret;
+  gsize offset;
+  gint res;
+  guint i;
+
+  with_msgs = gst_udpsrc_needs_control_messages (udpsrc);
+  with_saddr = udpsrc->retrieve_sender_address;
+  offset = udpsrc->skip_first_bytes;
+
+retry:
+  if (!gst_udpsrc_prepare_batch (udpsrc, with_saddr, with_msgs))
+    goto acquire_failed;
+
+  if ((ret = gst_udpsrc_wait_readable (udpsrc)) != GST_FLOW_OK)
+    return ret;
+
+  res =
+      g_socket_receive_messages (udpsrc->used_socket, udpsrc->batch_msgs,
+      udpsrc->n_batch_slots, G_SOCKET_MSG_NONE, udpsrc->cancellable, &err);
+
+  if (G_UNLIKELY (res < 0)) {
+    /* see gst_udpsrc_fill() */
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_HOST_UNREACHABLE) ||
+        g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CONNECTION_CLOSED)) {
+      g_clear_error (&err);
+      goto retry;
+    }
+    goto receive_error;
+  }
+
+  GST_LOG_OBJECT (udpsrc, "received %d packets in one batch", res);
+
+  list = gst_buffer_list_new_sized (res);
+
+  for (i = 0; i < (guint) res; i++) {
+    GstUDPSrcBatchSlot *slot = &udpsrc->batch_slots[i];
+    GInputMessage *msg = &udpsrc->batch_msgs[i];
+    GstBuffer *outbuf;
+    gboolean keep = TRUE;
+
+    outbuf = slot->buffer;
+    slot->buffer = NULL;
+    gst_buffer_unmap (outbuf, &slot->map);
+
+    if (with_msgs) {
+      keep = gst_udpsrc_handle_control_messages (udpsrc, outbuf, slot->msgs,
+          slot->n_msgs);
+      slot->msgs = NULL;
+      slot->n_msgs = 0;
+      if (!keep)
+        GST_DEBUG_OBJECT (udpsrc,
+            "Dropping packet for a different multicast address");
+    }
+#ifdef MSG_TRUNC
+    /* There is no room for an extra memory per packet here, unlike in
+     * gst_udpsrc_fill(), so oversized packets can only be dropped */
+    if (keep && (msg->flags & MSG_TRUNC)) {
+      GST_WARNING_OBJECT (udpsrc, "Dropping packet larger than the mtu of %u "
+          "bytes, increase the mtu property to receive it", udpsrc->mtu);
+      keep = FALSE;
+    }
+#endif
+
+    if (keep && G_UNLIKELY (offset > 0 && msg->bytes_received < offset)) {
+      gst_buffer_unref (outbuf);
+      g_clear_object (&slot->saddr);
+      gst_buffer_list_unref (list);
+
+      /* release what was received for the remaining packets */
+      for (i++; i < (guint) res; i++) {
+        slot = &udpsrc->batch_slots[i];
+        g_clear_object (&slot->saddr);
+        if (slot->msgs) {
+          guint j;
+
+          for (j = 0; j < slot->n_msgs; j++)
+            g_object_unref (slot->msgs[j]);
+          g_free (slot->msgs);
+          slot->msgs = NULL;
+          slot->n_msgs = 0;
+        }
+      }
+      goto skip_error;
+    }
+
+    if (!keep) {
+      gst_buffer_unref (outbuf);
+      g_clear_object (&slot->saddr);
+      continue;
+    }
+
+    gst_buffer_resize (outbuf, offset, msg->bytes_received - offset);
+
+    if (slot->saddr) {
+      gst_buffer_add_net_address_meta (outbuf, slot->saddr);
+      g_clear_object (&slot->saddr);
+    }
+
+    gst_buffer_list_add (list, outbuf);
+  }
+
+  if (gst_buffer_list_length (list) == 0) {
+    gst_buffer_list_unref (list);
+    list = NULL;
+    goto retry;
+  }
+
+  /* GstBaseSrc only timestamps the first buffer of a list, so when
+   * do-timestamp is enabled timestamp all the packets of this batch with the
+   * time of the wakeup */
+  if (gst_base_src_get_do_timestamp (GST_BASE_SRC_CAST (udpsrc))) {
+    clock = gst_element_get_clock (GST_ELEMENT_CAST (udpsrc));
+    if (clock) {
+      running_time = gst_clock_get_time (clock) -
+          gst_element_get_base_time (GST_ELEMENT_CAST (udpsrc));
+      gst_object_unref (clock);
+    }
+
+    for (i = 0; i < gst_buffer_list_length (list); i++) {
+      GstBuffer *outbuf = gst_buffer_list_get (list, i);
+
+      if (!GST_BUFFER_DTS_IS_VALID (outbuf))
+        GST_BUFFER_DTS (outbuf) = running_time;
+      if (!GST_BUFFER_PTS_IS_VALID (outbuf))
+        GST_BUFFER_PTS (outbuf) = GST_BUFFER_DTS (outbuf);
+    }
+  }
+
+  GST_LOG_OBJECT (udpsrc, "pushing list of %u packets",
+      gst_buffer_list_length (list));
+
+  gst_base_src_submit_buffer_list (GST_BASE_SRC_CAST (udpsrc), list);
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+acquire_failed:
+  {
+    GST_ELEMENT_ERROR (udpsrc, RESOURCE, READ, (NULL),
+        ("Failed to allocate or map receive buffers"));
+    return GST_FLOW_ERROR;
+  }
+receive_error:
+  {
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_BUSY) ||
+        g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      g_clear_error (&err);
+      return GST_FLOW_FLUSHING;
+    } else {
+      GST_ELEMENT_ERROR (udpsrc, RESOURCE, READ, (NULL),
+          ("receive error %d: %s", res, err->message));
+      g_clear_error (&err);
+      return GST_FLOW_ERROR;
+    }
+  }
+skip_error:
+  {
+    GST_ELEMENT_ERROR (udpsrc, STREAM, DECODE, (NULL),
+        ("UDP buffer to small to skip header"));
+    return GST_FLOW_ERROR;
+  }
+}
+
+static GstFlowReturn
+gst_udpsrc_create (GstBaseSrc * bsrc, guint64 offset, guint length,
+    GstBuffer ** buf)
+{
+  GstUDPSrc *udpsrc = GST_UDPSRC_CAST (bsrc);
+
+  if (udpsrc->batch_size <= 1 || *buf != NULL)
+    return GST_BASE_SRC_CLASS (parent_class)->create (bsrc, offset, length,
+        buf);
+
+  return gst_udpsrc_create_batch (udpsrc);
+}
+
 static gboolean
 gst_udpsrc_set_uri (GstUDPSrc * src, const gchar * uri, GError ** error)
 {
@@ -1374,6 +1726,9 @@ gst_udpsrc_set_property (GObject * object, guint prop_id, const GValue * value,
     case PROP_SOCKET_TIMESTAMP:
       udpsrc->socket_timestamp_mode = g_value_get_enum (value);
       break;
+    case PROP_BATCH_SIZE:
+      udpsrc->batch_size = g_value_get_uint (value);
+      break;
     default:
       break;
   }
@@ -1440,6 +1795,9 @@ gst_udpsrc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_SOCKET_TIMESTAMP:
       g_value_set_enum (value, udpsrc->socket_timestamp_mode);
       break;
+    case PROP_BATCH_SIZE:
+      g_value_set_uint (value, udpsrc->batch_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1929,6 +2287,9 @@ gst_udpsrc_change_state (GstElement * element, GstStateChange transition)
     goto failure;
 
   switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_udpsrc_free_batch (src);
+      break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       gst_udpsrc_close (src);
       break;
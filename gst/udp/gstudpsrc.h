@@ -43,6 +43,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstUDPSrc GstUDPSrc;
 typedef struct _GstUDPSrcClass GstUDPSrcClass;
+typedef struct _GstUDPSrcBatchSlot GstUDPSrcBatchSlot;
 
 
 /**
@@ -83,6 +84,7 @@ struct _GstUDPSrc {
   gboolean   reuse;
   gboolean   loop;
   GstSocketTimestampMode socket_timestamp_mode;
+  guint      batch_size;
 
   /* stats */
   guint      max_size;
@@ -96,6 +98,11 @@ struct _GstUDPSrc {
   /* Extra memory for buffers with a size superior to max_packet_size */
   GstMemory *extra_mem;
 
+  /* Receive state for batched mode, batch_size entries each */
+  GstUDPSrcBatchSlot *batch_slots;
+  GInputMessage *batch_msgs;
+  guint n_batch_slots;
+
   gchar     *uri;
 };
 
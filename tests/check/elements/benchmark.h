@@ -0,0 +1,57 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __CHECK_BENCHMARK_H__
+#define __CHECK_BENCHMARK_H__
+
+#include <gst/check/gstcheck.h>
+
+/* Benchmarks only log their numbers and take a while, so they are not part
+ * of the default run. They are added to a separate "benchmark" test case
+ * when GST_CHECK_BENCHMARKS is set in the environment:
+ *
+ *   GST_CHECK_BENCHMARKS=1 GST_DEBUG=check:4 ./elements_rtpjitterbuffer
+ */
+
+#define BENCHMARK_TIMEOUT 120
+
+static G_GNUC_UNUSED TCase *
+benchmark_tcase (Suite * s)
+{
+  static TCase *tc_bench = NULL;
+
+  if (g_getenv ("GST_CHECK_BENCHMARKS") == NULL)
+    return NULL;
+
+  if (tc_bench == NULL) {
+    tc_bench = tcase_create ("benchmark");
+    tcase_set_timeout (tc_bench, BENCHMARK_TIMEOUT);
+    suite_add_tcase (s, tc_bench);
+  }
+
+  return tc_bench;
+}
+
+#define tcase_add_benchmark(s,tf)                                       \
+  G_STMT_START {                                                        \
+    TCase *tc_bench_ = benchmark_tcase (s);                             \
+    if (tc_bench_)                                                      \
+      tcase_add_test (tc_bench_, tf);                                   \
+  } G_STMT_END
+
+#endif /* __CHECK_BENCHMARK_H__ */
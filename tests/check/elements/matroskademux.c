@@ -19,6 +19,9 @@
 
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstharness.h>
+#include <glib/gstdio.h>
+
+#include "benchmark.h"
 
 const gchar mkv_sub_base64[] =
     "GkXfowEAAAAAAAAUQoKJbWF0cm9za2EAQoeBAkKFgQIYU4BnAQAAAAAAAg0RTZt0AQAAAAAAAIxN"
@@ -307,6 +310,306 @@ GST_START_TEST (test_toc_demux)
 
 GST_END_TEST;
 
+/* the default run seeks a few dozen times in a short file, the benchmarks
+ * a thousand times in a ten minute one */
+#define SEEK_TEST_DURATION 120
+#define SEEK_TEST_N_SEEKS 40
+#define SEEK_BENCHMARK_DURATION 600
+#define SEEK_BENCHMARK_N_SEEKS 1000
+
+typedef struct
+{
+  GMutex lock;
+  guint64 bytes;
+  guint n_reads;
+} ReadStats;
+
+static GstPadProbeReturn
+count_reads_cb (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  ReadStats *stats = user_data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+
+  if (buf == NULL)
+    return GST_PAD_PROBE_OK;
+
+  g_mutex_lock (&stats->lock);
+  stats->bytes += gst_buffer_get_size (buf);
+  stats->n_reads++;
+  g_mutex_unlock (&stats->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+run_pipeline_to_eos (GstElement * pipeline)
+{
+  GstBus *bus = gst_element_get_bus (pipeline);
+  GstMessage *msg;
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+}
+
+/* live muxed files have no cues, so seeking has to search for clusters */
+static gchar *
+create_file_without_cues (guint duration)
+{
+  GstElement *pipeline;
+  gchar *filename, *desc;
+  gint fd;
+
+  fd = g_file_open_tmp ("matroskademux-XXXXXX.mkv", &filename, NULL);
+  fail_unless (fd >= 0);
+  g_close (fd, NULL);
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d ! "
+      "video/x-raw,format=GRAY8,width=16,height=16,framerate=25/1 ! "
+      "matroskamux streamable=true ! filesink location=\"%s\"",
+      duration * 25, filename);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  run_pipeline_to_eos (pipeline);
+  gst_object_unref (pipeline);
+  g_free (desc);
+
+  return filename;
+}
+
+/* counts the reads of matroskademux from upstream in @stats */
+static GstElement *
+create_seek_pipeline (const gchar * filename, const gchar * demux_props,
+    ReadStats * stats)
+{
+  GstElement *pipeline, *src;
+  GstPad *pad;
+  gchar *desc;
+
+  desc = g_strdup_printf ("filesrc name=src location=\"%s\" ! "
+      "matroskademux name=demux %s ! fakesink", filename, demux_props);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  pad = gst_element_get_static_pad (src, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_PULL,
+      count_reads_cb, stats, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (src);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PAUSED) !=
+      GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  return pipeline;
+}
+
+static void
+get_read_ahead_stats (GstElement * pipeline, guint64 * hits, guint64 * misses)
+{
+  GstElement *demux = gst_bin_get_by_name (GST_BIN (pipeline), "demux");
+  GstStructure *s;
+
+  g_object_get (demux, "stats", &s, NULL);
+  fail_unless (gst_structure_get_uint64 (s, "read-ahead-hits", hits));
+  fail_unless (gst_structure_get_uint64 (s, "read-ahead-misses", misses));
+  gst_structure_free (s);
+  gst_object_unref (demux);
+}
+
+/* does the same @n_seeks random seeks in the first @duration seconds on
+ * every call, and returns the number of bytes read from upstream for them */
+static guint64
+run_random_seeks (GstElement * pipeline, ReadStats * stats,
+    const gchar * pass, guint duration, guint n_seeks, guint * p_n_reads)
+{
+  GRand *rand = g_rand_new_with_seed (42);
+  gint64 start_time, elapsed;
+  guint64 bytes;
+  guint i, n_reads;
+
+  g_mutex_lock (&stats->lock);
+  stats->bytes = 0;
+  stats->n_reads = 0;
+  g_mutex_unlock (&stats->lock);
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < n_seeks; i++) {
+    GstClockTime pos = g_rand_int_range (rand, 0, duration * 1000) *
+        GST_MSECOND;
+
+    fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+            GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT, pos));
+    fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+            GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+  }
+  elapsed = g_get_monotonic_time () - start_time;
+
+  g_mutex_lock (&stats->lock);
+  bytes = stats->bytes;
+  n_reads = stats->n_reads;
+  g_mutex_unlock (&stats->lock);
+
+  GST_INFO ("%s: %u seeks read %" G_GUINT64_FORMAT " bytes in %u reads, "
+      "took %" G_GINT64_FORMAT " ms", pass, n_seeks, bytes, n_reads,
+      elapsed / 1000);
+
+  g_rand_free (rand);
+
+  if (p_n_reads)
+    *p_n_reads = n_reads;
+
+  return bytes;
+}
+
+static void
+remove_dir (const gchar * dirname)
+{
+  GDir *dir = g_dir_open (dirname, 0, NULL);
+  const gchar *name;
+
+  if (dir) {
+    while ((name = g_dir_read_name (dir))) {
+      gchar *path = g_build_filename (dirname, name, NULL);
+
+      g_unlink (path);
+      g_free (path);
+    }
+    g_dir_close (dir);
+  }
+  g_rmdir (dirname);
+}
+
+static void
+run_seek_index_test (guint duration, guint n_seeks)
+{
+  GstElement *pipeline;
+  ReadStats stats = { 0, };
+  gchar *filename, *index_dir, *props;
+  guint64 cold, warm, saved;
+
+  g_mutex_init (&stats.lock);
+
+  filename = create_file_without_cues (duration);
+  index_dir = g_dir_make_tmp ("matroskademux-index-XXXXXX", NULL);
+  fail_unless (index_dir != NULL);
+  props = g_strdup_printf ("seek-index-dir=\"%s\"", index_dir);
+
+  pipeline = create_seek_pipeline (filename, props, &stats);
+  cold = run_random_seeks (pipeline, &stats, "cold", duration, n_seeks, NULL);
+  /* seeks in the same file use the clusters found the first time */
+  warm = run_random_seeks (pipeline, &stats, "warm", duration, n_seeks, NULL);
+  fail_unless (warm < cold);
+  /* which are saved when shutting down */
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  /* and loaded when opening the file again */
+  pipeline = create_seek_pipeline (filename, props, &stats);
+  saved = run_random_seeks (pipeline, &stats, "saved", duration, n_seeks,
+      NULL);
+  fail_unless (saved < cold);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  remove_dir (index_dir);
+  g_unlink (filename);
+  g_free (props);
+  g_free (index_dir);
+  g_free (filename);
+  g_mutex_clear (&stats.lock);
+}
+
+GST_START_TEST (test_seek_index)
+{
+  run_seek_index_test (SEEK_TEST_DURATION, SEEK_TEST_N_SEEKS);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_seek_index_benchmark)
+{
+  run_seek_index_test (SEEK_BENCHMARK_DURATION, SEEK_BENCHMARK_N_SEEKS);
+}
+
+GST_END_TEST;
+
+static void
+run_read_ahead_test (guint duration, guint n_seeks)
+{
+  const guint block_sizes[] = { 4096, 256 * 1024 };
+  guint playback_reads[2], seek_reads[2];
+  guint64 hits[2], misses[2];
+  GstElement *pipeline;
+  ReadStats stats = { 0, };
+  gchar *filename;
+  guint i;
+
+  g_mutex_init (&stats.lock);
+
+  filename = create_file_without_cues (duration);
+
+  for (i = 0; i < G_N_ELEMENTS (block_sizes); i++) {
+    gchar *props = g_strdup_printf ("read-ahead-size=%u", block_sizes[i]);
+
+    stats.bytes = 0;
+    stats.n_reads = 0;
+    pipeline = create_seek_pipeline (filename, props, &stats);
+    run_pipeline_to_eos (pipeline);
+    get_read_ahead_stats (pipeline, &hits[i], &misses[i]);
+    gst_object_unref (pipeline);
+    playback_reads[i] = stats.n_reads;
+    GST_INFO ("%s: playback took %u reads of %" G_GUINT64_FORMAT " bytes, "
+        "%" G_GUINT64_FORMAT " cache hits, %" G_GUINT64_FORMAT " misses",
+        props, stats.n_reads, stats.bytes, hits[i], misses[i]);
+
+    /* every miss pulls a new block from upstream */
+    fail_unless (hits[i] > 0);
+    fail_unless (misses[i] > 0);
+    fail_unless (misses[i] <= playback_reads[i]);
+
+    pipeline = create_seek_pipeline (filename, props, &stats);
+    run_random_seeks (pipeline, &stats, props, duration, n_seeks,
+        &seek_reads[i]);
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (pipeline);
+    g_free (props);
+  }
+
+  /* element headers and frames are parsed from the blocks read ahead */
+  fail_unless (playback_reads[1] * 4 < playback_reads[0]);
+  fail_unless (misses[1] * 4 < misses[0]);
+  fail_unless (misses[1] * 4 < hits[1]);
+  fail_unless (seek_reads[1] <= seek_reads[0]);
+
+  g_unlink (filename);
+  g_free (filename);
+  g_mutex_clear (&stats.lock);
+}
+
+GST_START_TEST (test_read_ahead)
+{
+  run_read_ahead_test (SEEK_TEST_DURATION, SEEK_TEST_N_SEEKS);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_read_ahead_benchmark)
+{
+  run_read_ahead_test (SEEK_BENCHMARK_DURATION, SEEK_BENCHMARK_N_SEEKS);
+}
+
+GST_END_TEST;
+
 static Suite *
 matroskademux_suite (void)
 {
@@ -317,6 +620,15 @@ matroskademux_suite (void)
   tcase_add_test (tc_chain, test_sub_terminator);
   tcase_add_test (tc_chain, test_toc_demux);
 
+  tcase_set_timeout (tc_chain, 120);
+  if (gst_registry_check_feature_version (gst_registry_get (), "videotestsrc",
+          GST_VERSION_MAJOR, GST_VERSION_MINOR, 0)) {
+    tcase_add_test (tc_chain, test_seek_index);
+    tcase_add_test (tc_chain, test_read_ahead);
+    tcase_add_benchmark (s, test_seek_index_benchmark);
+    tcase_add_benchmark (s, test_read_ahead_benchmark);
+  }
+
   return s;
 }
 
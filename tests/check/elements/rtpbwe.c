@@ -0,0 +1,299 @@
+/* GStreamer
+ *
+ * Unit tests for the TWCC based bandwidth estimator, run against a
+ * simulated bottleneck
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include "gst/rtpmanager/rtpbwe.h"
+
+/* rtpbwe logs in the category of the session */
+GST_DEBUG_CATEGORY (rtp_session_debug);
+
+#define MIN_BITRATE 30000
+#define START_BITRATE 300000
+#define MAX_BITRATE 10000000
+
+#define PACKET_SIZE 1200
+#define PROPAGATION_DELAY (20 * GST_MSECOND)
+/* packets that would wait longer in the bottleneck queue are dropped */
+#define QUEUE_LIMIT (300 * GST_MSECOND)
+#define FEEDBACK_INTERVAL (50 * GST_MSECOND)
+
+typedef struct
+{
+  GstClockTime send_time;
+  GstClockTime arrival_time;
+} SimPacket;
+
+/* a sender pacing packets at the target bitrate through a drop-tail
+ * bottleneck, and a receiver sending feedback at a fixed interval */
+typedef struct
+{
+  RTPBandwidthEstimator *bwe;
+  GRand *rand;
+
+  guint capacity;
+  gdouble loss;
+
+  GArray *sent;
+  guint reported;
+  GstClockTime now;
+  GstClockTime depart;
+  GstClockTime next_feedback;
+} Simulation;
+
+static Simulation *
+simulation_new (guint capacity, gdouble loss)
+{
+  Simulation *sim = g_new0 (Simulation, 1);
+
+  sim->bwe = rtp_bandwidth_estimator_new (MIN_BITRATE, START_BITRATE,
+      MAX_BITRATE);
+  sim->rand = g_rand_new_with_seed (1);
+  sim->capacity = capacity;
+  sim->loss = loss;
+  sim->sent = g_array_new (FALSE, FALSE, sizeof (SimPacket));
+  sim->next_feedback = FEEDBACK_INTERVAL;
+
+  return sim;
+}
+
+static void
+simulation_free (Simulation * sim)
+{
+  rtp_bandwidth_estimator_free (sim->bwe);
+  g_rand_free (sim->rand);
+  g_array_unref (sim->sent);
+  g_free (sim);
+}
+
+static void
+simulation_feedback (Simulation * sim)
+{
+  GstClockTime cutoff = sim->next_feedback - PROPAGATION_DELAY;
+  GArray *twcc_packets;
+  gint last = -1;
+  guint i;
+
+  /* report up to the last packet that arrived in time */
+  for (i = sim->reported; i < sim->sent->len; i++) {
+    SimPacket *p = &g_array_index (sim->sent, SimPacket, i);
+
+    if (GST_CLOCK_TIME_IS_VALID (p->arrival_time) && p->arrival_time <= cutoff)
+      last = i;
+  }
+  if (last < (gint) sim->reported)
+    return;
+
+  twcc_packets = g_array_new (FALSE, FALSE, sizeof (RTPTWCCPacket));
+  for (i = sim->reported; i <= last; i++) {
+    SimPacket *p = &g_array_index (sim->sent, SimPacket, i);
+    RTPTWCCPacket pkt = { 0, };
+
+    pkt.local_ts = p->send_time;
+    pkt.seqnum = i;
+    pkt.size = PACKET_SIZE;
+    if (GST_CLOCK_TIME_IS_VALID (p->arrival_time)) {
+      pkt.remote_ts = p->arrival_time;
+      pkt.status = RTP_TWCC_PACKET_STATUS_SMALL_DELTA;
+    } else {
+      pkt.remote_ts = GST_CLOCK_TIME_NONE;
+      pkt.status = RTP_TWCC_PACKET_STATUS_NOT_RECV;
+    }
+    g_array_append_val (twcc_packets, pkt);
+  }
+  sim->reported = last + 1;
+
+  rtp_bandwidth_estimator_process_packets (sim->bwe, twcc_packets);
+  g_array_unref (twcc_packets);
+}
+
+static void
+simulation_run_until (Simulation * sim, GstClockTime until)
+{
+  while (sim->now < until) {
+    GstClockTime tx = gst_util_uint64_scale (PACKET_SIZE * 8, GST_SECOND,
+        sim->capacity);
+    GstClockTime depart = MAX (sim->now, sim->depart) + tx;
+    SimPacket p;
+
+    p.send_time = sim->now;
+    if (depart - sim->now > QUEUE_LIMIT ||
+        (sim->loss > 0 && g_rand_double (sim->rand) < sim->loss)) {
+      p.arrival_time = GST_CLOCK_TIME_NONE;
+    } else {
+      sim->depart = depart;
+      p.arrival_time = depart + PROPAGATION_DELAY;
+    }
+    g_array_append_val (sim->sent, p);
+
+    sim->now += gst_util_uint64_scale (PACKET_SIZE * 8, GST_SECOND,
+        rtp_bandwidth_estimator_get_target_bitrate (sim->bwe));
+
+    while (sim->now >= sim->next_feedback) {
+      simulation_feedback (sim);
+      sim->next_feedback += FEEDBACK_INTERVAL;
+    }
+  }
+}
+
+/* runs the simulation for @duration and returns the time after which the
+ * target stayed within [@low, @high], or GST_CLOCK_TIME_NONE */
+static GstClockTime
+simulation_run_converge (Simulation * sim, GstClockTime duration,
+    guint low, guint high)
+{
+  GstClockTime start = sim->now;
+  GstClockTime converged = GST_CLOCK_TIME_NONE;
+  GstClockTime t;
+
+  for (t = start + FEEDBACK_INTERVAL; t <= start + duration;
+      t += FEEDBACK_INTERVAL) {
+    guint target;
+
+    simulation_run_until (sim, t);
+    target = rtp_bandwidth_estimator_get_target_bitrate (sim->bwe);
+
+    if (target >= low && target <= high) {
+      if (!GST_CLOCK_TIME_IS_VALID (converged))
+        converged = t - start;
+    } else {
+      converged = GST_CLOCK_TIME_NONE;
+    }
+  }
+
+  return converged;
+}
+
+GST_START_TEST (test_bwe_convergence)
+{
+  const guint capacities[] = { 500000, 1000000, 2000000 };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (capacities); i++) {
+    guint capacity = capacities[i];
+    Simulation *sim = simulation_new (capacity, 0);
+    GstClockTime converged;
+
+    converged = simulation_run_converge (sim, 20 * GST_SECOND,
+        capacity / 2, capacity * 6 / 5);
+
+    GST_INFO ("%u bits/s bottleneck: converged after %" GST_TIME_FORMAT,
+        capacity, GST_TIME_ARGS (converged));
+    fail_unless (GST_CLOCK_TIME_IS_VALID (converged));
+    fail_unless (converged <= 10 * GST_SECOND);
+
+    simulation_free (sim);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bwe_capacity_drop)
+{
+  Simulation *sim = simulation_new (2000000, 0);
+  GstClockTime converged;
+
+  simulation_run_until (sim, 20 * GST_SECOND);
+  fail_unless (rtp_bandwidth_estimator_get_target_bitrate (sim->bwe) >
+      1000000);
+
+  sim->capacity = 500000;
+  simulation_run_until (sim, 22 * GST_SECOND);
+  fail_unless (rtp_bandwidth_estimator_get_target_bitrate (sim->bwe) <=
+      600000);
+
+  /* recovers towards the new capacity without overshooting */
+  converged = simulation_run_converge (sim, 18 * GST_SECOND, 250000, 600000);
+  GST_INFO ("recovered after %" GST_TIME_FORMAT, GST_TIME_ARGS (converged));
+  fail_unless (GST_CLOCK_TIME_IS_VALID (converged));
+
+  simulation_free (sim);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bwe_high_loss)
+{
+  Simulation *sim = simulation_new (5000000, 0.2);
+
+  simulation_run_until (sim, 10 * GST_SECOND);
+  fail_unless (rtp_bandwidth_estimator_get_target_bitrate (sim->bwe) <
+      START_BITRATE * 3 / 4);
+  fail_unless (rtp_bandwidth_estimator_get_target_bitrate (sim->bwe) >=
+      MIN_BITRATE);
+
+  simulation_free (sim);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bwe_low_loss)
+{
+  Simulation *sim = simulation_new (5000000, 0.01);
+
+  /* random loss below 2% doesn't prevent the ramp up */
+  simulation_run_until (sim, 10 * GST_SECOND);
+  fail_unless (rtp_bandwidth_estimator_get_target_bitrate (sim->bwe) >
+      START_BITRATE * 2);
+
+  simulation_free (sim);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bwe_reset)
+{
+  Simulation *sim = simulation_new (1000000, 0);
+
+  simulation_run_until (sim, 5 * GST_SECOND);
+  fail_unless (rtp_bandwidth_estimator_get_acked_bitrate (sim->bwe) > 0);
+
+  rtp_bandwidth_estimator_reset (sim->bwe, 100000, 50000, 200000);
+  fail_unless_equals_int (rtp_bandwidth_estimator_get_target_bitrate
+      (sim->bwe), 100000);
+  fail_unless_equals_int (rtp_bandwidth_estimator_get_acked_bitrate
+      (sim->bwe), 0);
+  fail_unless_equals_int (rtp_bandwidth_estimator_get_usage (sim->bwe),
+      RTP_BANDWIDTH_USAGE_NORMAL);
+
+  simulation_free (sim);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtpbwe_suite (void)
+{
+  Suite *s = suite_create ("rtpbwe");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (rtp_session_debug, "rtpsession", 0, "RTP Session");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_bwe_convergence);
+  tcase_add_test (tc_chain, test_bwe_capacity_drop);
+  tcase_add_test (tc_chain, test_bwe_high_loss);
+  tcase_add_test (tc_chain, test_bwe_low_loss);
+  tcase_add_test (tc_chain, test_bwe_reset);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtpbwe);
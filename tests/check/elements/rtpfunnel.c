@@ -24,6 +24,8 @@
 #include <gst/check/gstharness.h>
 #include <gst/rtp/gstrtpbuffer.h>
 
+#include "benchmark.h"
+
 GST_START_TEST (rtpfunnel_ssrc_demuxing)
 {
   GstHarness *h = gst_harness_new_with_padnames ("rtpfunnel", NULL, "src");
@@ -349,9 +351,12 @@ get_twcc_seqnum (GstBuffer * buf, guint8 ext_id)
   GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
   gint32 val = -1;
   gpointer data;
+  guint8 appbits;
 
   gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp);
   if (gst_rtp_buffer_get_extension_onebyte_header (&rtp, ext_id,
+          0, &data, NULL) ||
+      gst_rtp_buffer_get_extension_twobyte_header (&rtp, &appbits, ext_id,
           0, &data, NULL)) {
     val = GST_READ_UINT16_BE (data);
   }
@@ -488,6 +493,140 @@ GST_START_TEST (rtpfunnel_twcc_passthrough_then_mux)
 
 GST_END_TEST;
 
+GST_START_TEST (rtpfunnel_twcc_mux_buffer_list)
+{
+  GstHarness *h, *h0, *h1;
+  GstBufferList *list;
+  GstBuffer *buf;
+  guint i;
+
+  h = gst_harness_new_with_padnames ("rtpfunnel", NULL, "src");
+  h0 = gst_harness_new_with_element (h->element, "sink_0", NULL);
+  h1 = gst_harness_new_with_element (h->element, "sink_1", NULL);
+  gst_harness_set_src_caps_str (h0, "application/x-rtp, "
+      "ssrc=(uint)123, extmap-5=" TWCC_EXTMAP_STR "");
+  gst_harness_set_src_caps_str (h1, "application/x-rtp, "
+      "ssrc=(uint)456, extmap-5=" TWCC_EXTMAP_STR "");
+
+  /* push a list of 3 packets on both pads */
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 3; i++)
+    gst_buffer_list_add (list, generate_test_buffer (500 + i, 123, 5));
+  fail_unless_equals_int (GST_FLOW_OK, gst_pad_push_list (h0->srcpad, list));
+
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 3; i++)
+    gst_buffer_list_add (list, generate_test_buffer (60000 + i, 321, 5));
+  fail_unless_equals_int (GST_FLOW_OK, gst_pad_push_list (h1->srcpad, list));
+
+  /* the packets of the lists get continuous twcc-seqnums too */
+  for (i = 0; i < 6; i++) {
+    buf = gst_harness_pull (h);
+    fail_unless_equals_int (i < 3 ? 123 : 321, get_ssrc (buf));
+    fail_unless_equals_int (i, get_twcc_seqnum (buf, 5));
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+  gst_harness_teardown (h0);
+  gst_harness_teardown (h1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtpfunnel_twcc_mux_two_byte)
+{
+  GstHarness *h, *h0, *h1;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint8 data[2] = { 0xff, 0xff };
+  GstBuffer *buf;
+
+  h = gst_harness_new_with_padnames ("rtpfunnel", NULL, "src");
+  h0 = gst_harness_new_with_element (h->element, "sink_0", NULL);
+  h1 = gst_harness_new_with_element (h->element, "sink_1", NULL);
+  gst_harness_set_src_caps_str (h0, "application/x-rtp, "
+      "ssrc=(uint)123, extmap-5=" TWCC_EXTMAP_STR "");
+  gst_harness_set_src_caps_str (h1, "application/x-rtp, "
+      "ssrc=(uint)456, extmap-5=" TWCC_EXTMAP_STR "");
+
+  /* a packet without a twcc element still takes a twcc-seqnum */
+  fail_unless_equals_int (GST_FLOW_OK,
+      gst_harness_push (h0, generate_test_buffer (500, 123, 0)));
+
+  buf = generate_test_buffer (60000, 321, 0);
+  gst_rtp_buffer_map (buf, GST_MAP_READWRITE, &rtp);
+  gst_rtp_buffer_add_extension_twobyte_header (&rtp, 0, 5, data,
+      sizeof (data));
+  gst_rtp_buffer_unmap (&rtp);
+  fail_unless_equals_int (GST_FLOW_OK, gst_harness_push (h1, buf));
+
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (-1, get_twcc_seqnum (buf, 5));
+  gst_buffer_unref (buf);
+
+  /* and the two-byte element is rewritten like a one-byte one */
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (321, get_ssrc (buf));
+  fail_unless_equals_int (1, get_twcc_seqnum (buf, 5));
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+  gst_harness_teardown (h0);
+  gst_harness_teardown (h1);
+}
+
+GST_END_TEST;
+
+#define BENCHMARK_LISTS 2000
+#define BENCHMARK_LIST_SIZE 32
+
+static void
+run_twcc_benchmark (gboolean with_twcc)
+{
+  GstHarness *h, *h0;
+  GstBufferList **lists;
+  gint64 start, elapsed;
+  guint i, j;
+
+  h = gst_harness_new_with_padnames ("rtpfunnel", NULL, "src");
+  h0 = gst_harness_new_with_element (h->element, "sink_0", NULL);
+  gst_harness_set_src_caps_str (h0, with_twcc ? "application/x-rtp, "
+      "ssrc=(uint)123, extmap-5=" TWCC_EXTMAP_STR "" :
+      "application/x-rtp, ssrc=(uint)123");
+  gst_harness_set_drop_buffers (h, TRUE);
+
+  lists = g_new (GstBufferList *, BENCHMARK_LISTS);
+  for (i = 0; i < BENCHMARK_LISTS; i++) {
+    lists[i] = gst_buffer_list_new_sized (BENCHMARK_LIST_SIZE);
+    for (j = 0; j < BENCHMARK_LIST_SIZE; j++)
+      gst_buffer_list_add (lists[i],
+          generate_test_buffer (i * BENCHMARK_LIST_SIZE + j, 123,
+              with_twcc ? 5 : 0));
+  }
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < BENCHMARK_LISTS; i++)
+    fail_unless_equals_int (GST_FLOW_OK,
+        gst_pad_push_list (h0->srcpad, lists[i]));
+  elapsed = g_get_monotonic_time () - start;
+  g_free (lists);
+
+  GST_INFO ("%s twcc: %.0f packets/s", with_twcc ? "with" : "without",
+      (gdouble) BENCHMARK_LISTS * BENCHMARK_LIST_SIZE * G_USEC_PER_SEC /
+      MAX (elapsed, 1));
+
+  gst_harness_teardown (h);
+  gst_harness_teardown (h0);
+}
+
+GST_START_TEST (rtpfunnel_twcc_benchmark)
+{
+  run_twcc_benchmark (FALSE);
+  run_twcc_benchmark (TRUE);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtpfunnel_suite (void)
 {
@@ -507,6 +646,10 @@ rtpfunnel_suite (void)
   tcase_add_test (tc_chain, rtpfunnel_twcc_passthrough);
   tcase_add_test (tc_chain, rtpfunnel_twcc_mux);
   tcase_add_test (tc_chain, rtpfunnel_twcc_passthrough_then_mux);
+  tcase_add_test (tc_chain, rtpfunnel_twcc_mux_buffer_list);
+  tcase_add_test (tc_chain, rtpfunnel_twcc_mux_two_byte);
+
+  tcase_add_benchmark (s, rtpfunnel_twcc_benchmark);
 
   return s;
 }
@@ -25,6 +25,9 @@
 #include <gst/check/check.h>
 #include <gst/app/app.h>
 #include <gst/rtp/gstrtpbuffer.h>
+#include <gst/video/video.h>
+
+#include "benchmark.h"
 
 #define ALLOCATOR_CUSTOM_SYSMEM "CustomSysMem"
 
@@ -1455,6 +1458,692 @@ GST_START_TEST (test_rtph264pay_avc_incomplete_nal)
 
 GST_END_TEST;
 
+static guint8 h264_sei[] = {
+  0x00, 0x00, 0x00, 0x01, 0x06, 0x05, 0x02, 0xaa,
+  0xbb, 0x80
+};
+
+#define ZERO_COPY_N_SEI 10
+#define ZERO_COPY_IDR_SIZE 20000
+
+/* SPS, PPS, @n_sei SEI and an IDR slice that needs to be fragmented, in a
+ * single memory. With ZERO_COPY_N_SEI there are more SEI than a STAP-A can
+ * reference without merging memories */
+static GstBuffer *
+create_zero_copy_frame (guint n_sei, gsize * nal_bytes)
+{
+  gsize size = sizeof (h264_sps) + sizeof (h264_pps) +
+      n_sei * sizeof (h264_sei) + 4 + ZERO_COPY_IDR_SIZE;
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, size, NULL);
+  GstMapInfo map;
+  guint8 *data;
+  guint i;
+
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_WRITE));
+  data = map.data;
+
+  memcpy (data, h264_sps, sizeof (h264_sps));
+  data += sizeof (h264_sps);
+  memcpy (data, h264_pps, sizeof (h264_pps));
+  data += sizeof (h264_pps);
+  for (i = 0; i < n_sei; i++) {
+    memcpy (data, h264_sei, sizeof (h264_sei));
+    data += sizeof (h264_sei);
+  }
+
+  /* IDR slice without any zero byte */
+  data[0] = data[1] = data[2] = 0x00;
+  data[3] = 0x01;
+  data[4] = 0x65;
+  for (i = 1; i < ZERO_COPY_IDR_SIZE; i++)
+    data[4 + i] = 0x80 | (i & 0x7f);
+
+  gst_buffer_unmap (buffer, &map);
+
+  /* everything but the start codes */
+  *nal_bytes = size - (3 + n_sei) * 4;
+
+  return buffer;
+}
+
+/* the bytes of @buffer that reference @orig, the others were written by
+ * the payloader */
+static gsize
+count_shared_bytes (GstBuffer * buffer, GstMemory * orig)
+{
+  gsize shared = 0;
+  guint i;
+
+  for (i = 0; i < gst_buffer_n_memory (buffer); i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+
+    if (mem == orig || mem->parent == orig)
+      shared += gst_memory_get_sizes (mem, NULL, NULL);
+  }
+
+  return shared;
+}
+
+static const gchar *aggregate_modes[] = { "none", "zero-latency", "max-stap" };
+
+/* payloads @n_frames frames and returns the payload bytes that were
+ * referenced and written per frame */
+static gint64
+run_zero_copy (const gchar * aggregate_mode, guint n_frames, gsize * shared,
+    gsize * written)
+{
+  GstHarness *h;
+  GstBuffer *frame, *buffer;
+  GstMemory *orig;
+  gint64 start, elapsed = 0;
+  gsize nal_bytes;
+  gchar *desc;
+  guint n;
+
+  desc = g_strdup_printf ("rtph264pay mtu=1400 aggregate-mode=%s",
+      aggregate_mode);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  gst_harness_set_src_caps_str (h,
+      "video/x-h264,alignment=au,stream-format=byte-stream");
+
+  frame = create_zero_copy_frame (ZERO_COPY_N_SEI, &nal_bytes);
+  orig = gst_buffer_peek_memory (frame, 0);
+  *shared = *written = 0;
+
+  for (n = 0; n < n_frames; n++) {
+    buffer = gst_buffer_copy (frame);
+    GST_BUFFER_PTS (buffer) = n * GST_SECOND / 30;
+
+    start = g_get_monotonic_time ();
+    fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+    elapsed += g_get_monotonic_time () - start;
+
+    while ((buffer = gst_harness_try_pull (h))) {
+      gsize size = count_shared_bytes (buffer, orig);
+
+      *shared += size;
+      *written += gst_buffer_get_size (buffer) - 12 - size;
+      gst_buffer_unref (buffer);
+    }
+  }
+
+  *shared /= n_frames;
+  *written /= n_frames;
+
+  /* only the NAL header of the IDR slice isn't referenced, it's rewritten
+   * in the FU-A indicator and header */
+  fail_unless_equals_int (*shared, nal_bytes - 1);
+
+  gst_buffer_unref (frame);
+  gst_harness_teardown (h);
+
+  return MAX (elapsed, 1);
+}
+
+GST_START_TEST (test_rtph264pay_zero_copy)
+{
+  gsize shared, written;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (aggregate_modes); i++) {
+    run_zero_copy (aggregate_modes[i], 1, &shared, &written);
+    GST_INFO ("aggregate-mode=%s: %" G_GSIZE_FORMAT " bytes referenced, %"
+        G_GSIZE_FORMAT " bytes written per frame", aggregate_modes[i], shared,
+        written);
+  }
+}
+
+GST_END_TEST;
+
+#define BENCH_N_FRAMES 1000
+
+GST_START_TEST (test_rtph264pay_zero_copy_benchmark)
+{
+  gsize shared, written;
+  gint64 elapsed;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (aggregate_modes); i++) {
+    elapsed = run_zero_copy (aggregate_modes[i], BENCH_N_FRAMES, &shared,
+        &written);
+    GST_INFO ("aggregate-mode=%s: %.1f fps, %" G_GSIZE_FORMAT " bytes "
+        "referenced, %" G_GSIZE_FORMAT " bytes written per frame",
+        aggregate_modes[i], BENCH_N_FRAMES * (gdouble) G_USEC_PER_SEC /
+        elapsed, shared, written);
+  }
+}
+
+GST_END_TEST;
+
+/* P slice with first_mb_in_slice 0 */
+static guint8 h264_p_slice[] = {
+  0x41, 0x9a, 0x02, 0x04, 0x08, 0x10
+};
+
+static void
+add_gop_cache_nal (GstBufferList * list, const guint8 * nal, gsize size,
+    guint16 * seqnum, guint32 timestamp, gboolean marker)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer = gst_rtp_buffer_new_allocate (size, 0, 0);
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp));
+  memcpy (gst_rtp_buffer_get_payload (&rtp), nal, size);
+  gst_rtp_buffer_set_payload_type (&rtp, 96);
+  gst_rtp_buffer_set_seq (&rtp, (*seqnum)++);
+  gst_rtp_buffer_set_timestamp (&rtp, timestamp);
+  gst_rtp_buffer_set_marker (&rtp, marker);
+  gst_rtp_buffer_unmap (&rtp);
+
+  gst_buffer_list_add (list, buffer);
+}
+
+/* returns the single NAL unit packets of an IDR or a P frame */
+static GstBufferList *
+create_gop_cache_frame (gboolean keyframe, guint16 * seqnum)
+{
+  GstBufferList *list = gst_buffer_list_new ();
+  guint32 timestamp = *seqnum * 3000;
+
+  if (keyframe) {
+    add_gop_cache_nal (list, h264_sps + 4, sizeof (h264_sps) - 4, seqnum,
+        timestamp, FALSE);
+    add_gop_cache_nal (list, h264_pps + 4, sizeof (h264_pps) - 4, seqnum,
+        timestamp, FALSE);
+    add_gop_cache_nal (list, h264_idr_slice_1 + 4,
+        sizeof (h264_idr_slice_1) - 4, seqnum, timestamp, TRUE);
+  } else {
+    add_gop_cache_nal (list, h264_p_slice, sizeof (h264_p_slice), seqnum,
+        timestamp, TRUE);
+  }
+
+  return list;
+}
+
+static void
+push_gop_cache_frame (GstHarness * h, gboolean keyframe, guint16 * seqnum)
+{
+  GstBufferList *list = create_gop_cache_frame (keyframe, seqnum);
+  guint i;
+
+  for (i = 0; i < gst_buffer_list_length (list); i++)
+    fail_unless_equals_int (gst_harness_push (h,
+            gst_buffer_ref (gst_buffer_list_get (list, i))), GST_FLOW_OK);
+  gst_buffer_list_unref (list);
+}
+
+static guint64
+get_gop_cache_stat (GstHarness * h, const gchar * field)
+{
+  GstStructure *stats;
+  guint64 value;
+  guint n_buffers;
+
+  g_object_get (h->element, "stats", &stats, NULL);
+  if (g_str_equal (field, "gop-cache-buffers")) {
+    fail_unless (gst_structure_get_uint (stats, field, &n_buffers));
+    value = n_buffers;
+  } else {
+    fail_unless (gst_structure_get_uint64 (stats, field, &value));
+  }
+  gst_structure_free (stats);
+
+  return value;
+}
+
+/* pulls @n buffers, the first @n_decode_only being a replayed GOP */
+static gsize
+pull_gop_cache_frames (GstHarness * h, guint n, guint n_decode_only)
+{
+  GstBuffer *buffer;
+  gsize size = 0;
+  guint i;
+
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), n);
+
+  for (i = 0; i < n; i++) {
+    buffer = gst_harness_pull (h);
+    if (i < n_decode_only)
+      fail_unless (GST_BUFFER_FLAG_IS_SET (buffer,
+              GST_BUFFER_FLAG_DECODE_ONLY));
+    else
+      fail_if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DECODE_ONLY));
+    size += gst_buffer_get_size (buffer);
+    gst_buffer_unref (buffer);
+  }
+
+  return size;
+}
+
+GST_START_TEST (test_rtph264depay_gop_cache)
+{
+  GstHarness *h = gst_harness_new ("rtph264depay");
+  GstEvent *event;
+  guint16 seqnum = 0;
+  gsize gop_size;
+  guint i, n_requests = 0;
+
+  g_object_set (h->element, "gop-cache-size", 100000,
+      "keyframe-request-interval", 60000, NULL);
+  gst_harness_set_caps_str (h,
+      "application/x-rtp,media=video,clock-rate=90000,encoding-name=H264",
+      "video/x-h264,alignment=au,stream-format=byte-stream");
+
+  push_gop_cache_frame (h, TRUE, &seqnum);
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  gop_size = pull_gop_cache_frames (h, 3, 0);
+
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-buffers"), 3);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-bytes"),
+      gop_size);
+
+  /* after a flush the cached GOP comes before the next frame */
+  fail_unless (gst_harness_push_event (h, gst_event_new_flush_start ()));
+  fail_unless (gst_harness_push_event (h, gst_event_new_flush_stop (FALSE)));
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  pull_gop_cache_frames (h, 4, 3);
+
+  /* keyframe requests from downstream don't replay the cache, and only the
+   * first one goes upstream */
+  for (i = 0; i < 3; i++)
+    fail_unless (gst_harness_push_upstream_event (h,
+            gst_video_event_new_upstream_force_key_unit (GST_CLOCK_TIME_NONE,
+                TRUE, 0)));
+  while ((event = gst_harness_try_pull_upstream_event (h))) {
+    if (gst_video_event_is_force_key_unit (event))
+      n_requests++;
+    gst_event_unref (event);
+  }
+  fail_unless_equals_int (n_requests, 1);
+  fail_unless_equals_int (get_gop_cache_stat (h, "keyframe-requests"), 1);
+  fail_unless_equals_int (get_gop_cache_stat (h,
+          "keyframe-requests-coalesced"), 2);
+
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  pull_gop_cache_frames (h, 1, 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-replays"), 1);
+
+  /* a keyframe starts a new GOP and isn't preceded by the old one */
+  fail_unless (gst_harness_push_upstream_event (h,
+          gst_video_event_new_upstream_force_key_unit (GST_CLOCK_TIME_NONE,
+              TRUE, 0)));
+  push_gop_cache_frame (h, TRUE, &seqnum);
+  gop_size = pull_gop_cache_frames (h, 1, 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-buffers"), 1);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-gops"), 2);
+
+  /* the GOP is dropped until the next keyframe once it doesn't fit */
+  g_object_set (h->element, "gop-cache-size", (guint) gop_size, NULL);
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  pull_gop_cache_frames (h, 1, 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-bytes"), 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-overflows"), 1);
+
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  pull_gop_cache_frames (h, 1, 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-buffers"), 0);
+
+  push_gop_cache_frame (h, TRUE, &seqnum);
+  pull_gop_cache_frames (h, 1, 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-bytes"),
+      gop_size);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtph264depay_gop_cache_headers)
+{
+  GstHarness *h = gst_harness_new ("rtph264depay");
+  GstBuffer *buffer;
+  gchar *sps, *pps, *caps;
+  guint16 seqnum = 0;
+  gsize keyframe_size;
+
+  sps = g_base64_encode (h264_sps + 4, sizeof (h264_sps) - 4);
+  pps = g_base64_encode (h264_pps + 4, sizeof (h264_pps) - 4);
+  caps = g_strdup_printf ("application/x-rtp,media=video,clock-rate=90000,"
+      "encoding-name=H264,sprop-parameter-sets=\"%s,%s\"", sps, pps);
+  g_object_set (h->element, "gop-cache-size", 100000, NULL);
+  gst_harness_set_caps_str (h, caps,
+      "video/x-h264,alignment=au,stream-format=byte-stream");
+  g_free (caps);
+  g_free (pps);
+  g_free (sps);
+
+  push_gop_cache_frame (h, TRUE, &seqnum);
+  buffer = gst_harness_pull (h);
+  keyframe_size = gst_buffer_get_size (buffer);
+  gst_buffer_unref (buffer);
+
+  /* the parameter sets from the caps come with the replayed keyframe */
+  fail_unless (gst_harness_push_event (h, gst_event_new_flush_start ()));
+  fail_unless (gst_harness_push_event (h, gst_event_new_flush_stop (FALSE)));
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 2);
+  buffer = gst_harness_pull (h);
+  fail_unless (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DECODE_ONLY));
+  fail_if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT));
+  fail_unless_equals_int (gst_buffer_get_size (buffer),
+      keyframe_size + sizeof (h264_sps) + sizeof (h264_pps));
+  gst_buffer_unref (buffer);
+  buffer = gst_harness_pull (h);
+  fail_if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DECODE_ONLY));
+  gst_buffer_unref (buffer);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* pulls @n buffers from @sink, the first @n_decode_only being a replayed
+ * GOP */
+static void
+pull_gop_cache_samples (GstElement * sink, guint n, guint n_decode_only)
+{
+  GstSample *sample;
+  GstBuffer *buffer;
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    sample = gst_app_sink_try_pull_sample (GST_APP_SINK (sink), 5 * GST_SECOND);
+    fail_unless (sample != NULL);
+    buffer = gst_sample_get_buffer (sample);
+    if (i < n_decode_only)
+      fail_unless (GST_BUFFER_FLAG_IS_SET (buffer,
+              GST_BUFFER_FLAG_DECODE_ONLY));
+    else
+      fail_if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DECODE_ONLY));
+    gst_sample_unref (sample);
+  }
+}
+
+/* a consumer that joins behind a tee doesn't link the source pad of the
+ * depayloader, it asks for the cached GOP with a custom event instead */
+GST_START_TEST (test_rtph264depay_gop_cache_tee)
+{
+  GstElement *pipeline, *src, *depay, *tee, *sink, *sink2;
+  GstPad *teepad, *sinkpad;
+  GstStructure *stats;
+  guint64 n_replays;
+  guint16 seqnum = 0;
+
+  pipeline = gst_parse_launch ("appsrc name=src format=time "
+      "caps=\"application/x-rtp,media=video,clock-rate=90000,"
+      "encoding-name=H264\" ! rtph264depay name=depay gop-cache-size=100000 "
+      "! video/x-h264,alignment=au,stream-format=byte-stream "
+      "! tee name=t ! appsink name=sink sync=false", NULL);
+  fail_unless (pipeline != NULL);
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  depay = gst_bin_get_by_name (GST_BIN (pipeline), "depay");
+  tee = gst_bin_get_by_name (GST_BIN (pipeline), "t");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+
+  fail_unless_equals_int (gst_app_src_push_buffer_list (GST_APP_SRC (src),
+          create_gop_cache_frame (TRUE, &seqnum)), GST_FLOW_OK);
+  fail_unless_equals_int (gst_app_src_push_buffer_list (GST_APP_SRC (src),
+          create_gop_cache_frame (FALSE, &seqnum)), GST_FLOW_OK);
+  fail_unless_equals_int (gst_app_src_push_buffer_list (GST_APP_SRC (src),
+          create_gop_cache_frame (FALSE, &seqnum)), GST_FLOW_OK);
+  pull_gop_cache_samples (sink, 3, 0);
+
+  /* the new branch asks for the GOP, and gets it before the next frame */
+  sink2 = gst_element_factory_make ("appsink", NULL);
+  g_object_set (sink2, "sync", FALSE, "async", FALSE, NULL);
+  fail_unless (gst_bin_add (GST_BIN (pipeline), sink2));
+  teepad = gst_element_request_pad_simple (tee, "src_%u");
+  sinkpad = gst_element_get_static_pad (sink2, "sink");
+  fail_unless_equals_int (gst_pad_link (teepad, sinkpad), GST_PAD_LINK_OK);
+  fail_unless (gst_element_sync_state_with_parent (sink2));
+
+  fail_unless (gst_pad_push_event (sinkpad,
+          gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+              gst_structure_new_empty ("GstRtpGopCacheReplay"))));
+
+  fail_unless_equals_int (gst_app_src_push_buffer_list (GST_APP_SRC (src),
+          create_gop_cache_frame (FALSE, &seqnum)), GST_FLOW_OK);
+  pull_gop_cache_samples (sink2, 4, 3);
+  /* the consumers that were there already see it again, but don't show it */
+  pull_gop_cache_samples (sink, 4, 3);
+
+  g_object_get (depay, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "gop-cache-replays",
+          &n_replays));
+  fail_unless_equals_int (n_replays, 1);
+  gst_structure_free (stats);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  gst_element_release_request_pad (tee, teepad);
+  gst_object_unref (teepad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (sink);
+  gst_object_unref (tee);
+  gst_object_unref (depay);
+  gst_object_unref (src);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+/* payloads a frame with @n_sei SEI and returns its RTP packets */
+static GPtrArray *
+create_zero_copy_packets (guint n_sei, guint mtu, gsize * nal_bytes)
+{
+  GPtrArray *packets;
+  GstHarness *h;
+  GstBuffer *buffer;
+  gchar *desc;
+
+  desc = g_strdup_printf ("rtph264pay mtu=%u aggregate-mode=zero-latency",
+      mtu);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  gst_harness_set_src_caps_str (h,
+      "video/x-h264,alignment=au,stream-format=byte-stream");
+
+  fail_unless_equals_int (gst_harness_push (h,
+          create_zero_copy_frame (n_sei, nal_bytes)), GST_FLOW_OK);
+
+  packets = g_ptr_array_new_with_free_func ((GDestroyNotify) gst_buffer_unref);
+  while ((buffer = gst_harness_try_pull (h)))
+    g_ptr_array_add (packets, buffer);
+
+  gst_harness_teardown (h);
+
+  return packets;
+}
+
+/* copies @packet into a single memory, the way a source would receive it */
+static GstBuffer *
+copy_packet (GstBuffer * packet, guint16 seqnum, guint32 timestamp)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+  GstMapInfo map;
+
+  buffer = gst_buffer_new_allocate (NULL, gst_buffer_get_size (packet), NULL);
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_WRITE));
+  gst_buffer_extract (packet, 0, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp));
+  gst_rtp_buffer_set_seq (&rtp, seqnum);
+  gst_rtp_buffer_set_timestamp (&rtp, timestamp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buffer;
+}
+
+/* depayloads @n_frames frames made of @packets and returns the output bytes
+ * that reference the RTP packets and that were copied per frame. The output
+ * is appended to @output if not %NULL */
+static gint64
+run_depay_zero_copy (GPtrArray * packets, const gchar * stream_format,
+    const gchar * alignment, gboolean zero_copy, guint n_frames,
+    gsize * shared, gsize * copied, GByteArray * output)
+{
+  GPtrArray *mems;
+  GstHarness *h;
+  GstBuffer *buffer;
+  gint64 start, elapsed = 0;
+  guint16 seqnum = 0;
+  gchar *caps;
+  guint n, i;
+
+  h = gst_harness_new ("rtph264depay");
+  g_object_set (h->element, "zero-copy", zero_copy, NULL);
+
+  caps = g_strdup_printf ("video/x-h264,alignment=%s,stream-format=%s",
+      alignment, stream_format);
+  gst_harness_set_caps_str (h,
+      "application/x-rtp,media=video,clock-rate=90000,encoding-name=H264",
+      caps);
+  g_free (caps);
+
+  mems = g_ptr_array_new_with_free_func ((GDestroyNotify) gst_memory_unref);
+  *shared = *copied = 0;
+
+  for (n = 0; n < n_frames; n++) {
+    for (i = 0; i < packets->len; i++) {
+      buffer = copy_packet (g_ptr_array_index (packets, i), seqnum++, n * 3000);
+      g_ptr_array_add (mems, gst_memory_ref (gst_buffer_peek_memory (buffer,
+                  0)));
+
+      start = g_get_monotonic_time ();
+      fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+      elapsed += g_get_monotonic_time () - start;
+    }
+
+    while ((buffer = gst_harness_try_pull (h))) {
+      gsize size = 0;
+
+      for (i = 0; i < mems->len; i++)
+        size += count_shared_bytes (buffer, g_ptr_array_index (mems, i));
+
+      *shared += size;
+      *copied += gst_buffer_get_size (buffer) - size;
+
+      if (output) {
+        GstMapInfo map;
+
+        fail_unless (gst_buffer_map (buffer, &map, GST_MAP_READ));
+        g_byte_array_append (output, map.data, map.size);
+        gst_buffer_unmap (buffer, &map);
+      }
+      gst_buffer_unref (buffer);
+    }
+
+    g_ptr_array_set_size (mems, 0);
+  }
+
+  *shared /= n_frames;
+  *copied /= n_frames;
+
+  g_ptr_array_unref (mems);
+  gst_harness_teardown (h);
+
+  return MAX (elapsed, 1);
+}
+
+/* the output formats the depayloader supports */
+static const gchar *stream_formats[] = { "byte-stream", "byte-stream", "avc" };
+static const gchar *alignments[] = { "nal", "au", "au" };
+
+GST_START_TEST (test_rtph264depay_zero_copy)
+{
+  GPtrArray *small, *large;
+  GByteArray *expected, *output;
+  gsize small_bytes, large_bytes, ps_bytes, shared, copied;
+  guint i;
+
+  /* the NAL units of an access unit fit in a buffer */
+  small = create_zero_copy_packets (1, 9000, &small_bytes);
+  /* they don't and the access unit has to be gathered */
+  large = create_zero_copy_packets (ZERO_COPY_N_SEI, 1400, &large_bytes);
+
+  for (i = 0; i < G_N_ELEMENTS (stream_formats); i++) {
+    /* SPS and PPS go in the codec_data with avc */
+    ps_bytes = i < 2 ? 0 : sizeof (h264_sps) + sizeof (h264_pps) - 8;
+
+    expected = g_byte_array_new ();
+    output = g_byte_array_new ();
+
+    run_depay_zero_copy (small, stream_formats[i], alignments[i], FALSE, 1,
+        &shared, &copied, expected);
+    fail_unless_equals_int (shared, 0);
+
+    /* only the NAL header of the IDR slice isn't referenced, it's
+     * reconstructed from the FU indicator and header */
+    run_depay_zero_copy (small, stream_formats[i], alignments[i], TRUE, 1,
+        &shared, &copied, output);
+    fail_unless_equals_int (shared, small_bytes - ps_bytes - 1);
+    fail_unless_equals_int (output->len, expected->len);
+    fail_unless (memcmp (output->data, expected->data, output->len) == 0);
+
+    g_byte_array_set_size (expected, 0);
+    g_byte_array_set_size (output, 0);
+
+    run_depay_zero_copy (large, stream_formats[i], alignments[i], FALSE, 1,
+        &shared, &copied, expected);
+    run_depay_zero_copy (large, stream_formats[i], alignments[i], TRUE, 1,
+        &shared, &copied, output);
+    if (i > 0)
+      fail_unless_equals_int (shared, 0);
+    fail_unless_equals_int (output->len, expected->len);
+    fail_unless (memcmp (output->data, expected->data, output->len) == 0);
+
+    GST_INFO ("stream-format=%s alignment=%s: %" G_GSIZE_FORMAT " bytes "
+        "referenced, %" G_GSIZE_FORMAT " bytes copied per large frame",
+        stream_formats[i], alignments[i], shared, copied);
+
+    g_byte_array_unref (expected);
+    g_byte_array_unref (output);
+  }
+
+  g_ptr_array_unref (small);
+  g_ptr_array_unref (large);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtph264depay_zero_copy_benchmark)
+{
+  GPtrArray *packets[2];
+  gsize nal_bytes, shared, copied;
+  gint64 elapsed;
+  guint i, j, k;
+
+  packets[0] = create_zero_copy_packets (1, 9000, &nal_bytes);
+  packets[1] = create_zero_copy_packets (ZERO_COPY_N_SEI, 1400, &nal_bytes);
+
+  for (i = 0; i < G_N_ELEMENTS (packets); i++) {
+    for (j = 1; j < G_N_ELEMENTS (stream_formats); j++) {
+      for (k = 0; k < 2; k++) {
+        elapsed = run_depay_zero_copy (packets[i], stream_formats[j],
+            alignments[j], k, BENCH_N_FRAMES, &shared, &copied, NULL);
+        GST_INFO ("%u packets, stream-format=%s zero-copy=%u: %.1f fps, %"
+            G_GSIZE_FORMAT " bytes referenced, %" G_GSIZE_FORMAT " bytes "
+            "copied per frame", packets[i]->len, stream_formats[j], k,
+            BENCH_N_FRAMES * (gdouble) G_USEC_PER_SEC / elapsed, shared,
+            copied);
+      }
+    }
+    g_ptr_array_unref (packets[i]);
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 rtph264_suite (void)
 {
@@ -1469,6 +2158,10 @@ rtph264_suite (void)
   tcase_add_test (tc_chain, test_rtph264depay_stap_a_marker);
   tcase_add_test (tc_chain, test_rtph264depay_fu_a);
   tcase_add_test (tc_chain, test_rtph264depay_fu_a_missing_start);
+  tcase_add_test (tc_chain, test_rtph264depay_zero_copy);
+  tcase_add_test (tc_chain, test_rtph264depay_gop_cache);
+  tcase_add_test (tc_chain, test_rtph264depay_gop_cache_headers);
+  tcase_add_test (tc_chain, test_rtph264depay_gop_cache_tee);
 
   tc_chain = tcase_create ("rtph264pay");
   suite_add_tcase (s, tc_chain);
@@ -1486,6 +2179,10 @@ rtph264_suite (void)
   tcase_add_test (tc_chain, test_rtph264pay_avc);
   tcase_add_test (tc_chain, test_rtph264pay_avc_two_slices_per_buffer);
   tcase_add_test (tc_chain, test_rtph264pay_avc_incomplete_nal);
+  tcase_add_test (tc_chain, test_rtph264pay_zero_copy);
+
+  tcase_add_benchmark (s, test_rtph264pay_zero_copy_benchmark);
+  tcase_add_benchmark (s, test_rtph264depay_zero_copy_benchmark);
 
   return s;
 }
@@ -28,6 +28,9 @@
 #include <gst/app/app.h>
 #include <gst/rtp/gstrtpbuffer.h>
 #include <gst/rtp/gstrtph265types.h>
+#include <gst/video/video.h>
+
+#include "benchmark.h"
 
 #define ALLOCATOR_CUSTOM_SYSMEM "CustomSysMem"
 
@@ -1128,6 +1131,546 @@ GST_START_TEST (test_rtph265pay_aggregate_verify_nalu_hdr)
 }
 
 GST_END_TEST;
+
+static guint8 h265_sei[] = {
+  0x00, 0x00, 0x00, 0x01, 0x4e, 0x01, 0x05, 0x02,
+  0xaa, 0xbb, 0x80
+};
+
+#define ZERO_COPY_N_SEI 10
+#define ZERO_COPY_IDR_SIZE 20000
+
+/* VPS, SPS, PPS, @n_sei SEI and an IDR slice that needs to be fragmented, in a
+ * single memory. With ZERO_COPY_N_SEI there are more SEI than an AP can
+ * reference without merging memories */
+static GstBuffer *
+create_zero_copy_frame (guint n_sei, gsize * nal_bytes)
+{
+  gsize size = sizeof (h265_vps) + sizeof (h265_sps) + sizeof (h265_pps) +
+      n_sei * sizeof (h265_sei) + 4 + ZERO_COPY_IDR_SIZE;
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, size, NULL);
+  GstMapInfo map;
+  guint8 *data;
+  guint i;
+
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_WRITE));
+  data = map.data;
+
+  memcpy (data, h265_vps, sizeof (h265_vps));
+  data += sizeof (h265_vps);
+  memcpy (data, h265_sps, sizeof (h265_sps));
+  data += sizeof (h265_sps);
+  memcpy (data, h265_pps, sizeof (h265_pps));
+  data += sizeof (h265_pps);
+  for (i = 0; i < n_sei; i++) {
+    memcpy (data, h265_sei, sizeof (h265_sei));
+    data += sizeof (h265_sei);
+  }
+
+  /* IDR slice without any zero byte */
+  data[0] = data[1] = data[2] = 0x00;
+  data[3] = 0x01;
+  data[4] = 0x28;
+  data[5] = 0x01;
+  for (i = 2; i < ZERO_COPY_IDR_SIZE; i++)
+    data[4 + i] = 0x80 | (i & 0x7f);
+
+  gst_buffer_unmap (buffer, &map);
+
+  /* everything but the start codes */
+  *nal_bytes = size - (4 + n_sei) * 4;
+
+  return buffer;
+}
+
+/* the bytes of @buffer that reference @orig, the others were written by
+ * the payloader */
+static gsize
+count_shared_bytes (GstBuffer * buffer, GstMemory * orig)
+{
+  gsize shared = 0;
+  guint i;
+
+  for (i = 0; i < gst_buffer_n_memory (buffer); i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+
+    if (mem == orig || mem->parent == orig)
+      shared += gst_memory_get_sizes (mem, NULL, NULL);
+  }
+
+  return shared;
+}
+
+static const gchar *aggregate_modes[] = { "none", "zero-latency", "max" };
+
+/* payloads @n_frames frames and returns the payload bytes that were
+ * referenced and written per frame */
+static gint64
+run_zero_copy (const gchar * aggregate_mode, guint n_frames, gsize * shared,
+    gsize * written)
+{
+  GstHarness *h;
+  GstBuffer *frame, *buffer;
+  GstMemory *orig;
+  gint64 start, elapsed = 0;
+  gsize nal_bytes;
+  gchar *desc;
+  guint n;
+
+  desc = g_strdup_printf ("rtph265pay mtu=1400 aggregate-mode=%s",
+      aggregate_mode);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  gst_harness_set_src_caps_str (h,
+      "video/x-h265,alignment=au,stream-format=byte-stream");
+
+  frame = create_zero_copy_frame (ZERO_COPY_N_SEI, &nal_bytes);
+  orig = gst_buffer_peek_memory (frame, 0);
+  *shared = *written = 0;
+
+  for (n = 0; n < n_frames; n++) {
+    buffer = gst_buffer_copy (frame);
+    GST_BUFFER_PTS (buffer) = n * GST_SECOND / 30;
+
+    start = g_get_monotonic_time ();
+    fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+    elapsed += g_get_monotonic_time () - start;
+
+    while ((buffer = gst_harness_try_pull (h))) {
+      gsize size = count_shared_bytes (buffer, orig);
+
+      *shared += size;
+      *written += gst_buffer_get_size (buffer) - 12 - size;
+      gst_buffer_unref (buffer);
+    }
+  }
+
+  *shared /= n_frames;
+  *written /= n_frames;
+
+  /* only the NAL header of the IDR slice isn't referenced, it's rewritten
+   * in the PayloadHdr and FU header */
+  fail_unless_equals_int (*shared, nal_bytes - 2);
+
+  gst_buffer_unref (frame);
+  gst_harness_teardown (h);
+
+  return MAX (elapsed, 1);
+}
+
+GST_START_TEST (test_rtph265pay_zero_copy)
+{
+  gsize shared, written;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (aggregate_modes); i++) {
+    run_zero_copy (aggregate_modes[i], 1, &shared, &written);
+    GST_INFO ("aggregate-mode=%s: %" G_GSIZE_FORMAT " bytes referenced, %"
+        G_GSIZE_FORMAT " bytes written per frame", aggregate_modes[i], shared,
+        written);
+  }
+}
+
+GST_END_TEST;
+
+#define BENCH_N_FRAMES 1000
+
+GST_START_TEST (test_rtph265pay_zero_copy_benchmark)
+{
+  gsize shared, written;
+  gint64 elapsed;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (aggregate_modes); i++) {
+    elapsed = run_zero_copy (aggregate_modes[i], BENCH_N_FRAMES, &shared,
+        &written);
+    GST_INFO ("aggregate-mode=%s: %.1f fps, %" G_GSIZE_FORMAT " bytes "
+        "referenced, %" G_GSIZE_FORMAT " bytes written per frame",
+        aggregate_modes[i], BENCH_N_FRAMES * (gdouble) G_USEC_PER_SEC /
+        elapsed, shared, written);
+  }
+}
+
+GST_END_TEST;
+
+/* TRAIL_R slice with first_slice_segment_in_pic_flag */
+static guint8 h265_trail_slice[] = {
+  0x02, 0x01, 0xd0, 0x02, 0x04, 0x08, 0x10
+};
+
+static void
+push_gop_cache_nal (GstHarness * h, const guint8 * nal, gsize size,
+    guint16 * seqnum, guint32 timestamp, gboolean marker)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer = gst_rtp_buffer_new_allocate (size, 0, 0);
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp));
+  memcpy (gst_rtp_buffer_get_payload (&rtp), nal, size);
+  gst_rtp_buffer_set_payload_type (&rtp, 96);
+  gst_rtp_buffer_set_seq (&rtp, (*seqnum)++);
+  gst_rtp_buffer_set_timestamp (&rtp, timestamp);
+  gst_rtp_buffer_set_marker (&rtp, marker);
+  gst_rtp_buffer_unmap (&rtp);
+
+  fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+}
+
+/* pushes an IDR or a TRAIL frame as single NAL unit packets */
+static void
+push_gop_cache_frame (GstHarness * h, gboolean keyframe, guint16 * seqnum)
+{
+  guint32 timestamp = *seqnum * 3000;
+
+  if (keyframe) {
+    push_gop_cache_nal (h, h265_vps + 4, sizeof (h265_vps) - 4, seqnum,
+        timestamp, FALSE);
+    push_gop_cache_nal (h, h265_sps + 4, sizeof (h265_sps) - 4, seqnum,
+        timestamp, FALSE);
+    push_gop_cache_nal (h, h265_pps + 4, sizeof (h265_pps) - 4, seqnum,
+        timestamp, FALSE);
+    push_gop_cache_nal (h, h265_idr_slice_1 + 4,
+        sizeof (h265_idr_slice_1) - 4, seqnum, timestamp, TRUE);
+  } else {
+    push_gop_cache_nal (h, h265_trail_slice, sizeof (h265_trail_slice),
+        seqnum, timestamp, TRUE);
+  }
+}
+
+static guint64
+get_gop_cache_stat (GstHarness * h, const gchar * field)
+{
+  GstStructure *stats;
+  guint64 value;
+  guint n_buffers;
+
+  g_object_get (h->element, "stats", &stats, NULL);
+  if (g_str_equal (field, "gop-cache-buffers")) {
+    fail_unless (gst_structure_get_uint (stats, field, &n_buffers));
+    value = n_buffers;
+  } else {
+    fail_unless (gst_structure_get_uint64 (stats, field, &value));
+  }
+  gst_structure_free (stats);
+
+  return value;
+}
+
+/* pulls @n buffers, the first @n_decode_only being a replayed GOP */
+static gsize
+pull_gop_cache_frames (GstHarness * h, guint n, guint n_decode_only)
+{
+  GstBuffer *buffer;
+  gsize size = 0;
+  guint i;
+
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), n);
+
+  for (i = 0; i < n; i++) {
+    buffer = gst_harness_pull (h);
+    if (i < n_decode_only)
+      fail_unless (GST_BUFFER_FLAG_IS_SET (buffer,
+              GST_BUFFER_FLAG_DECODE_ONLY));
+    else
+      fail_if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DECODE_ONLY));
+    size += gst_buffer_get_size (buffer);
+    gst_buffer_unref (buffer);
+  }
+
+  return size;
+}
+
+GST_START_TEST (test_rtph265depay_gop_cache)
+{
+  GstHarness *h = gst_harness_new ("rtph265depay");
+  GstEvent *event;
+  guint16 seqnum = 0;
+  gsize gop_size;
+  guint i, n_requests = 0;
+
+  g_object_set (h->element, "gop-cache-size", 100000,
+      "keyframe-request-interval", 60000, NULL);
+  gst_harness_set_caps_str (h,
+      "application/x-rtp,media=video,clock-rate=90000,encoding-name=H265",
+      "video/x-h265,alignment=au,stream-format=byte-stream");
+
+  push_gop_cache_frame (h, TRUE, &seqnum);
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  gop_size = pull_gop_cache_frames (h, 3, 0);
+
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-buffers"), 3);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-bytes"),
+      gop_size);
+
+  /* after a flush the cached GOP comes before the next frame */
+  fail_unless (gst_harness_push_event (h, gst_event_new_flush_start ()));
+  fail_unless (gst_harness_push_event (h, gst_event_new_flush_stop (FALSE)));
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  pull_gop_cache_frames (h, 4, 3);
+
+  /* keyframe requests from downstream don't replay the cache, and only the
+   * first one goes upstream */
+  for (i = 0; i < 3; i++)
+    fail_unless (gst_harness_push_upstream_event (h,
+            gst_video_event_new_upstream_force_key_unit (GST_CLOCK_TIME_NONE,
+                TRUE, 0)));
+  while ((event = gst_harness_try_pull_upstream_event (h))) {
+    if (gst_video_event_is_force_key_unit (event))
+      n_requests++;
+    gst_event_unref (event);
+  }
+  fail_unless_equals_int (n_requests, 1);
+  fail_unless_equals_int (get_gop_cache_stat (h, "keyframe-requests"), 1);
+  fail_unless_equals_int (get_gop_cache_stat (h,
+          "keyframe-requests-coalesced"), 2);
+
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  pull_gop_cache_frames (h, 1, 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-replays"), 1);
+
+  /* a keyframe starts a new GOP and isn't preceded by the old one */
+  fail_unless (gst_harness_push_upstream_event (h,
+          gst_video_event_new_upstream_force_key_unit (GST_CLOCK_TIME_NONE,
+              TRUE, 0)));
+  push_gop_cache_frame (h, TRUE, &seqnum);
+  gop_size = pull_gop_cache_frames (h, 1, 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-buffers"), 1);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-gops"), 2);
+
+  /* the GOP is dropped until the next keyframe once it doesn't fit */
+  g_object_set (h->element, "gop-cache-size", (guint) gop_size, NULL);
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  pull_gop_cache_frames (h, 1, 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-bytes"), 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-overflows"), 1);
+
+  push_gop_cache_frame (h, FALSE, &seqnum);
+  pull_gop_cache_frames (h, 1, 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-buffers"), 0);
+
+  push_gop_cache_frame (h, TRUE, &seqnum);
+  pull_gop_cache_frames (h, 1, 0);
+  fail_unless_equals_int (get_gop_cache_stat (h, "gop-cache-bytes"),
+      gop_size);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* payloads a frame with @n_sei SEI and returns its RTP packets */
+static GPtrArray *
+create_zero_copy_packets (guint n_sei, guint mtu, gsize * nal_bytes)
+{
+  GPtrArray *packets;
+  GstHarness *h;
+  GstBuffer *buffer;
+  gchar *desc;
+
+  desc = g_strdup_printf ("rtph265pay mtu=%u aggregate-mode=zero-latency",
+      mtu);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  gst_harness_set_src_caps_str (h,
+      "video/x-h265,alignment=au,stream-format=byte-stream");
+
+  fail_unless_equals_int (gst_harness_push (h,
+          create_zero_copy_frame (n_sei, nal_bytes)), GST_FLOW_OK);
+
+  packets = g_ptr_array_new_with_free_func ((GDestroyNotify) gst_buffer_unref);
+  while ((buffer = gst_harness_try_pull (h)))
+    g_ptr_array_add (packets, buffer);
+
+  gst_harness_teardown (h);
+
+  return packets;
+}
+
+/* copies @packet into a single memory, the way a source would receive it */
+static GstBuffer *
+copy_packet (GstBuffer * packet, guint16 seqnum, guint32 timestamp)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+  GstMapInfo map;
+
+  buffer = gst_buffer_new_allocate (NULL, gst_buffer_get_size (packet), NULL);
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_WRITE));
+  gst_buffer_extract (packet, 0, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp));
+  gst_rtp_buffer_set_seq (&rtp, seqnum);
+  gst_rtp_buffer_set_timestamp (&rtp, timestamp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buffer;
+}
+
+/* depayloads @n_frames frames made of @packets and returns the output bytes
+ * that reference the RTP packets and that were copied per frame. The output
+ * is appended to @output if not %NULL */
+static gint64
+run_depay_zero_copy (GPtrArray * packets, const gchar * stream_format,
+    const gchar * alignment, gboolean zero_copy, guint n_frames,
+    gsize * shared, gsize * copied, GByteArray * output)
+{
+  GPtrArray *mems;
+  GstHarness *h;
+  GstBuffer *buffer;
+  gint64 start, elapsed = 0;
+  guint16 seqnum = 0;
+  gchar *caps;
+  guint n, i;
+
+  h = gst_harness_new ("rtph265depay");
+  g_object_set (h->element, "zero-copy", zero_copy, NULL);
+
+  caps = g_strdup_printf ("video/x-h265,alignment=%s,stream-format=%s",
+      alignment, stream_format);
+  gst_harness_set_caps_str (h,
+      "application/x-rtp,media=video,clock-rate=90000,encoding-name=H265",
+      caps);
+  g_free (caps);
+
+  mems = g_ptr_array_new_with_free_func ((GDestroyNotify) gst_memory_unref);
+  *shared = *copied = 0;
+
+  for (n = 0; n < n_frames; n++) {
+    for (i = 0; i < packets->len; i++) {
+      buffer = copy_packet (g_ptr_array_index (packets, i), seqnum++, n * 3000);
+      g_ptr_array_add (mems, gst_memory_ref (gst_buffer_peek_memory (buffer,
+                  0)));
+
+      start = g_get_monotonic_time ();
+      fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+      elapsed += g_get_monotonic_time () - start;
+    }
+
+    while ((buffer = gst_harness_try_pull (h))) {
+      gsize size = 0;
+
+      for (i = 0; i < mems->len; i++)
+        size += count_shared_bytes (buffer, g_ptr_array_index (mems, i));
+
+      *shared += size;
+      *copied += gst_buffer_get_size (buffer) - size;
+
+      if (output) {
+        GstMapInfo map;
+
+        fail_unless (gst_buffer_map (buffer, &map, GST_MAP_READ));
+        g_byte_array_append (output, map.data, map.size);
+        gst_buffer_unmap (buffer, &map);
+      }
+      gst_buffer_unref (buffer);
+    }
+
+    g_ptr_array_set_size (mems, 0);
+  }
+
+  *shared /= n_frames;
+  *copied /= n_frames;
+
+  g_ptr_array_unref (mems);
+  gst_harness_teardown (h);
+
+  return MAX (elapsed, 1);
+}
+
+/* the output formats the depayloader supports */
+static const gchar *stream_formats[] = { "byte-stream", "byte-stream", "hvc1" };
+static const gchar *alignments[] = { "nal", "au", "au" };
+
+GST_START_TEST (test_rtph265depay_zero_copy)
+{
+  GPtrArray *small, *large;
+  GByteArray *expected, *output;
+  gsize small_bytes, large_bytes, ps_bytes, shared, copied;
+  guint i;
+
+  /* the NAL units of an access unit fit in a buffer */
+  small = create_zero_copy_packets (1, 9000, &small_bytes);
+  /* they don't and the access unit has to be gathered */
+  large = create_zero_copy_packets (ZERO_COPY_N_SEI, 1400, &large_bytes);
+
+  for (i = 0; i < G_N_ELEMENTS (stream_formats); i++) {
+    /* VPS, SPS and PPS go in the codec_data with hvc1 */
+    ps_bytes = i < 2 ? 0 : sizeof (h265_vps) + sizeof (h265_sps) +
+        sizeof (h265_pps) - 12;
+
+    expected = g_byte_array_new ();
+    output = g_byte_array_new ();
+
+    run_depay_zero_copy (small, stream_formats[i], alignments[i], FALSE, 1,
+        &shared, &copied, expected);
+    fail_unless_equals_int (shared, 0);
+
+    /* only the NAL header of the IDR slice isn't referenced, it's
+     * reconstructed from the PayloadHdr and FU header */
+    run_depay_zero_copy (small, stream_formats[i], alignments[i], TRUE, 1,
+        &shared, &copied, output);
+    fail_unless_equals_int (shared, small_bytes - ps_bytes - 2);
+    fail_unless_equals_int (output->len, expected->len);
+    fail_unless (memcmp (output->data, expected->data, output->len) == 0);
+
+    g_byte_array_set_size (expected, 0);
+    g_byte_array_set_size (output, 0);
+
+    run_depay_zero_copy (large, stream_formats[i], alignments[i], FALSE, 1,
+        &shared, &copied, expected);
+    run_depay_zero_copy (large, stream_formats[i], alignments[i], TRUE, 1,
+        &shared, &copied, output);
+    if (i > 0)
+      fail_unless_equals_int (shared, 0);
+    fail_unless_equals_int (output->len, expected->len);
+    fail_unless (memcmp (output->data, expected->data, output->len) == 0);
+
+    GST_INFO ("stream-format=%s alignment=%s: %" G_GSIZE_FORMAT " bytes "
+        "referenced, %" G_GSIZE_FORMAT " bytes copied per large frame",
+        stream_formats[i], alignments[i], shared, copied);
+
+    g_byte_array_unref (expected);
+    g_byte_array_unref (output);
+  }
+
+  g_ptr_array_unref (small);
+  g_ptr_array_unref (large);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtph265depay_zero_copy_benchmark)
+{
+  GPtrArray *packets[2];
+  gsize nal_bytes, shared, copied;
+  gint64 elapsed;
+  guint i, j, k;
+
+  packets[0] = create_zero_copy_packets (1, 9000, &nal_bytes);
+  packets[1] = create_zero_copy_packets (ZERO_COPY_N_SEI, 1400, &nal_bytes);
+
+  for (i = 0; i < G_N_ELEMENTS (packets); i++) {
+    for (j = 1; j < G_N_ELEMENTS (stream_formats); j++) {
+      for (k = 0; k < 2; k++) {
+        elapsed = run_depay_zero_copy (packets[i], stream_formats[j],
+            alignments[j], k, BENCH_N_FRAMES, &shared, &copied, NULL);
+        GST_INFO ("%u packets, stream-format=%s zero-copy=%u: %.1f fps, %"
+            G_GSIZE_FORMAT " bytes referenced, %" G_GSIZE_FORMAT " bytes "
+            "copied per frame", packets[i]->len, stream_formats[j], k,
+            BENCH_N_FRAMES * (gdouble) G_USEC_PER_SEC / elapsed, shared,
+            copied);
+      }
+    }
+    g_ptr_array_unref (packets[i]);
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 rtph265_suite (void)
 {
@@ -1139,6 +1682,8 @@ rtph265_suite (void)
   tcase_add_test (tc_chain, test_rtph265depay_with_downstream_allocator);
   tcase_add_test (tc_chain, test_rtph265depay_eos);
   tcase_add_test (tc_chain, test_rtph265depay_marker_to_flag);
+  tcase_add_test (tc_chain, test_rtph265depay_zero_copy);
+  tcase_add_test (tc_chain, test_rtph265depay_gop_cache);
   /* TODO We need a sample to test with */
   /* tcase_add_test (tc_chain, test_rtph265depay_aggregate_marker); */
 
@@ -1154,6 +1699,10 @@ rtph265_suite (void)
   tcase_add_test (tc_chain, test_rtph265pay_aggregate_with_discont);
   tcase_add_test (tc_chain, test_rtph265pay_aggregate_until_vcl);
   tcase_add_test (tc_chain, test_rtph265pay_aggregate_verify_nalu_hdr);
+  tcase_add_test (tc_chain, test_rtph265pay_zero_copy);
+
+  tcase_add_benchmark (s, test_rtph265pay_zero_copy_benchmark);
+  tcase_add_benchmark (s, test_rtph265depay_zero_copy_benchmark);
 
   return s;
 }
@@ -0,0 +1,305 @@
+/* GStreamer
+ *
+ * Unit tests and benchmark for the RTP packet history shared by rtpstorage
+ * and rtprtxsend
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include "gst/rtp/rtphistory.h"
+#include "benchmark.h"
+
+#define PACKET_SIZE 1200
+
+static GstBuffer *
+create_packet (gsize size, GstClockTime pts)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+
+  GST_BUFFER_PTS (buf) = pts;
+  return buf;
+}
+
+static gboolean
+add_packet (RtpHistory * history, guint32 ssrc, guint16 seqnum)
+{
+  GstBuffer *buf = create_packet (PACKET_SIZE, seqnum * GST_MSECOND);
+  gboolean ret;
+
+  ret = rtp_history_add_packet (history, ssrc, buf, seqnum, 96, seqnum * 90);
+  gst_buffer_unref (buf);
+
+  return ret;
+}
+
+GST_START_TEST (test_history_lookup)
+{
+  RtpHistory *history = rtp_history_new ();
+  const RtpHistoryPacket *packet;
+  guint16 seqnum;
+
+  for (seqnum = 100; seqnum < 200; seqnum++)
+    fail_unless (add_packet (history, 0x1234, seqnum));
+
+  fail_unless (rtp_history_has_stream (history, 0x1234));
+  fail_if (rtp_history_has_stream (history, 0x4321));
+  fail_unless_equals_int (rtp_history_get_n_packets (history, 0x1234), 100);
+  fail_unless_equals_uint64 (rtp_history_get_n_bytes (history),
+      100 * PACKET_SIZE);
+
+  packet = rtp_history_lookup (history, 0x1234, 150);
+  fail_unless (packet != NULL);
+  fail_unless_equals_int (packet->seqnum, 150);
+  fail_unless_equals_int (packet->pt, 96);
+  fail_unless_equals_int (packet->rtptime, 150 * 90);
+  fail_unless_equals_uint64 (packet->arrival, 150 * GST_MSECOND);
+  fail_unless_equals_int (gst_buffer_get_size (packet->buffer), PACKET_SIZE);
+
+  fail_unless (rtp_history_lookup (history, 0x1234, 99) == NULL);
+  fail_unless (rtp_history_lookup (history, 0x1234, 200) == NULL);
+  fail_unless (rtp_history_lookup (history, 0x4321, 150) == NULL);
+
+  fail_unless_equals_int (rtp_history_get_oldest (history, 0x1234)->seqnum,
+      100);
+  fail_unless_equals_int (rtp_history_get_newest (history, 0x1234)->seqnum,
+      199);
+  fail_unless_equals_uint64 (rtp_history_get_max_arrival (history, 0x1234),
+      199 * GST_MSECOND);
+
+  rtp_history_remove_oldest (history, 0x1234);
+  fail_unless (rtp_history_lookup (history, 0x1234, 100) == NULL);
+  fail_unless_equals_int (rtp_history_get_oldest (history, 0x1234)->seqnum,
+      101);
+  fail_unless_equals_int (rtp_history_get_n_packets (history, 0x1234), 99);
+
+  rtp_history_remove_stream (history, 0x1234);
+  fail_if (rtp_history_has_stream (history, 0x1234));
+  fail_unless_equals_uint64 (rtp_history_get_n_bytes (history), 0);
+
+  rtp_history_free (history);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_history_seqnum_wrap)
+{
+  RtpHistory *history = rtp_history_new ();
+  guint16 seqnum = 65500;
+  guint i;
+
+  for (i = 0; i < 100; i++, seqnum++)
+    fail_unless (add_packet (history, 0x1234, seqnum));
+
+  fail_unless_equals_int (rtp_history_get_oldest (history, 0x1234)->seqnum,
+      65500);
+  fail_unless_equals_int (rtp_history_get_newest (history, 0x1234)->seqnum,
+      63);
+  fail_unless (rtp_history_lookup (history, 0x1234, 65535) != NULL);
+  fail_unless (rtp_history_lookup (history, 0x1234, 0) != NULL);
+  fail_unless (rtp_history_lookup (history, 0x1234, 64) == NULL);
+  fail_unless (rtp_history_lookup (history, 0x1234, 65499) == NULL);
+
+  rtp_history_free (history);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_history_reorder)
+{
+  RtpHistory *history = rtp_history_new ();
+
+  fail_unless (add_packet (history, 0x1234, 1000));
+  fail_unless (add_packet (history, 0x1234, 1003));
+  /* a hole at 1002 */
+  fail_unless (add_packet (history, 0x1234, 1001));
+  /* older than the oldest packet */
+  fail_unless (add_packet (history, 0x1234, 998));
+  /* already stored */
+  fail_if (add_packet (history, 0x1234, 1001));
+
+  fail_unless_equals_int (rtp_history_get_n_packets (history, 0x1234), 4);
+  fail_unless (rtp_history_lookup (history, 0x1234, 999) == NULL);
+  fail_unless (rtp_history_lookup (history, 0x1234, 1002) == NULL);
+  fail_unless_equals_int (rtp_history_get_oldest (history, 0x1234)->seqnum,
+      998);
+  fail_unless_equals_int (rtp_history_get_newest (history, 0x1234)->seqnum,
+      1003);
+
+  /* the holes are skipped when removing the oldest packets */
+  rtp_history_remove_oldest (history, 0x1234);
+  fail_unless_equals_int (rtp_history_get_oldest (history, 0x1234)->seqnum,
+      1000);
+
+  /* the window covers at most half the seqnum space, the packets that
+   * don't fit anymore are dropped */
+  fail_unless (add_packet (history, 0x1234, 1000 + 32769));
+  fail_unless_equals_int (rtp_history_get_n_packets (history, 0x1234), 2);
+  fail_unless_equals_int (rtp_history_get_oldest (history, 0x1234)->seqnum,
+      1003);
+  /* and older packets than the window can't be stored */
+  fail_if (add_packet (history, 0x1234, 1001));
+
+  /* a packet far behind the oldest one is handled as a restart */
+  fail_unless (add_packet (history, 0x5678, 5000));
+  fail_unless (add_packet (history, 0x5678, 5001));
+  fail_unless (add_packet (history, 0x5678, 1000));
+  fail_unless_equals_int (rtp_history_get_n_packets (history, 0x5678), 1);
+  fail_unless (rtp_history_lookup (history, 0x5678, 5000) == NULL);
+  fail_unless (rtp_history_lookup (history, 0x5678, 1000) != NULL);
+
+  rtp_history_free (history);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_history_max_bytes)
+{
+  RtpHistory *history = rtp_history_new ();
+  guint16 seqnum;
+  guint32 ssrc;
+
+  /* 3 streams, interleaved */
+  for (seqnum = 0; seqnum < 100; seqnum++) {
+    for (ssrc = 1; ssrc <= 3; ssrc++)
+      fail_unless (add_packet (history, ssrc, seqnum));
+  }
+  fail_unless_equals_uint64 (rtp_history_get_n_bytes (history),
+      300 * PACKET_SIZE);
+
+  /* setting a limit drops the packets stored first */
+  rtp_history_set_max_bytes (history, 150 * PACKET_SIZE);
+  fail_unless_equals_uint64 (rtp_history_get_n_bytes (history),
+      150 * PACKET_SIZE);
+  for (ssrc = 1; ssrc <= 3; ssrc++) {
+    fail_unless_equals_int (rtp_history_get_n_packets (history, ssrc), 50);
+    fail_unless_equals_int (rtp_history_get_oldest (history, ssrc)->seqnum,
+        50);
+  }
+
+  /* packets removed by the user are not counted twice */
+  rtp_history_remove_oldest (history, 1);
+  rtp_history_remove_stream (history, 2);
+  fail_unless_equals_uint64 (rtp_history_get_n_bytes (history),
+      99 * PACKET_SIZE);
+
+  /* a busy stream pushes the others out */
+  for (seqnum = 100; seqnum < 250; seqnum++)
+    fail_unless (add_packet (history, 4, seqnum));
+  fail_unless_equals_uint64 (rtp_history_get_n_bytes (history),
+      150 * PACKET_SIZE);
+  fail_unless_equals_int (rtp_history_get_n_packets (history, 1), 0);
+  fail_unless_equals_int (rtp_history_get_n_packets (history, 3), 0);
+  fail_unless_equals_int (rtp_history_get_n_packets (history, 4), 150);
+
+  /* buffers of mixed sizes */
+  rtp_history_clear (history);
+  for (seqnum = 0; seqnum < 100; seqnum++) {
+    GstBuffer *buf = create_packet (100 + seqnum, GST_CLOCK_TIME_NONE);
+
+    fail_unless (rtp_history_add_packet (history, 1, buf, seqnum, 96, 0));
+    fail_unless (rtp_history_get_n_bytes (history) <= 150 * PACKET_SIZE);
+    gst_buffer_unref (buf);
+  }
+
+  rtp_history_set_max_bytes (history, 0);
+  for (seqnum = 100; seqnum < 400; seqnum++)
+    fail_unless (add_packet (history, 1, seqnum));
+  fail_unless (rtp_history_get_n_bytes (history) > 150 * PACKET_SIZE);
+
+  rtp_history_free (history);
+}
+
+GST_END_TEST;
+
+#define BENCH_STREAMS 100
+#define BENCH_PACKETS 1000
+#define BENCH_LOOKUPS 1000000
+
+GST_START_TEST (test_history_benchmark)
+{
+  RtpHistory *history = rtp_history_new ();
+  /* all the packets share one buffer to keep the memory use low */
+  GstBuffer *buf = create_packet (PACKET_SIZE, GST_CLOCK_TIME_NONE);
+  GstClockTime start, elapsed;
+  GRand *rand = g_rand_new_with_seed (1);
+  guint found = 0;
+  guint32 ssrc;
+  guint i;
+
+  rtp_history_set_max_bytes (history, BENCH_STREAMS * BENCH_PACKETS *
+      PACKET_SIZE);
+
+  /* the streams are interleaved like in a busy SFU, the seqnums wrap */
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < BENCH_PACKETS * 2; i++) {
+    for (ssrc = 0; ssrc < BENCH_STREAMS; ssrc++)
+      rtp_history_add_packet (history, 0x10000 + ssrc, buf,
+          (guint16) (65000 + i), 96, i * 3000);
+  }
+  elapsed = gst_util_get_timestamp () - start;
+
+  fail_unless_equals_uint64 (rtp_history_get_n_bytes (history),
+      BENCH_STREAMS * BENCH_PACKETS * PACKET_SIZE);
+  GST_INFO ("adding %u packets: %" G_GUINT64_FORMAT " ns per packet",
+      BENCH_STREAMS * BENCH_PACKETS * 2,
+      elapsed / (BENCH_STREAMS * BENCH_PACKETS * 2));
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < BENCH_LOOKUPS; i++) {
+    ssrc = 0x10000 + g_rand_int_range (rand, 0, BENCH_STREAMS);
+    if (rtp_history_lookup (history, ssrc,
+            (guint16) (65000 + BENCH_PACKETS + g_rand_int_range (rand, 0,
+                    BENCH_PACKETS))))
+      found++;
+  }
+  elapsed = gst_util_get_timestamp () - start;
+
+  fail_unless_equals_int (found, BENCH_LOOKUPS);
+  GST_INFO ("%u streams: %" G_GUINT64_FORMAT " ns per lookup, %"
+      G_GSIZE_FORMAT " bytes of overhead per packet", BENCH_STREAMS,
+      elapsed / BENCH_LOOKUPS, rtp_history_get_overhead (history) /
+      (BENCH_STREAMS * BENCH_PACKETS));
+
+  /* the overhead is the ring, sized to the next power of two */
+  fail_unless (rtp_history_get_overhead (history) <
+      BENCH_STREAMS * BENCH_PACKETS * 128);
+
+  g_rand_free (rand);
+  rtp_history_free (history);
+  gst_buffer_unref (buf);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtphistory_suite (void)
+{
+  Suite *s = suite_create ("rtphistory");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_history_lookup);
+  tcase_add_test (tc_chain, test_history_seqnum_wrap);
+  tcase_add_test (tc_chain, test_history_reorder);
+  tcase_add_test (tc_chain, test_history_max_bytes);
+
+  tcase_add_benchmark (s, test_history_benchmark);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtphistory);
@@ -25,11 +25,19 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <time.h>
+
 #include <gst/check/gstcheck.h>
 #include <gst/check/gsttestclock.h>
 #include <gst/check/gstharness.h>
 #include <gst/rtp/gstrtpbuffer.h>
 
+#include "benchmark.h"
+
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
 /* For ease of programming we use globals to keep refs for our floating
  * src and sink pads we create; otherwise we always have to do get_pad,
  * get_peer, and then remove references in every test function */
@@ -2826,6 +2834,119 @@ GST_START_TEST (test_performance)
 
 GST_END_TEST;
 
+GST_START_TEST (test_shared_timers_lost_event)
+{
+  GstHarness *h = gst_harness_new_parse ("rtpjitterbuffer shared-timers=1");
+  GstBuffer *buf;
+  gint latency_ms = 100;
+  guint next_seqnum;
+  guint missing_seqnum;
+
+  g_object_set (h->element, "do-lost", TRUE, NULL);
+  next_seqnum = construct_deterministic_initial_state (h, latency_ms);
+
+  /* same as test_lost_event, but the timers are now handled from the shared
+   * thread pool */
+  missing_seqnum = next_seqnum;
+  next_seqnum += 1;
+  push_test_buffer (h, next_seqnum);
+
+  fail_unless_equals_int (0, gst_harness_buffers_in_queue (h));
+  fail_unless_equals_int (0, gst_harness_events_in_queue (h));
+
+  gst_harness_crank_single_clock_wait (h);
+  verify_lost_event (h, missing_seqnum,
+      missing_seqnum * TEST_BUF_DURATION, TEST_BUF_DURATION);
+
+  buf = gst_harness_pull (h);
+  fail_unless_equals_uint64 (next_seqnum * TEST_BUF_DURATION,
+      GST_BUFFER_PTS (buf));
+  fail_unless_equals_int (next_seqnum, get_rtp_seq_num (buf));
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* number of times any thread of the process was switched out, which is
+ * dominated by the timer threads going to sleep and waking up again */
+static guint64
+get_n_context_switches (void)
+{
+#ifdef G_OS_UNIX
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw + usage.ru_nivcsw;
+#else
+  return 0;
+#endif
+}
+
+static void
+run_timers_benchmark (gboolean shared_timers, guint n_jitterbuffers)
+{
+  GstHarness **h = g_new (GstHarness *, n_jitterbuffers);
+  GTimer *timer = g_timer_new ();
+  const gdouble test_duration = 1.0;
+  guint buffers_pushed = 0;
+  guint buffers_received = 0;
+  clock_t cpu_start, cpu_used;
+  guint64 switches_start, switches;
+  gchar *launch;
+  guint i;
+
+  launch = g_strdup_printf ("rtpjitterbuffer do-lost=1 latency=50 "
+      "shared-timers=%d", shared_timers);
+  for (i = 0; i < n_jitterbuffers; i++) {
+    h[i] = gst_harness_new_parse (launch);
+    gst_harness_set_src_caps (h[i], generate_caps ());
+    gst_harness_use_systemclock (h[i]);
+  }
+  g_free (launch);
+
+  switches_start = get_n_context_switches ();
+  cpu_start = clock ();
+  while (g_timer_elapsed (timer, NULL) < test_duration) {
+    /* every packet also produces a gap, so each jitterbuffer always has a
+     * lost timer pending */
+    guint n = buffers_pushed * 2;
+    guint16 seqnum = n & 0xffff;
+    guint32 rtp_ts = n * 8;
+    GstClockTime dts = n * GST_MSECOND;
+
+    for (i = 0; i < n_jitterbuffers; i++)
+      gst_harness_push (h[i], generate_test_buffer_full (dts, seqnum, rtp_ts));
+    buffers_pushed++;
+    g_usleep (2 * G_USEC_PER_SEC / 1000);
+  }
+  cpu_used = clock () - cpu_start;
+  switches = get_n_context_switches () - switches_start;
+  g_timer_destroy (timer);
+
+  for (i = 0; i < n_jitterbuffers; i++) {
+    buffers_received += gst_harness_buffers_received (h[i]);
+    gst_harness_teardown (h[i]);
+  }
+  g_free (h);
+
+  GST_INFO ("%u jitterbuffers, shared timers %d: pushed %u, received %u "
+      "(%.1f%%), %.0f wakeups/s, %.1f%% CPU", n_jitterbuffers, shared_timers,
+      buffers_pushed * n_jitterbuffers, buffers_received,
+      100.0 * buffers_received / (buffers_pushed * n_jitterbuffers),
+      switches / test_duration,
+      100.0 * cpu_used / CLOCKS_PER_SEC / test_duration);
+}
+
+GST_START_TEST (test_shared_timers_performance)
+{
+  run_timers_benchmark (FALSE, 100);
+  run_timers_benchmark (TRUE, 100);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_fill_queue)
 {
   GstHarness *h = gst_harness_new ("rtpjitterbuffer");
@@ -3433,6 +3554,7 @@ rtpjitterbuffer_suite (void)
       G_N_ELEMENTS (test_considered_lost_packet_in_large_gap_arrives_input));
 
   tcase_add_test (tc_chain, test_performance);
+  tcase_add_test (tc_chain, test_shared_timers_lost_event);
 
   tcase_add_test (tc_chain, test_drop_messages_too_late);
   tcase_add_test (tc_chain, test_drop_messages_drop_on_latency);
@@ -3443,6 +3565,7 @@ rtpjitterbuffer_suite (void)
   tcase_add_test (tc_chain, test_reset_using_rtx_packets_does_not_stall);
   tcase_add_test (tc_chain, test_gap_using_rtx_does_not_stall);
 
+  tcase_add_benchmark (s, test_shared_timers_performance);
 
   return s;
 }
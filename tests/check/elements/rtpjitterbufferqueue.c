@@ -0,0 +1,288 @@
+/* GStreamer
+ *
+ * Unit tests and benchmarks for the RTPJitterBuffer packet queue
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include "gst/rtpmanager/rtpjitterbuffer.h"
+#include "benchmark.h"
+
+static gboolean
+push_seqnum (RTPJitterBuffer * jbuf, GstBuffer * buf, guint16 seqnum)
+{
+  gboolean duplicate;
+
+  rtp_jitter_buffer_append_buffer (jbuf, gst_buffer_ref (buf),
+      GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, seqnum, seqnum * 90,
+      &duplicate, NULL);
+
+  return !duplicate;
+}
+
+static void
+push_event (RTPJitterBuffer * jbuf)
+{
+  rtp_jitter_buffer_append_event (jbuf, gst_event_new_gap (0, 0));
+}
+
+/* pops all items and checks them against @expected, -1 being an event */
+static void
+check_pop_order (RTPJitterBuffer * jbuf, const gint * expected, guint n)
+{
+  RTPJitterBufferItem *item;
+  guint i;
+
+  fail_unless_equals_int (rtp_jitter_buffer_num_packets (jbuf), n);
+
+  for (i = 0; i < n; i++) {
+    item = rtp_jitter_buffer_pop (jbuf, NULL);
+    fail_unless (item != NULL);
+    fail_unless_equals_int ((gint) item->seqnum, expected[i]);
+    rtp_jitter_buffer_free_item (item);
+  }
+
+  fail_unless (rtp_jitter_buffer_peek (jbuf) == NULL);
+}
+
+GST_START_TEST (test_queue_insert_order)
+{
+  RTPJitterBuffer *jbuf = rtp_jitter_buffer_new ();
+  GstBuffer *buf = gst_buffer_new ();
+  const gint expected[] = { 5, 10, 11, 12, 13, 14, 15 };
+
+  fail_unless (push_seqnum (jbuf, buf, 10));
+  fail_unless (push_seqnum (jbuf, buf, 12));
+  fail_unless (push_seqnum (jbuf, buf, 11));
+  fail_unless (push_seqnum (jbuf, buf, 15));
+  fail_unless (push_seqnum (jbuf, buf, 13));
+  fail_unless (push_seqnum (jbuf, buf, 14));
+  fail_unless (push_seqnum (jbuf, buf, 5));
+
+  /* duplicates of the head, the tail and something in between */
+  fail_if (push_seqnum (jbuf, buf, 5));
+  fail_if (push_seqnum (jbuf, buf, 12));
+  fail_if (push_seqnum (jbuf, buf, 15));
+
+  check_pop_order (jbuf, expected, G_N_ELEMENTS (expected));
+
+  /* a popped seqnum can be inserted again */
+  fail_unless (push_seqnum (jbuf, buf, 12));
+  check_pop_order (jbuf, expected + 3, 1);
+
+  g_object_unref (jbuf);
+  gst_buffer_unref (buf);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_queue_insert_events)
+{
+  RTPJitterBuffer *jbuf = rtp_jitter_buffer_new ();
+  GstBuffer *buf = gst_buffer_new ();
+  const gint expected[] = { -1, 0, 1, -1, -1, 2, 3, 4, -1 };
+
+  /* packets are inserted after the events that follow the previous packet,
+   * or after the events at the head */
+  push_event (jbuf);
+  fail_unless (push_seqnum (jbuf, buf, 1));
+  push_event (jbuf);
+  push_event (jbuf);
+  fail_unless (push_seqnum (jbuf, buf, 4));
+  push_event (jbuf);
+  fail_unless (push_seqnum (jbuf, buf, 0));
+  fail_unless (push_seqnum (jbuf, buf, 3));
+  fail_unless (push_seqnum (jbuf, buf, 2));
+
+  check_pop_order (jbuf, expected, G_N_ELEMENTS (expected));
+
+  g_object_unref (jbuf);
+  gst_buffer_unref (buf);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_queue_insert_wraparound)
+{
+  RTPJitterBuffer *jbuf = rtp_jitter_buffer_new ();
+  GstBuffer *buf = gst_buffer_new ();
+  const gint expected[] = { 65533, 65534, 65535, 0, 1, 2, 3 };
+
+  fail_unless (push_seqnum (jbuf, buf, 65534));
+  fail_unless (push_seqnum (jbuf, buf, 1));
+  fail_unless (push_seqnum (jbuf, buf, 65535));
+  fail_unless (push_seqnum (jbuf, buf, 3));
+  fail_unless (push_seqnum (jbuf, buf, 0));
+  fail_unless (push_seqnum (jbuf, buf, 65533));
+  fail_unless (push_seqnum (jbuf, buf, 2));
+  fail_if (push_seqnum (jbuf, buf, 65535));
+
+  check_pop_order (jbuf, expected, G_N_ELEMENTS (expected));
+
+  g_object_unref (jbuf);
+  gst_buffer_unref (buf);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_queue_insert_large_gaps)
+{
+  RTPJitterBuffer *jbuf = rtp_jitter_buffer_new ();
+  GstBuffer *buf = gst_buffer_new ();
+  const gint expected[] = { 0, 256, 300, 500, 600, 1000, 5000, 20000 };
+
+  /* gaps too big to be looked up in the index and packets that need the
+   * index to grow */
+  fail_unless (push_seqnum (jbuf, buf, 0));
+  fail_unless (push_seqnum (jbuf, buf, 1000));
+  fail_unless (push_seqnum (jbuf, buf, 500));
+  fail_unless (push_seqnum (jbuf, buf, 20000));
+  fail_unless (push_seqnum (jbuf, buf, 300));
+  fail_unless (push_seqnum (jbuf, buf, 5000));
+  fail_unless (push_seqnum (jbuf, buf, 600));
+  fail_unless (push_seqnum (jbuf, buf, 256));
+  fail_if (push_seqnum (jbuf, buf, 500));
+  fail_if (push_seqnum (jbuf, buf, 20000));
+
+  check_pop_order (jbuf, expected, G_N_ELEMENTS (expected));
+
+  g_object_unref (jbuf);
+  gst_buffer_unref (buf);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_queue_lost_event)
+{
+  RTPJitterBuffer *jbuf = rtp_jitter_buffer_new ();
+  GstBuffer *buf = gst_buffer_new ();
+  const gint expected[] = { 1, 2, 4 };
+
+  fail_unless (push_seqnum (jbuf, buf, 1));
+  fail_unless (push_seqnum (jbuf, buf, 4));
+  rtp_jitter_buffer_append_lost_event (jbuf, gst_event_new_gap (0, 0), 2, 2);
+  /* a lost event for a seqnum that is already there is a duplicate */
+  fail_if (rtp_jitter_buffer_append_lost_event (jbuf,
+          gst_event_new_gap (0, 0), 4, 1));
+
+  check_pop_order (jbuf, expected, G_N_ELEMENTS (expected));
+
+  g_object_unref (jbuf);
+  gst_buffer_unref (buf);
+}
+
+GST_END_TEST;
+
+typedef enum
+{
+  STREAM_IN_ORDER,
+  STREAM_REORDERED,
+  STREAM_LOSSY,
+} StreamType;
+
+static const gchar *stream_names[] = { "in order", "reordered", "lossy" };
+
+#define BENCH_PACKETS 200000
+/* 4K video at 2000 ms latency */
+#define BENCH_QUEUED 30000
+
+static void
+run_benchmark (StreamType type)
+{
+  RTPJitterBuffer *jbuf = rtp_jitter_buffer_new ();
+  GstBuffer *buf = gst_buffer_new ();
+  RTPJitterBufferItem *item;
+  GRand *rand = g_rand_new_with_seed (42);
+  guint16 *seqnums;
+  guint i, n_packets = 0;
+  gint64 start, elapsed;
+
+  seqnums = g_new (guint16, BENCH_PACKETS);
+  for (i = 0; i < BENCH_PACKETS; i++) {
+    guint16 seqnum = i;
+
+    /* drop 5% of the packets */
+    if (type == STREAM_LOSSY && g_rand_int_range (rand, 0, 100) < 5)
+      continue;
+
+    seqnums[n_packets++] = seqnum;
+  }
+
+  /* swap packets with one of the next 16 packets */
+  if (type == STREAM_REORDERED) {
+    for (i = 0; i + 16 < n_packets; i += 2) {
+      guint j = i + g_rand_int_range (rand, 1, 16);
+      guint16 tmp = seqnums[i];
+
+      seqnums[i] = seqnums[j];
+      seqnums[j] = tmp;
+    }
+  }
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_packets; i++) {
+    push_seqnum (jbuf, buf, seqnums[i]);
+
+    if (rtp_jitter_buffer_num_packets (jbuf) > BENCH_QUEUED) {
+      item = rtp_jitter_buffer_pop (jbuf, NULL);
+      rtp_jitter_buffer_free_item (item);
+    }
+  }
+  while (rtp_jitter_buffer_peek (jbuf)) {
+    item = rtp_jitter_buffer_pop (jbuf, NULL);
+    rtp_jitter_buffer_free_item (item);
+  }
+  elapsed = g_get_monotonic_time () - start;
+
+  GST_INFO ("%s: %u packets with %u queued in %" G_GINT64_FORMAT
+      " us, %.1f ns per insert/pop", stream_names[type], n_packets,
+      BENCH_QUEUED, elapsed, (gdouble) elapsed * 1000 / n_packets);
+
+  g_free (seqnums);
+  g_rand_free (rand);
+  g_object_unref (jbuf);
+  gst_buffer_unref (buf);
+}
+
+GST_START_TEST (test_queue_benchmark)
+{
+  run_benchmark (STREAM_IN_ORDER);
+  run_benchmark (STREAM_REORDERED);
+  run_benchmark (STREAM_LOSSY);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtpjitterbufferqueue_suite (void)
+{
+  Suite *s = suite_create ("rtpjitterbufferqueue");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_queue_insert_order);
+  tcase_add_test (tc_chain, test_queue_insert_events);
+  tcase_add_test (tc_chain, test_queue_insert_wraparound);
+  tcase_add_test (tc_chain, test_queue_insert_large_gaps);
+  tcase_add_test (tc_chain, test_queue_lost_event);
+
+  tcase_add_benchmark (s, test_queue_benchmark);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtpjitterbufferqueue);
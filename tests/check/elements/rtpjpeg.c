@@ -22,6 +22,8 @@
 #include <gst/app/app.h>
 #include <gst/rtp/gstrtpbuffer.h>
 
+#include "benchmark.h"
+
 
 /* one complete blank jpeg 1x1 */
 static const guint8 rtp_jpeg_frame_data[] =
@@ -334,6 +336,163 @@ GST_START_TEST (test_rtpjpegpay_5_slices)
 
 GST_END_TEST;
 
+/* offset of the first value of the luma quant table in rtp_jpeg_frame_data */
+#define FRAME_LUMA_TABLE_OFFSET 25
+/* offset of the luma quant table in the payload of the first packet */
+#define PAYLOAD_LUMA_TABLE_OFFSET 12
+/* offset of the luma quant table in the depayloaded JPEG */
+#define DEPAY_LUMA_TABLE_OFFSET 7
+
+/* a copy of rtp_jpeg_frame_data with @scan_size bytes of scan data and
+ * @luma_value as the first value of the luma quant table */
+static GstBuffer *
+create_jpeg_frame (guint8 luma_value, gsize scan_size)
+{
+  /* the frame ends with 6 bytes of scan data and EOI */
+  gsize header_size = sizeof (rtp_jpeg_frame_data) - 8;
+  gsize size = header_size + scan_size + 2;
+  guint8 *data = g_malloc (size);
+
+  memcpy (data, rtp_jpeg_frame_data, header_size);
+  data[FRAME_LUMA_TABLE_OFFSET] = luma_value;
+  memset (data + header_size, 0x55, scan_size);
+  data[size - 2] = 0xff;
+  data[size - 1] = 0xd9;
+
+  return gst_buffer_new_wrapped (data, size);
+}
+
+GST_START_TEST (test_rtpjpegpay_header_cache)
+{
+  GstHarness *h = gst_harness_new ("rtpjpegpay");
+  const guint8 luma_values[] = { 0x08, 0x08, 0x10, 0x08 };
+  GstMemory *quant[G_N_ELEMENTS (luma_values)];
+  GstBuffer *buffer;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint8 *payload;
+  guint i;
+
+  gst_harness_set_src_caps_str (h, "video/x-jpeg,height=1,width=1");
+
+  for (i = 0; i < G_N_ELEMENTS (luma_values); i++) {
+    fail_unless_equals_int (gst_harness_push (h,
+            create_jpeg_frame (luma_values[i], 16)), GST_FLOW_OK);
+    fail_unless_equals_int (gst_harness_buffers_in_queue (h), 1);
+
+    buffer = gst_harness_pull (h);
+    /* RTP and JPEG headers, quant tables and scan data */
+    fail_unless_equals_int (gst_buffer_n_memory (buffer), 3);
+    quant[i] = gst_memory_ref (gst_buffer_peek_memory (buffer, 1));
+
+    fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp));
+    payload = gst_rtp_buffer_get_payload (&rtp);
+    fail_unless_equals_int (payload[4], 1);     /* type */
+    fail_unless_equals_int (payload[6], 1);     /* width */
+    fail_unless_equals_int (payload[7], 1);     /* height */
+    fail_unless_equals_int (payload[PAYLOAD_LUMA_TABLE_OFFSET],
+        luma_values[i]);
+    fail_unless_equals_int (gst_rtp_buffer_get_payload_len (&rtp),
+        8 + 4 + 128 + 16 + 2);
+    gst_rtp_buffer_unmap (&rtp);
+    gst_buffer_unref (buffer);
+  }
+
+  /* the quant tables are shared as long as they don't change */
+  fail_unless (quant[0] == quant[1]);
+  fail_unless (quant[1] != quant[2]);
+  fail_unless (quant[2] != quant[3]);
+
+  for (i = 0; i < G_N_ELEMENTS (luma_values); i++)
+    gst_memory_unref (quant[i]);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtpjpegdepay_header_cache)
+{
+  GstHarness *h = gst_harness_new_parse ("rtpjpegpay ! rtpjpegdepay");
+  const guint8 luma_values[] = { 0x08, 0x08, 0x10, 0x08 };
+  GstBuffer *outbufs[G_N_ELEMENTS (luma_values)];
+  GstMapInfo map;
+  guint i;
+
+  gst_harness_set_src_caps_str (h, "video/x-jpeg,height=1,width=1");
+
+  for (i = 0; i < G_N_ELEMENTS (luma_values); i++) {
+    fail_unless_equals_int (gst_harness_push (h,
+            create_jpeg_frame (luma_values[i], 4000)), GST_FLOW_OK);
+    fail_unless_equals_int (gst_harness_buffers_in_queue (h), 1);
+
+    outbufs[i] = gst_harness_pull (h);
+    fail_unless (gst_buffer_map (outbufs[i], &map, GST_MAP_READ));
+    fail_unless_equals_int (map.data[0], 0xff); /* SOI */
+    fail_unless_equals_int (map.data[1], 0xd8);
+    fail_unless_equals_int (map.data[DEPAY_LUMA_TABLE_OFFSET],
+        luma_values[i]);
+    fail_unless_equals_int (map.data[map.size - 2], 0xff);      /* EOI */
+    fail_unless_equals_int (map.data[map.size - 1], 0xd9);
+    gst_buffer_unmap (outbufs[i], &map);
+  }
+
+  /* frames with the same tables give the same JPEG, also after the header
+   * was made again for other tables */
+  fail_unless_equals_int (gst_buffer_get_size (outbufs[0]),
+      gst_buffer_get_size (outbufs[2]));
+  fail_unless (gst_buffer_map (outbufs[0], &map, GST_MAP_READ));
+  fail_unless (gst_buffer_memcmp (outbufs[1], 0, map.data, map.size) == 0);
+  fail_unless (gst_buffer_memcmp (outbufs[2], 0, map.data, map.size) != 0);
+  fail_unless (gst_buffer_memcmp (outbufs[3], 0, map.data, map.size) == 0);
+  gst_buffer_unmap (outbufs[0], &map);
+
+  for (i = 0; i < G_N_ELEMENTS (luma_values); i++)
+    gst_buffer_unref (outbufs[i]);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+#define BENCH_STREAMS 16
+#define BENCH_FRAMES 200
+/* a 720p MJPEG frame from a camera */
+#define BENCH_SCAN_SIZE (64 * 1024)
+
+GST_START_TEST (test_rtpjpeg_benchmark)
+{
+  GstHarness *h[BENCH_STREAMS];
+  GstBuffer *frame = create_jpeg_frame (0x08, BENCH_SCAN_SIZE);
+  gint64 start, elapsed;
+  guint i, j;
+
+  for (i = 0; i < BENCH_STREAMS; i++) {
+    h[i] = gst_harness_new_parse ("rtpjpegpay ! rtpjpegdepay");
+    gst_harness_set_src_caps_str (h[i], "video/x-jpeg,height=1,width=1");
+  }
+
+  start = g_get_monotonic_time ();
+  for (j = 0; j < BENCH_FRAMES; j++) {
+    for (i = 0; i < BENCH_STREAMS; i++) {
+      fail_unless_equals_int (gst_harness_push (h[i], gst_buffer_ref (frame)),
+          GST_FLOW_OK);
+      gst_buffer_unref (gst_harness_pull (h[i]));
+    }
+  }
+  elapsed = g_get_monotonic_time () - start;
+
+  GST_INFO ("%u streams of %u frames of %u bytes in %" G_GINT64_FORMAT
+      " us, %.1f frames/s", BENCH_STREAMS, BENCH_FRAMES,
+      (guint) gst_buffer_get_size (frame), elapsed,
+      (gdouble) BENCH_STREAMS * BENCH_FRAMES * G_USEC_PER_SEC / elapsed);
+
+  for (i = 0; i < BENCH_STREAMS; i++)
+    gst_harness_teardown (h[i]);
+  gst_buffer_unref (frame);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 rtpjpeg_suite (void)
@@ -347,6 +506,14 @@ rtpjpeg_suite (void)
   tcase_add_test (tc_chain, test_rtpjpegpay_1_slice);
   tcase_add_test (tc_chain, test_rtpjpegpay_5_slices);
 
+  tc_chain = tcase_create ("rtpjpeg_header_cache");
+  suite_add_tcase (s, tc_chain);
+
+  tcase_add_test (tc_chain, test_rtpjpegpay_header_cache);
+  tcase_add_test (tc_chain, test_rtpjpegdepay_header_cache);
+
+  tcase_add_benchmark (s, test_rtpjpeg_benchmark);
+
   return s;
 }
 
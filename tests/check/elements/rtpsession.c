@@ -627,6 +627,102 @@ GST_START_TEST (test_no_rbs_for_internal_senders)
 
 GST_END_TEST;
 
+/* all internal senders report the same loss for a remote sender, and the
+ * generation of the RTCP packets is accounted in the session stats */
+GST_START_TEST (test_internal_senders_share_report_blocks)
+{
+  SessionHarness *h = session_harness_new ();
+  GstBuffer *buf;
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket rtcp_packet;
+  GstStructure *stats;
+  guint64 generation_count;
+  guint8 fractionlost[2];
+  gint32 packetslost, last_packetslost = 0;
+  guint32 exthighestseq, last_exthighestseq = 0;
+  guint32 ssrc;
+  gint i, j;
+
+  /* keep the remote source a sender for all the reports below */
+  g_object_set (h->session, "rtcp-min-interval", GST_SECOND, NULL);
+
+  for (j = 0; j < 5; j++) {
+    for (i = 0; i < 2; i++) {
+      buf = generate_test_buffer (j, 10000 + i);
+      fail_unless_equals_int (GST_FLOW_OK, session_harness_send_rtp (h, buf));
+    }
+  }
+
+  /* drop the first SRs */
+  session_harness_produce_rtcp (h, 2);
+  for (i = 0; i < 2; i++)
+    gst_buffer_unref (session_harness_pull_rtcp (h));
+
+  /* a remote sender losing packet 5 */
+  for (j = 0; j < 10; j++) {
+    if (j == 5)
+      continue;
+    buf = generate_test_buffer (j, 20000);
+    fail_unless_equals_int (GST_FLOW_OK, session_harness_recv_rtp (h, buf));
+  }
+
+  session_harness_produce_rtcp (h, 2);
+  for (i = 0; i < 2; i++) {
+    buf = session_harness_pull_rtcp (h);
+    fail_unless (gst_rtcp_buffer_validate (buf));
+
+    gst_rtcp_buffer_map (buf, GST_MAP_READ, &rtcp);
+    fail_unless (gst_rtcp_buffer_get_first_packet (&rtcp, &rtcp_packet));
+    fail_unless_equals_int (GST_RTCP_TYPE_SR,
+        gst_rtcp_packet_get_type (&rtcp_packet));
+    fail_unless_equals_int (1, gst_rtcp_packet_get_rb_count (&rtcp_packet));
+    gst_rtcp_packet_get_rb (&rtcp_packet, 0, &ssrc, &fractionlost[i],
+        &last_packetslost, &last_exthighestseq, NULL, NULL, NULL);
+    fail_unless_equals_int (20000, ssrc);
+
+    gst_rtcp_buffer_unmap (&rtcp);
+    gst_buffer_unref (buf);
+  }
+
+  fail_unless (fractionlost[0] > 0);
+  fail_unless_equals_int (fractionlost[0], fractionlost[1]);
+
+  /* nothing was received since, the report block is sent again without any
+   * loss in the interval */
+  session_harness_produce_rtcp (h, 2);
+  for (i = 0; i < 2; i++) {
+    buf = session_harness_pull_rtcp (h);
+    fail_unless (gst_rtcp_buffer_validate (buf));
+
+    gst_rtcp_buffer_map (buf, GST_MAP_READ, &rtcp);
+    fail_unless (gst_rtcp_buffer_get_first_packet (&rtcp, &rtcp_packet));
+    fail_unless_equals_int (1, gst_rtcp_packet_get_rb_count (&rtcp_packet));
+    gst_rtcp_packet_get_rb (&rtcp_packet, 0, &ssrc, &fractionlost[i],
+        &packetslost, &exthighestseq, NULL, NULL, NULL);
+    fail_unless_equals_int (20000, ssrc);
+    fail_unless_equals_int (0, fractionlost[i]);
+    fail_unless_equals_int (last_packetslost, packetslost);
+    fail_unless_equals_int (last_exthighestseq, exthighestseq);
+
+    gst_rtcp_buffer_unmap (&rtcp);
+    gst_buffer_unref (buf);
+  }
+
+  g_object_get (h->internal_session, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "rtcp-generation-count",
+          &generation_count));
+  fail_unless (generation_count >= 2);
+  fail_unless (gst_structure_has_field_typed (stats, "rtcp-generation-time",
+          G_TYPE_UINT64));
+  fail_unless (gst_structure_has_field_typed (stats,
+          "rtcp-generation-time-max", G_TYPE_UINT64));
+  gst_structure_free (stats);
+
+  session_harness_free (h);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_internal_sources_timeout)
 {
   SessionHarness *h = session_harness_new ();
@@ -2560,6 +2656,65 @@ GST_START_TEST (test_clear_pt_map_stress)
 
 GST_END_TEST;
 
+static gpointer
+_crank_rtcp_timeouts (gpointer user_data)
+{
+  SessionHarness *h = user_data;
+
+  while (h->running) {
+    session_harness_crank_clock (h);
+    gst_test_clock_wait_for_next_pending_id (h->testclock, NULL);
+  }
+
+  return NULL;
+}
+
+#define MANY_SOURCES 1000
+#define MANY_SOURCES_ROUNDS 20
+
+GST_START_TEST (test_many_sources_rtcp_does_not_block_receive)
+{
+  SessionHarness *h = session_harness_new ();
+  GThread *thread;
+  gint64 start, elapsed, max_elapsed = 0, total_elapsed = 0;
+  guint i, j;
+
+  g_object_set (h->internal_session, "internal-ssrc", 0xDEADBEEF, NULL);
+
+  for (i = 0; i < MANY_SOURCES; i++) {
+    fail_unless_equals_int (GST_FLOW_OK,
+        session_harness_recv_rtp (h, generate_test_buffer (0, 10000 + i)));
+  }
+
+  /* fire RTCP timeouts for all the sources while receiving */
+  h->running = TRUE;
+  thread = g_thread_new (NULL, _crank_rtcp_timeouts, h);
+
+  for (j = 1; j < MANY_SOURCES_ROUNDS; j++) {
+    for (i = 0; i < MANY_SOURCES; i++) {
+      GstBuffer *buf = generate_test_buffer (j, 10000 + i);
+
+      start = g_get_monotonic_time ();
+      fail_unless_equals_int (GST_FLOW_OK, session_harness_recv_rtp (h, buf));
+      elapsed = g_get_monotonic_time () - start;
+
+      max_elapsed = MAX (max_elapsed, elapsed);
+      total_elapsed += elapsed;
+    }
+  }
+
+  h->running = FALSE;
+  g_thread_join (thread);
+
+  GST_INFO ("%u sources: receive latency average %.1f us, max %"
+      G_GINT64_FORMAT " us", MANY_SOURCES, (gdouble) total_elapsed /
+      (MANY_SOURCES * (MANY_SOURCES_ROUNDS - 1)), max_elapsed);
+
+  session_harness_free (h);
+}
+
+GST_END_TEST;
+
 static GstBuffer *
 generate_stepped_ts_buffer (guint i, gboolean stepped)
 {
@@ -4014,6 +4169,82 @@ GST_START_TEST (test_twcc_send_and_recv)
 
 GST_END_TEST;
 
+static void
+_notify_target_bitrate (GParamSpec * spec G_GNUC_UNUSED,
+    GObject * object G_GNUC_UNUSED, gpointer data)
+{
+  guint *count = data;
+
+  (*count)++;
+}
+
+GST_START_TEST (test_twcc_bandwidth_estimation_loss)
+{
+  SessionHarness *h_send = session_harness_new ();
+  SessionHarness *h_recv = session_harness_new ();
+  guint frame;
+  const guint num_frames = 4;
+  const guint num_slices = 15;
+  guint target_bitrate;
+  guint notify_count = 0;
+
+  /* enable twcc */
+  session_harness_set_twcc_recv_ext_id (h_recv, TEST_TWCC_EXT_ID);
+  session_harness_set_twcc_send_ext_id (h_send, TEST_TWCC_EXT_ID);
+
+  g_object_set (h_send->session, "bandwidth-estimation", TRUE, NULL);
+  g_object_get (h_send->session, "target-bitrate", &target_bitrate, NULL);
+  fail_unless_equals_int (target_bitrate, 300000);
+  g_signal_connect (h_send->session, "notify::target-bitrate",
+      (GCallback) _notify_target_bitrate, &notify_count);
+
+  for (frame = 0; frame < num_frames; frame++) {
+    GstBuffer *buf;
+    guint slice;
+
+    for (slice = 0; slice < num_slices; slice++) {
+      GstFlowReturn res;
+      guint seq = frame * num_slices + slice;
+      gboolean marker = slice == num_slices - 1;
+
+      /* from payloder to rtpbin */
+      buf = generate_twcc_send_buffer (seq, marker);
+      res = session_harness_send_rtp (h_send, buf);
+      fail_unless_equals_int (GST_FLOW_OK, res);
+      session_harness_advance_and_crank (h_send, TEST_BUF_DURATION);
+
+      /* get the buffer ready for the network */
+      buf = session_harness_pull_send_rtp (h_send);
+
+      /* the network loses every other packet but the marker */
+      if (slice % 2 == 0 && !marker) {
+        gst_buffer_unref (buf);
+        continue;
+      }
+
+      /* buffer arrives at the receiver */
+      res = session_harness_recv_rtp (h_recv, buf);
+      fail_unless_equals_int (GST_FLOW_OK, res);
+    }
+
+    /* receiver sends a TWCC packet to the sender */
+    buf = session_harness_produce_twcc (h_recv);
+
+    /* sender receives the TWCC packet */
+    session_harness_recv_rtcp (h_send, buf);
+  }
+
+  /* close to half of the packets were lost */
+  g_object_get (h_send->session, "target-bitrate", &target_bitrate, NULL);
+  fail_unless (target_bitrate < 300000);
+  fail_unless (notify_count > 0);
+
+  session_harness_free (h_send);
+  session_harness_free (h_recv);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_twcc_multiple_payloads_below_window)
 {
   SessionHarness *h_send = session_harness_new ();
@@ -4287,6 +4518,7 @@ rtpsession_suite (void)
   tcase_add_test (tc_chain, test_multiple_ssrc_rr);
   tcase_add_test (tc_chain, test_multiple_senders_roundrobin_rbs);
   tcase_add_test (tc_chain, test_no_rbs_for_internal_senders);
+  tcase_add_test (tc_chain, test_internal_senders_share_report_blocks);
   tcase_add_test (tc_chain, test_internal_sources_timeout);
   tcase_add_test (tc_chain, test_receive_rtcp_app_packet);
   tcase_add_test (tc_chain, test_dont_lock_on_stats);
@@ -4318,6 +4550,7 @@ rtpsession_suite (void)
   tcase_add_test (tc_chain, test_disable_probation);
   tcase_add_test (tc_chain, test_request_late_nack);
   tcase_add_test (tc_chain, test_clear_pt_map_stress);
+  tcase_add_test (tc_chain, test_many_sources_rtcp_does_not_block_receive);
   tcase_add_test (tc_chain, test_packet_rate);
   tcase_add_test (tc_chain, test_stepped_packet_rate);
 
@@ -4350,6 +4583,7 @@ rtpsession_suite (void)
   tcase_add_test (tc_chain, test_twcc_recv_rtcp_reordered);
   tcase_add_test (tc_chain, test_twcc_no_exthdr_in_buffer);
   tcase_add_test (tc_chain, test_twcc_send_and_recv);
+  tcase_add_test (tc_chain, test_twcc_bandwidth_estimation_loss);
   tcase_add_test (tc_chain, test_twcc_multiple_payloads_below_window);
   tcase_add_loop_test (tc_chain, test_twcc_feedback_interval, 0,
       G_N_ELEMENTS (test_twcc_feedback_interval_ctx));
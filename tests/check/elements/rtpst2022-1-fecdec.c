@@ -22,6 +22,8 @@
 #include <gst/rtp/gstrtpbuffer.h>
 #include <gst/base/base.h>
 
+#include "benchmark.h"
+
 static GstBuffer *
 make_fec_sample (guint16 seq, guint32 ts, guint16 seq_base, gboolean row,
     guint8 offset, guint8 NA, guint32 ts_recovery, guint8 * fec_payload,
@@ -331,10 +333,10 @@ GST_START_TEST (test_2d)
   pull_and_check (h, 6, 0, &payload, 1, 5);
   payload = 0x3a;
   pull_and_check (h, 5, 0, &payload, 1, 4);
-  payload = 0x21;
-  pull_and_check (h, 8, 0, &payload, 1, 3);
   payload = 0x5f;
-  pull_and_check (h, 7, 0, &payload, 1, 2);
+  pull_and_check (h, 7, 0, &payload, 1, 3);
+  payload = 0x21;
+  pull_and_check (h, 8, 0, &payload, 1, 2);
   payload = 0xfc;
   pull_and_check (h, 2, 0, &payload, 1, 1);
 
@@ -424,6 +426,283 @@ GST_START_TEST (test_variable_length)
 
 GST_END_TEST;
 
+#define BENCH_PAYLOAD_LEN 1316
+#define BENCH_N_PACKETS 20000
+/* 1316 bytes payloads at 1 Gbit/s */
+#define BENCH_PACKET_DURATION (10 * GST_USECOND)
+
+typedef struct
+{
+  GstBuffer *buffer;
+  /* 0: media, 1: column FEC, 2: row FEC */
+  guint stream;
+} BenchItem;
+
+static void
+collect_fec (GstHarness * h, guint stream, GstClockTime dts, GArray * items)
+{
+  while (gst_harness_buffers_in_queue (h)) {
+    BenchItem item = { gst_harness_pull (h), stream };
+
+    GST_BUFFER_DTS (item.buffer) = dts;
+    g_array_append_val (items, item);
+  }
+}
+
+static void
+encode_stream (guint rows, guint columns, guint n_packets, GArray * items)
+{
+  GstHarness *h_enc, *h_enc_fec_0, *h_enc_fec_1;
+  guint8 payload[BENCH_PAYLOAD_LEN];
+  guint i;
+  GstElement *enc = gst_element_factory_make ("rtpst2022-1-fecenc", NULL);
+
+  g_object_set (enc, "columns", columns, "rows", rows, NULL);
+  h_enc = gst_harness_new_with_element (enc, "sink", "src");
+  h_enc_fec_0 = gst_harness_new_with_element (h_enc->element, NULL, "fec_0");
+  h_enc_fec_1 = gst_harness_new_with_element (h_enc->element, NULL, "fec_1");
+  gst_harness_set_src_caps_str (h_enc, "application/x-rtp");
+
+  for (i = 0; i < n_packets; i++) {
+    GstClockTime dts = i * BENCH_PACKET_DURATION;
+    GstBuffer *buffer;
+
+    memset (payload, i, BENCH_PAYLOAD_LEN);
+    buffer = make_media_sample (i, i * 90, payload, BENCH_PAYLOAD_LEN);
+    GST_BUFFER_DTS (buffer) = dts;
+    gst_harness_push (h_enc, buffer);
+
+    collect_fec (h_enc, 0, dts, items);
+    collect_fec (h_enc_fec_0, 1, dts, items);
+    collect_fec (h_enc_fec_1, 2, dts, items);
+  }
+
+  gst_object_unref (enc);
+  gst_harness_teardown (h_enc);
+  gst_harness_teardown (h_enc_fec_0);
+  gst_harness_teardown (h_enc_fec_1);
+}
+
+static guint16
+get_seq (GstBuffer * buffer)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint16 seq;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp));
+  seq = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return seq;
+}
+
+/* encode a stream, then time the decoding of it with a packet lost in each
+ * row */
+static void
+run_recovery_benchmark (guint rows, guint columns)
+{
+  GstHarness *h, *h_media, *h_fec_0, *h_fec_1;
+  GArray *items = g_array_new (FALSE, FALSE, sizeof (BenchItem));
+  gint64 start, elapsed;
+  guint i, n_lost = 0, n_received;
+
+  encode_stream (rows, columns, BENCH_N_PACKETS, items);
+
+  h = gst_harness_new_with_padnames ("rtpst2022-1-fecdec", NULL, "src");
+  h_media = gst_harness_new_with_element (h->element, "sink", NULL);
+  h_fec_0 = gst_harness_new_with_element (h->element, "fec_0", NULL);
+  h_fec_1 = gst_harness_new_with_element (h->element, "fec_1", NULL);
+  gst_harness_set_src_caps_str (h_media, "application/x-rtp");
+  gst_harness_set_src_caps_str (h_fec_0, "application/x-rtp");
+  gst_harness_set_src_caps_str (h_fec_1, "application/x-rtp");
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < items->len; i++) {
+    BenchItem *item = &g_array_index (items, BenchItem, i);
+
+    switch (item->stream) {
+      case 0:{
+        guint16 seq = get_seq (item->buffer);
+
+        /* lose a different packet in each row */
+        if (seq % columns == (seq / columns) % columns) {
+          gst_buffer_unref (item->buffer);
+          n_lost++;
+        } else {
+          gst_harness_push (h_media, item->buffer);
+        }
+        break;
+      }
+      case 1:
+        gst_harness_push (h_fec_0, item->buffer);
+        break;
+      default:
+        gst_harness_push (h_fec_1, item->buffer);
+        break;
+    }
+  }
+  elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+  n_received = gst_harness_buffers_in_queue (h);
+  fail_unless (n_received > BENCH_N_PACKETS - n_lost);
+
+  GST_INFO ("%ux%u: decoded %u packets, recovered %u of %u lost in %"
+      G_GINT64_FORMAT " us, %.2f Gbit/s", columns, rows, BENCH_N_PACKETS,
+      n_received - (BENCH_N_PACKETS - n_lost), n_lost, elapsed,
+      (gdouble) BENCH_N_PACKETS * BENCH_PAYLOAD_LEN * 8 / (elapsed * 1000));
+
+  g_array_unref (items);
+  gst_harness_teardown (h);
+  gst_harness_teardown (h_media);
+  gst_harness_teardown (h_fec_0);
+  gst_harness_teardown (h_fec_1);
+}
+
+GST_START_TEST (test_recovery_benchmark)
+{
+  run_recovery_benchmark (4, 4);
+  run_recovery_benchmark (5, 10);
+  run_recovery_benchmark (10, 10);
+  run_recovery_benchmark (20, 5);
+}
+
+GST_END_TEST;
+
+#define BURST_N_MATRICES 30
+
+/* encode a stream, then lose @burst packets per matrix, starting at the
+ * beginning of a different row each time, and check that all of them get
+ * recovered. The latency added by the recovery is measured as the time
+ * between the original position of a lost packet in the stream and the
+ * arrival of the packet that allowed recovering it */
+static void
+run_burst_loss (guint rows, guint columns, guint burst, guint n_threads,
+    GstClockTime latency_budget)
+{
+  GstHarness *h, *h_media, *h_fec_0, *h_fec_1;
+  GArray *items = g_array_new (FALSE, FALSE, sizeof (BenchItem));
+  guint n_packets = BURST_N_MATRICES * rows * columns;
+  gboolean *lost = g_new0 (gboolean, n_packets);
+  gboolean *received = g_new0 (gboolean, n_packets);
+  GstClockTime latency, total_latency = 0, max_latency = 0;
+  guint i, n_lost = 0, n_recovered = 0;
+
+  fail_unless (rows > 1 && burst <= columns + 1);
+
+  /* The column FEC packets of the last matrices aren't sent out yet */
+  for (i = 0; i < BURST_N_MATRICES - 2; i++) {
+    guint first = (i * rows + i % (rows - 1)) * columns;
+    guint j;
+
+    for (j = first; j < first + burst; j++) {
+      lost[j] = TRUE;
+      n_lost++;
+    }
+  }
+
+  encode_stream (rows, columns, n_packets, items);
+
+  h = gst_harness_new_with_padnames ("rtpst2022-1-fecdec", NULL, "src");
+  g_object_set (h->element, "recovery-threads", n_threads, "latency-budget",
+      latency_budget, NULL);
+  h_media = gst_harness_new_with_element (h->element, "sink", NULL);
+  h_fec_0 = gst_harness_new_with_element (h->element, "fec_0", NULL);
+  h_fec_1 = gst_harness_new_with_element (h->element, "fec_1", NULL);
+  gst_harness_set_src_caps_str (h_media, "application/x-rtp");
+  gst_harness_set_src_caps_str (h_fec_0, "application/x-rtp");
+  gst_harness_set_src_caps_str (h_fec_1, "application/x-rtp");
+
+  for (i = 0; i < items->len; i++) {
+    BenchItem *item = &g_array_index (items, BenchItem, i);
+    GstClockTime now = GST_BUFFER_DTS (item->buffer);
+
+    switch (item->stream) {
+      case 0:
+        if (lost[get_seq (item->buffer)])
+          gst_buffer_unref (item->buffer);
+        else
+          gst_harness_push (h_media, item->buffer);
+        break;
+      case 1:
+        gst_harness_push (h_fec_0, item->buffer);
+        break;
+      default:
+        gst_harness_push (h_fec_1, item->buffer);
+        break;
+    }
+
+    while (gst_harness_buffers_in_queue (h)) {
+      GstBuffer *buffer = gst_harness_pull (h);
+      guint16 seq = get_seq (buffer);
+
+      fail_unless (seq < n_packets);
+      fail_if (received[seq], "packet %u received twice", seq);
+      received[seq] = TRUE;
+
+      if (lost[seq]) {
+        n_recovered++;
+        latency = now - seq * BENCH_PACKET_DURATION;
+        total_latency += latency;
+        max_latency = MAX (max_latency, latency);
+      }
+
+      gst_buffer_unref (buffer);
+    }
+  }
+
+  GST_INFO ("%ux%u, bursts of %u, %u threads, budget %" GST_TIME_FORMAT
+      ": recovered %u of %u lost packets, added latency avg %"
+      GST_TIME_FORMAT " max %" GST_TIME_FORMAT, columns, rows, burst,
+      n_threads, GST_TIME_ARGS (latency_budget), n_recovered, n_lost,
+      GST_TIME_ARGS (n_recovered ? total_latency / n_recovered : 0),
+      GST_TIME_ARGS (max_latency));
+
+  fail_unless_equals_int (n_recovered, n_lost);
+
+  g_free (lost);
+  g_free (received);
+  g_array_unref (items);
+  gst_harness_teardown (h);
+  gst_harness_teardown (h_media);
+  gst_harness_teardown (h_fec_0);
+  gst_harness_teardown (h_fec_1);
+}
+
+/* A lost row is recovered through column FEC alone */
+GST_START_TEST (test_burst_loss_row)
+{
+  run_burst_loss (10, 10, 10, 1, 0);
+  run_burst_loss (5, 20, 20, 1, 0);
+}
+
+GST_END_TEST;
+
+/* A lost row and the first packet of the next one: that packet is recovered
+ * through row FEC first, which in turn makes the first column recoverable */
+GST_START_TEST (test_burst_loss_2d)
+{
+  run_burst_loss (10, 10, 11, 1, 0);
+  run_burst_loss (4, 4, 5, 1, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_burst_loss_threads)
+{
+  run_burst_loss (10, 10, 11, 4, 0);
+  run_burst_loss (5, 20, 21, 0, 0);
+}
+
+GST_END_TEST;
+
+/* Work deferred because of the budget is picked up by the next packets */
+GST_START_TEST (test_burst_loss_latency_budget)
+{
+  run_burst_loss (10, 10, 11, 1, 1);
+  run_burst_loss (10, 10, 11, 4, GST_MSECOND);
+}
+
+GST_END_TEST;
 
 static Suite *
 st2022_1_dec_suite (void)
@@ -437,6 +716,12 @@ st2022_1_dec_suite (void)
   tcase_add_test (tc_chain, test_column);
   tcase_add_test (tc_chain, test_2d);
   tcase_add_test (tc_chain, test_variable_length);
+  tcase_add_test (tc_chain, test_burst_loss_row);
+  tcase_add_test (tc_chain, test_burst_loss_2d);
+  tcase_add_test (tc_chain, test_burst_loss_threads);
+  tcase_add_test (tc_chain, test_burst_loss_latency_budget);
+
+  tcase_add_benchmark (s, test_recovery_benchmark);
 
   return s;
 }
@@ -22,6 +22,8 @@
 #include <gst/rtp/gstrtpbuffer.h>
 #include <gst/base/base.h>
 
+#include "benchmark.h"
+
 typedef struct
 {
   guint16 seq;
@@ -212,6 +214,64 @@ GST_START_TEST (test_columns)
 
 GST_END_TEST;
 
+#define BENCH_PAYLOAD_LEN 1316
+#define BENCH_N_PACKETS 20000
+/* 1316 bytes payloads at 1 Gbit/s */
+#define BENCH_PACKET_DURATION (10 * GST_USECOND)
+
+static void
+run_encode_benchmark (guint rows, guint columns)
+{
+  GstHarness *h, *h_fec_0, *h_fec_1;
+  GstBuffer **buffers = g_new (GstBuffer *, BENCH_N_PACKETS);
+  guint8 payload[BENCH_PAYLOAD_LEN];
+  gint64 start, elapsed;
+  guint i;
+  GstElement *enc = gst_element_factory_make ("rtpst2022-1-fecenc", NULL);
+
+  g_object_set (enc, "columns", columns, "rows", rows, NULL);
+  h = gst_harness_new_with_element (enc, "sink", "src");
+  h_fec_0 = gst_harness_new_with_element (h->element, NULL, "fec_0");
+  h_fec_1 = gst_harness_new_with_element (h->element, NULL, "fec_1");
+
+  gst_harness_set_src_caps_str (h, "application/x-rtp");
+
+  for (i = 0; i < BENCH_N_PACKETS; i++) {
+    memset (payload, i, BENCH_PAYLOAD_LEN);
+    buffers[i] = make_media_sample (i, i * 90, payload, BENCH_PAYLOAD_LEN);
+    GST_BUFFER_DTS (buffers[i]) = i * BENCH_PACKET_DURATION;
+  }
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < BENCH_N_PACKETS; i++)
+    gst_harness_push (h, buffers[i]);
+  elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), BENCH_N_PACKETS);
+  fail_unless (gst_harness_buffers_in_queue (h_fec_1) > 0);
+  fail_unless (gst_harness_buffers_in_queue (h_fec_0) > 0);
+
+  GST_INFO ("%ux%u: encoded %u packets in %" G_GINT64_FORMAT " us, "
+      "%.2f Gbit/s", columns, rows, BENCH_N_PACKETS, elapsed,
+      (gdouble) BENCH_N_PACKETS * BENCH_PAYLOAD_LEN * 8 / (elapsed * 1000));
+
+  g_free (buffers);
+  gst_object_unref (enc);
+  gst_harness_teardown (h);
+  gst_harness_teardown (h_fec_0);
+  gst_harness_teardown (h_fec_1);
+}
+
+GST_START_TEST (test_encode_benchmark)
+{
+  run_encode_benchmark (4, 4);
+  run_encode_benchmark (5, 10);
+  run_encode_benchmark (10, 10);
+  run_encode_benchmark (20, 5);
+}
+
+GST_END_TEST;
+
 static Suite *
 st2022_1_dec_suite (void)
 {
@@ -223,6 +283,8 @@ st2022_1_dec_suite (void)
   tcase_add_test (tc_chain, test_row);
   tcase_add_test (tc_chain, test_columns);
 
+  tcase_add_benchmark (s, test_encode_benchmark);
+
   return s;
 }
 
@@ -20,6 +20,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
 #include "gst/rtpmanager/rtptimerqueue.h"
 
 GST_START_TEST (test_timer_queue_set_timer)
@@ -305,6 +306,158 @@ GST_START_TEST (test_timer_queue_timer_offset)
 
 GST_END_TEST;
 
+static void
+check_timer_queue_order (RtpTimerQueue * queue)
+{
+  RtpTimer *timer, *next;
+  guint length = 0;
+
+  for (timer = rtp_timer_queue_peek_earliest (queue); timer; timer = next) {
+    next = rtp_timer_get_next (timer);
+    length++;
+
+    fail_unless (rtp_timer_queue_find (queue, timer->seqnum) == timer);
+
+    if (next == NULL)
+      continue;
+
+    /* timers without timeout come first */
+    if (GST_CLOCK_TIME_IS_VALID (timer->timeout))
+      fail_unless (GST_CLOCK_TIME_IS_VALID (next->timeout));
+    else if (GST_CLOCK_TIME_IS_VALID (next->timeout))
+      continue;
+
+    fail_unless (next->timeout >= timer->timeout);
+    if (next->timeout == timer->timeout)
+      fail_unless (gst_rtp_buffer_compare_seqnum (timer->seqnum,
+              next->seqnum) > 0);
+  }
+
+  fail_unless_equals_int (length, rtp_timer_queue_length (queue));
+}
+
+#define STRESS_PACKETS 200000
+#define STRESS_SPACING (2 * GST_MSECOND)
+#define STRESS_LATENCY (200 * GST_MSECOND)
+#define STRESS_RTX_RETRY (40 * GST_MSECOND)
+
+/* Simulates the timers of a jitterbuffer receiving a stream with @loss
+ * percent of packet loss: expected timers for the next packet, rtx retries
+ * rescheduling lost packet timers and lost timers popped once expired. */
+static void
+run_timer_queue_stress (guint loss)
+{
+  RtpTimerQueue *queue = rtp_timer_queue_new ();
+  GRand *rand = g_rand_new_with_seed (loss);
+  RtpTimer *timer;
+  guint64 ops = 0;
+  gint64 start, elapsed;
+  guint i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < STRESS_PACKETS; i++) {
+    GstClockTime now = i * STRESS_SPACING;
+    guint16 seqnum = i;
+
+    if (g_rand_int_range (rand, 0, 100) < loss) {
+      /* lost, wait for a retransmission and give up after the latency */
+      rtp_timer_queue_set_expected (queue, seqnum, now, STRESS_RTX_RETRY,
+          STRESS_SPACING);
+      ops++;
+    } else {
+      /* received, the next one is expected soon after */
+      if ((timer = rtp_timer_queue_find (queue, seqnum))) {
+        rtp_timer_queue_unschedule (queue, timer);
+        rtp_timer_free (timer);
+        ops++;
+      }
+      rtp_timer_queue_set_expected (queue, seqnum + 1, now,
+          STRESS_SPACING / 2, STRESS_SPACING);
+      ops++;
+    }
+
+    while ((timer = rtp_timer_queue_pop_until (queue, now))) {
+      ops++;
+
+      if (timer->type == RTP_TIMER_EXPECTED && timer->num_rtx_retry < 3 &&
+          timer->timeout - timer->rtx_base < STRESS_LATENCY) {
+        /* request again later */
+        timer->num_rtx_retry++;
+        rtp_timer_queue_update_timer (queue, timer, timer->seqnum,
+            now, STRESS_RTX_RETRY * timer->num_rtx_retry, 0, FALSE);
+      } else if (timer->type == RTP_TIMER_EXPECTED) {
+        timer->type = RTP_TIMER_LOST;
+        rtp_timer_queue_update_timer (queue, timer, timer->seqnum,
+            timer->rtx_base, STRESS_LATENCY, 0, FALSE);
+      } else {
+        rtp_timer_free (timer);
+        continue;
+      }
+      ops++;
+    }
+  }
+  elapsed = g_get_monotonic_time () - start;
+
+  check_timer_queue_order (queue);
+
+  GST_INFO ("%u%% loss: %" G_GUINT64_FORMAT " timer operations in %"
+      G_GINT64_FORMAT " us, %.0f operations per second, %u timers left",
+      loss, ops, elapsed, ops * (gdouble) G_USEC_PER_SEC / MAX (elapsed, 1),
+      rtp_timer_queue_length (queue));
+
+  g_rand_free (rand);
+  g_object_unref (queue);
+}
+
+GST_START_TEST (test_timer_queue_stress)
+{
+  run_timer_queue_stress (0);
+  run_timer_queue_stress (5);
+  run_timer_queue_stress (30);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_timer_queue_random_order)
+{
+  RtpTimerQueue *queue = rtp_timer_queue_new ();
+  GRand *rand = g_rand_new_with_seed (0);
+  guint i;
+
+  /* timers spread over several turns of the timer wheel, with equal
+   * timeouts and invalid timeouts */
+  for (i = 0; i < 20000; i++) {
+    guint16 seqnum = g_rand_int_range (rand, 0, 2000);
+    GstClockTime timeout;
+
+    if (g_rand_int_range (rand, 0, 50) == 0)
+      timeout = GST_CLOCK_TIME_NONE;
+    else
+      timeout = g_rand_int_range (rand, 0, 5000) * GST_MSECOND / 2;
+
+    if (g_rand_boolean (rand)) {
+      rtp_timer_queue_set_lost (queue, seqnum, timeout, 0, 0);
+    } else {
+      RtpTimer *timer = rtp_timer_queue_find (queue, seqnum);
+
+      if (timer) {
+        rtp_timer_queue_unschedule (queue, timer);
+        rtp_timer_free (timer);
+      }
+    }
+
+    if (i % 1000 == 0)
+      check_timer_queue_order (queue);
+  }
+
+  check_timer_queue_order (queue);
+
+  g_rand_free (rand);
+  g_object_unref (queue);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtptimerqueue_suite (void)
 {
@@ -319,6 +472,8 @@ rtptimerqueue_suite (void)
   tcase_add_test (tc_chain, test_timer_queue_update_timer_seqnum);
   tcase_add_test (tc_chain, test_timer_queue_dup_timer);
   tcase_add_test (tc_chain, test_timer_queue_timer_offset);
+  tcase_add_test (tc_chain, test_timer_queue_random_order);
+  tcase_add_test (tc_chain, test_timer_queue_stress);
 
   return s;
 }
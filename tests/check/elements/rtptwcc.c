@@ -0,0 +1,354 @@
+/* GStreamer
+ *
+ * Unit tests and benchmarks for the transport-wide congestion control
+ * manager
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include "gst/rtpmanager/rtptwcc.h"
+#include "benchmark.h"
+
+/* rtptwcc logs in the category of the session */
+GST_DEBUG_CATEGORY (rtp_session_debug);
+
+#define TWCC_EXTMAP_STR "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01"
+#define TWCC_EXT_ID 5
+
+static RTPTWCCManager *
+create_manager (gboolean send)
+{
+  RTPTWCCManager *twcc = rtp_twcc_manager_new (1400);
+  GstStructure *s = gst_structure_new ("application/x-rtp",
+      "extmap-5", G_TYPE_STRING, TWCC_EXTMAP_STR, NULL);
+
+  if (send)
+    rtp_twcc_manager_parse_send_ext_id (twcc, s);
+  else
+    rtp_twcc_manager_parse_recv_ext_id (twcc, s);
+  gst_structure_free (s);
+
+  return twcc;
+}
+
+/* the one-byte header extension data of a packet with a twcc-seqnum */
+static GBytes *
+create_header_ext (guint16 seqnum)
+{
+  guint8 data[4] = { (TWCC_EXT_ID << 4) | 1, seqnum >> 8, seqnum & 0xff, 0 };
+
+  return g_bytes_new (data, sizeof (data));
+}
+
+static gboolean
+recv_packet (RTPTWCCManager * twcc, GBytes * header_ext,
+    GstClockTime arrival_time, gboolean marker)
+{
+  RTPPacketInfo pinfo = { 0, };
+
+  pinfo.arrival_time = arrival_time;
+  pinfo.current_time = arrival_time;
+  pinfo.running_time = arrival_time;
+  pinfo.marker = marker;
+  pinfo.ssrc = 0x12345678;
+  pinfo.header_ext = header_ext;
+  pinfo.header_ext_bit_pattern = 0xBEDE;
+
+  return rtp_twcc_manager_recv_packet (twcc, &pinfo);
+}
+
+static gboolean
+recv_seqnum (RTPTWCCManager * twcc, guint16 seqnum,
+    GstClockTime arrival_time, gboolean marker)
+{
+  GBytes *header_ext = create_header_ext (seqnum);
+  gboolean ret = recv_packet (twcc, header_ext, arrival_time, marker);
+
+  g_bytes_unref (header_ext);
+
+  return ret;
+}
+
+static GArray *
+parse_feedback (RTPTWCCManager * twcc, GstBuffer * buf)
+{
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  GArray *twcc_packets;
+
+  gst_rtcp_buffer_map (buf, GST_MAP_READ, &rtcp);
+  fail_unless (gst_rtcp_buffer_get_first_packet (&rtcp, &packet));
+  twcc_packets = rtp_twcc_manager_parse_fci (twcc,
+      gst_rtcp_packet_fb_get_fci (&packet),
+      gst_rtcp_packet_fb_get_fci_length (&packet) * sizeof (guint32));
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  return twcc_packets;
+}
+
+static void
+check_same_fci (GstBuffer * buf0, GstBuffer * buf1)
+{
+  GstRTCPBuffer rtcp0 = GST_RTCP_BUFFER_INIT;
+  GstRTCPBuffer rtcp1 = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet0, packet1;
+  guint length;
+
+  gst_rtcp_buffer_map (buf0, GST_MAP_READ, &rtcp0);
+  gst_rtcp_buffer_map (buf1, GST_MAP_READ, &rtcp1);
+  fail_unless (gst_rtcp_buffer_get_first_packet (&rtcp0, &packet0));
+  fail_unless (gst_rtcp_buffer_get_first_packet (&rtcp1, &packet1));
+
+  length = gst_rtcp_packet_fb_get_fci_length (&packet0);
+  fail_unless_equals_int (gst_rtcp_packet_fb_get_fci_length (&packet1),
+      length);
+  fail_unless_equals_int (memcmp (gst_rtcp_packet_fb_get_fci (&packet0),
+          gst_rtcp_packet_fb_get_fci (&packet1), length * 4), 0);
+
+  gst_rtcp_buffer_unmap (&rtcp0);
+  gst_rtcp_buffer_unmap (&rtcp1);
+}
+
+GST_START_TEST (test_twcc_reordered_same_feedback)
+{
+  RTPTWCCManager *in_order = create_manager (FALSE);
+  RTPTWCCManager *reordered = create_manager (FALSE);
+  const guint16 seqnums[] = { 1, 4, 2, 3, 0, 6, 5, 7 };
+  GstBuffer *buf0, *buf1;
+  guint i;
+
+  /* a reordered packet is placed where it belongs, the feedback is the
+   * same as for packets arriving in order */
+  for (i = 0; i < 8; i++) {
+    fail_if (recv_seqnum (in_order, i, (10 + i) * GST_MSECOND, FALSE));
+    fail_if (recv_seqnum (reordered, seqnums[i],
+            (10 + seqnums[i]) * GST_MSECOND, FALSE));
+  }
+
+  /* duplicates are dropped wherever they are */
+  fail_if (recv_seqnum (reordered, 2, 50 * GST_MSECOND, FALSE));
+  fail_if (recv_seqnum (reordered, 7, 50 * GST_MSECOND, FALSE));
+
+  fail_unless (recv_seqnum (in_order, 8, 18 * GST_MSECOND, TRUE));
+  fail_unless (recv_seqnum (reordered, 8, 18 * GST_MSECOND, TRUE));
+
+  buf0 = rtp_twcc_manager_get_feedback (in_order, 0);
+  buf1 = rtp_twcc_manager_get_feedback (reordered, 0);
+  fail_unless (buf0 != NULL);
+  fail_unless (buf1 != NULL);
+  check_same_fci (buf0, buf1);
+
+  gst_buffer_unref (buf0);
+  gst_buffer_unref (buf1);
+  g_object_unref (in_order);
+  g_object_unref (reordered);
+}
+
+GST_END_TEST;
+
+#define SENT_PACKETS 3000
+
+GST_START_TEST (test_twcc_sent_packets_ring)
+{
+  RTPTWCCManager *sender = create_manager (TRUE);
+  RTPTWCCManager *receiver = create_manager (FALSE);
+  GQueue feedback = G_QUEUE_INIT;
+  GstBuffer *buf;
+  guint i, n_packets = 0;
+
+  /* all packets are sent before any feedback comes back, so the ring of
+   * sent packets has to grow */
+  for (i = 0; i < SENT_PACKETS; i++) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    RTPPacketInfo pinfo = { 0, };
+    guint8 data[2] = { 0, };
+    GBytes *header_ext;
+    guint16 bit_pattern;
+
+    buf = gst_rtp_buffer_new_allocate (100, 0, 0);
+    gst_rtp_buffer_map (buf, GST_MAP_READWRITE, &rtp);
+    gst_rtp_buffer_add_extension_onebyte_header (&rtp, TWCC_EXT_ID, data, 2);
+    gst_rtp_buffer_unmap (&rtp);
+
+    pinfo.data = buf;
+    pinfo.current_time = i * GST_MSECOND;
+    pinfo.payload_len = 100 + i;
+    pinfo.pt = 96;
+    rtp_twcc_manager_send_packet (sender, &pinfo);
+    buf = pinfo.data;
+
+    gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp);
+    header_ext = gst_rtp_buffer_get_extension_bytes (&rtp, &bit_pattern);
+    gst_rtp_buffer_unmap (&rtp);
+
+    /* lose every 10th packet, the marker is on the one before */
+    if (i % 10 != 9) {
+      if (recv_packet (receiver, header_ext, (i + 20) * GST_MSECOND,
+              i % 50 == 48)) {
+        while ((buf = rtp_twcc_manager_get_feedback (receiver, 0)))
+          g_queue_push_tail (&feedback, buf);
+      }
+    }
+
+    g_bytes_unref (header_ext);
+    gst_buffer_unref (pinfo.data);
+  }
+
+  fail_unless (feedback.length > 0);
+
+  while ((buf = g_queue_pop_head (&feedback))) {
+    GArray *twcc_packets = parse_feedback (sender, buf);
+
+    fail_unless (twcc_packets != NULL);
+    for (i = 0; i < twcc_packets->len; i++) {
+      RTPTWCCPacket *pkt = &g_array_index (twcc_packets, RTPTWCCPacket, i);
+
+      fail_unless_equals_uint64 (pkt->local_ts, pkt->seqnum * GST_MSECOND);
+      fail_unless_equals_int (pkt->size, 100 + pkt->seqnum);
+      fail_unless_equals_int (pkt->pt, 96);
+      if (pkt->seqnum % 10 == 9) {
+        fail_unless_equals_int (pkt->status, RTP_TWCC_PACKET_STATUS_NOT_RECV);
+      } else {
+        fail_unless (GST_CLOCK_TIME_IS_VALID (pkt->remote_ts));
+        n_packets++;
+      }
+    }
+
+    g_array_unref (twcc_packets);
+    gst_buffer_unref (buf);
+  }
+
+  /* only the packets after the last marker were not reported */
+  fail_unless_equals_int (n_packets, SENT_PACKETS * 9 / 10);
+
+  g_object_unref (sender);
+  g_object_unref (receiver);
+}
+
+GST_END_TEST;
+
+typedef enum
+{
+  ARRIVAL_IN_ORDER,
+  ARRIVAL_LOSSY,
+  ARRIVAL_REORDERED,
+  ARRIVAL_BURSTY,
+} ArrivalPattern;
+
+static const gchar *pattern_names[] = {
+  "in order", "lossy", "reordered", "bursty"
+};
+
+#define BENCH_PACKETS 200000
+/* a frame every 20 packets */
+#define BENCH_FRAME_PACKETS 20
+
+static void
+run_benchmark (ArrivalPattern pattern)
+{
+  RTPTWCCManager *twcc = create_manager (FALSE);
+  GRand *rand = g_rand_new_with_seed (42);
+  GBytes **header_exts;
+  GstClockTime *arrival_times;
+  guint i, n_packets = 0, n_feedback = 0;
+  gint64 start, elapsed;
+  GstBuffer *buf;
+
+  header_exts = g_new (GBytes *, BENCH_PACKETS);
+  arrival_times = g_new (GstClockTime, BENCH_PACKETS);
+
+  for (i = 0; i < BENCH_PACKETS; i++) {
+    guint16 seqnum = i;
+    GstClockTime arrival_time = i * 100 * GST_USECOND;
+
+    /* drop 5% of the packets */
+    if (pattern == ARRIVAL_LOSSY && g_rand_int_range (rand, 0, 100) < 5)
+      continue;
+
+    /* packets arriving in bursts need large deltas now and then */
+    if (pattern == ARRIVAL_BURSTY)
+      arrival_time = (i / 10) * 100 * 10 * GST_USECOND +
+          g_rand_int_range (rand, 0, 5) * GST_MSECOND;
+
+    header_exts[n_packets] = create_header_ext (seqnum);
+    arrival_times[n_packets] = arrival_time;
+    n_packets++;
+  }
+
+  /* swap packets with the next one within a frame */
+  if (pattern == ARRIVAL_REORDERED) {
+    for (i = 0; i + 1 < n_packets; i += BENCH_FRAME_PACKETS / 2) {
+      GBytes *tmp = header_exts[i];
+
+      header_exts[i] = header_exts[i + 1];
+      header_exts[i + 1] = tmp;
+    }
+  }
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_packets; i++) {
+    if (recv_packet (twcc, header_exts[i], arrival_times[i],
+            i % BENCH_FRAME_PACKETS == BENCH_FRAME_PACKETS - 1)) {
+      while ((buf = rtp_twcc_manager_get_feedback (twcc, 0))) {
+        gst_buffer_unref (buf);
+        n_feedback++;
+      }
+    }
+  }
+  elapsed = g_get_monotonic_time () - start;
+
+  GST_INFO ("%s: %u packets, %u feedback packets in %" G_GINT64_FORMAT
+      " us, %.1f ns per packet, %.2f us per feedback", pattern_names[pattern],
+      n_packets, n_feedback, elapsed, (gdouble) elapsed * 1000 / n_packets,
+      (gdouble) elapsed / MAX (n_feedback, 1));
+
+  for (i = 0; i < n_packets; i++)
+    g_bytes_unref (header_exts[i]);
+  g_free (header_exts);
+  g_free (arrival_times);
+  g_rand_free (rand);
+  g_object_unref (twcc);
+}
+
+GST_START_TEST (test_twcc_benchmark)
+{
+  run_benchmark (ARRIVAL_IN_ORDER);
+  run_benchmark (ARRIVAL_LOSSY);
+  run_benchmark (ARRIVAL_REORDERED);
+  run_benchmark (ARRIVAL_BURSTY);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtptwcc_suite (void)
+{
+  Suite *s = suite_create ("rtptwcc");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (rtp_session_debug, "rtpsession", 0, "RTP Session");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_twcc_reordered_same_feedback);
+  tcase_add_test (tc_chain, test_twcc_sent_packets_ring);
+
+  tcase_add_benchmark (s, test_twcc_benchmark);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtptwcc);
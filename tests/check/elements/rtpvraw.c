@@ -0,0 +1,381 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/check.h>
+#include <gst/check/gstharness.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/video/video.h>
+
+#include "benchmark.h"
+
+static const gchar *formats[] = {
+  "RGB", "RGBA", "BGR", "BGRA", "AYUV", "UYVY", "I420", "Y41B", "UYVP"
+};
+
+static GstBuffer *
+create_frame (GstHarness * h, GstVideoInfo * info, guint n)
+{
+  GstBuffer *buffer = gst_harness_create_buffer (h, info->size);
+  GstMapInfo map;
+  gsize i;
+
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_WRITE));
+  for (i = 0; i < map.size; i++)
+    map.data[i] = (i * 7 + n) & 0xff;
+  gst_buffer_unmap (buffer, &map);
+
+  return buffer;
+}
+
+/* the size of the meaningful part of a line of a plane */
+static guint
+plane_line_size (GstVideoInfo * info, guint plane)
+{
+  if (GST_VIDEO_INFO_FORMAT (info) == GST_VIDEO_FORMAT_UYVP)
+    return GST_ROUND_UP_2 (GST_VIDEO_INFO_WIDTH (info)) / 2 * 5;
+
+  return GST_VIDEO_INFO_COMP_WIDTH (info, plane) *
+      GST_VIDEO_INFO_COMP_PSTRIDE (info, plane);
+}
+
+static void
+check_frames_equal (GstVideoInfo * info, GstBuffer * expected,
+    GstBuffer * buffer)
+{
+  GstVideoFrame in, out;
+  guint plane, line, i;
+
+  fail_unless (gst_video_frame_map (&in, info, expected, GST_MAP_READ));
+  fail_unless (gst_video_frame_map (&out, info, buffer, GST_MAP_READ));
+
+  for (plane = 0; plane < GST_VIDEO_INFO_N_PLANES (info); plane++) {
+    guint size = plane_line_size (info, plane);
+
+    for (line = 0; line < GST_VIDEO_INFO_COMP_HEIGHT (info, plane); line++) {
+      guint8 *inp = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (&in, plane) +
+          line * GST_VIDEO_FRAME_PLANE_STRIDE (&in, plane);
+      guint8 *outp = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (&out, plane) +
+          line * GST_VIDEO_FRAME_PLANE_STRIDE (&out, plane);
+
+      if (GST_VIDEO_INFO_FORMAT (info) != GST_VIDEO_FORMAT_AYUV) {
+        fail_unless (memcmp (outp, inp, size) == 0, "line %u of plane %u "
+            "differs", line, plane);
+        continue;
+      }
+
+      /* the alpha channel isn't transmitted */
+      for (i = 0; i < size; i++) {
+        if (i % 4 != 0)
+          fail_unless_equals_int (outp[i], inp[i]);
+      }
+    }
+  }
+
+  gst_video_frame_unmap (&in);
+  gst_video_frame_unmap (&out);
+}
+
+static void
+run_roundtrip (const gchar * format, gint width, gint height, guint n_threads)
+{
+  GstHarness *h;
+  GstVideoInfo info;
+  GstBuffer *frame, *buffer;
+  GstCaps *caps;
+  gchar *desc;
+  guint n;
+
+  desc = g_strdup_printf ("rtpvrawpay n-threads=%u ! rtpvrawdepay", n_threads);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING, format,
+      "width", G_TYPE_INT, width, "height", G_TYPE_INT, height,
+      "framerate", GST_TYPE_FRACTION, 30, 1, NULL);
+  fail_unless (gst_video_info_from_caps (&info, caps));
+  gst_harness_set_src_caps (h, caps);
+
+  for (n = 0; n < 2; n++) {
+    frame = create_frame (h, &info, n);
+    GST_BUFFER_PTS (frame) = n * GST_SECOND / 30;
+    fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (frame)),
+        GST_FLOW_OK);
+
+    buffer = gst_harness_pull (h);
+    check_frames_equal (&info, frame, buffer);
+    gst_buffer_unref (buffer);
+    gst_buffer_unref (frame);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_START_TEST (test_vraw_roundtrip)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GST_INFO ("testing %s", formats[i]);
+    run_roundtrip (formats[i], 320, 240, 1);
+    run_roundtrip (formats[i], 64, 48, 1);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_vraw_roundtrip_threads)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GST_INFO ("testing %s", formats[i]);
+    run_roundtrip (formats[i], 320, 240, 4);
+    /* more threads than lines */
+    run_roundtrip (formats[i], 64, 2, 8);
+  }
+}
+
+GST_END_TEST;
+
+/* the packets of all the slices of a frame come out in one list, in order */
+GST_START_TEST (test_vraw_pay_threads_order)
+{
+  GstHarness *h = gst_harness_new ("rtpvrawpay");
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstVideoInfo info;
+  GstBuffer *buffer;
+  guint16 seqnum = 0;
+  guint n, i, n_packets;
+
+  g_object_set (h->element, "n-threads", 4, NULL);
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, 320, 240);
+  gst_harness_set_src_caps (h, gst_video_info_to_caps (&info));
+
+  for (n = 0; n < 2; n++) {
+    buffer = create_frame (h, &info, n);
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+    fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+
+    n_packets = gst_harness_buffers_in_queue (h);
+    fail_unless (n_packets > 4);
+
+    for (i = 0; i < n_packets; i++) {
+      buffer = gst_harness_pull (h);
+      fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp));
+      if (n > 0 || i > 0)
+        fail_unless_equals_int (gst_rtp_buffer_get_seq (&rtp),
+            (guint16) (seqnum + 1));
+      seqnum = gst_rtp_buffer_get_seq (&rtp);
+
+      /* only the last packet of the frame has the marker */
+      fail_unless_equals_int (gst_rtp_buffer_get_marker (&rtp),
+          i == n_packets - 1);
+      /* and only the first one is a discont */
+      fail_unless_equals_int (GST_BUFFER_IS_DISCONT (buffer) != 0, i == 0);
+
+      gst_rtp_buffer_unmap (&rtp);
+      gst_buffer_unref (buffer);
+    }
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* packets of formats laid out like RFC 4175 pgroups reference the frame */
+GST_START_TEST (test_vraw_pay_zero_copy)
+{
+  GstHarness *h = gst_harness_new ("rtpvrawpay");
+  GstVideoInfo info;
+  GstBuffer *frame, *buffer;
+  GstMemory *mem;
+  guint n_packets = 0;
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_UYVY, 320, 240);
+  gst_harness_set_src_caps (h, gst_video_info_to_caps (&info));
+
+  frame = create_frame (h, &info, 0);
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (frame)),
+      GST_FLOW_OK);
+
+  while ((buffer = gst_harness_try_pull (h))) {
+    guint i;
+
+    /* RTP header, headers of the payload and the referenced lines */
+    fail_unless (gst_buffer_n_memory (buffer) > 1);
+    for (i = 1; i < gst_buffer_n_memory (buffer); i++) {
+      mem = gst_buffer_peek_memory (buffer, i);
+      fail_unless (mem->parent == gst_buffer_peek_memory (frame, 0));
+    }
+
+    gst_buffer_unref (buffer);
+    n_packets++;
+  }
+  fail_unless (n_packets > 0);
+
+  gst_buffer_unref (frame);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+#define BENCH_N_FRAMES 30
+
+static void
+run_benchmark (const gchar * format, gint width, gint height)
+{
+  GstHarness *h_pay = gst_harness_new ("rtpvrawpay");
+  GstHarness *h_depay = gst_harness_new ("rtpvrawdepay");
+  GPtrArray *packets = g_ptr_array_new ();
+  gint64 start, pay_time = 0, depay_time = 0;
+  GstVideoInfo info;
+  GstBuffer *frame, *buffer;
+  GstCaps *caps;
+  guint n, i;
+
+  caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING, format,
+      "width", G_TYPE_INT, width, "height", G_TYPE_INT, height,
+      "framerate", GST_TYPE_FRACTION, 60, 1, NULL);
+  fail_unless (gst_video_info_from_caps (&info, caps));
+  gst_harness_set_src_caps (h_pay, caps);
+
+  frame = create_frame (h_pay, &info, 0);
+
+  for (n = 0; n < BENCH_N_FRAMES; n++) {
+    buffer = gst_buffer_copy (frame);
+    GST_BUFFER_PTS (buffer) = n * GST_SECOND / 60;
+
+    start = g_get_monotonic_time ();
+    gst_harness_push (h_pay, buffer);
+    pay_time += g_get_monotonic_time () - start;
+
+    if (n == 0)
+      gst_harness_set_src_caps (h_depay,
+          gst_pad_get_current_caps (h_pay->sinkpad));
+
+    while ((buffer = gst_harness_try_pull (h_pay)))
+      g_ptr_array_add (packets, buffer);
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < packets->len; i++)
+      gst_harness_push (h_depay, g_ptr_array_index (packets, i));
+    depay_time += g_get_monotonic_time () - start;
+    g_ptr_array_set_size (packets, 0);
+
+    gst_buffer_unref (gst_harness_pull (h_depay));
+  }
+
+  pay_time = MAX (pay_time, 1);
+  depay_time = MAX (depay_time, 1);
+  GST_INFO ("%s %dx%d: payloading %.1f fps, depayloading %.1f fps", format,
+      width, height, BENCH_N_FRAMES * (gdouble) G_USEC_PER_SEC / pay_time,
+      BENCH_N_FRAMES * (gdouble) G_USEC_PER_SEC / depay_time);
+
+  gst_buffer_unref (frame);
+  g_ptr_array_unref (packets);
+  gst_harness_teardown (h_pay);
+  gst_harness_teardown (h_depay);
+}
+
+GST_START_TEST (test_vraw_benchmark)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    run_benchmark (formats[i], 1920, 1080);
+}
+
+GST_END_TEST;
+
+static void
+run_threads_benchmark (const gchar * format, guint n_threads)
+{
+  GstHarness *h_src, *h_pay;
+  GstBuffer *frame, *buffer;
+  gint64 start, elapsed;
+  gchar *desc;
+  guint n;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=1 pattern=smpte ! "
+      "video/x-raw,format=%s,width=3840,height=2160,framerate=60/1", format);
+  h_src = gst_harness_new_parse (desc);
+  g_free (desc);
+  gst_harness_play (h_src);
+  frame = gst_harness_pull (h_src);
+
+  h_pay = gst_harness_new ("rtpvrawpay");
+  g_object_set (h_pay->element, "n-threads", n_threads, NULL);
+  gst_harness_set_src_caps (h_pay, gst_pad_get_current_caps (h_src->sinkpad));
+
+  elapsed = 0;
+  for (n = 0; n < BENCH_N_FRAMES; n++) {
+    buffer = gst_buffer_copy (frame);
+    GST_BUFFER_PTS (buffer) = n * GST_SECOND / 60;
+
+    start = g_get_monotonic_time ();
+    gst_harness_push (h_pay, buffer);
+    elapsed += g_get_monotonic_time () - start;
+
+    while ((buffer = gst_harness_try_pull (h_pay)))
+      gst_buffer_unref (buffer);
+  }
+
+  elapsed = MAX (elapsed, 1);
+  GST_INFO ("%s 3840x2160 with %u threads: payloading %.1f fps", format,
+      n_threads, BENCH_N_FRAMES * (gdouble) G_USEC_PER_SEC / elapsed);
+
+  gst_buffer_unref (frame);
+  gst_harness_teardown (h_pay);
+  gst_harness_teardown (h_src);
+}
+
+GST_START_TEST (test_vraw_threads_benchmark)
+{
+  guint n_threads;
+
+  for (n_threads = 1; n_threads <= 8; n_threads *= 2) {
+    run_threads_benchmark ("UYVP", n_threads);
+    run_threads_benchmark ("I420", n_threads);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+rtpvraw_suite (void)
+{
+  Suite *s = suite_create ("rtpvraw");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_vraw_roundtrip);
+  tcase_add_test (tc_chain, test_vraw_roundtrip_threads);
+  tcase_add_test (tc_chain, test_vraw_pay_zero_copy);
+  tcase_add_test (tc_chain, test_vraw_pay_threads_order);
+
+  tcase_add_benchmark (s, test_vraw_benchmark);
+  tcase_add_benchmark (s, test_vraw_threads_benchmark);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtpvraw);
@@ -0,0 +1,881 @@
+/* GStreamer
+ *
+ * Unit tests for rtspsrc, run against a minimal RTSP server on the loopback
+ * interface
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/rtsp/rtsp.h>
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchmark.h"
+
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#define RTP_PT 96
+#define RTP_SSRC 0x12345678
+#define PACKET_SIZE 1400
+#define BATCH_INTERVAL (10 * G_TIME_SPAN_MILLISECOND)
+
+#define TEST_SDP \
+  "v=0\r\n" \
+  "o=- 0 0 IN IP4 127.0.0.1\r\n" \
+  "s=test\r\n" \
+  "c=IN IP4 127.0.0.1\r\n" \
+  "t=0 0\r\n" \
+  "m=video 0 RTP/AVP 96\r\n" \
+  "a=rtpmap:96 H264/90000\r\n" \
+  "a=control:stream=0\r\n"
+
+/* an audio stream that never receives data */
+#define TEST_SDP_AUDIO \
+  "m=audio 0 RTP/AVP 0\r\n" \
+  "a=control:stream=1\r\n"
+
+#define TEST_SESSION "12345678"
+
+/* an RTSP server that streams one video stream interleaved in the RTSP
+ * connection, at @bitrate, to any number of clients. Its replies are delayed
+ * by @rtt. */
+typedef struct
+{
+  GSocket *socket;
+  guint16 port;
+  guint bitrate;
+  gint64 rtt;
+  gboolean audio;
+
+  GThread *thread;
+  GCancellable *cancellable;
+  GMutex lock;
+  GList *clients;
+  guint n_describe;
+  guint n_round_trips;
+} TestServer;
+
+typedef struct
+{
+  GstRTSPMessage *response;
+  GstRTSPMethod method;
+  gint64 due;
+} TestResponse;
+
+typedef struct
+{
+  TestServer *server;
+  GstRTSPConnection *conn;
+  GThread *thread;
+
+  gboolean playing;
+  guint16 seqnum;
+  gint64 start;
+  gint64 next_batch;
+
+  gboolean have_session;
+  GQueue responses;
+} TestClient;
+
+/* requests after the first SETUP must be in the session */
+static gboolean
+test_client_check_session (TestClient * client, GstRTSPMessage * request)
+{
+  gchar *session = NULL;
+
+  if (!client->have_session)
+    return FALSE;
+
+  gst_rtsp_message_get_header (request, GST_RTSP_HDR_SESSION, &session, 0);
+  return session && g_str_has_prefix (session, TEST_SESSION);
+}
+
+/* queues the reply to @request, to be sent after the RTT of the server */
+static void
+test_client_handle_request (TestClient * client, GstRTSPMessage * request)
+{
+  TestServer *server = client->server;
+  TestResponse *resp = g_new0 (TestResponse, 1);
+  GstRTSPMessage *response;
+  GstRTSPTransport *transport = NULL;
+  const gchar *uri;
+  gchar *str;
+
+  gst_rtsp_message_parse_request (request, &resp->method, &uri, NULL);
+  gst_rtsp_message_new_response (&response, GST_RTSP_STS_OK, NULL, request);
+
+  /* until playing, a request that comes while no reply is pending is the
+   * first one or had to wait for the previous reply. Pipelined requests
+   * arrive well within the RTT. */
+  if (!client->playing && g_queue_is_empty (&client->responses)) {
+    g_mutex_lock (&server->lock);
+    server->n_round_trips++;
+    g_mutex_unlock (&server->lock);
+  }
+
+  switch (resp->method) {
+    case GST_RTSP_OPTIONS:
+      gst_rtsp_message_add_header (response, GST_RTSP_HDR_PUBLIC,
+          "OPTIONS, DESCRIBE, SETUP, PLAY, TEARDOWN, GET_PARAMETER");
+      break;
+    case GST_RTSP_DESCRIBE:
+      g_mutex_lock (&server->lock);
+      server->n_describe++;
+      g_mutex_unlock (&server->lock);
+
+      str = g_strdup_printf ("rtsp://127.0.0.1:%u/test/", server->port);
+      gst_rtsp_message_add_header (response, GST_RTSP_HDR_CONTENT_BASE, str);
+      g_free (str);
+      gst_rtsp_message_add_header (response, GST_RTSP_HDR_CONTENT_TYPE,
+          "application/sdp");
+      str = g_strconcat (TEST_SDP, server->audio ? TEST_SDP_AUDIO : "", NULL);
+      gst_rtsp_message_take_body (response, (guint8 *) str, strlen (str));
+      break;
+    case GST_RTSP_SETUP:
+      if (client->have_session &&
+          !test_client_check_session (client, request)) {
+        gst_rtsp_message_init_response (response,
+            GST_RTSP_STS_SESSION_NOT_FOUND, NULL, request);
+        break;
+      }
+      /* accept the channels that the client asked for */
+      gst_rtsp_transport_new (&transport);
+      if (gst_rtsp_message_get_header (request, GST_RTSP_HDR_TRANSPORT, &str,
+              0) != GST_RTSP_OK ||
+          gst_rtsp_transport_parse (str, transport) != GST_RTSP_OK) {
+        gst_rtsp_message_init_response (response,
+            GST_RTSP_STS_UNSUPPORTED_TRANSPORT, NULL, request);
+      } else {
+        str = g_strdup_printf ("RTP/AVP/TCP;unicast;interleaved=%d-%d",
+            transport->interleaved.min, transport->interleaved.max);
+        gst_rtsp_message_take_header (response, GST_RTSP_HDR_TRANSPORT, str);
+        gst_rtsp_message_add_header (response, GST_RTSP_HDR_SESSION,
+            TEST_SESSION);
+        client->have_session = TRUE;
+      }
+      gst_rtsp_transport_free (transport);
+      break;
+    case GST_RTSP_PLAY:
+      if (!test_client_check_session (client, request))
+        gst_rtsp_message_init_response (response,
+            GST_RTSP_STS_SESSION_NOT_FOUND, NULL, request);
+      break;
+    default:
+      break;
+  }
+
+  resp->response = response;
+  resp->due = g_get_monotonic_time () + server->rtt;
+  g_queue_push_tail (&client->responses, resp);
+}
+
+/* sends the replies that are due, returns FALSE when the connection should
+ * be closed */
+static gboolean
+test_client_send_responses (TestClient * client)
+{
+  TestResponse *resp;
+  gboolean keep_going = TRUE;
+
+  while (keep_going && (resp = g_queue_peek_head (&client->responses)) &&
+      resp->due <= g_get_monotonic_time ()) {
+    g_queue_pop_head (&client->responses);
+
+    if (gst_rtsp_connection_send_usec (client->conn, resp->response,
+            G_USEC_PER_SEC) != GST_RTSP_OK)
+      keep_going = FALSE;
+
+    if (resp->method == GST_RTSP_PLAY &&
+        resp->response->type_data.response.code == GST_RTSP_STS_OK) {
+      client->playing = TRUE;
+      client->start = client->next_batch = g_get_monotonic_time ();
+    } else if (resp->method == GST_RTSP_TEARDOWN) {
+      keep_going = FALSE;
+    }
+
+    gst_rtsp_message_free (resp->response);
+    g_free (resp);
+  }
+
+  return keep_going;
+}
+
+/* sends the RTP packets for one interval as one write */
+static gboolean
+test_client_send_batch (TestClient * client, guint8 * batch, guint n_packets)
+{
+  guint32 rtptime;
+  guint i;
+
+  rtptime = (g_get_monotonic_time () - client->start) * 9 / 100;
+
+  for (i = 0; i < n_packets; i++) {
+    guint8 *frame = batch + i * (4 + PACKET_SIZE);
+
+    frame[0] = '$';
+    frame[1] = 0;
+    GST_WRITE_UINT16_BE (frame + 2, PACKET_SIZE);
+    frame[4] = 0x80;
+    frame[5] = RTP_PT;
+    GST_WRITE_UINT16_BE (frame + 6, client->seqnum);
+    GST_WRITE_UINT32_BE (frame + 8, rtptime);
+    GST_WRITE_UINT32_BE (frame + 12, RTP_SSRC);
+    /* the send time, for measuring the latency, and a payload that makes
+     * every packet recognizable */
+    GST_WRITE_UINT64_BE (frame + 16, g_get_monotonic_time ());
+    memset (frame + 24, client->seqnum & 0xff, PACKET_SIZE - 20);
+    client->seqnum++;
+  }
+
+  return gst_rtsp_connection_write_usec (client->conn, batch,
+      n_packets * (4 + PACKET_SIZE), G_USEC_PER_SEC) == GST_RTSP_OK;
+}
+
+static gpointer
+test_client_thread (TestClient * client)
+{
+  TestServer *server = client->server;
+  TestResponse *resp;
+  guint n_packets;
+  guint8 *batch;
+
+  n_packets = MAX (1, gst_util_uint64_scale (server->bitrate / 8,
+          BATCH_INTERVAL, G_USEC_PER_SEC * PACKET_SIZE));
+  batch = g_malloc (n_packets * (4 + PACKET_SIZE));
+
+  while (!g_cancellable_is_cancelled (server->cancellable)) {
+    GstRTSPMessage request = { 0, };
+    GstRTSPResult res;
+    gint64 timeout = 100 * G_TIME_SPAN_MILLISECOND;
+
+    if (client->playing)
+      timeout = CLAMP (client->next_batch - g_get_monotonic_time (),
+          G_TIME_SPAN_MILLISECOND, BATCH_INTERVAL);
+    if ((resp = g_queue_peek_head (&client->responses)))
+      timeout = CLAMP (resp->due - g_get_monotonic_time (),
+          G_TIME_SPAN_MILLISECOND, timeout);
+
+    res = gst_rtsp_connection_receive_usec (client->conn, &request, timeout);
+    if (res == GST_RTSP_OK) {
+      if (request.type == GST_RTSP_MESSAGE_REQUEST)
+        test_client_handle_request (client, &request);
+      gst_rtsp_message_unset (&request);
+    } else if (res != GST_RTSP_ETIMEOUT) {
+      break;
+    }
+
+    if (!test_client_send_responses (client))
+      break;
+
+    if (client->playing && g_get_monotonic_time () >= client->next_batch) {
+      if (!test_client_send_batch (client, batch, n_packets))
+        break;
+      client->next_batch += BATCH_INTERVAL;
+    }
+  }
+
+  g_free (batch);
+
+  while ((resp = g_queue_pop_head (&client->responses))) {
+    gst_rtsp_message_free (resp->response);
+    g_free (resp);
+  }
+
+  return NULL;
+}
+
+static gpointer
+test_server_thread (TestServer * server)
+{
+  while (TRUE) {
+    GstRTSPConnection *conn;
+    TestClient *client;
+
+    if (gst_rtsp_connection_accept (server->socket, &conn,
+            server->cancellable) != GST_RTSP_OK)
+      break;
+
+    client = g_new0 (TestClient, 1);
+    client->server = server;
+    client->conn = conn;
+    g_queue_init (&client->responses);
+    client->thread = g_thread_new ("test-client",
+        (GThreadFunc) test_client_thread, client);
+
+    g_mutex_lock (&server->lock);
+    server->clients = g_list_prepend (server->clients, client);
+    g_mutex_unlock (&server->lock);
+  }
+
+  return NULL;
+}
+
+static TestServer *
+test_server_new (guint bitrate)
+{
+  TestServer *server = g_new0 (TestServer, 1);
+  GInetAddress *inet;
+  GSocketAddress *addr;
+  GError *err = NULL;
+
+  server->bitrate = bitrate;
+  server->cancellable = g_cancellable_new ();
+  g_mutex_init (&server->lock);
+
+  server->socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_STREAM,
+      G_SOCKET_PROTOCOL_TCP, &err);
+  fail_unless (server->socket != NULL, "%s", err ? err->message : "");
+
+  inet = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  addr = g_inet_socket_address_new (inet, 0);
+  fail_unless (g_socket_bind (server->socket, addr, TRUE, NULL));
+  fail_unless (g_socket_listen (server->socket, NULL));
+  g_object_unref (addr);
+  g_object_unref (inet);
+
+  addr = g_socket_get_local_address (server->socket, NULL);
+  server->port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr));
+  g_object_unref (addr);
+
+  server->thread = g_thread_new ("test-server",
+      (GThreadFunc) test_server_thread, server);
+
+  return server;
+}
+
+static gchar *
+test_server_get_uri (TestServer * server)
+{
+  return g_strdup_printf ("rtsp://127.0.0.1:%u/test", server->port);
+}
+
+static void
+test_server_free (TestServer * server)
+{
+  GList *walk;
+
+  g_cancellable_cancel (server->cancellable);
+  g_thread_join (server->thread);
+
+  for (walk = server->clients; walk; walk = walk->next) {
+    TestClient *client = walk->data;
+
+    g_thread_join (client->thread);
+    gst_rtsp_connection_free (client->conn);
+    g_free (client);
+  }
+  g_list_free (server->clients);
+
+  g_socket_close (server->socket, NULL);
+  g_object_unref (server->socket);
+  g_object_unref (server->cancellable);
+  g_mutex_clear (&server->lock);
+  g_free (server);
+}
+
+/* an rtspsrc receiving from a server into a fakesink */
+typedef struct
+{
+  GstElement *src;
+  GstElement *sink;
+  GstPad *pad;
+
+  /* protected by the object lock of pad */
+  guint64 bytes;
+  guint packets;
+  guint corrupted;
+  GstClockTimeDiff latency_sum;
+  gint64 first_buffer;
+} TestSession;
+
+static void
+check_rtp_buffer (GstBuffer * buf, TestSession * session)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint8 *payload;
+  guint16 seqnum;
+  guint i, len;
+
+  if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp)) {
+    session->corrupted++;
+    return;
+  }
+
+  seqnum = gst_rtp_buffer_get_seq (&rtp);
+  payload = gst_rtp_buffer_get_payload (&rtp);
+  len = gst_rtp_buffer_get_payload_len (&rtp);
+  if (len < 8) {
+    session->corrupted++;
+  } else {
+    session->latency_sum +=
+        g_get_monotonic_time () - (gint64) GST_READ_UINT64_BE (payload);
+    for (i = 8; i < len; i++) {
+      if (payload[i] != (seqnum & 0xff)) {
+        session->corrupted++;
+        break;
+      }
+    }
+  }
+  if (session->packets == 0)
+    session->first_buffer = g_get_monotonic_time ();
+  session->bytes += gst_buffer_get_size (buf);
+  session->packets++;
+
+  gst_rtp_buffer_unmap (&rtp);
+}
+
+static gboolean
+check_rtp_list_buffer (GstBuffer ** buf, guint idx, TestSession * session)
+{
+  check_rtp_buffer (*buf, session);
+  return TRUE;
+}
+
+static GstPadProbeReturn
+receive_probe (GstPad * pad, GstPadProbeInfo * info, TestSession * session)
+{
+  GST_OBJECT_LOCK (pad);
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER)
+    check_rtp_buffer (GST_PAD_PROBE_INFO_BUFFER (info), session);
+  else
+    gst_buffer_list_foreach (GST_PAD_PROBE_INFO_BUFFER_LIST (info),
+        (GstBufferListFunc) check_rtp_list_buffer, session);
+  GST_OBJECT_UNLOCK (pad);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+pad_added_cb (GstElement * src, GstPad * pad, GstElement * sink)
+{
+  GstPad *sinkpad = gst_element_get_static_pad (sink, "sink");
+
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+}
+
+static TestSession *
+test_session_new (GstElement * pipeline, TestServer * server,
+    const gchar * first_property, ...)
+{
+  TestSession *session = g_new0 (TestSession, 1);
+  va_list args;
+  gchar *uri;
+
+  session->src = gst_element_factory_make ("rtspsrc", NULL);
+  session->sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (session->src != NULL && session->sink != NULL);
+
+  uri = test_server_get_uri (server);
+  g_object_set (session->src, "location", uri, "protocols",
+      GST_RTSP_LOWER_TRANS_TCP, "latency", 0, NULL);
+  g_free (uri);
+  va_start (args, first_property);
+  g_object_set_valist (G_OBJECT (session->src), first_property, args);
+  va_end (args);
+  g_object_set (session->sink, "sync", FALSE, NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), session->src, session->sink, NULL);
+  g_signal_connect (session->src, "pad-added", G_CALLBACK (pad_added_cb),
+      session->sink);
+
+  session->pad = gst_element_get_static_pad (session->sink, "sink");
+  gst_pad_add_probe (session->pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      (GstPadProbeCallback) receive_probe, session, NULL);
+
+  return session;
+}
+
+static void
+test_session_free (TestSession * session)
+{
+  gst_object_unref (session->pad);
+  g_free (session);
+}
+
+static void
+test_session_get_stats (TestSession * session, guint64 * bytes,
+    guint * packets, GstClockTimeDiff * latency_sum)
+{
+  GST_OBJECT_LOCK (session->pad);
+  *bytes = session->bytes;
+  *packets = session->packets;
+  *latency_sum = session->latency_sum;
+  fail_unless_equals_int (session->corrupted, 0);
+  GST_OBJECT_UNLOCK (session->pad);
+}
+
+/* waits until all @sessions received data */
+static void
+wait_for_data (GPtrArray * sessions)
+{
+  gint64 deadline = g_get_monotonic_time () + 20 * G_USEC_PER_SEC;
+  guint i;
+
+  for (i = 0; i < sessions->len; i++) {
+    guint64 bytes;
+    guint packets;
+    GstClockTimeDiff latency_sum;
+
+    do {
+      test_session_get_stats (g_ptr_array_index (sessions, i), &bytes,
+          &packets, &latency_sum);
+      if (bytes == 0)
+        g_usleep (G_TIME_SPAN_MILLISECOND);
+    } while (bytes == 0 && g_get_monotonic_time () < deadline);
+    fail_unless (bytes > 0, "no data received");
+  }
+}
+
+static guint64
+get_total_bytes (GPtrArray * sessions, guint * packets,
+    GstClockTimeDiff * latency_sum)
+{
+  guint64 total = 0;
+  guint i;
+
+  *packets = 0;
+  *latency_sum = 0;
+  for (i = 0; i < sessions->len; i++) {
+    guint64 bytes;
+    guint p;
+    GstClockTimeDiff l;
+
+    test_session_get_stats (g_ptr_array_index (sessions, i), &bytes, &p, &l);
+    total += bytes;
+    *packets += p;
+    *latency_sum += l;
+  }
+
+  return total;
+}
+
+static gint64
+get_cpu_time (void)
+{
+#ifdef G_OS_UNIX
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+  return (gint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+      G_USEC_PER_SEC + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#else
+  return 0;
+#endif
+}
+
+/* returns the number of threads of the process, or 0 when unknown */
+static guint
+get_n_threads (void)
+{
+  gchar *status, *line;
+  guint n_threads = 0;
+
+  if (!g_file_get_contents ("/proc/self/status", &status, NULL, NULL))
+    return 0;
+
+  line = strstr (status, "\nThreads:");
+  if (line)
+    n_threads = strtoul (line + strlen ("\nThreads:"), NULL, 10);
+  g_free (status);
+
+  return n_threads;
+}
+
+typedef struct
+{
+  guint n_threads;
+  /* in microseconds */
+  gdouble cpu_per_mbit;
+  gdouble latency;
+} TestMeasurement;
+
+/* measures while @sessions together receive at least @mbits */
+static void
+measure_mbits (GPtrArray * sessions, guint mbits, TestMeasurement * result)
+{
+  gint64 deadline, cpu_start, cpu_end;
+  guint64 bytes_start, bytes;
+  guint packets_start, packets;
+  GstClockTimeDiff latency_start, latency;
+
+  wait_for_data (sessions);
+
+  result->n_threads = get_n_threads ();
+  cpu_start = get_cpu_time ();
+  bytes_start = get_total_bytes (sessions, &packets_start, &latency_start);
+
+  deadline = g_get_monotonic_time () + 20 * G_USEC_PER_SEC;
+  do {
+    g_usleep (10 * G_TIME_SPAN_MILLISECOND);
+    bytes = get_total_bytes (sessions, &packets, &latency);
+  } while (bytes - bytes_start < (guint64) mbits * 1000000 / 8 &&
+      g_get_monotonic_time () < deadline);
+  cpu_end = get_cpu_time ();
+
+  fail_unless (bytes - bytes_start >= (guint64) mbits * 1000000 / 8);
+
+  result->cpu_per_mbit = (gdouble) (cpu_end - cpu_start) * 1000000 /
+      ((bytes - bytes_start) * 8);
+  result->latency = (gdouble) (latency - latency_start) /
+      MAX (1, packets - packets_start);
+}
+
+/* receives @mbits of data from @server with one rtspsrc */
+static void
+receive_mbits (TestServer * server, guint chunk_size, guint mbits,
+    TestMeasurement * result)
+{
+  GstElement *pipeline = gst_pipeline_new (NULL);
+  GPtrArray *sessions = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      test_session_free);
+
+  g_ptr_array_add (sessions, test_session_new (pipeline, server,
+          "interleaved-chunk-size", chunk_size, NULL));
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  measure_mbits (sessions, mbits, result);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  g_ptr_array_unref (sessions);
+  gst_object_unref (pipeline);
+}
+
+GST_START_TEST (test_interleaved_receive)
+{
+  TestServer *server = test_server_new (4000000);
+  TestMeasurement result;
+
+  receive_mbits (server, 0, 2, &result);
+
+  test_server_free (server);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_interleaved_receive_chunked)
+{
+  TestServer *server = test_server_new (4000000);
+  TestMeasurement result;
+
+  /* rounded up to fit the largest frame */
+  receive_mbits (server, 1, 2, &result);
+  receive_mbits (server, 256 * 1024, 2, &result);
+
+  test_server_free (server);
+}
+
+GST_END_TEST;
+
+/* compares the CPU time spent per Mbit received over TCP, for the server and
+ * the client together, with and without chunked receiving */
+GST_START_TEST (test_interleaved_receive_benchmark)
+{
+  TestServer *server = test_server_new (50000000);
+  TestMeasurement per_frame, chunked;
+
+  receive_mbits (server, 0, 100, &per_frame);
+  receive_mbits (server, 256 * 1024, 100, &chunked);
+
+  GST_INFO ("CPU time per Mbit: %.1f us per frame, %.1f us chunked",
+      per_frame.cpu_per_mbit, chunked.cpu_per_mbit);
+
+  test_server_free (server);
+}
+
+GST_END_TEST;
+
+/* returns the time from starting to play until the first buffer */
+static gint64
+time_to_first_buffer (TestServer * server, gboolean pipeline_requests,
+    gboolean cache_sdp)
+{
+  GstElement *pipeline = gst_pipeline_new (NULL);
+  GPtrArray *sessions = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      test_session_free);
+  TestSession *session;
+  gint64 start, first_buffer;
+
+  session = test_session_new (pipeline, server, "pipeline-requests",
+      pipeline_requests, "cache-sdp", cache_sdp, NULL);
+  g_ptr_array_add (sessions, session);
+
+  start = g_get_monotonic_time ();
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  wait_for_data (sessions);
+
+  GST_OBJECT_LOCK (session->pad);
+  first_buffer = session->first_buffer;
+  GST_OBJECT_UNLOCK (session->pad);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  g_ptr_array_unref (sessions);
+  gst_object_unref (pipeline);
+
+  return first_buffer - start;
+}
+
+static guint
+test_server_get_n_describe (TestServer * server)
+{
+  guint n_describe;
+
+  g_mutex_lock (&server->lock);
+  n_describe = server->n_describe;
+  g_mutex_unlock (&server->lock);
+
+  return n_describe;
+}
+
+/* returns the number of round trips until the first buffer */
+static guint
+round_trips_to_first_buffer (TestServer * server, gboolean pipeline_requests,
+    gboolean cache_sdp, gint64 * time)
+{
+  guint n_round_trips;
+
+  g_mutex_lock (&server->lock);
+  server->n_round_trips = 0;
+  g_mutex_unlock (&server->lock);
+
+  *time = time_to_first_buffer (server, pipeline_requests, cache_sdp);
+
+  g_mutex_lock (&server->lock);
+  n_round_trips = server->n_round_trips;
+  g_mutex_unlock (&server->lock);
+
+  return n_round_trips;
+}
+
+/* with two streams and aggregate control, pipelining saves the round trip
+ * of the second SETUP and of PLAY, and a cached SDP those of OPTIONS and
+ * DESCRIBE. The stand-in server counts the round trips, the times are only
+ * logged. */
+GST_START_TEST (test_fast_start)
+{
+  TestServer *server = test_server_new (500000);
+  gint64 plain_time, pipelined_time, cached_time;
+  guint plain, pipelined, cached;
+  guint n_describe;
+
+  server->rtt = 100 * G_TIME_SPAN_MILLISECOND;
+  server->audio = TRUE;
+
+  plain = round_trips_to_first_buffer (server, FALSE, FALSE, &plain_time);
+  pipelined = round_trips_to_first_buffer (server, TRUE, FALSE,
+      &pipelined_time);
+  /* fills the cache */
+  round_trips_to_first_buffer (server, TRUE, TRUE, &cached_time);
+  n_describe = test_server_get_n_describe (server);
+  cached = round_trips_to_first_buffer (server, TRUE, TRUE, &cached_time);
+
+  GST_INFO ("round trips to the first buffer: %u (%" G_GINT64_FORMAT
+      " ms), %u pipelined (%" G_GINT64_FORMAT " ms), %u pipelined with "
+      "cached SDP (%" G_GINT64_FORMAT " ms)", plain,
+      plain_time / G_TIME_SPAN_MILLISECOND, pipelined,
+      pipelined_time / G_TIME_SPAN_MILLISECOND, cached,
+      cached_time / G_TIME_SPAN_MILLISECOND);
+
+  fail_unless_equals_int (test_server_get_n_describe (server), n_describe);
+  fail_unless_equals_int (pipelined + 1, plain);
+  fail_unless_equals_int (cached + 2, pipelined);
+
+  test_server_free (server);
+}
+
+GST_END_TEST;
+
+/* receives from @n_sessions rtspsrc elements at once */
+static void
+receive_sessions (guint n_sessions, gboolean shared_loop,
+    TestMeasurement * result)
+{
+  TestServer *server = test_server_new (500000);
+  GstElement *pipeline = gst_pipeline_new (NULL);
+  GPtrArray *sessions = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      test_session_free);
+  guint i;
+
+  for (i = 0; i < n_sessions; i++)
+    g_ptr_array_add (sessions, test_session_new (pipeline, server,
+            "shared-loop", shared_loop, NULL));
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  measure_mbits (sessions, n_sessions, result);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  g_ptr_array_unref (sessions);
+  gst_object_unref (pipeline);
+  test_server_free (server);
+}
+
+GST_START_TEST (test_shared_loop_scaling)
+{
+  const guint n_sessions[] = { 4, 16, 48 };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (n_sessions); i++) {
+    TestMeasurement own, shared;
+
+    receive_sessions (n_sessions[i], FALSE, &own);
+    receive_sessions (n_sessions[i], TRUE, &shared);
+
+    GST_INFO ("%u sessions: %u threads, %.1f us CPU per Mbit, %.0f us "
+        "latency with a thread each; %u threads, %.1f us CPU per Mbit, "
+        "%.0f us latency with a shared loop", n_sessions[i], own.n_threads,
+        own.cpu_per_mbit, own.latency, shared.n_threads, shared.cpu_per_mbit,
+        shared.latency);
+
+    /* the shared loop has at most a thread per processor */
+    if (own.n_threads > 0 &&
+        n_sessions[i] > 2 * (guint) g_get_num_processors () + 4)
+      fail_unless (shared.n_threads < own.n_threads);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+rtspsrc_suite (void)
+{
+  Suite *s = suite_create ("rtspsrc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_interleaved_receive);
+  tcase_add_test (tc_chain, test_interleaved_receive_chunked);
+  tcase_add_test (tc_chain, test_fast_start);
+
+  tcase_add_benchmark (s, test_interleaved_receive_benchmark);
+  tcase_add_benchmark (s, test_shared_loop_scaling);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtspsrc);
@@ -20,7 +20,16 @@
 #include <gst/check/gstcheck.h>
 #include <gst/base/gstbasesink.h>
 #include <gio/gio.h>
+#include <gio/gnetworking.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
 
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
@@ -239,6 +248,218 @@ GST_START_TEST (test_udpsink_dscp)
 
 GST_END_TEST;
 
+#define N_GSO_PACKETS 10
+#define GSO_PACKET_SIZE 1200
+
+/* does the same check as multiudpsink before it enables segmentation */
+static gboolean
+udp_segment_supported (GSocket * socket)
+{
+#ifdef UDP_SEGMENT
+  return g_socket_set_option (socket, IPPROTO_UDP, UDP_SEGMENT, 0, NULL);
+#else
+  return FALSE;
+#endif
+}
+
+GST_START_TEST (test_multiudpsink_gso)
+{
+  GstElement *udpsink;
+  GstPad *srcpad;
+  GstSegment segment;
+  GstBufferList *list;
+  GstStructure *stats;
+  GSocket *socket;
+  GSocketAddress *sa;
+  GInetAddress *ia;
+  GError *error = NULL;
+  guint64 packets_sent, bytes_sent, messages_sent;
+  gchar data[2048], expected[2048];
+  gboolean have_gso;
+  guint16 port;
+  guint i;
+
+  /* receiving side on loopback */
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, &error);
+  fail_unless (socket != NULL && error == NULL);
+  ia = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  sa = g_inet_socket_address_new (ia, 0);
+  fail_unless (g_socket_bind (socket, sa, TRUE, NULL));
+  g_object_unref (sa);
+  g_object_unref (ia);
+  sa = g_socket_get_local_address (socket, NULL);
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (sa));
+  g_object_unref (sa);
+  g_socket_set_timeout (socket, 5);
+  have_gso = udp_segment_supported (socket);
+
+  udpsink = gst_check_setup_element ("multiudpsink");
+  g_object_set (udpsink, "gso", TRUE, NULL);
+  g_signal_emit_by_name (udpsink, "add", "127.0.0.1", port, NULL);
+
+  srcpad = gst_check_setup_src_pad_by_name (udpsink, &srctemplate, "sink");
+
+  gst_element_set_state (udpsink, GST_STATE_PLAYING);
+  gst_pad_set_active (srcpad, TRUE);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("hey there!"));
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  /* equally sized packets and a shorter last one, like a payloaded frame */
+  list = gst_buffer_list_new ();
+  for (i = 0; i < N_GSO_PACKETS; i++) {
+    gsize size = (i == N_GSO_PACKETS - 1) ? 500 : GSO_PACKET_SIZE;
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+
+    gst_buffer_memset (buf, 0, i, size);
+    gst_buffer_list_add (list, buf);
+  }
+
+  fail_unless_equals_int (gst_pad_push_list (srcpad, list), GST_FLOW_OK);
+
+  /* whether the kernel segmented them or we fell back to single sends, the
+   * receiver sees the original packets, one per datagram */
+  for (i = 0; i < N_GSO_PACKETS; i++) {
+    gsize size = (i == N_GSO_PACKETS - 1) ? 500 : GSO_PACKET_SIZE;
+    gssize len;
+
+    len = g_socket_receive (socket, data, sizeof (data), NULL, &error);
+    fail_unless (error == NULL);
+    fail_unless_equals_int (len, size);
+    memset (expected, i, size);
+    fail_unless (memcmp (data, expected, size) == 0);
+  }
+
+  /* and nothing else */
+  g_socket_set_blocking (socket, FALSE);
+  fail_unless (g_socket_receive (socket, data, sizeof (data), NULL,
+          &error) < 0);
+  fail_unless (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK));
+  g_clear_error (&error);
+
+  g_signal_emit_by_name (udpsink, "get-stats", "127.0.0.1", port, &stats);
+  fail_unless (gst_structure_get_uint64 (stats, "packets-sent",
+          &packets_sent));
+  fail_unless (gst_structure_get_uint64 (stats, "bytes-sent", &bytes_sent));
+  fail_unless (gst_structure_get_uint64 (stats, "messages-sent",
+          &messages_sent));
+  gst_structure_free (stats);
+
+  GST_INFO ("sent %" G_GUINT64_FORMAT " packets with %" G_GUINT64_FORMAT
+      " messages (UDP_SEGMENT %ssupported)", packets_sent, messages_sent,
+      have_gso ? "" : "not ");
+
+  fail_unless_equals_int (packets_sent, N_GSO_PACKETS);
+  fail_unless_equals_int (bytes_sent,
+      (N_GSO_PACKETS - 1) * GSO_PACKET_SIZE + 500);
+  if (have_gso)
+    fail_unless (messages_sent < N_GSO_PACKETS);
+  else
+    fail_unless_equals_int (messages_sent, N_GSO_PACKETS);
+
+  gst_check_teardown_pad_by_name (udpsink, "sink");
+  gst_check_teardown_element (udpsink);
+
+  g_object_unref (socket);
+}
+
+GST_END_TEST;
+
+#define N_PACED_PACKETS 10
+#define PACING_WINDOW (100 * GST_MSECOND)
+
+GST_START_TEST (test_multiudpsink_pacing)
+{
+  GstElement *udpsink;
+  GstPad *srcpad;
+  GstSegment segment;
+  GstBufferList *list;
+  GSocket *socket;
+  GSocketAddress *sa;
+  GInetAddress *ia;
+  GError *error = NULL;
+  guint queue_depth;
+  gint64 start, last, spread;
+  gchar data[2048];
+  guint16 port;
+  guint i;
+
+  /* receiving side on loopback */
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, &error);
+  fail_unless (socket != NULL && error == NULL);
+  ia = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  sa = g_inet_socket_address_new (ia, 0);
+  fail_unless (g_socket_bind (socket, sa, TRUE, NULL));
+  g_object_unref (sa);
+  g_object_unref (ia);
+  sa = g_socket_get_local_address (socket, NULL);
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (sa));
+  g_object_unref (sa);
+  g_socket_set_timeout (socket, 5);
+
+  udpsink = gst_check_setup_element ("multiudpsink");
+  g_object_set (udpsink, "pacing-window", (guint64) PACING_WINDOW, NULL);
+  g_signal_emit_by_name (udpsink, "add", "127.0.0.1", port, NULL);
+
+  srcpad = gst_check_setup_src_pad_by_name (udpsink, &srctemplate, "sink");
+
+  gst_element_set_state (udpsink, GST_STATE_PLAYING);
+  gst_pad_set_active (srcpad, TRUE);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("hey there!"));
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  list = gst_buffer_list_new ();
+  for (i = 0; i < N_PACED_PACKETS; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, 1000, NULL);
+
+    gst_buffer_memset (buf, 0, i, 1000);
+    gst_buffer_list_add (list, buf);
+  }
+
+  start = g_get_monotonic_time ();
+  fail_unless_equals_int (gst_pad_push_list (srcpad, list), GST_FLOW_OK);
+  GST_INFO ("pushing took %" G_GINT64_FORMAT " us",
+      g_get_monotonic_time () - start);
+
+  /* the packets arrive in order */
+  for (i = 0; i < N_PACED_PACKETS; i++) {
+    gssize len;
+
+    len = g_socket_receive (socket, data, sizeof (data), NULL, &error);
+    fail_unless (error == NULL);
+    fail_unless_equals_int (len, 1000);
+    fail_unless_equals_int (data[0], i);
+  }
+  last = g_get_monotonic_time ();
+
+  /* and are spread over the window instead of sent in a burst. The last
+   * packet cannot be received before it was sent, however late we read,
+   * so only check that it did not come much earlier than the end of the
+   * window, and that the sink did not stall */
+  spread = last - start;
+  GST_INFO ("packets received within %" G_GINT64_FORMAT " us", spread);
+  fail_unless (spread >= GST_TIME_AS_USECONDS (PACING_WINDOW) / 2);
+  fail_unless (spread < GST_TIME_AS_USECONDS (PACING_WINDOW) * 20);
+
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+  g_object_get (udpsink, "pacing-queue-depth", &queue_depth, NULL);
+  fail_unless_equals_int (queue_depth, 0);
+
+  gst_check_teardown_pad_by_name (udpsink, "sink");
+  gst_check_teardown_element (udpsink);
+
+  g_object_unref (socket);
+}
+
+GST_END_TEST;
+
 static Suite *
 udpsink_suite (void)
 {
@@ -251,6 +472,8 @@ udpsink_suite (void)
   tcase_add_test (tc_chain, test_udpsink_bufferlist);
   tcase_add_test (tc_chain, test_udpsink_client_add_remove);
   tcase_add_test (tc_chain, test_udpsink_dscp);
+  tcase_add_test (tc_chain, test_multiudpsink_gso);
+  tcase_add_test (tc_chain, test_multiudpsink_pacing);
 
   return s;
 }
@@ -17,8 +17,13 @@
  * Boston, MA 02110-1301, USA.
  */
 #include <gst/check/gstcheck.h>
+#include <gst/net/gstnetaddressmeta.h>
 #include <gio/gio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "benchmark.h"
 
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -26,8 +31,8 @@ static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_STATIC_CAPS_ANY);
 
 static gboolean
-udpsrc_setup (GstElement ** udpsrc, GSocket ** socket,
-    GstPad ** sinkpad, GSocketAddress ** sa)
+udpsrc_setup_full (GstElement ** udpsrc, GSocket ** socket,
+    GstPad ** sinkpad, GSocketAddress ** sa, guint batch_size)
 {
   GInetAddress *ia;
   int port = 0;
@@ -35,7 +40,7 @@ udpsrc_setup (GstElement ** udpsrc, GSocket ** socket,
 
   *udpsrc = gst_check_setup_element ("udpsrc");
   fail_unless (*udpsrc != NULL);
-  g_object_set (*udpsrc, "port", 0, NULL);
+  g_object_set (*udpsrc, "port", 0, "batch-size", batch_size, NULL);
 
   *sinkpad = gst_check_setup_sink_pad_by_name (*udpsrc, &sinktemplate, "src");
   fail_unless (*sinkpad != NULL);
@@ -63,6 +68,13 @@ udpsrc_setup (GstElement ** udpsrc, GSocket ** socket,
   return TRUE;
 }
 
+static gboolean
+udpsrc_setup (GstElement ** udpsrc, GSocket ** socket,
+    GstPad ** sinkpad, GSocketAddress ** sa)
+{
+  return udpsrc_setup_full (udpsrc, socket, sinkpad, sa, 1);
+}
+
 GST_START_TEST (test_udpsrc_empty_packet)
 {
   GSocketAddress *sa = NULL;
@@ -247,6 +259,197 @@ send_failure:
 
 GST_END_TEST;
 
+static guint n_buffer_lists;
+
+static GstFlowReturn
+udpsrc_chain_list (GstPad * pad, GstObject * parent, GstBufferList * list)
+{
+  guint i, len;
+
+  len = gst_buffer_list_length (list);
+
+  g_mutex_lock (&check_mutex);
+  n_buffer_lists++;
+  for (i = 0; i < len; i++)
+    buffers = g_list_append (buffers,
+        gst_buffer_ref (gst_buffer_list_get (list, i)));
+  g_cond_signal (&check_cond);
+  g_mutex_unlock (&check_mutex);
+
+  gst_buffer_list_unref (list);
+
+  return GST_FLOW_OK;
+}
+
+#define N_BATCH_PACKETS 64
+
+GST_START_TEST (test_udpsrc_batch)
+{
+  gboolean do_timestamp = (__i__ == 0);
+  GstClock *clock;
+  GSocketAddress *sa = NULL;
+  GstElement *udpsrc = NULL;
+  GSocket *socket = NULL;
+  GstPad *sinkpad = NULL;
+  GError *err = NULL;
+  guint8 data[200];
+  GList *l;
+  guint i;
+
+  n_buffer_lists = 0;
+
+  if (!udpsrc_setup_full (&udpsrc, &socket, &sinkpad, &sa, 16))
+    goto no_socket;
+
+  gst_pad_set_chain_list_function (sinkpad, udpsrc_chain_list);
+  g_object_set (udpsrc, "do-timestamp", do_timestamp, NULL);
+
+  /* there is no pipeline to provide a clock for the timestamps */
+  clock = gst_system_clock_obtain ();
+  gst_element_set_base_time (udpsrc, gst_clock_get_time (clock));
+  gst_element_set_clock (udpsrc, clock);
+  gst_object_unref (clock);
+
+  for (i = 0; i < N_BATCH_PACKETS; i++) {
+    memset (data, i, sizeof (data));
+    if (g_socket_send_to (socket, sa, (gchar *) data, 100 + i, NULL,
+            &err) == -1)
+      goto send_failure;
+  }
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < N_BATCH_PACKETS)
+    g_cond_wait (&check_cond, &check_mutex);
+
+  GST_INFO ("received %u packets in %u buffer lists", N_BATCH_PACKETS,
+      n_buffer_lists);
+  fail_unless (n_buffer_lists > 0);
+  fail_unless (n_buffer_lists <= N_BATCH_PACKETS);
+
+  /* every packet keeps its own size, content, sender and timestamp */
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    GstBuffer *buf = GST_BUFFER (l->data);
+    GstNetAddressMeta *meta;
+    GstMapInfo map;
+
+    fail_unless_equals_int (gst_buffer_get_size (buf), 100 + i);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.data[0], i);
+    fail_unless_equals_int (map.data[map.size - 1], i);
+    gst_buffer_unmap (buf, &map);
+
+    meta = gst_buffer_get_net_address_meta (buf);
+    fail_unless (meta != NULL);
+    fail_unless (G_IS_INET_SOCKET_ADDRESS (meta->addr));
+
+    /* only the socket timestamps can set a DTS without do-timestamp */
+    if (do_timestamp) {
+      fail_unless (GST_BUFFER_DTS_IS_VALID (buf));
+      fail_unless (GST_BUFFER_PTS_IS_VALID (buf));
+    } else {
+      fail_if (GST_BUFFER_PTS_IS_VALID (buf));
+    }
+  }
+  g_mutex_unlock (&check_mutex);
+
+no_socket:
+send_failure:
+  if (err) {
+    GST_WARNING ("Socket send error, skipping test: %s", err->message);
+    g_clear_error (&err);
+  }
+
+  gst_element_set_state (udpsrc, GST_STATE_NULL);
+
+  gst_check_drop_buffers ();
+  gst_check_teardown_pad_by_name (udpsrc, "src");
+  gst_check_teardown_element (udpsrc);
+
+  g_object_unref (socket);
+  g_object_unref (sa);
+}
+
+GST_END_TEST;
+
+#define N_PERF_PACKETS 20000
+
+/* Not a pass/fail test: logs packets/sec and CPU time per packet for single
+ * and batched receive. Run with GST_DEBUG=check:4 to see the numbers. */
+static void
+udpsrc_measure_throughput (guint batch_size)
+{
+  GSocketAddress *sa = NULL;
+  GstElement *udpsrc = NULL;
+  GSocket *socket = NULL;
+  GstPad *sinkpad = NULL;
+  GError *err = NULL;
+  gchar data[1400] = { 0, };
+  gint64 start, end, deadline;
+  clock_t cpu_start, cpu_end;
+  guint i, received;
+
+  n_buffer_lists = 0;
+
+  if (!udpsrc_setup_full (&udpsrc, &socket, &sinkpad, &sa, batch_size))
+    goto no_socket;
+
+  gst_pad_set_chain_list_function (sinkpad, udpsrc_chain_list);
+
+  start = g_get_monotonic_time ();
+  cpu_start = clock ();
+
+  for (i = 0; i < N_PERF_PACKETS; i++) {
+    if (g_socket_send_to (socket, sa, data, sizeof (data), NULL, &err) == -1)
+      goto send_failure;
+    /* give the receiver a chance so we don't just measure kernel drops */
+    if (i % 64 == 63)
+      g_usleep (100);
+  }
+
+  deadline = g_get_monotonic_time () + G_TIME_SPAN_SECOND;
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < N_PERF_PACKETS)
+    if (!g_cond_wait_until (&check_cond, &check_mutex, deadline))
+      break;
+  received = g_list_length (buffers);
+  g_mutex_unlock (&check_mutex);
+
+  end = g_get_monotonic_time ();
+  cpu_end = clock ();
+
+  fail_unless (received > 0);
+
+  GST_INFO ("batch-size %u: %u/%u packets in %u lists, %.0f packets/s, "
+      "%.3f us CPU per packet", batch_size, received, N_PERF_PACKETS,
+      n_buffer_lists, received * (gdouble) G_USEC_PER_SEC / (end - start),
+      (cpu_end - cpu_start) * (gdouble) G_USEC_PER_SEC /
+      CLOCKS_PER_SEC / received);
+
+no_socket:
+send_failure:
+  if (err) {
+    GST_WARNING ("Socket send error, skipping test: %s", err->message);
+    g_clear_error (&err);
+  }
+
+  gst_element_set_state (udpsrc, GST_STATE_NULL);
+
+  gst_check_drop_buffers ();
+  gst_check_teardown_pad_by_name (udpsrc, "src");
+  gst_check_teardown_element (udpsrc);
+
+  g_object_unref (socket);
+  g_object_unref (sa);
+}
+
+GST_START_TEST (test_udpsrc_batch_throughput)
+{
+  udpsrc_measure_throughput (1);
+  udpsrc_measure_throughput (32);
+}
+
+GST_END_TEST;
+
 static Suite *
 udpsrc_suite (void)
 {
@@ -256,6 +459,10 @@ udpsrc_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_udpsrc_empty_packet);
   tcase_add_test (tc_chain, test_udpsrc);
+  tcase_add_loop_test (tc_chain, test_udpsrc_batch, 0, 2);
+
+  tcase_add_benchmark (s, test_udpsrc_batch_throughput);
+
   return s;
 }
 